@@ -0,0 +1,160 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  AttitudeController.cpp
+//
+// The combined ADACS controller from ADACSDynamics/INCA_State_Model.m.
+
+#include "AttitudeController.hpp"
+#include "Quaternion.hpp"
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+// defaultControllerGains - the gains from INCA_Dynamics_Solution.m, the same
+// as ExampleControllerGains.inca
+ControllerGains defaultControllerGains()
+{
+    ControllerGains gains;
+    gains.Kb = Mat3::zeros();
+    gains.Kp = Mat3::identity() * 1e-6;
+    gains.Kd = Mat3::identity() * 1e-5;
+    gains.Ko = Mat3::zeros();
+    gains.Ko(0,0) = 1e-3;
+    gains.Ko(1,1) = 1e-3;
+    gains.Ki = Mat3::zeros();
+    gains.rTarget = makeVec3(0.0, 0.0, 1.0);
+    gains.omegaTarget = Vec3();
+    return gains;
+}
+
+// loadControllerGains - reads the controller gains from a config file.
+// All of the keys must be present.
+// @param configFile - the config file to read from.
+// @param gains - output gains.
+// @return - 0 on success, -1 on failure.
+int loadControllerGains(ConfigFile &configFile, ControllerGains *gains)
+{
+    if (configFile.getMat3("Kb", &gains->Kb[0]) != 0 ||
+        configFile.getMat3("Kp", &gains->Kp[0]) != 0 ||
+        configFile.getMat3("Kd", &gains->Kd[0]) != 0 ||
+        configFile.getMat3("Ko", &gains->Ko[0]) != 0 ||
+        configFile.getMat3("Ki", &gains->Ki[0]) != 0 ||
+        configFile.getVec3("rTarget", &gains->rTarget[0]) != 0 ||
+        configFile.getVec3("omegaTarget", &gains->omegaTarget[0]) != 0) {
+        ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+        return -1;
+    }
+
+    if (!(norm(gains->rTarget) > 0.0)) {
+        ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+        return -1;
+    }
+    return 0;
+}
+
+// saveControllerGains - writes the gains to a config file, any other values
+// and comments already in the file are kept.
+// @param path - the config file to write.
+// @param gains - the gains to save.
+// @return - 0 on success, -1 on failure.
+int saveControllerGains(const string &path, const ControllerGains &gains)
+{
+    ConfigFile configFile(path);
+    // a missing file is fine, a new one is made
+    configFile.load();
+
+    configFile.setMat3("Kb", &gains.Kb[0]);
+    configFile.setMat3("Kp", &gains.Kp[0]);
+    configFile.setMat3("Kd", &gains.Kd[0]);
+    configFile.setMat3("Ko", &gains.Ko[0]);
+    configFile.setMat3("Ki", &gains.Ki[0]);
+    configFile.setVec3("rTarget", &gains.rTarget[0]);
+    configFile.setVec3("omegaTarget", &gains.omegaTarget[0]);
+
+    return configFile.save();
+}
+
+template <typename T, typename Time>
+AttitudeControllerT<T, Time>::AttitudeControllerT(const ControllerGains &gains) :
+    gains(gains), bdot(matrixCast<T>(gains.Kb)),
+    pid(matrixCast<T>(gains.Kp), matrixCast<T>(gains.Kd), matrixCast<T>(gains.Ko),
+        matrixCast<T>(gains.Ki), matrixCast<T>(gains.rTarget), matrixCast<T>(gains.omegaTarget))
+{
+}
+
+// reset - clears the controller history
+template <typename T, typename Time>
+void AttitudeControllerT<T, Time>::reset(ControllerStateT<T, Time> *state) const
+{
+    bdot.reset(&state->bdot);
+    pid.reset(&state->pid);
+}
+
+// step - calculates the commanded dipole for the current state.
+// @param state - the controller history.
+// @param x - the attitude state [q; q_dot]
+// @param Binr - the magnetic field in the inertial frame (T)
+// @param rSun - the sun vector in the inertial frame, zero in eclipse.
+// @param t - the current time (s)
+// @param i - the step index.
+// @return - the commanded dipole (A*m^2), the norm is at most ADACS_MAX_DIPOLE
+template <typename T, typename Time>
+Matrix<T, 3, 1> AttitudeControllerT<T, Time>::step(ControllerStateT<T, Time> *state,
+                                                   const Matrix<T, STATE_SIZE, 1> &x,
+                                                   const Vector3 &Binr, const Vector3 &rSun,
+                                                   Time t, long i) const
+{
+    Matrix<T, 4, 1> q;
+    for (int k = 0; k < 4; k++) {
+        q[k] = x[k];
+    }
+
+    // calculate B and the sun vector in the body frame.
+    Vector3 Bbody = quatTrans(q, Binr);
+    Vector3 sunBody = quatTrans(q, rSun);
+
+    // a zero sun vector means the sun can't be seen (eclipse), the PID needs
+    // the sun so only the B-dot controller runs. The PID history keeps up
+    // with the time so the integral does not jump when the sun comes back.
+    Vector3 D = bdot.step(&state->bdot, Bbody, t, i);
+    if (norm(rSun) > T(0)) {
+        D += pid.step(&state->pid, sunBody, Bbody, t, x, i);
+    } else {
+        pid.hold(&state->pid, t, i);
+    }
+
+    // a zero field or sun vector makes the dipole undefined, command nothing.
+    for (int k = 0; k < 3; k++) {
+        if (!std::isfinite(D[k])) {
+            return Vector3();
+        }
+    }
+
+    // Limit magnitude of D
+    T n = norm(D);
+    if (n > T(ADACS_MAX_DIPOLE)) {
+        D *= T(ADACS_MAX_DIPOLE) / n;
+    }
+    return D;
+}
+
+template class AttitudeControllerT<double>;
+template class AttitudeControllerT<float>;
+template class AttitudeControllerT<float, double>;
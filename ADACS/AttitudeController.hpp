@@ -0,0 +1,133 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  AttitudeController.hpp
+//
+// The combined ADACS controller from ADACSDynamics/INCA_State_Model.m.
+// The b-dot and PID dipoles are summed and the norm of the result is clamped
+// to ADACS_MAX_DIPOLE like the MATLAB model does.
+//
+// The gains are loaded from a config file, each 3x3 matrix is stored as a
+// single array key by rows (Kp = [1e-6 0 0; 0 1e-6 0; 0 0 1e-6]) and each
+// vector as a 3 element array (rTarget = [0, 0, 1]).
+// See ExampleControllerGains.inca
+//
+// All of the controller history is in ControllerState, which can be copied
+// freely. step() never allocates memory so the same code can be used for
+// batch simulations and on the flight loop.
+//
+// The gains are always kept in double, AttitudeControllerT<T, Time> rounds
+// them to T and runs the controllers in T with the times in Time. It is
+// compiled for double (AttitudeController), float and float with double
+// times for the flight processors.
+//
+// Example code for use is shown below:
+//
+// ControllerGains gains;
+// if (loadControllerGains(configFile, &gains) != 0) {
+// // handle error
+// }
+// AttitudeController controller(gains);
+// ControllerState state;
+// controller.reset(&state);
+//
+// Vec3 D = controller.step(&state, x, Binr, rSun, t, i);
+
+#ifndef AttitudeController_hpp
+#define AttitudeController_hpp
+
+#include "BdotController.hpp"
+#include "PIDController.hpp"
+#include "ConfigFile.hpp"
+
+// max magnetic dipole the torquers can make (A*m^2)
+#define ADACS_MAX_DIPOLE 0.01
+
+struct ControllerGains {
+    Mat3 Kb;
+    Mat3 Kp;
+    Mat3 Kd;
+    Mat3 Ko;
+    Mat3 Ki;
+    // body axis to point at the sun
+    Vec3 rTarget;
+    // desired rotation rate (rad/s)
+    Vec3 omegaTarget;
+};
+
+// history of both controllers
+template <typename T, typename Time = T>
+struct ControllerStateT {
+    BdotStateT<T, Time> bdot;
+    PIDStateT<T, Time> pid;
+};
+
+typedef ControllerStateT<double> ControllerState;
+
+// defaultControllerGains - the gains from INCA_Dynamics_Solution.m, the same
+// as ExampleControllerGains.inca
+ControllerGains defaultControllerGains();
+
+// loadControllerGains - reads the controller gains from a config file.
+// All of the keys must be present.
+// @param configFile - the config file to read from.
+// @param gains - output gains.
+// @return - 0 on success, -1 on failure.
+int loadControllerGains(ConfigFile &configFile, ControllerGains *gains);
+
+// saveControllerGains - writes the gains to a config file, any other values
+// and comments already in the file are kept.
+// @param path - the config file to write.
+// @param gains - the gains to save.
+// @return - 0 on success, -1 on failure.
+int saveControllerGains(const string &path, const ControllerGains &gains);
+
+template <typename T, typename Time = T>
+class AttitudeControllerT {
+public:
+    typedef Matrix<T, 3, 1> Vector3;
+
+    AttitudeControllerT(const ControllerGains &gains);
+
+    // reset - clears the controller history
+    void reset(ControllerStateT<T, Time> *state) const;
+
+    // step - calculates the commanded dipole for the current state.
+    // @param state - the controller history.
+    // @param x - the attitude state [q; q_dot]
+    // @param Binr - the magnetic field in the inertial frame (T)
+    // @param rSun - the sun vector in the inertial frame, zero in eclipse
+    //               to only run the B-dot controller.
+    // @param t - the current time (s)
+    // @param i - the step index.
+    // @return - the commanded dipole (A*m^2), the norm is at most ADACS_MAX_DIPOLE
+    Vector3 step(ControllerStateT<T, Time> *state, const Matrix<T, STATE_SIZE, 1> &x,
+                 const Vector3 &Binr, const Vector3 &rSun, Time t, long i) const;
+
+    const ControllerGains &getGains() const { return gains; }
+
+private:
+    ControllerGains gains;
+    BdotControllerT<T, Time> bdot;
+    PIDControllerT<T, Time> pid;
+};
+
+typedef AttitudeControllerT<double> AttitudeController;
+
+#endif /* AttitudeController_hpp */
@@ -0,0 +1,197 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  BatchRunner.cpp
+//
+// Runs the jobs of a scenario sweep on a pool of threads.
+
+#include "BatchRunner.hpp"
+#include "Trajectory.hpp"
+#include "Quaternion.hpp"
+
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cmath>
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+// runJob - loads and simulates one job of a sweep to its run time.
+// @return - 0 on success, -1 if the job failed (see result->status)
+int runJob(const ScenarioSweep &sweep, uint64_t index, BatchResult *result,
+           const string &trajectoryPath)
+{
+    result->status = BATCH_JOB_BAD_SCENARIO;
+    result->t = 0.0;
+    result->steps = 0;
+    result->rejected = 0;
+    result->evaluations = 0;
+    result->pointing = 0.0;
+    result->rate = 0.0;
+
+    ConfigFile configFile("");
+    Scenario scenario = defaultScenario();
+    if (sweep.job(index, &configFile) != 0 || loadScenario(configFile, &scenario) != 0) {
+        return -1;
+    }
+    scenario.sim.statusInterval = 0;
+
+    Simulator sim(scenario.sim, scenario.gains);
+    sim.init(scenario.x0);
+    TrajectoryWriter writer;
+    if (!trajectoryPath.empty()) {
+        if (writer.open(trajectoryPath, trajectoryHeader(scenario.sim, scenario.gains)) != 0) {
+            result->status = BATCH_JOB_TRAJECTORY_FAILED;
+            return -1;
+        }
+        writer.write(sim.getState());
+        sim.setOutputHandler([&](const SimulatorState &s) { writer.write(s); });
+    }
+    int ret = sim.run(scenario.sim.runTime);
+    bool written = writer.close() == 0;
+
+    const SimulatorState &state = sim.getState();
+    result->status = BATCH_JOB_OK;
+    if (ret != 0) {
+        result->status = BATCH_JOB_DIVERGED;
+    } else if (!written) {
+        result->status = BATCH_JOB_TRAJECTORY_FAILED;
+    }
+    result->t = state.t;
+    result->steps = state.i - 1;
+    result->rejected = state.rejected;
+    result->evaluations = state.evaluations;
+
+    Vec4 q, qDot;
+    for (int k = 0; k < 4; k++) {
+        q[k] = state.w[k];
+        qDot[k] = state.w[k + 4];
+    }
+    const SimulatorConfig &config = scenario.sim;
+    Vec3 rSun = sunDirection(config.sunModel, config.rSun, config.epochJD, state.t);
+    result->pointing = pointingAngle(q, rSun, scenario.gains.rTarget);
+    result->rate = norm(2.0 * (Xi(q).transpose() * qDot)) * 180 / M_PI;
+
+    return result->status == BATCH_JOB_OK ? 0 : -1;
+}
+
+// formatRow - one line of the results table
+static string formatRow(const ScenarioSweep &sweep, uint64_t index, const BatchResult &result)
+{
+    vector<string> values;
+    sweep.jobValues(index, &values);
+
+    string row = to_string(index);
+    for (size_t k = 0; k < values.size(); k++) {
+        // the columns are split by spaces, so arrays are written without them
+        string value = values[k];
+        value.erase(remove_if(value.begin(), value.end(), ::isspace), value.end());
+        row += " " + value;
+    }
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), " %d %.9g %ld %ld %ld %.9g %.9g\n", result.status, result.t,
+             result.steps, result.rejected, result.evaluations, result.pointing, result.rate);
+    return row + buffer;
+}
+
+// runBatch - runs every job of the sweep and writes the results table.
+// @return - the number of jobs that failed, -1 if the table can't be written.
+long runBatch(const ScenarioSweep &sweep, const string &resultsPath, int threads,
+              const string &trajectoryDir)
+{
+    if (threads <= 0) {
+        threads = thread::hardware_concurrency();
+        if (threads <= 0) { threads = 1; }
+    }
+
+    ofstream out(resultsPath.c_str(), ios::trunc);
+    if (!out.is_open()) {
+        ErrorManager::ERROR(ADACS_BATCH_RESULTS_WRITE_FAILED);
+        return -1;
+    }
+    out << "# job";
+    for (size_t k = 0; k < sweep.getAxes().size(); k++) {
+        out << " " << sweep.getAxes()[k].key;
+    }
+    out << " status t steps rejected evaluations pointing rate" << endl;
+
+    const uint64_t jobs = sweep.size();
+    const uint64_t window = (uint64_t)threads * BATCH_WINDOW_PER_THREAD;
+
+    // everything below is guarded by lock
+    mutex lock;
+    condition_variable ready;
+    uint64_t next = 0;
+    uint64_t written = 0;
+    long failed = 0;
+    // finished rows waiting for the jobs before them
+    map<uint64_t, string> pending;
+
+    auto worker = [&]() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            ready.wait(guard, [&]() { return next >= jobs || next < written + window; });
+            if (next >= jobs) {
+                return;
+            }
+            uint64_t index = next++;
+            guard.unlock();
+
+            BatchResult result;
+            string trajectoryPath;
+            if (!trajectoryDir.empty()) {
+                trajectoryPath = trajectoryDir + "/job" + to_string(index) + ".traj";
+            }
+            int ret = runJob(sweep, index, &result, trajectoryPath);
+            string row = formatRow(sweep, index, result);
+
+            guard.lock();
+            failed += ret != 0;
+            pending[index] = row;
+            map<uint64_t, string>::iterator itr;
+            while ((itr = pending.find(written)) != pending.end()) {
+                out << itr->second;
+                pending.erase(itr);
+                written++;
+            }
+            ready.notify_all();
+        }
+    };
+
+    vector<thread> pool;
+    for (int k = 1; k < threads; k++) {
+        pool.push_back(thread(worker));
+    }
+    worker();
+    for (size_t k = 0; k < pool.size(); k++) {
+        pool[k].join();
+    }
+
+    out.close();
+    if (!out) {
+        ErrorManager::ERROR(ADACS_BATCH_RESULTS_WRITE_FAILED);
+        return -1;
+    }
+    return failed;
+}
@@ -0,0 +1,93 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  BatchRunner.hpp
+//
+// Runs every job of a ScenarioSweep on a pool of threads and writes one
+// results table, one line per job in job order:
+//
+//  job <swept values> status t steps rejected evaluations pointing rate
+//
+// Swept arrays are written without their spaces. status is BATCH_JOB_OK,
+// BATCH_JOB_DIVERGED, BATCH_JOB_BAD_SCENARIO or BATCH_JOB_TRAJECTORY_FAILED,
+// pointing is the final angle
+// between the sun and rTarget in the body frame (deg) and rate is the final
+// rotation rate (deg/s).
+//
+// Jobs are made from the sweep as the threads take them, and a finished job
+// only waits in memory until the jobs before it are written. A thread never
+// runs more than BATCH_WINDOW_PER_THREAD jobs ahead of the oldest unwritten
+// job per thread, so the memory used does not grow with the size of the sweep.
+//
+// Example code for use is shown below:
+//
+// ScenarioSweep sweep;
+// sweep.load(scenarioFile);
+// int failed = runBatch(sweep, "results.txt", 0);
+
+#ifndef BatchRunner_hpp
+#define BatchRunner_hpp
+
+#include <string>
+#include <cstdint>
+
+#include "Scenario.hpp"
+
+using namespace std;
+
+#define BATCH_JOB_OK 0
+#define BATCH_JOB_DIVERGED 1
+#define BATCH_JOB_BAD_SCENARIO 2
+#define BATCH_JOB_TRAJECTORY_FAILED 3
+
+// how far ahead of the results table each thread can run
+#define BATCH_WINDOW_PER_THREAD 4
+
+// the results of one job
+struct BatchResult {
+    int status;
+    double t;
+    long steps;
+    long rejected;
+    long evaluations;
+    // final pointing error (deg) and rotation rate (deg/s)
+    double pointing;
+    double rate;
+};
+
+// runJob - loads and simulates one job of a sweep to its run time.
+// @param sweep - the sweep
+// @param index - job number, 0 to sweep.size() - 1
+// @param result - output results.
+// @param trajectoryPath - trajectory file to write, empty for none.
+// @return - 0 on success, -1 if the job failed (see result->status)
+int runJob(const ScenarioSweep &sweep, uint64_t index, BatchResult *result,
+           const string &trajectoryPath = "");
+
+// runBatch - runs every job of the sweep and writes the results table.
+// @param sweep - the sweep
+// @param resultsPath - the results table to write.
+// @param threads - number of threads, 0 for one per core.
+// @param trajectoryDir - directory for the trajectory of every job, empty
+//                        for none.
+// @return - the number of jobs that failed, -1 if the table can't be written.
+long runBatch(const ScenarioSweep &sweep, const string &resultsPath, int threads,
+              const string &trajectoryDir = "");
+
+#endif /* BatchRunner_hpp */
@@ -0,0 +1,96 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  BdotController.cpp
+//
+// B-dot detumble controller, the C++ version of
+// ADACSDynamics/INCA_Bdot_Controller.m
+
+#include "BdotController.hpp"
+
+// constructor for the controller
+// @param Kb - b-dot gain matrix
+template <typename T, typename Time>
+BdotControllerT<T, Time>::BdotControllerT(const Matrix3 &Kb) : Kb(Kb)
+{
+}
+
+// reset - clears the controller history
+template <typename T, typename Time>
+void BdotControllerT<T, Time>::reset(BdotStateT<T, Time> *state) const
+{
+    state->Bold = Vector3();
+    state->told = Time(0);
+    state->Dold = Vector3();
+    state->iOld = 0;
+    state->initialized = false;
+}
+
+// step - calculates the commanded dipole.
+// @param state - the controller history.
+// @param B - the magnetic field in the body frame (T)
+// @param t - the current time (s)
+// @param i - the step index.
+// @return - the commanded dipole (A*m^2)
+template <typename T, typename Time>
+Matrix<T, 3, 1> BdotControllerT<T, Time>::step(BdotStateT<T, Time> *state, const Vector3 &B,
+                                               Time t, long i) const
+{
+    if (!state->initialized || t == Time(0)) {
+        state->Bold = B;
+        state->told = Time(0);
+        state->Dold = Vector3();
+        state->iOld = 0;
+        state->initialized = true;
+    }
+
+    T delT = T(t - state->told);
+
+    Vector3 Bdot;
+    for (int k = 0; k < 3; k++) {
+        Bdot[k] = (B[k] - state->Bold[k]) / delT;
+    }
+
+    T normB = norm(B);
+    Vector3 D = Kb * Bdot;
+    for (int k = 0; k < 3; k++) {
+        D[k] = D[k] / normB;
+    }
+
+    if (std::isnan(D[0]) || std::isnan(D[1]) || std::isnan(D[2])) {
+        D = Vector3();
+    }
+
+    if (delT <= T(0)) {
+        D = state->Dold;
+    }
+
+    if (state->iOld < i) {
+        state->Bold = B;
+        state->told = t;
+        state->Dold = D;
+        state->iOld = i;
+    }
+
+    return D;
+}
+
+template class BdotControllerT<double>;
+template class BdotControllerT<float>;
+template class BdotControllerT<float, double>;
@@ -0,0 +1,93 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  BdotController.hpp
+//
+// B-dot detumble controller, the C++ version of
+// ADACSDynamics/INCA_Bdot_Controller.m
+//
+// D = Kb * (B - B_old) / del_t / norm(B)
+//
+// The MATLAB version keeps its history in persistent variables. Here the
+// controller only holds the gains and the history is kept in a BdotState that
+// is passed in, so any number of controllers can be run side by side.
+// Nothing in here allocates memory.
+//
+// BdotControllerT<T, Time> does the math in T and keeps the times in Time,
+// it is compiled for double (BdotController), float and float with double
+// times. A float time of 16 hours is only good to 4 ms, so del_t found from
+// two float times is off by that much.
+//
+// Example code for use is shown below:
+//
+// BdotController bdot(Kb);
+// BdotState state;
+// bdot.reset(&state);
+//
+// Vec3 D = bdot.step(&state, Bbody, t, i);
+
+#ifndef BdotController_hpp
+#define BdotController_hpp
+
+#include "Matrix.hpp"
+
+// history of the b-dot controller (the MATLAB persistent variables)
+template <typename T, typename Time = T>
+struct BdotStateT {
+    Matrix<T, 3, 1> Bold;
+    Time told;
+    Matrix<T, 3, 1> Dold;
+    long iOld;
+    bool initialized;
+};
+
+template <typename T, typename Time = T>
+class BdotControllerT {
+public:
+    typedef Matrix<T, 3, 1> Vector3;
+    typedef Matrix<T, 3, 3> Matrix3;
+
+    // constructor for the controller
+    // @param Kb - b-dot gain matrix
+    BdotControllerT(const Matrix3 &Kb);
+
+    // reset - clears the controller history
+    void reset(BdotStateT<T, Time> *state) const;
+
+    // step - calculates the commanded dipole.
+    // The history is only updated the first time step is called with a new
+    // step index i, so calling it again for the same step (integrator stages,
+    // rejected steps) does not change the state.
+    // @param state - the controller history.
+    // @param B - the magnetic field in the body frame (T)
+    // @param t - the current time (s)
+    // @param i - the step index.
+    // @return - the commanded dipole (A*m^2)
+    Vector3 step(BdotStateT<T, Time> *state, const Vector3 &B, Time t, long i) const;
+
+    const Matrix3 &getGain() const { return Kb; }
+
+private:
+    Matrix3 Kb;
+};
+
+typedef BdotStateT<double> BdotState;
+typedef BdotControllerT<double> BdotController;
+
+#endif /* BdotController_hpp */
@@ -0,0 +1,232 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  ControlLoop.cpp
+//
+// Fixed rate periodic executive for the ADACS.
+
+#include "ControlLoop.hpp"
+#include "Timing.hpp"
+
+// for ERROR
+#include <ErrorManager.hpp>
+// for INSTRUMENT_TIMER
+#include <Instrumentation.hpp>
+// for pthread_setaffinity_np and pthread_setschedparam
+#include <pthread.h>
+#include <sched.h>
+#include <cerrno>
+#include <system_error>
+
+// loadControlLoopConfig - reads the control loop settings from a config file.
+// Keys: controlLoopRate, controlLoopCpu, controlLoopPriority. Any key that is
+// missing keeps its default value.
+// @return - 0 on success, -1 if the rate is not positive.
+int loadControlLoopConfig(ConfigFile &configFile, ControlLoopConfig *config)
+{
+    double rate;
+    int value;
+
+    if (configFile.getDouble("controlLoopRate", &rate) == 0) {
+        config->rate = rate;
+    }
+    if (configFile.getInt("controlLoopCpu", &value) == 0) {
+        config->cpu = value;
+    }
+    if (configFile.getInt("controlLoopPriority", &value) == 0) {
+        config->priority = value;
+    }
+
+    if (!(config->rate > 0.0)) {
+        ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+        return -1;
+    }
+    return 0;
+}
+
+ControlLoop::ControlLoop(const ControlLoopConfig &config) : config(config)
+{
+    periodNs = (uint64_t)(1e9 / config.rate + 0.5);
+    running.store(false);
+    cycleCount.store(0);
+    overrunCount.store(0);
+    skippedCount.store(0);
+    stageFailureCount.store(0);
+}
+
+ControlLoop::~ControlLoop()
+{
+    stop();
+}
+
+// setStage - sets the function for one of the CONTROL_STAGE_* stages.
+// Must be called before the loop is started.
+void ControlLoop::setStage(int stage, ControlStage function)
+{
+    if (stage >= 0 && stage < CONTROL_NUM_STAGES) {
+        stages[stage] = function;
+    }
+}
+
+// setupThread - applies the cpu pinning and scheduler settings to the
+// calling thread. Failures are reported but the loop still runs.
+void ControlLoop::setupThread()
+{
+    if (config.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config.cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            ErrorManager::ERROR(ADACS_CONTROL_LOOP_FAILED_TO_SET_AFFINITY);
+        }
+    }
+
+    if (config.priority > 0) {
+        struct sched_param param;
+        param.sched_priority = config.priority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+            ErrorManager::ERROR(ADACS_CONTROL_LOOP_FAILED_TO_SET_PRIORITY);
+        }
+    }
+}
+
+// run - runs the loop on the calling thread for the given number of cycles.
+// @return - 0 on success, -1 on failure.
+int ControlLoop::run(long cycles)
+{
+    if (running.exchange(true)) {
+        return -1;
+    }
+    setupThread();
+    loop(cycles);
+    running.store(false);
+    return 0;
+}
+
+// start - runs the loop on its own thread until stop() is called.
+// @return - 0 on success, -1 on failure.
+int ControlLoop::start()
+{
+    if (running.exchange(true)) {
+        return -1;
+    }
+
+    try {
+        loopThread = thread([this]() {
+            setupThread();
+            loop(-1);
+        });
+    } catch (const system_error &e) {
+        running.store(false);
+        ErrorManager::ERROR(ADACS_CONTROL_LOOP_FAILED_TO_START);
+        return -1;
+    }
+    return 0;
+}
+
+void ControlLoop::stop()
+{
+    running.store(false);
+    if (loopThread.joinable()) {
+        loopThread.join();
+    }
+}
+
+// loop - the periodic executive.
+// @param cycles - number of cycles to run, -1 to run until stopped.
+void ControlLoop::loop(long cycles)
+{
+    uint64_t start = monotonicNs();
+    // index of the deadline the current cycle belongs to.
+    long index = 0;
+    long lastIndex = 0;
+    uint64_t lastWake = start;
+    long ran = 0;
+
+    while (running.load(memory_order_relaxed) && (cycles < 0 || ran < cycles)) {
+        uint64_t deadline = start + (uint64_t)index * periodNs;
+
+        // sleep to the absolute deadline, retrying if interrupted by a signal.
+        struct timespec ts = nsToTimespec(deadline);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+
+        uint64_t wake = monotonicNs();
+        wakeJitter.record(wake > deadline ? wake - deadline : 0);
+        if (index > 0) {
+            uint64_t period = wake - lastWake;
+            uint64_t nominal = (uint64_t)(index - lastIndex) * periodNs;
+            periodJitter.record(period > nominal ? period - nominal : nominal - period);
+        }
+        lastWake = wake;
+
+        double t = (double)index * (double)periodNs * 1e-9;
+        double dt = (double)(index - lastIndex) * (double)periodNs * 1e-9;
+
+        uint64_t stageStart = wake;
+        {
+            // the cycle body in the process wide probe report, next to the
+            // probes of the code the stages call
+            INSTRUMENT_TIMER("ControlLoop::cycle");
+            for (int s = 0; s < CONTROL_NUM_STAGES; s++) {
+                if (stages[s]) {
+                    if (stages[s](t, dt) != 0) {
+                        stageFailureCount.fetch_add(1);
+                        ErrorManager::ERROR(ADACS_CONTROL_LOOP_STAGE_FAILED);
+                    }
+                }
+                uint64_t stageEnd = monotonicNs();
+                stageTime[s].record(stageEnd - stageStart);
+                stageStart = stageEnd;
+            }
+        }
+        cycleTime.record(stageStart - wake);
+
+        cycleCount.fetch_add(1);
+        ran++;
+        lastIndex = index;
+        index++;
+
+        // check if the cycle ran past the next deadline, skip any cycles missed.
+        uint64_t next = start + (uint64_t)index * periodNs;
+        if (stageStart > next) {
+            overrunCount.fetch_add(1);
+            INSTRUMENT_COUNT("ControlLoop::overrun", 1);
+            ErrorManager::ERROR(ADACS_CONTROL_LOOP_DEADLINE_OVERRUN);
+            long behind = (long)((stageStart - next) / periodNs) + 1;
+            skippedCount.fetch_add(behind);
+            index += behind;
+        }
+    }
+}
+
+// printStatistics - prints all of the histograms
+void ControlLoop::printStatistics()
+{
+    const char *names[CONTROL_NUM_STAGES] = {"sense (ns)", "estimate (ns)", "control (ns)", "actuate (ns)"};
+
+    cout << "Control loop: rate = " << config.rate << " Hz, cycles = " << getCycleCount()
+         << ", overruns = " << getOverrunCount() << ", skipped = " << getSkippedCount()
+         << ", stage failures = " << getStageFailureCount() << endl;
+    for (int s = 0; s < CONTROL_NUM_STAGES; s++) {
+        stageTime[s].print(names[s]);
+    }
+    cycleTime.print("cycle (ns)");
+    wakeJitter.print("wake jitter (ns)");
+    periodJitter.print("period jitter (ns)");
+}
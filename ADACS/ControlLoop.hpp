@@ -0,0 +1,150 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  ControlLoop.hpp
+//
+// Fixed rate periodic executive for the ADACS.
+// Each cycle runs the sense -> estimate -> control -> actuate stages in order.
+// The loop sleeps to absolute deadlines (clock_nanosleep with TIMER_ABSTIME)
+// so the period does not drift with the stage execution time, and every stage
+// is given the nominal time of the cycle (t = cycle * period) and the fixed
+// time step instead of reading the clock itself. This keeps the controllers
+// independent of how the thread happened to be scheduled.
+//
+// The execution time of each stage, the whole cycle, and the wake up jitter
+// are recorded in lock-free histograms. If a cycle runs past the next deadline
+// ADACS_CONTROL_LOOP_DEADLINE_OVERRUN is reported and the missed cycles are
+// skipped (the next stage call will see the larger dt).
+//
+// Example code for use is shown below:
+//
+// ControlLoopConfig config;
+// loadControlLoopConfig(configFile, &config);
+// ControlLoop loop(config);
+// loop.setStage(CONTROL_STAGE_SENSE, [&](double t, double dt) { return readSensors(); });
+// loop.setStage(CONTROL_STAGE_CONTROL, [&](double t, double dt) { return runController(t, dt); });
+// if (loop.start() != 0) {
+// // handle error
+// }
+// ...
+// loop.stop();
+// loop.printStatistics();
+
+#ifndef ControlLoop_hpp
+#define ControlLoop_hpp
+
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <cstdint>
+
+#include "Histogram.hpp"
+#include "ConfigFile.hpp"
+
+using namespace std;
+
+#define CONTROL_STAGE_SENSE 0
+#define CONTROL_STAGE_ESTIMATE 1
+#define CONTROL_STAGE_CONTROL 2
+#define CONTROL_STAGE_ACTUATE 3
+#define CONTROL_NUM_STAGES 4
+
+// a stage of the control loop
+// @param t - nominal time of the cycle (s)
+// @param dt - time since the last cycle that ran (s)
+// @return - 0 on success, anything else is counted as a stage failure.
+typedef function<int(double t, double dt)> ControlStage;
+
+struct ControlLoopConfig {
+    // loop rate (Hz)
+    double rate;
+    // cpu to pin the loop thread to, -1 to not pin.
+    int cpu;
+    // SCHED_FIFO priority (1-99), 0 to keep the normal scheduler.
+    int priority;
+
+    ControlLoopConfig() : rate(10.0), cpu(-1), priority(0) {}
+};
+
+// loadControlLoopConfig - reads the control loop settings from a config file.
+// Keys: controlLoopRate, controlLoopCpu, controlLoopPriority. Any key that is
+// missing keeps its default value.
+// @return - 0 on success, -1 if the rate is not positive.
+int loadControlLoopConfig(ConfigFile &configFile, ControlLoopConfig *config);
+
+class ControlLoop {
+public:
+    ControlLoop(const ControlLoopConfig &config);
+    ~ControlLoop();
+
+    // setStage - sets the function for one of the CONTROL_STAGE_* stages.
+    // Must be called before the loop is started.
+    void setStage(int stage, ControlStage function);
+
+    // run - runs the loop on the calling thread for the given number of cycles.
+    // @return - 0 on success, -1 on failure.
+    int run(long cycles);
+
+    // start - runs the loop on its own thread until stop() is called.
+    // @return - 0 on success, -1 on failure.
+    int start();
+    void stop();
+
+    long getCycleCount() const { return cycleCount.load(); }
+    long getOverrunCount() const { return overrunCount.load(); }
+    long getSkippedCount() const { return skippedCount.load(); }
+    long getStageFailureCount() const { return stageFailureCount.load(); }
+
+    // execution time of each stage (ns)
+    const Histogram &getStageHistogram(int stage) const { return stageTime[stage]; }
+    // execution time of the full cycle (ns)
+    const Histogram &getCycleHistogram() const { return cycleTime; }
+    // how late the loop woke up after each deadline (ns)
+    const Histogram &getWakeJitterHistogram() const { return wakeJitter; }
+    // difference between the measured and nominal period (ns)
+    const Histogram &getPeriodJitterHistogram() const { return periodJitter; }
+
+    // printStatistics - prints all of the histograms
+    void printStatistics();
+
+private:
+    ControlLoopConfig config;
+    uint64_t periodNs;
+    ControlStage stages[CONTROL_NUM_STAGES];
+
+    thread loopThread;
+    atomic<bool> running;
+
+    atomic<long> cycleCount;
+    atomic<long> overrunCount;
+    atomic<long> skippedCount;
+    atomic<long> stageFailureCount;
+
+    Histogram stageTime[CONTROL_NUM_STAGES];
+    Histogram cycleTime;
+    Histogram wakeJitter;
+    Histogram periodJitter;
+
+    // setupThread - applies the cpu pinning and scheduler settings to the
+    // calling thread.
+    void setupThread();
+    void loop(long cycles);
+};
+
+#endif /* ControlLoop_hpp */
@@ -0,0 +1,220 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Dual.hpp
+//
+// Forward mode automatic differentiation with dual numbers.
+// A Dual<N> carries a value and its N partial derivatives, every operation
+// applies the chain rule to all of them at once. Code written for a
+// template type T (Matrix, Quaternion.hpp, StateModel::derivative) gives
+// its exact jacobian when it is evaluated on Dual<N> with the inputs seeded
+// by Dual<N>::variable(). Like Matrix, the derivatives are stored inside of
+// the object so nothing allocates memory.
+//
+// Example code for use is shown below:
+//
+// Dual<2> x = Dual<2>::variable(3.0, 0);
+// Dual<2> y = Dual<2>::variable(0.5, 1);
+// Dual<2> f = x * sin(y);
+// // f.value = 3 * sin(0.5), f.d[0] = sin(0.5), f.d[1] = 3 * cos(0.5)
+
+#ifndef Dual_hpp
+#define Dual_hpp
+
+#include <cmath>
+
+#include "Matrix.hpp"
+
+template <int N>
+class Dual {
+public:
+    // constructor for a constant, all of the derivatives are zero.
+    Dual(double value = 0.0) : value(value) {
+        for (int i = 0; i < N; i++) { d[i] = 0.0; }
+    }
+
+    // variable - the i'th input variable, d/dx_i = 1.
+    static Dual variable(double value, int i) {
+        Dual x(value);
+        x.d[i] = 1.0;
+        return x;
+    }
+
+    Dual &operator+=(const Dual &b) {
+        value += b.value;
+        for (int i = 0; i < N; i++) { d[i] += b.d[i]; }
+        return *this;
+    }
+    Dual &operator-=(const Dual &b) {
+        value -= b.value;
+        for (int i = 0; i < N; i++) { d[i] -= b.d[i]; }
+        return *this;
+    }
+    Dual &operator*=(const Dual &b) {
+        for (int i = 0; i < N; i++) { d[i] = d[i] * b.value + value * b.d[i]; }
+        value *= b.value;
+        return *this;
+    }
+    Dual &operator/=(const Dual &b) {
+        double inv = 1.0 / b.value;
+        value *= inv;
+        for (int i = 0; i < N; i++) { d[i] = (d[i] - value * b.d[i]) * inv; }
+        return *this;
+    }
+
+    // constants skip the derivatives of the other side
+    Dual &operator*=(double s) {
+        value *= s;
+        for (int i = 0; i < N; i++) { d[i] *= s; }
+        return *this;
+    }
+
+    // the binary operators write the result directly, copying an operand
+    // first is most of the time for small N
+    friend Dual operator+(const Dual &a, const Dual &b) {
+        Dual r(a.value + b.value, 0);
+        for (int i = 0; i < N; i++) { r.d[i] = a.d[i] + b.d[i]; }
+        return r;
+    }
+    friend Dual operator-(const Dual &a, const Dual &b) {
+        Dual r(a.value - b.value, 0);
+        for (int i = 0; i < N; i++) { r.d[i] = a.d[i] - b.d[i]; }
+        return r;
+    }
+    friend Dual operator*(const Dual &a, const Dual &b) {
+        Dual r(a.value * b.value, 0);
+        for (int i = 0; i < N; i++) { r.d[i] = a.d[i] * b.value + a.value * b.d[i]; }
+        return r;
+    }
+    friend Dual operator/(Dual a, const Dual &b) { a /= b; return a; }
+    friend Dual operator*(Dual a, double s) { a *= s; return a; }
+    friend Dual operator*(double s, Dual a) { a *= s; return a; }
+    friend Dual operator-(Dual a) { a *= -1.0; return a; }
+
+    // comparisons only look at the value
+    friend bool operator<(const Dual &a, const Dual &b) { return a.value < b.value; }
+    friend bool operator>(const Dual &a, const Dual &b) { return a.value > b.value; }
+    friend bool operator<=(const Dual &a, const Dual &b) { return a.value <= b.value; }
+    friend bool operator>=(const Dual &a, const Dual &b) { return a.value >= b.value; }
+    friend bool operator==(const Dual &a, const Dual &b) { return a.value == b.value; }
+    friend bool operator!=(const Dual &a, const Dual &b) { return a.value != b.value; }
+
+    double value;
+    double d[N];
+
+private:
+    // constructor that leaves the derivatives to the caller.
+    Dual(double value, int) : value(value) {}
+};
+
+// chain - f(a) given f(a.value) and f'(a.value)
+template <int N>
+Dual<N> chain(const Dual<N> &a, double f, double fPrime)
+{
+    Dual<N> r(f);
+    for (int i = 0; i < N; i++) { r.d[i] = fPrime * a.d[i]; }
+    return r;
+}
+
+template <int N>
+Dual<N> sqrt(const Dual<N> &a)
+{
+    double s = std::sqrt(a.value);
+    return chain(a, s, 0.5 / s);
+}
+
+template <int N>
+Dual<N> sin(const Dual<N> &a) { return chain(a, std::sin(a.value), std::cos(a.value)); }
+
+template <int N>
+Dual<N> cos(const Dual<N> &a) { return chain(a, std::cos(a.value), -std::sin(a.value)); }
+
+template <int N>
+Dual<N> fabs(const Dual<N> &a) { return a.value < 0.0 ? -a : a; }
+
+// operator* - matrix product that sums into the result in place instead of
+// making a Dual for every product.
+template <int N, int R, int K, int C>
+Matrix<Dual<N>, R, C> operator*(const Matrix<Dual<N>, R, K> &a, const Matrix<Dual<N>, K, C> &b)
+{
+    Matrix<Dual<N>, R, C> m;
+    for (int r = 0; r < R; r++) {
+        for (int k = 0; k < K; k++) {
+            const Dual<N> &ark = a(r, k);
+            for (int c = 0; c < C; c++) {
+                const Dual<N> &bkc = b(k, c);
+                Dual<N> &out = m(r, c);
+                out.value += ark.value * bkc.value;
+                for (int i = 0; i < N; i++) {
+                    out.d[i] += ark.d[i] * bkc.value + ark.value * bkc.d[i];
+                }
+            }
+        }
+    }
+    return m;
+}
+
+// operator* - product with a constant matrix, which has no derivatives.
+template <int N, int R, int K, int C>
+Matrix<Dual<N>, R, C> operator*(const Matrix<double, R, K> &a, const Matrix<Dual<N>, K, C> &b)
+{
+    Matrix<Dual<N>, R, C> m;
+    for (int r = 0; r < R; r++) {
+        for (int k = 0; k < K; k++) {
+            double ark = a(r, k);
+            for (int c = 0; c < C; c++) {
+                const Dual<N> &bkc = b(k, c);
+                Dual<N> &out = m(r, c);
+                out.value += ark * bkc.value;
+                for (int i = 0; i < N; i++) {
+                    out.d[i] += ark * bkc.d[i];
+                }
+            }
+        }
+    }
+    return m;
+}
+
+// autoJacobian - evaluates f once on dual numbers to get y = f(x) and the
+// exact jacobian J = dy/dx.
+// @param f - function taking Matrix<Dual<N>, N, 1> and returning
+//            Matrix<Dual<N>, M, 1>
+// @param x - the point to evaluate at.
+// @param y - output value, NULL to skip it.
+// @param J - output M x N jacobian.
+template <int M, int N, typename Function>
+void autoJacobian(const Function &f, const Matrix<double, N, 1> &x,
+                  Matrix<double, M, 1> *y, Matrix<double, M, N> *J)
+{
+    Matrix<Dual<N>, N, 1> xd;
+    for (int j = 0; j < N; j++) {
+        xd[j] = Dual<N>::variable(x[j], j);
+    }
+    Matrix<Dual<N>, M, 1> yd = f(xd);
+    for (int i = 0; i < M; i++) {
+        if (y != NULL) {
+            (*y)[i] = yd[i].value;
+        }
+        for (int j = 0; j < N; j++) {
+            (*J)(i, j) = yd[i].d[j];
+        }
+    }
+}
+
+#endif /* Dual_hpp */
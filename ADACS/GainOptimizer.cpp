@@ -0,0 +1,399 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  GainOptimizer.cpp
+//
+// Parallel CMA-ES search of the controller gains.
+
+#include "GainOptimizer.hpp"
+#include "Quaternion.hpp"
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+// defaultGainSearchSpace - searches Kp, Kd and Ko with the structure of the
+// gains in INCA_Dynamics_Solution.m, Kb and Ki are kept at the base gains.
+GainSearchSpace defaultGainSearchSpace()
+{
+    GainSearchSpace space;
+    for (int k = 0; k < NUM_GAIN_PARAMETERS; k++) {
+        space.enabled[k] = false;
+        space.structure[k] = Mat3::identity();
+    }
+    space.lower[GAIN_KB] = -2; space.upper[GAIN_KB] = 2;
+    space.lower[GAIN_KP] = -8; space.upper[GAIN_KP] = -4;
+    space.lower[GAIN_KD] = -7; space.upper[GAIN_KD] = -3;
+    space.lower[GAIN_KO] = -5; space.upper[GAIN_KO] = -1;
+    space.lower[GAIN_KI] = -12; space.upper[GAIN_KI] = -8;
+
+    space.structure[GAIN_KO](2,2) = 0.0;
+    space.structure[GAIN_KI](2,2) = 1.0 / 3;
+
+    space.enabled[GAIN_KP] = true;
+    space.enabled[GAIN_KD] = true;
+    space.enabled[GAIN_KO] = true;
+    return space;
+}
+
+// defaultOptimizerConfig - the reference scenario for 2 hours with the lie
+// group integrator, which is the fastest one (see integratorBenchmark).
+OptimizerConfig defaultOptimizerConfig()
+{
+    OptimizerConfig config;
+    config.sim = defaultSimulatorConfig();
+    config.sim.integrator = SIM_INTEGRATOR_LIE_GROUP;
+    config.sim.statusInterval = 0;
+    config.x0 = defaultInitialState();
+    config.horizon = 2 * 3600;
+    config.settleAngle = 10;
+    config.wSettle = 1;
+    config.wPointing = 1.0 / 90;
+    config.wEffort = 0.1;
+    config.rejectFactor = 2;
+    config.population = 0;
+    config.generations = 30;
+    config.threads = 0;
+    config.sigma0 = 0.3;
+    config.seed = 1;
+    config.verbose = true;
+    return config;
+}
+
+// loadOptimizerConfig - reads the optimizer settings from a config file,
+// the simulator settings are read with loadSimulatorConfig().
+// @return - 0 on success, -1 on failure.
+int loadOptimizerConfig(ConfigFile &configFile, OptimizerConfig *config)
+{
+    if (loadSimulatorConfig(configFile, &config->sim) != 0) {
+        return -1;
+    }
+
+    double value;
+    int intValue;
+    long longValue;
+
+    if (configFile.getDouble("optHorizon", &value) == 0) {
+        config->horizon = value;
+    }
+    if (configFile.getDouble("optSettleAngle", &value) == 0) {
+        config->settleAngle = value;
+    }
+    if (configFile.getDouble("optWeightSettle", &value) == 0) {
+        config->wSettle = value;
+    }
+    if (configFile.getDouble("optWeightPointing", &value) == 0) {
+        config->wPointing = value;
+    }
+    if (configFile.getDouble("optWeightEffort", &value) == 0) {
+        config->wEffort = value;
+    }
+    if (configFile.getDouble("optRejectFactor", &value) == 0) {
+        config->rejectFactor = value;
+    }
+    if (configFile.getInt("optPopulation", &intValue) == 0) {
+        config->population = intValue;
+    }
+    if (configFile.getInt("optGenerations", &intValue) == 0) {
+        config->generations = intValue;
+    }
+    if (configFile.getInt("optThreads", &intValue) == 0) {
+        config->threads = intValue;
+    }
+    if (configFile.getLong("optSeed", &longValue) == 0) {
+        config->seed = (uint64_t)longValue;
+    }
+
+    if (!(config->horizon > 0.0) || !(config->rejectFactor >= 1.0) || config->generations < 0) {
+        ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+        return -1;
+    }
+    return 0;
+}
+
+// gainsFromParameters - the gains for the point x in the search space
+ControllerGains gainsFromParameters(const GainSearchSpace &space, const ControllerGains &base,
+                                    const double *x)
+{
+    ControllerGains gains = base;
+    Mat3 *matrices[NUM_GAIN_PARAMETERS] = {&gains.Kb, &gains.Kp, &gains.Kd, &gains.Ko, &gains.Ki};
+    for (int k = 0; k < NUM_GAIN_PARAMETERS; k++) {
+        if (space.enabled[k]) {
+            *matrices[k] = space.structure[k] * pow(10.0, x[k]);
+        }
+    }
+    return gains;
+}
+
+// evaluateGains - simulates the scenario with the given gains.
+// @return - 0 if the full horizon was simulated, -1 if it was rejected.
+int evaluateGains(const OptimizerConfig &config, const ControllerGains &gains,
+                  double abortCost, GainCost *cost)
+{
+    SimulatorConfig simConfig = config.sim;
+    simConfig.statusInterval = 0;
+    Simulator sim(simConfig, gains);
+    sim.init(config.x0);
+
+    double pointingSum = 0.0;
+    double effortSum = 0.0;
+
+    cost->settlingTime = 0.0;
+    cost->pointingError = 0.0;
+    cost->dipoleEffort = 0.0;
+    cost->total = 0.0;
+    cost->rejected = false;
+
+    while (sim.getState().t < config.horizon) {
+        double tOld = sim.getState().t;
+        if (sim.step() != 0) {
+            cost->total = 1e300;
+            cost->rejected = true;
+            return -1;
+        }
+        const SimulatorState &s = sim.getState();
+        double dt = s.t - tOld;
+
+        Vec4 q;
+        for (int k = 0; k < 4; k++) {
+            q[k] = s.w[k];
+        }
+        Vec3 rSun = sunDirection(simConfig.sunModel, simConfig.rSun, simConfig.epochJD, s.t);
+        double angle = pointingAngle(q, rSun, gains.rTarget);
+
+        pointingSum += angle * dt;
+        effortSum += norm(s.D) / ADACS_MAX_DIPOLE * dt;
+        if (angle > config.settleAngle) {
+            cost->settlingTime = s.t;
+        }
+
+        // every term only grows, so this is a lower bound of the final cost
+        cost->pointingError = pointingSum / config.horizon;
+        cost->dipoleEffort = effortSum / config.horizon;
+        cost->total = config.wSettle * cost->settlingTime / config.horizon
+                    + config.wPointing * cost->pointingError
+                    + config.wEffort * cost->dipoleEffort;
+
+        if (cost->total > abortCost) {
+            cost->rejected = true;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+GainOptimizer::GainOptimizer(const OptimizerConfig &config, const GainSearchSpace &space,
+                             const ControllerGains &base) :
+    config(config), space(space), base(base)
+{
+    if (this->config.threads <= 0) {
+        this->config.threads = thread::hardware_concurrency();
+        if (this->config.threads <= 0) { this->config.threads = 1; }
+    }
+}
+
+// evaluatePopulation - evaluates the candidates on a pool of threads
+void GainOptimizer::evaluatePopulation(const vector<ControllerGains> &candidates, double abortCost,
+                                       vector<GainCost> *costs)
+{
+    costs->resize(candidates.size());
+    atomic<size_t> next(0);
+
+    auto worker = [&]() {
+        size_t k;
+        while ((k = next.fetch_add(1)) < candidates.size()) {
+            evaluateGains(config, candidates[k], abortCost, &(*costs)[k]);
+        }
+    };
+
+    vector<thread> pool;
+    for (int k = 1; k < config.threads && k < (int)candidates.size(); k++) {
+        pool.push_back(thread(worker));
+    }
+    worker();
+    for (size_t k = 0; k < pool.size(); k++) {
+        pool[k].join();
+    }
+}
+
+// run - runs all of the generations of the separable CMA-ES (Ros and Hansen
+// 2008), in coordinates scaled so the bounds are [0, 1].
+// @return - 0 on success, -1 if no gain is enabled or every candidate was
+// rejected.
+int GainOptimizer::run(OptimizerResult *result)
+{
+    // the enabled dimensions
+    vector<int> dims;
+    for (int k = 0; k < NUM_GAIN_PARAMETERS; k++) {
+        if (space.enabled[k]) { dims.push_back(k); }
+    }
+    const int n = dims.size();
+    if (n == 0) {
+        ErrorManager::ERROR(ADACS_OPTIMIZER_EMPTY_SEARCH_SPACE);
+        return -1;
+    }
+
+    // strategy parameters
+    int lambda = config.population;
+    if (lambda <= 0) {
+        lambda = max(4 + (int)(3 * log((double)n)), config.threads);
+    }
+    int mu = lambda / 2;
+    vector<double> weights(mu);
+    double wSum = 0.0, w2Sum = 0.0;
+    for (int i = 0; i < mu; i++) {
+        weights[i] = log(mu + 0.5) - log(i + 1.0);
+        wSum += weights[i];
+    }
+    for (int i = 0; i < mu; i++) {
+        weights[i] /= wSum;
+        w2Sum += weights[i] * weights[i];
+    }
+    double muEff = 1.0 / w2Sum;
+
+    double cSigma = (muEff + 2) / (n + muEff + 5);
+    double dSigma = 1 + 2 * max(0.0, sqrt((muEff - 1) / (n + 1)) - 1) + cSigma;
+    double cc = (4 + muEff / n) / (n + 4 + 2 * muEff / n);
+    double c1 = 2 / ((n + 1.3) * (n + 1.3) + muEff) * (n + 2) / 3;
+    double cMu = min(1 - c1, 2 * (muEff - 2 + 1 / muEff) / ((n + 2) * (n + 2) + muEff) * (n + 2) / 3);
+    double chiN = sqrt((double)n) * (1 - 1.0 / (4 * n) + 1.0 / (21 * n * n));
+
+    // start at the base gains when they are inside the bounds
+    double x[NUM_GAIN_PARAMETERS] = {0};
+    const Mat3 *baseMatrices[NUM_GAIN_PARAMETERS] = {&base.Kb, &base.Kp, &base.Kd, &base.Ko, &base.Ki};
+    vector<double> mean(n), C(n, 1.0), pSigma(n, 0.0), pc(n, 0.0);
+    for (int d = 0; d < n; d++) {
+        int k = dims[d];
+        double scale = 0.0, structure = 0.0;
+        for (int e = 0; e < 9; e++) {
+            scale = fmax(scale, fabs((*baseMatrices[k])[e]));
+            structure = fmax(structure, fabs(space.structure[k][e]));
+        }
+        double start = (scale > 0.0 && structure > 0.0) ? log10(scale / structure) : -1e300;
+        mean[d] = (start - space.lower[k]) / (space.upper[k] - space.lower[k]);
+        if (!(mean[d] >= 0.0 && mean[d] <= 1.0)) {
+            mean[d] = 0.5;
+        }
+        x[k] = space.lower[k] + mean[d] * (space.upper[k] - space.lower[k]);
+    }
+    double sigma = config.sigma0;
+
+    // the starting point sets the first rejection threshold
+    result->gains = gainsFromParameters(space, base, x);
+    evaluateGains(config, result->gains, 1e300, &result->cost);
+    for (int k = 0; k < NUM_GAIN_PARAMETERS; k++) { result->x[k] = x[k]; }
+    result->evaluations = 1;
+    result->rejected = result->cost.rejected ? 1 : 0;
+    bool found = !result->cost.rejected;
+
+    if (config.verbose) {
+        cout << "start cost = " << result->cost.total << endl;
+    }
+
+    Random rng(config.seed);
+    vector<vector<double> > y(lambda, vector<double>(n));
+    vector<ControllerGains> candidates(lambda);
+    vector<GainCost> costs;
+
+    for (int g = 0; g < config.generations; g++) {
+        // sample the population
+        for (int i = 0; i < lambda; i++) {
+            for (int d = 0; d < n; d++) {
+                double v = mean[d] + sigma * sqrt(C[d]) * rng.normal();
+                y[i][d] = fmin(1.0, fmax(0.0, v));
+                x[dims[d]] = space.lower[dims[d]] + y[i][d] * (space.upper[dims[d]] - space.lower[dims[d]]);
+            }
+            candidates[i] = gainsFromParameters(space, base, x);
+        }
+
+        double abortCost = found ? config.rejectFactor * result->cost.total : 1e300;
+        evaluatePopulation(candidates, abortCost, &costs);
+
+        // rank the candidates, rejected ones sort by their partial cost
+        // after every candidate that finished
+        vector<int> order(lambda);
+        for (int i = 0; i < lambda; i++) { order[i] = i; }
+        stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            if (costs[a].rejected != costs[b].rejected) { return !costs[a].rejected; }
+            return costs[a].total < costs[b].total;
+        });
+
+        for (int i = 0; i < lambda; i++) {
+            result->evaluations++;
+            if (costs[i].rejected) { result->rejected++; }
+        }
+
+        const GainCost &best = costs[order[0]];
+        if (!best.rejected && (!found || best.total < result->cost.total)) {
+            found = true;
+            result->cost = best;
+            result->gains = candidates[order[0]];
+            for (int d = 0; d < n; d++) {
+                result->x[dims[d]] = space.lower[dims[d]] + y[order[0]][d] * (space.upper[dims[d]] - space.lower[dims[d]]);
+            }
+        }
+
+        // update the mean and the evolution paths
+        vector<double> oldMean = mean;
+        for (int d = 0; d < n; d++) {
+            mean[d] = 0.0;
+            for (int i = 0; i < mu; i++) {
+                mean[d] += weights[i] * y[order[i]][d];
+            }
+        }
+
+        double pSigmaNorm2 = 0.0;
+        for (int d = 0; d < n; d++) {
+            double step = (mean[d] - oldMean[d]) / sigma;
+            pSigma[d] = (1 - cSigma) * pSigma[d] + sqrt(cSigma * (2 - cSigma) * muEff) * step / sqrt(C[d]);
+            pSigmaNorm2 += pSigma[d] * pSigma[d];
+        }
+        double pSigmaNorm = sqrt(pSigmaNorm2);
+        bool hSigma = pSigmaNorm / sqrt(1 - pow(1 - cSigma, 2.0 * (g + 1))) < (1.4 + 2.0 / (n + 1)) * chiN;
+
+        for (int d = 0; d < n; d++) {
+            double step = (mean[d] - oldMean[d]) / sigma;
+            pc[d] = (1 - cc) * pc[d] + (hSigma ? sqrt(cc * (2 - cc) * muEff) * step : 0.0);
+
+            double rankMu = 0.0;
+            for (int i = 0; i < mu; i++) {
+                double z = (y[order[i]][d] - oldMean[d]) / sigma;
+                rankMu += weights[i] * z * z;
+            }
+            C[d] = (1 - c1 - cMu) * C[d]
+                 + c1 * (pc[d] * pc[d] + (hSigma ? 0.0 : cc * (2 - cc) * C[d]))
+                 + cMu * rankMu;
+        }
+        sigma *= exp((cSigma / dSigma) * (pSigmaNorm / chiN - 1));
+
+        if (config.verbose) {
+            int rejected = 0;
+            for (int i = 0; i < lambda; i++) { rejected += costs[i].rejected; }
+            cout << "generation " << g + 1 << " best = " << result->cost.total
+                 << " generation best = " << best.total << (best.rejected ? " (rejected)" : "")
+                 << " rejected " << rejected << "/" << lambda << " sigma = " << sigma << endl;
+        }
+    }
+
+    return found ? 0 : -1;
+}
@@ -0,0 +1,162 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  GainOptimizer.hpp
+//
+// Searches the controller gain space for the gains with the lowest cost on a
+// simulated scenario, instead of hand editing the constants in
+// INCA_Dynamics_Solution.m
+//
+// The search is a separable CMA-ES (diagonal covariance) over log10 of the
+// scale of each enabled gain matrix. Each generation of candidates is
+// simulated in parallel on all of the cores. The cost
+//
+//  cost = wSettle * settling time / horizon
+//       + wPointing * mean pointing error (deg)
+//       + wEffort * mean |D| / ADACS_MAX_DIPOLE
+//
+// only grows as the simulation goes on, so a candidate is stopped (rejected)
+// as soon as its partial cost passes rejectFactor times the best full cost
+// found so far. The results only depend on the seed, not on the number of
+// threads.
+//
+// Example code for use is shown below:
+//
+// OptimizerConfig config = defaultOptimizerConfig();
+// GainOptimizer optimizer(config, defaultGainSearchSpace(), defaultControllerGains());
+// OptimizerResult result;
+// optimizer.run(&result);
+// saveControllerGains("OptimizedGains.inca", result.gains);
+
+#ifndef GainOptimizer_hpp
+#define GainOptimizer_hpp
+
+#include "Simulator.hpp"
+
+#define GAIN_KB 0
+#define GAIN_KP 1
+#define GAIN_KD 2
+#define GAIN_KO 3
+#define GAIN_KI 4
+#define NUM_GAIN_PARAMETERS 5
+
+// the gains that are searched, each one is 10^x * structure[i]
+struct GainSearchSpace {
+    bool enabled[NUM_GAIN_PARAMETERS];
+    // log10 bounds of the scale
+    double lower[NUM_GAIN_PARAMETERS];
+    double upper[NUM_GAIN_PARAMETERS];
+    Mat3 structure[NUM_GAIN_PARAMETERS];
+};
+
+struct OptimizerConfig {
+    SimulatorConfig sim;
+    StateVector x0;
+    // simulated time for each candidate (s)
+    double horizon;
+    // pointing error that counts as settled (deg)
+    double settleAngle;
+    double wSettle;
+    double wPointing;
+    double wEffort;
+    // candidates are stopped once their cost passes rejectFactor * best cost
+    double rejectFactor;
+    // candidates per generation, 0 for the CMA-ES default (at least one per thread)
+    int population;
+    int generations;
+    // 0 for one per core
+    int threads;
+    // initial step size as a fraction of the bounds
+    double sigma0;
+    uint64_t seed;
+    bool verbose;
+};
+
+struct GainCost {
+    double settlingTime;
+    double pointingError;
+    double dipoleEffort;
+    double total;
+    // true if the candidate was stopped early or diverged, total is then
+    // only a lower bound.
+    bool rejected;
+};
+
+struct OptimizerResult {
+    ControllerGains gains;
+    GainCost cost;
+    double x[NUM_GAIN_PARAMETERS];
+    long evaluations;
+    long rejected;
+};
+
+// defaultGainSearchSpace - searches Kp, Kd and Ko with the structure of the
+// gains in INCA_Dynamics_Solution.m, Kb and Ki are kept at the base gains.
+GainSearchSpace defaultGainSearchSpace();
+
+// defaultOptimizerConfig - the reference scenario for 2 hours with the lie
+// group integrator, which is the fastest one (see integratorBenchmark).
+OptimizerConfig defaultOptimizerConfig();
+
+// loadOptimizerConfig - reads the optimizer settings from a config file,
+// the simulator settings are read with loadSimulatorConfig().
+// Keys: optHorizon, optSettleAngle, optWeightSettle, optWeightPointing,
+// optWeightEffort, optRejectFactor, optPopulation, optGenerations,
+// optThreads, optSeed. Any key that is missing keeps its value.
+// @return - 0 on success, -1 on failure.
+int loadOptimizerConfig(ConfigFile &configFile, OptimizerConfig *config);
+
+// gainsFromParameters - the gains for the point x in the search space
+// @param space - the search space
+// @param base - gains used for anything not being searched
+// @param x - log10 scale of each gain
+ControllerGains gainsFromParameters(const GainSearchSpace &space, const ControllerGains &base,
+                                    const double *x);
+
+// evaluateGains - simulates the scenario with the given gains.
+// @param config - the scenario and cost weights
+// @param gains - the gains to evaluate
+// @param abortCost - the simulation is stopped once the cost passes this
+// @param cost - output cost
+// @return - 0 if the full horizon was simulated, -1 if it was rejected.
+int evaluateGains(const OptimizerConfig &config, const ControllerGains &gains,
+                  double abortCost, GainCost *cost);
+
+class GainOptimizer {
+public:
+    GainOptimizer(const OptimizerConfig &config, const GainSearchSpace &space,
+                  const ControllerGains &base);
+
+    // run - runs all of the generations.
+    // @param result - output best gains found
+    // @return - 0 on success, -1 if no gain is enabled or every candidate
+    // was rejected.
+    int run(OptimizerResult *result);
+
+private:
+    OptimizerConfig config;
+    GainSearchSpace space;
+    ControllerGains base;
+
+    // evaluatePopulation - evaluates the candidates on a pool of threads
+    void evaluatePopulation(const vector<ControllerGains> &candidates, double abortCost,
+                            vector<GainCost> *costs);
+};
+
+#endif /* GainOptimizer_hpp */
@@ -0,0 +1,154 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Histogram.cpp
+//
+// Lock-free histogram for timing measurements (latency, execution time, jitter).
+
+#include "Histogram.hpp"
+
+Histogram::Histogram()
+{
+    reset();
+}
+
+// reset - clears all of the recorded values.
+// Not safe to call while other threads are recording.
+void Histogram::reset()
+{
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+    min.store(UINT64_MAX, std::memory_order_relaxed);
+}
+
+// bucketIndex - values under 8 get their own bucket, above that the bucket is
+// found from the highest set bit and the 3 bits below it.
+int Histogram::bucketIndex(uint64_t value)
+{
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return (int)value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int sub = (int)((value >> (msb - 3)) & (HISTOGRAM_SUB_BUCKETS - 1));
+    return (msb - 2) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+uint64_t Histogram::bucketLower(int index)
+{
+    if (index < HISTOGRAM_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    int msb = index / HISTOGRAM_SUB_BUCKETS + 2;
+    uint64_t sub = (uint64_t)(index % HISTOGRAM_SUB_BUCKETS);
+    return (HISTOGRAM_SUB_BUCKETS + sub) << (msb - 3);
+}
+
+uint64_t Histogram::bucketUpper(int index)
+{
+    if (index < HISTOGRAM_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    int msb = index / HISTOGRAM_SUB_BUCKETS + 2;
+    return bucketLower(index) + ((uint64_t)1 << (msb - 3)) - 1;
+}
+
+// record - adds a single value to the histogram.
+void Histogram::record(uint64_t value)
+{
+    buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t old = max.load(std::memory_order_relaxed);
+    while (value > old && !max.compare_exchange_weak(old, value, std::memory_order_relaxed)) {}
+    old = min.load(std::memory_order_relaxed);
+    while (value < old && !min.compare_exchange_weak(old, value, std::memory_order_relaxed)) {}
+}
+
+uint64_t Histogram::getCount() const { return count.load(std::memory_order_relaxed); }
+uint64_t Histogram::getMax() const { return max.load(std::memory_order_relaxed); }
+
+uint64_t Histogram::getMin() const
+{
+    if (getCount() == 0) {
+        return 0;
+    }
+    return min.load(std::memory_order_relaxed);
+}
+
+double Histogram::getMean() const
+{
+    uint64_t n = getCount();
+    if (n == 0) {
+        return 0.0;
+    }
+    return (double)sum.load(std::memory_order_relaxed) / (double)n;
+}
+
+// percentile - returns the upper bound of the bucket holding the
+// given percentile.
+// @param p - percentile between 0 and 100
+uint64_t Histogram::percentile(double p) const
+{
+    uint64_t n = getCount();
+    if (n == 0) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)(p / 100.0 * (double)n);
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            uint64_t upper = bucketUpper(i);
+            return upper < getMax() ? upper : getMax();
+        }
+    }
+    return getMax();
+}
+
+// print - outputs a one line summary of the histogram.
+void Histogram::print(const char *name, std::ostream &out) const
+{
+    out << name << ": count = " << getCount()
+        << " min = " << getMin()
+        << " mean = " << getMean()
+        << " p50 = " << percentile(50)
+        << " p99 = " << percentile(99)
+        << " p99.9 = " << percentile(99.9)
+        << " max = " << getMax() << std::endl;
+}
+
+// printBuckets - outputs every non empty bucket as "lower upper count"
+void Histogram::printBuckets(std::ostream &out) const
+{
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        uint64_t c = buckets[i].load(std::memory_order_relaxed);
+        if (c != 0) {
+            out << bucketLower(i) << " " << bucketUpper(i) << " " << c << std::endl;
+        }
+    }
+}
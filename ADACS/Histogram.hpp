@@ -0,0 +1,88 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Histogram.hpp
+//
+// Lock-free histogram for timing measurements (latency, execution time, jitter).
+// Any number of threads may call record() at the same time, it only uses
+// relaxed atomic adds so it is safe to call from inside of the control loop.
+//
+// Values are bucketed by their power of 2 with 8 linear sub-buckets in each
+// power, so any reported percentile is within 12.5% of the real value.
+//
+// Example code for use is shown below:
+//
+// Histogram latency;
+// latency.record(endNs - startNs);
+// ...
+// latency.print("latency (ns)");
+
+#ifndef Histogram_hpp
+#define Histogram_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+#define HISTOGRAM_SUB_BUCKETS 8
+#define HISTOGRAM_BUCKETS 496
+
+class Histogram {
+public:
+    Histogram();
+
+    // record - adds a single value to the histogram.
+    void record(uint64_t value);
+
+    // reset - clears all of the recorded values.
+    // Not safe to call while other threads are recording.
+    void reset();
+
+    uint64_t getCount() const;
+    uint64_t getMax() const;
+    uint64_t getMin() const;
+    double getMean() const;
+
+    // percentile - returns the upper bound of the bucket holding the
+    // given percentile.
+    // @param p - percentile between 0 and 100
+    uint64_t percentile(double p) const;
+
+    // print - outputs a one line summary of the histogram.
+    void print(const char *name, std::ostream &out = std::cout) const;
+
+    // printBuckets - outputs every non empty bucket as "lower upper count"
+    void printBuckets(std::ostream &out = std::cout) const;
+
+private:
+    std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+    std::atomic<uint64_t> min;
+
+    Histogram(const Histogram &);
+    Histogram &operator=(const Histogram &);
+
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketLower(int index);
+    static uint64_t bucketUpper(int index);
+};
+
+#endif /* Histogram_hpp */
@@ -0,0 +1,279 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Integrator.cpp
+//
+// Single step integrators for the attitude simulator.
+
+#include "Integrator.hpp"
+#include "Quaternion.hpp"
+
+// Dormand Prince 4/5 coefficients from DormandPrince45.m, a[k] is the row of
+// the tableau used to make stage k + 1 (the last row is the 5th order step).
+static const double DP_C[7] = {0.0, 1.0/5, 3.0/10, 4.0/5, 8.0/9, 1.0, 1.0};
+static const double DP_A[7][6] = {
+    {0, 0, 0, 0, 0, 0},
+    {1.0/5, 0, 0, 0, 0, 0},
+    {3.0/40, 9.0/40, 0, 0, 0, 0},
+    {44.0/45, -56.0/15, 32.0/9, 0, 0, 0},
+    {19372.0/6561, -25360.0/2187, 64448.0/6561, -212.0/729, 0, 0},
+    {9017.0/3168, -355.0/33, 46732.0/5247, 49.0/176, -5103.0/18656, 0},
+    {35.0/384, 0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84}};
+// difference between the 5th and 4th order steps
+static const double DP_E[7] = {71.0/57600, 0, -71.0/16695, 71.0/1920, -17253.0/339200, 22.0/525, -1.0/40};
+
+
+///////////////////////////////////////////////////////// Dormand Prince
+
+class DormandPrince45 : public Integrator {
+public:
+    int attempt(IntegratorSystem &system, double t, const StateVector &w, double h,
+                const StateVector &f0, StateVector *wNew, StateVector *fNew, double *err) const
+    {
+        StateVector s[7];
+        s[0] = f0;
+        for (int k = 1; k < 7; k++) {
+            StateVector sum;
+            for (int l = 0; l < k; l++) {
+                if (DP_A[k][l] != 0.0) { sum += DP_A[k][l] * s[l]; }
+            }
+            StateVector x = w + h * sum;
+            system.derivative(t + DP_C[k] * h, x, &s[k]);
+            if (k == 6) { *wNew = x; }
+        }
+        *fNew = s[6];
+
+        StateVector e;
+        for (int l = 0; l < 7; l++) {
+            if (DP_E[l] != 0.0) { e += DP_E[l] * s[l]; }
+        }
+        *err = 0.0;
+        for (int k = 0; k < STATE_SIZE; k++) {
+            if (fabs(e[k]) > *err) { *err = fabs(e[k]); }
+        }
+        *err *= h;
+        return 0;
+    }
+
+    int errorOrder() const { return 4; }
+    bool preservesNorm() const { return false; }
+    const char *name() const { return "dp45"; }
+};
+
+
+///////////////////////////////////////////////////////// Lie group
+
+// expQuat - unit quaternion for the rotation vector u
+static Vec4 expQuat(const Vec3 &u)
+{
+    double theta = norm(u);
+    // sin(theta / 2) / theta, with the series near 0
+    double s = (theta > 1e-4) ? sin(theta / 2) / theta : 0.5 - theta * theta / 48;
+    Vec4 q;
+    q[0] = s * u[0];
+    q[1] = s * u[1];
+    q[2] = s * u[2];
+    q[3] = cos(theta / 2);
+    return q;
+}
+
+// dexpInv - derivative of the rotation vector u of q = q0 * exp(u) for the
+// body rate omega, the series is cut after the terms needed for 5th order.
+static Vec3 dexpInv(const Vec3 &u, const Vec3 &omega)
+{
+    Vec3 a1 = cross(u, omega);
+    Vec3 a2 = cross(u, a1);
+    Vec3 a4 = cross(u, cross(u, a2));
+    return omega + 0.5 * a1 + (1.0 / 12) * a2 - (1.0 / 720) * a4;
+}
+
+// Runge-Kutta-Munthe-Kaas with the Dormand Prince tableau. The state is
+// written as q = q0 * exp(u), omega where the stages are found for u and
+// omega, which are both plain vectors. omega = 2 * Xi(q)' * q_dot and
+// omega_dot = 2 * Xi(q)' * q_dot_dot since Xi(q_dot)' * q_dot = 0.
+class LieGroupIntegrator : public Integrator {
+public:
+    int attempt(IntegratorSystem &system, double t, const StateVector &w, double h,
+                const StateVector &f0, StateVector *wNew, StateVector *fNew, double *err) const
+    {
+        Vec4 q0, qDot0, qDotDot0;
+        for (int k = 0; k < 4; k++) {
+            q0[k] = w[k];
+            qDot0[k] = w[k + 4];
+            qDotDot0[k] = f0[k + 4];
+        }
+        Matrix<double, 3, 4> XiT0 = Xi(q0).transpose();
+        Vec3 omega0 = 2.0 * (XiT0 * qDot0);
+
+        // stage derivatives of u and omega
+        Vec3 U[7], W[7];
+        U[0] = omega0;
+        W[0] = 2.0 * (XiT0 * qDotDot0);
+
+        for (int k = 1; k < 7; k++) {
+            Vec3 u, omega = omega0;
+            for (int l = 0; l < k; l++) {
+                if (DP_A[k][l] != 0.0) {
+                    u += (h * DP_A[k][l]) * U[l];
+                    omega += (h * DP_A[k][l]) * W[l];
+                }
+            }
+
+            // the dexp series only converges for rotations under 2 pi,
+            // reject anything past pi so h is cut down.
+            if (!(norm(u) < M_PI)) {
+                return -1;
+            }
+
+            Vec4 q = hamMult(q0, expQuat(u));
+            Matrix<double, 4, 3> XiQ = Xi(q);
+            Vec4 qDot = 0.5 * (XiQ * omega);
+
+            StateVector x, f;
+            for (int i = 0; i < 4; i++) {
+                x[i] = q[i];
+                x[i + 4] = qDot[i];
+            }
+            system.derivative(t + DP_C[k] * h, x, &f);
+
+            Vec4 qDotDot;
+            for (int i = 0; i < 4; i++) {
+                qDotDot[i] = f[i + 4];
+            }
+            U[k] = dexpInv(u, omega);
+            W[k] = 2.0 * (XiQ.transpose() * qDotDot);
+
+            // the last stage is the new state (FSAL)
+            if (k == 6) {
+                *wNew = x;
+                *fNew = f;
+            }
+        }
+
+        // error in u and omega, a change of du in u changes q by about du / 2
+        Vec3 eU, eW;
+        for (int l = 0; l < 7; l++) {
+            if (DP_E[l] != 0.0) {
+                eU += DP_E[l] * U[l];
+                eW += DP_E[l] * W[l];
+            }
+        }
+        *err = 0.0;
+        for (int k = 0; k < 3; k++) {
+            if (fabs(eU[k]) > *err) { *err = fabs(eU[k]); }
+            if (fabs(eW[k]) > *err) { *err = fabs(eW[k]); }
+        }
+        *err *= 0.5 * h;
+        return 0;
+    }
+
+    int errorOrder() const { return 4; }
+    bool preservesNorm() const { return true; }
+    const char *name() const { return "lie"; }
+};
+
+
+///////////////////////////////////////////////////////// Rosenbrock
+
+// Modified Rosenbrock 2(3) pair of Shampine and Reichelt (MATLAB ode23s). It
+// is a W-method, so it stays 2nd order when F is only approximate, and it is
+// L-stable. The time partial of f is left out, the field only changes over an
+// orbit.
+//  W = I - d*h*F
+//  k1 = W \ f(t, w)
+//  k2 = W \ (f(t + h/2, w + h/2*k1) - k1) + k1
+//  w_new = w + h*k2
+//  k3 = W \ (f(t + h, w_new) - e32*(k2 - f1) - 2*(k1 - f0))
+//  err = h/6 * (k1 - 2*k2 + k3)
+class RosenbrockIntegrator : public Integrator {
+public:
+    int attempt(IntegratorSystem &system, double t, const StateVector &w, double h,
+                const StateVector &f0, StateVector *wNew, StateVector *fNew, double *err) const
+    {
+        const double d = 1.0 / (2.0 + sqrt(2.0));
+        const double e32 = 6.0 + sqrt(2.0);
+
+        StateMatrix F;
+        system.jacobian(t, w, &F);
+        StateMatrix W = StateMatrix::identity() - (d * h) * F;
+        int pivot[STATE_SIZE];
+        if (luFactor(W, pivot) != 0) {
+            return -1;
+        }
+
+        StateVector k1 = f0;
+        luSolve(W, pivot, k1);
+
+        StateVector f1;
+        system.derivative(t + 0.5 * h, w + (0.5 * h) * k1, &f1);
+        StateVector k2 = f1 - k1;
+        luSolve(W, pivot, k2);
+        k2 += k1;
+
+        *wNew = w + h * k2;
+        system.derivative(t + h, *wNew, fNew);
+
+        StateVector k3 = *fNew - e32 * (k2 - f1) - 2.0 * (k1 - f0);
+        luSolve(W, pivot, k3);
+
+        *err = 0.0;
+        for (int k = 0; k < STATE_SIZE; k++) {
+            double e = fabs(h / 6 * (k1[k] - 2.0 * k2[k] + k3[k]));
+            if (e > *err) { *err = e; }
+        }
+        return 0;
+    }
+
+    int errorOrder() const { return 2; }
+    bool preservesNorm() const { return false; }
+    const char *name() const { return "rosenbrock"; }
+};
+
+
+static const DormandPrince45 dormandPrince45;
+static const LieGroupIntegrator lieGroup;
+static const RosenbrockIntegrator rosenbrock;
+
+// getIntegrator - the integrator for one of the SIM_INTEGRATOR_* types
+// @return - the integrator, or NULL for an unknown type.
+const Integrator *getIntegrator(int type)
+{
+    switch (type) {
+        case SIM_INTEGRATOR_DP45 :
+            return &dormandPrince45;
+        case SIM_INTEGRATOR_LIE_GROUP :
+            return &lieGroup;
+        case SIM_INTEGRATOR_ROSENBROCK :
+            return &rosenbrock;
+        default:
+            return NULL;
+    }
+}
+
+// integratorType - finds the type from the name ("dp45", "lie", "rosenbrock")
+// @return - the SIM_INTEGRATOR_* type, or -1 for an unknown name.
+int integratorType(const string &name)
+{
+    for (int type = 0; type < SIM_NUM_INTEGRATORS; type++) {
+        if (name == getIntegrator(type)->name()) {
+            return type;
+        }
+    }
+    return -1;
+}
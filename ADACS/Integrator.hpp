@@ -0,0 +1,111 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Integrator.hpp
+//
+// Single step integrators for the attitude simulator. Each one takes a trial
+// step of size h and returns the new state with an error estimate, the step
+// size control (accept / reject and the next h) stays in the Simulator so all
+// of the integrators are run the same way INCA_Dynamics_Solution.m runs
+// DormandPrince45.m
+//
+//  SIM_INTEGRATOR_DP45       - DormandPrince45.m, explicit 4/5 order pair.
+//                              q drifts off the unit sphere so the simulator
+//                              normalizes it every step.
+//  SIM_INTEGRATOR_LIE_GROUP  - the same 4/5 pair applied on the Lie algebra
+//                              (Runge-Kutta-Munthe-Kaas). q is only ever
+//                              updated by multiplying with a unit quaternion
+//                              so its norm is preserved by construction.
+//  SIM_INTEGRATOR_ROSENBROCK - linearly implicit 2(3) pair (MATLAB ode23s)
+//                              using the analytic F jacobian from StateModel.
+//                              F is found with the dipole held fixed, the
+//                              method keeps its order for any approximate
+//                              jacobian.
+//
+// All of the integrators are FSAL, the derivative at the start of the step is
+// passed in and the derivative at the end of the step is returned.
+//
+// Example code for use is shown below:
+//
+// const Integrator *integrator = getIntegrator(SIM_INTEGRATOR_LIE_GROUP);
+// integrator->attempt(system, t, w, h, f0, &wNew, &fNew, &err);
+
+#ifndef Integrator_hpp
+#define Integrator_hpp
+
+#include <string>
+
+#include "StateModel.hpp"
+
+using namespace std;
+
+#define SIM_INTEGRATOR_DP45 0
+#define SIM_INTEGRATOR_LIE_GROUP 1
+#define SIM_INTEGRATOR_ROSENBROCK 2
+#define SIM_NUM_INTEGRATORS 3
+
+// the system being integrated
+class IntegratorSystem {
+public:
+    virtual ~IntegratorSystem() {}
+
+    // derivative - x_dot at (t, x)
+    virtual void derivative(double t, const StateVector &x, StateVector *xDot) = 0;
+
+    // jacobian - F = d(x_dot)/dx at (t, x), only used by the implicit methods.
+    virtual void jacobian(double t, const StateVector &x, StateMatrix *F) = 0;
+};
+
+class Integrator {
+public:
+    virtual ~Integrator() {}
+
+    // attempt - takes a trial step from (t, w)
+    // @param system - the system to integrate
+    // @param t - time at the start of the step (s)
+    // @param w - state at the start of the step
+    // @param h - step size (s)
+    // @param f0 - derivative at (t, w)
+    // @param wNew - output state at t + h
+    // @param fNew - output derivative at (t + h, wNew)
+    // @param err - output max abs local error estimate
+    // @return - 0 on success, -1 if the step could not be taken (reject it)
+    virtual int attempt(IntegratorSystem &system, double t, const StateVector &w, double h,
+                        const StateVector &f0, StateVector *wNew, StateVector *fNew,
+                        double *err) const = 0;
+
+    // errorOrder - order of the error estimate, the step size is scaled by
+    // err^(-1 / (errorOrder + 1))
+    virtual int errorOrder() const = 0;
+
+    // preservesNorm - true if q stays a unit quaternion without normalizing
+    virtual bool preservesNorm() const = 0;
+
+    virtual const char *name() const = 0;
+};
+
+// getIntegrator - the integrator for one of the SIM_INTEGRATOR_* types
+// @return - the integrator, or NULL for an unknown type.
+const Integrator *getIntegrator(int type);
+
+// integratorType - finds the type from the name ("dp45", "lie", "rosenbrock")
+// @return - the SIM_INTEGRATOR_* type, or -1 for an unknown name.
+int integratorType(const string &name);
+
+#endif /* Integrator_hpp */
@@ -0,0 +1,277 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  KalmanFilter.cpp
+//
+// Extended kalman filter for the INCA attitude state x = [q; q_dot].
+
+#include "KalmanFilter.hpp"
+
+// for ERROR
+#include <ErrorManager.hpp>
+// for INSTRUMENT_TIMER
+#include <Instrumentation.hpp>
+
+// constructor for the kalman filter
+// @param model - the state model used for prediction
+// @param x0 - the initial state estimate
+// @param P0 - the initial state covariance
+// @param Q - the process noise added on each predict step
+template <typename T, typename Cov>
+KalmanFilterT<T, Cov>::KalmanFilterT(const StateModelT<T> &model, const Vector &x0,
+                                     const Covariance &P0, const Covariance &Q) :
+    model(model), x(x0), P(P0), Q(Q)
+{
+    updateMode = KALMAN_UPDATE_JOINT;
+    lastNIS = 0.0;
+}
+
+// predict - propagates the state and covariance forward in time.
+// The state is propagated with RK4 and the covariance with the second order
+// transition matrix Phi = I + F*dt + (F*dt)^2 / 2.
+// @param dt - time step (s)
+// @param Binr - magnetic field in the inertial frame (T)
+// @param D - the commanded magnetic dipole (A*m^2)
+template <typename T, typename Cov>
+void KalmanFilterT<T, Cov>::predict(T dt, const Vector3 &Binr, const Vector3 &D)
+{
+    INSTRUMENT_TIMER("KalmanFilter::predict");
+    Matrix<T, STATE_SIZE, STATE_SIZE> F;
+    model.jacobian(x, Binr, D, &F);
+
+    Vector k1, k2, k3, k4;
+    model.derivative(x, Binr, D, &k1);
+    model.derivative(x + k1 * (T(0.5) * dt), Binr, D, &k2);
+    model.derivative(x + k2 * (T(0.5) * dt), Binr, D, &k3);
+    model.derivative(x + k3 * dt, Binr, D, &k4);
+    x += (k1 + T(2) * k2 + T(2) * k3 + k4) * (dt / T(6));
+
+    // NOTE: q is not normalized here like the simulator does. The vector
+    // sensors keep the norm observable, and normalizing without also
+    // projecting P makes the filter overconfident.
+
+    Covariance Fdt = matrixCast<Cov>(F) * Cov(dt);
+    Covariance Phi = Covariance::identity() + Fdt + (Fdt * Fdt) * Cov(0.5);
+    P = Phi * P * Phi.transpose() + Q;
+
+    // keep P symmetric
+    for (int r = 0; r < STATE_SIZE; r++) {
+        for (int c = r + 1; c < STATE_SIZE; c++) {
+            Cov avg = Cov(0.5) * (P(r, c) + P(c, r));
+            P(r, c) = avg;
+            P(c, r) = avg;
+        }
+    }
+}
+
+// linearize - stacks the innovations, jacobians and noise for a batch at the
+// current state.
+// @return - the number of scalar measurements, or -1 for a bad batch.
+template <typename T, typename Cov>
+int KalmanFilterT<T, Cov>::linearize(const MeasurementT<T> *measurements, int count,
+                                     Matrix<T, KALMAN_MAX_MEASUREMENT_SIZE, 1> *y,
+                                     Matrix<T, KALMAN_MAX_MEASUREMENT_SIZE, STATE_SIZE> *H,
+                                     Matrix<T, KALMAN_MAX_MEASUREMENT_SIZE, 1> *R)
+{
+    if (count < 1 || count > KALMAN_MAX_BATCH) {
+        ErrorManager::ERROR(KALMAN_FILTER_BAD_MEASUREMENT);
+        return -1;
+    }
+
+    for (int k = 0; k < count; k++) {
+        const MeasurementT<T> &m = measurements[k];
+        Vector3 h;
+        Matrix<T, 3, STATE_SIZE> Hk;
+
+        switch (m.type) {
+            case SENSOR_GYRO :
+                gyroMeasurement(x, &h, &Hk);
+                break;
+            case SENSOR_MAGNETOMETER :
+            case SENSOR_SUN :
+                vectorMeasurement(x, m.reference, &h, &Hk);
+                break;
+            default:
+                ErrorManager::ERROR(KALMAN_FILTER_BAD_MEASUREMENT);
+                return -1;
+        }
+
+        for (int i = 0; i < 3; i++) {
+            if (!(m.variance[i] > T(0))) {
+                ErrorManager::ERROR(KALMAN_FILTER_BAD_MEASUREMENT);
+                return -1;
+            }
+            int row = 3 * k + i;
+            (*y)[row] = m.z[i] - h[i];
+            (*R)[row] = m.variance[i];
+            for (int c = 0; c < STATE_SIZE; c++) {
+                (*H)(row, c) = Hk(i, c);
+            }
+        }
+    }
+
+    return 3 * count;
+}
+
+// update - applies a batch of measurements using the current update mode.
+// @param measurements - array of measurements taken at the same time.
+// @param count - number of measurements in the array (1 to KALMAN_MAX_BATCH)
+// @return - 0 on success, -1 on failure (the state is left unchanged).
+template <typename T, typename Cov>
+int KalmanFilterT<T, Cov>::update(const MeasurementT<T> *measurements, int count)
+{
+    INSTRUMENT_TIMER("KalmanFilter::update");
+    if (updateMode == KALMAN_UPDATE_SEQUENTIAL) {
+        return updateSequential(measurements, count);
+    }
+    return updateJoint(measurements, count);
+}
+
+// updateJoint - standard EKF update using all of the components together.
+// K = P*H'*S^-1 is never formed, instead S is factored once and solved
+// against [H*P, y]. Everything after the linearization is done in Cov.
+template <typename T, typename Cov>
+int KalmanFilterT<T, Cov>::updateJoint(const MeasurementT<T> *measurements, int count)
+{
+    Matrix<T, KALMAN_MAX_MEASUREMENT_SIZE, 1> y, R;
+    Matrix<T, KALMAN_MAX_MEASUREMENT_SIZE, STATE_SIZE> H;
+    int m = linearize(measurements, count, &y, &H, &R);
+    if (m < 0) {
+        return -1;
+    }
+
+    // HP = H * P (only the first m rows are used)
+    Matrix<Cov, KALMAN_MAX_MEASUREMENT_SIZE, STATE_SIZE> HP;
+    for (int i = 0; i < m; i++) {
+        for (int k = 0; k < STATE_SIZE; k++) {
+            Cov hik = H(i, k);
+            for (int c = 0; c < STATE_SIZE; c++) {
+                HP(i, c) += hik * P(k, c);
+            }
+        }
+    }
+
+    // S = H * P * H' + R,  B = [H*P, y]
+    Matrix<Cov, KALMAN_MAX_MEASUREMENT_SIZE, KALMAN_MAX_MEASUREMENT_SIZE> S;
+    Matrix<Cov, KALMAN_MAX_MEASUREMENT_SIZE, STATE_SIZE + 1> B;
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < m; j++) {
+            Cov s = Cov(0);
+            for (int k = 0; k < STATE_SIZE; k++) {
+                s += HP(i, k) * Cov(H(j, k));
+            }
+            S(i, j) = s;
+        }
+        S(i, i) += R[i];
+        for (int c = 0; c < STATE_SIZE; c++) {
+            B(i, c) = HP(i, c);
+        }
+        B(i, STATE_SIZE) = y[i];
+    }
+
+    if (choleskySolve(S, B, m, STATE_SIZE + 1) != 0) {
+        ErrorManager::ERROR(KALMAN_FILTER_UPDATE_FAILED);
+        return -1;
+    }
+
+    // x = x + P*H'*S^-1*y,  P = P - P*H'*S^-1*H*P
+    Cov nis = Cov(0);
+    for (int i = 0; i < m; i++) {
+        nis += Cov(y[i]) * B(i, STATE_SIZE);
+    }
+    for (int r = 0; r < STATE_SIZE; r++) {
+        Cov dx = Cov(0);
+        for (int i = 0; i < m; i++) {
+            dx += HP(i, r) * B(i, STATE_SIZE);
+        }
+        x[r] += T(dx);
+        for (int c = 0; c < STATE_SIZE; c++) {
+            Cov dp = Cov(0);
+            for (int i = 0; i < m; i++) {
+                dp += HP(i, r) * B(i, c);
+            }
+            P(r, c) -= dp;
+        }
+    }
+
+    lastNIS = nis;
+    return 0;
+}
+
+// updateSequential - processes each scalar component one at a time.
+// All of the components are linearized once at the prior state, so the
+// innovation of component i is corrected by H_i * (x - x_prior). This makes
+// the result equal to the joint update while only dividing by scalars.
+template <typename T, typename Cov>
+int KalmanFilterT<T, Cov>::updateSequential(const MeasurementT<T> *measurements, int count)
+{
+    Matrix<T, KALMAN_MAX_MEASUREMENT_SIZE, 1> y, R;
+    Matrix<T, KALMAN_MAX_MEASUREMENT_SIZE, STATE_SIZE> H;
+    int m = linearize(measurements, count, &y, &H, &R);
+    if (m < 0) {
+        return -1;
+    }
+
+    Matrix<Cov, STATE_SIZE, 1> dx;
+    Covariance Pnew = P;
+    Cov nis = Cov(0);
+
+    for (int i = 0; i < m; i++) {
+        // PHt = P * H_i'
+        Matrix<Cov, STATE_SIZE, 1> PHt;
+        for (int r = 0; r < STATE_SIZE; r++) {
+            Cov s = Cov(0);
+            for (int c = 0; c < STATE_SIZE; c++) {
+                s += Pnew(r, c) * Cov(H(i, c));
+            }
+            PHt[r] = s;
+        }
+
+        Cov s = R[i];
+        Cov innovation = y[i];
+        for (int c = 0; c < STATE_SIZE; c++) {
+            s += Cov(H(i, c)) * PHt[c];
+            innovation -= Cov(H(i, c)) * dx[c];
+        }
+
+        if (!(s > Cov(0))) {
+            ErrorManager::ERROR(KALMAN_FILTER_UPDATE_FAILED);
+            return -1;
+        }
+        Cov invS = Cov(1) / s;
+
+        for (int r = 0; r < STATE_SIZE; r++) {
+            Cov kr = PHt[r] * invS;
+            dx[r] += kr * innovation;
+            for (int c = 0; c < STATE_SIZE; c++) {
+                Pnew(r, c) -= kr * PHt[c];
+            }
+        }
+        nis += innovation * innovation * invS;
+    }
+
+    x += matrixCast<T>(dx);
+    P = Pnew;
+    lastNIS = nis;
+    return 0;
+}
+
+template class KalmanFilterT<double>;
+template class KalmanFilterT<float>;
+template class KalmanFilterT<float, double>;
@@ -0,0 +1,147 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  KalmanFilter.hpp
+//
+// Extended kalman filter for the INCA attitude state x = [q; q_dot].
+// The filter uses StateModel for the prediction and MeasurementModel for the
+// gyro, magnetometer and sun sensor updates.
+//
+// Measurements that arrive in the same tick can be passed in together as a
+// single batch. The batch can be processed two ways:
+//  KALMAN_UPDATE_JOINT      - all components at once, solving the full
+//                             innovation covariance S = H*P*H' + R.
+//  KALMAN_UPDATE_SEQUENTIAL - one scalar component at a time. Since R is
+//                             diagonal this gives the same estimate without
+//                             ever inverting (or factoring) S.
+//
+// Example code for use is shown below:
+//
+// KalmanFilter filter(model, x0, P0, Q);
+// filter.setUpdateMode(KALMAN_UPDATE_SEQUENTIAL);
+//
+// filter.predict(dt, Binr, D);
+//
+// Measurement m[2];
+// m[0].type = SENSOR_GYRO; ...
+// m[1].type = SENSOR_MAGNETOMETER; ...
+// if (filter.update(m, 2) != 0) {
+// // handle error, the filter state was not changed
+// }
+//
+// KalmanFilterT<T, Cov> runs the state and measurement models in T and keeps
+// the covariance in Cov. It is compiled for double (KalmanFilter), float and
+// float with a double covariance. The covariance is what loses positive
+// definiteness first in float, P - P*H'*S^-1*H*P cancels most of P once the
+// filter has converged, so the mixed filter keeps the float speed of the
+// models with the double covariance.
+
+#ifndef KalmanFilter_hpp
+#define KalmanFilter_hpp
+
+#include "StateModel.hpp"
+#include "MeasurementModel.hpp"
+
+#define SENSOR_GYRO 0
+#define SENSOR_MAGNETOMETER 1
+#define SENSOR_SUN 2
+
+#define KALMAN_UPDATE_JOINT 0
+#define KALMAN_UPDATE_SEQUENTIAL 1
+
+// max number of sensors that can be batched into a single update.
+#define KALMAN_MAX_BATCH 4
+#define KALMAN_MAX_MEASUREMENT_SIZE (3 * KALMAN_MAX_BATCH)
+
+// a single 3 axis sensor reading.
+template <typename T>
+struct MeasurementT {
+    // SENSOR_GYRO, SENSOR_MAGNETOMETER or SENSOR_SUN
+    int type;
+    // the measured value
+    Matrix<T, 3, 1> z;
+    // diagonal of the measurement noise covariance R (uncorrelated components)
+    Matrix<T, 3, 1> variance;
+    // inertial reference vector for the vector sensors (unused for the gyro)
+    Matrix<T, 3, 1> reference;
+};
+
+typedef MeasurementT<double> Measurement;
+
+template <typename T, typename Cov = T>
+class KalmanFilterT {
+public:
+    typedef Matrix<T, STATE_SIZE, 1> Vector;
+    typedef Matrix<Cov, STATE_SIZE, STATE_SIZE> Covariance;
+    typedef Matrix<T, 3, 1> Vector3;
+
+    // constructor for the kalman filter
+    // @param model - the state model used for prediction
+    // @param x0 - the initial state estimate
+    // @param P0 - the initial state covariance
+    // @param Q - the process noise added on each predict step
+    KalmanFilterT(const StateModelT<T> &model, const Vector &x0,
+                  const Covariance &P0, const Covariance &Q);
+
+    // predict - propagates the state and covariance forward in time.
+    // @param dt - time step (s)
+    // @param Binr - magnetic field in the inertial frame (T)
+    // @param D - the commanded magnetic dipole (A*m^2)
+    void predict(T dt, const Vector3 &Binr, const Vector3 &D);
+
+    // update - applies a batch of measurements using the current update mode.
+    // @param measurements - array of measurements taken at the same time.
+    // @param count - number of measurements in the array (1 to KALMAN_MAX_BATCH)
+    // @return - 0 on success, -1 on failure (the state is left unchanged).
+    int update(const MeasurementT<T> *measurements, int count);
+    int updateJoint(const MeasurementT<T> *measurements, int count);
+    int updateSequential(const MeasurementT<T> *measurements, int count);
+
+    // setUpdateMode - KALMAN_UPDATE_JOINT or KALMAN_UPDATE_SEQUENTIAL
+    void setUpdateMode(int mode) { updateMode = mode; }
+    int getUpdateMode() const { return updateMode; }
+
+    const Vector &getState() const { return x; }
+    const Covariance &getCovariance() const { return P; }
+
+    // getLastNIS - normalized innovation squared y' * S^-1 * y of the last update.
+    // In sequential mode this is the sum of the scalar normalized innovations
+    // which is the same value.
+    double getLastNIS() const { return lastNIS; }
+
+private:
+    const StateModelT<T> &model;
+    Vector x;
+    Covariance P;
+    Covariance Q;
+    int updateMode;
+    double lastNIS;
+
+    // linearize - stacks the predicted measurements, jacobians and noise
+    // for a batch at the current state.
+    // @return - the number of scalar measurements, or -1 for a bad batch.
+    int linearize(const MeasurementT<T> *measurements, int count,
+                  Matrix<T, KALMAN_MAX_MEASUREMENT_SIZE, 1> *y,
+                  Matrix<T, KALMAN_MAX_MEASUREMENT_SIZE, STATE_SIZE> *H,
+                  Matrix<T, KALMAN_MAX_MEASUREMENT_SIZE, 1> *R);
+};
+
+typedef KalmanFilterT<double> KalmanFilter;
+
+#endif /* KalmanFilter_hpp */
@@ -0,0 +1,110 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Lanes.hpp
+//
+// A scalar type that holds N independent values, one per lane, and applies
+// every operation to all of them. Evaluating code written for a template
+// type T (Matrix, Quaternion.hpp, StateModel::derivative) on Lanes<N> runs
+// it for N inputs at once with the data in structure of arrays order, each
+// element of a Matrix<Lanes<N>, ...> is the N values of that element. The
+// loops over the lanes are simple enough for the compiler to vectorize.
+//
+// Example code for use is shown below:
+//
+// Matrix<Lanes<17>, STATE_SIZE, 1> x, xDot;
+// x[0].v[k] = ...;  // component 0 of the k'th state
+// model.derivative(x, Binr, D, &xDot);
+
+#ifndef Lanes_hpp
+#define Lanes_hpp
+
+#include <cmath>
+
+#include "Matrix.hpp"
+
+template <int N>
+class Lanes {
+public:
+    // constructor puts the same value in every lane.
+    Lanes(double value = 0.0) {
+        for (int i = 0; i < N; i++) { v[i] = value; }
+    }
+
+    Lanes &operator+=(const Lanes &b) {
+        for (int i = 0; i < N; i++) { v[i] += b.v[i]; }
+        return *this;
+    }
+    Lanes &operator-=(const Lanes &b) {
+        for (int i = 0; i < N; i++) { v[i] -= b.v[i]; }
+        return *this;
+    }
+    Lanes &operator*=(const Lanes &b) {
+        for (int i = 0; i < N; i++) { v[i] *= b.v[i]; }
+        return *this;
+    }
+    Lanes &operator/=(const Lanes &b) {
+        for (int i = 0; i < N; i++) { v[i] /= b.v[i]; }
+        return *this;
+    }
+    Lanes &operator*=(double s) {
+        for (int i = 0; i < N; i++) { v[i] *= s; }
+        return *this;
+    }
+
+    friend Lanes operator+(Lanes a, const Lanes &b) { a += b; return a; }
+    friend Lanes operator-(Lanes a, const Lanes &b) { a -= b; return a; }
+    friend Lanes operator*(Lanes a, const Lanes &b) { a *= b; return a; }
+    friend Lanes operator/(Lanes a, const Lanes &b) { a /= b; return a; }
+    friend Lanes operator*(Lanes a, double s) { a *= s; return a; }
+    friend Lanes operator*(double s, Lanes a) { a *= s; return a; }
+    friend Lanes operator-(Lanes a) { a *= -1.0; return a; }
+
+    double v[N];
+};
+
+template <int N>
+Lanes<N> sqrt(Lanes<N> a)
+{
+    for (int i = 0; i < N; i++) { a.v[i] = std::sqrt(a.v[i]); }
+    return a;
+}
+
+// operator* - product with a constant matrix, each constant multiplies
+// every lane.
+template <int N, int R, int K, int C>
+Matrix<Lanes<N>, R, C> operator*(const Matrix<double, R, K> &a, const Matrix<Lanes<N>, K, C> &b)
+{
+    Matrix<Lanes<N>, R, C> m;
+    for (int r = 0; r < R; r++) {
+        for (int k = 0; k < K; k++) {
+            double ark = a(r, k);
+            for (int c = 0; c < C; c++) {
+                Lanes<N> &out = m(r, c);
+                const Lanes<N> &bkc = b(k, c);
+                for (int i = 0; i < N; i++) {
+                    out.v[i] += ark * bkc.v[i];
+                }
+            }
+        }
+    }
+    return m;
+}
+
+#endif /* Lanes_hpp */
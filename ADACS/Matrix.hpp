@@ -0,0 +1,408 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Matrix.hpp
+//
+// Small fixed size matrix class used by the ADACS code.
+// All of the storage is inside of the object (row major), so nothing in here
+// ever allocates memory, which keeps it safe to use inside of the control loop.
+// Vectors are just matrices with a single column.
+//
+// Example code for use is shown below:
+//
+// Mat3 I = Mat3::identity();
+// Vec3 v;
+// v[0] = 1.0;
+//
+// Vec3 w = I * v;
+
+#ifndef Matrix_hpp
+#define Matrix_hpp
+
+#include <cmath>
+
+template <typename T, int R, int C>
+class Matrix {
+public:
+    // constructor zeros the matrix.
+    Matrix() {
+        for (int i = 0; i < R*C; i++) { data[i] = T(0); }
+    }
+
+    static Matrix zeros() { return Matrix(); }
+    static Matrix identity() {
+        Matrix m;
+        for (int i = 0; i < R && i < C; i++) { m(i, i) = T(1); }
+        return m;
+    }
+
+    // element access (row, column)
+    T &operator()(int r, int c) { return data[r*C + c]; }
+    const T &operator()(int r, int c) const { return data[r*C + c]; }
+
+    // flat element access, mostly used for vectors.
+    T &operator[](int i) { return data[i]; }
+    const T &operator[](int i) const { return data[i]; }
+
+    int rows() const { return R; }
+    int cols() const { return C; }
+
+    Matrix<T, C, R> transpose() const {
+        Matrix<T, C, R> m;
+        for (int r = 0; r < R; r++) {
+            for (int c = 0; c < C; c++) {
+                m(c, r) = (*this)(r, c);
+            }
+        }
+        return m;
+    }
+
+    Matrix &operator+=(const Matrix &b) {
+        for (int i = 0; i < R*C; i++) { data[i] += b.data[i]; }
+        return *this;
+    }
+    Matrix &operator-=(const Matrix &b) {
+        for (int i = 0; i < R*C; i++) { data[i] -= b.data[i]; }
+        return *this;
+    }
+    Matrix &operator*=(T s) {
+        for (int i = 0; i < R*C; i++) { data[i] *= s; }
+        return *this;
+    }
+
+    T data[R*C];
+};
+
+template <typename T, int R, int C>
+Matrix<T, R, C> operator+(Matrix<T, R, C> a, const Matrix<T, R, C> &b) { a += b; return a; }
+
+template <typename T, int R, int C>
+Matrix<T, R, C> operator-(Matrix<T, R, C> a, const Matrix<T, R, C> &b) { a -= b; return a; }
+
+template <typename T, int R, int C>
+Matrix<T, R, C> operator-(Matrix<T, R, C> a) { a *= T(-1); return a; }
+
+template <typename T, int R, int C>
+Matrix<T, R, C> operator*(Matrix<T, R, C> a, T s) { a *= s; return a; }
+
+template <typename T, int R, int C>
+Matrix<T, R, C> operator*(T s, Matrix<T, R, C> a) { a *= s; return a; }
+
+template <typename T, int R, int K, int C>
+Matrix<T, R, C> operator*(const Matrix<T, R, K> &a, const Matrix<T, K, C> &b)
+{
+    Matrix<T, R, C> m;
+    for (int r = 0; r < R; r++) {
+        for (int k = 0; k < K; k++) {
+            T ark = a(r, k);
+            for (int c = 0; c < C; c++) {
+                m(r, c) += ark * b(k, c);
+            }
+        }
+    }
+    return m;
+}
+
+// vector functions
+template <typename T, int N>
+T dot(const Matrix<T, N, 1> &a, const Matrix<T, N, 1> &b)
+{
+    T sum = T(0);
+    for (int i = 0; i < N; i++) { sum += a[i] * b[i]; }
+    return sum;
+}
+
+template <typename T, int N>
+T norm(const Matrix<T, N, 1> &a)
+{
+    using std::sqrt;
+    return sqrt(dot(a, a));
+}
+
+template <typename T>
+Matrix<T, 3, 1> cross(const Matrix<T, 3, 1> &a, const Matrix<T, 3, 1> &b)
+{
+    Matrix<T, 3, 1> c;
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+    return c;
+}
+
+template <typename T>
+Matrix<T, 3, 1> makeVec3(T x, T y, T z)
+{
+    Matrix<T, 3, 1> v;
+    v[0] = x; v[1] = y; v[2] = z;
+    return v;
+}
+
+// invert3 - closed form inverse of a 3x3 matrix.
+//
+// @param a - the matrix to invert.
+// @param inv - the output inverse.
+// @return - 0 on success, -1 if the matrix is singular.
+template <typename T>
+int invert3(const Matrix<T, 3, 3> &a, Matrix<T, 3, 3> *inv)
+{
+    T c00 = a(1,1) * a(2,2) - a(1,2) * a(2,1);
+    T c01 = a(1,2) * a(2,0) - a(1,0) * a(2,2);
+    T c02 = a(1,0) * a(2,1) - a(1,1) * a(2,0);
+    T det = a(0,0) * c00 + a(0,1) * c01 + a(0,2) * c02;
+    if (det == T(0)) {
+        return -1;
+    }
+    T invDet = T(1) / det;
+
+    (*inv)(0,0) = c00 * invDet;
+    (*inv)(0,1) = (a(0,2) * a(2,1) - a(0,1) * a(2,2)) * invDet;
+    (*inv)(0,2) = (a(0,1) * a(1,2) - a(0,2) * a(1,1)) * invDet;
+    (*inv)(1,0) = c01 * invDet;
+    (*inv)(1,1) = (a(0,0) * a(2,2) - a(0,2) * a(2,0)) * invDet;
+    (*inv)(1,2) = (a(0,2) * a(1,0) - a(0,0) * a(1,2)) * invDet;
+    (*inv)(2,0) = c02 * invDet;
+    (*inv)(2,1) = (a(0,1) * a(2,0) - a(0,0) * a(2,1)) * invDet;
+    (*inv)(2,2) = (a(0,0) * a(1,1) - a(0,1) * a(1,0)) * invDet;
+    return 0;
+}
+
+// choleskySolve - solves A * X = B in place using a Cholesky factorization.
+// Only the leading n x n block of A and the leading n rows, k columns of B are used,
+// so a single fixed size buffer can be used for different sized problems.
+//
+// @param A - symmetric positive definite matrix, overwritten with its factor.
+// @param B - right hand side, overwritten with the solution X.
+// @param n - size of the system to solve.
+// @param k - number of right hand side columns.
+// @return - 0 on success, -1 if A is not positive definite.
+template <typename T, int N, int K>
+int choleskySolve(Matrix<T, N, N> &A, Matrix<T, N, K> &B, int n, int k)
+{
+    using std::sqrt;
+    // factor A = L * L', L stored in the lower triangle of A
+    for (int j = 0; j < n; j++) {
+        T d = A(j, j);
+        for (int p = 0; p < j; p++) { d -= A(j, p) * A(j, p); }
+        if (!(d > T(0))) {
+            return -1;
+        }
+        d = sqrt(d);
+        A(j, j) = d;
+        for (int i = j + 1; i < n; i++) {
+            T s = A(i, j);
+            for (int p = 0; p < j; p++) { s -= A(i, p) * A(j, p); }
+            A(i, j) = s / d;
+        }
+    }
+
+    for (int c = 0; c < k; c++) {
+        // forward substitution L * y = b
+        for (int i = 0; i < n; i++) {
+            T s = B(i, c);
+            for (int p = 0; p < i; p++) { s -= A(i, p) * B(p, c); }
+            B(i, c) = s / A(i, i);
+        }
+        // back substitution L' * x = y
+        for (int i = n - 1; i >= 0; i--) {
+            T s = B(i, c);
+            for (int p = i + 1; p < n; p++) { s -= A(p, i) * B(p, c); }
+            B(i, c) = s / A(i, i);
+        }
+    }
+    return 0;
+}
+
+// choleskyFactor - the lower triangular L with A = L * L'. A zero pivot
+// gives a zero column, so a semidefinite A such as a process noise with
+// some zero variances can be factored.
+// @param A - symmetric positive semidefinite matrix.
+// @param L - output factor.
+// @return - 0 on success, -1 if A is not positive semidefinite.
+template <typename T, int N>
+int choleskyFactor(const Matrix<T, N, N> &A, Matrix<T, N, N> *L)
+{
+    using std::sqrt;
+    *L = Matrix<T, N, N>::zeros();
+    for (int j = 0; j < N; j++) {
+        T d = A(j, j);
+        for (int p = 0; p < j; p++) { d -= (*L)(j, p) * (*L)(j, p); }
+        if (d < T(0)) {
+            return -1;
+        }
+        if (d == T(0)) {
+            continue;
+        }
+        d = sqrt(d);
+        (*L)(j, j) = d;
+        for (int i = j + 1; i < N; i++) {
+            T s = A(i, j);
+            for (int p = 0; p < j; p++) { s -= (*L)(i, p) * (*L)(j, p); }
+            (*L)(i, j) = s / d;
+        }
+    }
+    return 0;
+}
+
+// lqFactor - Householder LQ factorization A = L * Q done in place, which
+// gives the lower triangular L with L * L' = A * A' without ever forming
+// A * A'. Only the leading n rows and k columns (k >= n) of A are used, so a
+// single fixed size buffer can be used for different sized problems.
+// @param A - n x k matrix, the leading n x n block is overwritten with L
+//            (non-negative diagonal) and the rest of it with zeros.
+template <typename T, int N, int K>
+void lqFactor(Matrix<T, N, K> &A, int n, int k)
+{
+    using std::sqrt;
+    for (int j = 0; j < n; j++) {
+        T normSq = T(0);
+        for (int c = j; c < k; c++) { normSq += A(j, c) * A(j, c); }
+        if (normSq == T(0)) {
+            continue;
+        }
+        // reflect row j onto alpha * e_j, alpha with the opposite sign of
+        // A(j, j) so u has no cancellation
+        T alpha = sqrt(normSq);
+        if (A(j, j) > T(0)) {
+            alpha = -alpha;
+        }
+        T u0 = A(j, j) - alpha;
+        // beta = 2 / (u' * u)
+        T beta = T(1) / (normSq - alpha * A(j, j));
+
+        A(j, j) = alpha;
+        for (int r = j + 1; r < n; r++) {
+            T s = A(r, j) * u0;
+            for (int c = j + 1; c < k; c++) { s += A(r, c) * A(j, c); }
+            s *= beta;
+            A(r, j) -= s * u0;
+            for (int c = j + 1; c < k; c++) { A(r, c) -= s * A(j, c); }
+        }
+        for (int c = j + 1; c < k; c++) { A(j, c) = T(0); }
+
+        // flipping the sign of a column of L does not change L * L'
+        if (alpha < T(0)) {
+            for (int r = j; r < n; r++) { A(r, j) = -A(r, j); }
+        }
+    }
+}
+
+// choleskyUpdate - rank one update of a cholesky factor in place,
+// L * L' + sign * v * v'. Only the leading n x n block of L is used.
+// @param L - lower triangular factor with a positive diagonal.
+// @param v - the n element update vector, overwritten.
+// @param sign - 1 to add v * v', -1 to remove it (downdate).
+// @return - 0 on success, -1 if a downdate would leave L * L' not positive
+//           definite (L is then partly updated).
+template <typename T, int N, int K>
+int choleskyUpdate(Matrix<T, N, K> &L, T *v, T sign, int n)
+{
+    using std::sqrt;
+    for (int j = 0; j < n; j++) {
+        T d = L(j, j);
+        T rSq = d * d + sign * v[j] * v[j];
+        if (!(rSq > T(0)) || !(d > T(0))) {
+            return -1;
+        }
+        T r = sqrt(rSq);
+        T c = r / d;
+        T s = v[j] / d;
+        L(j, j) = r;
+        for (int i = j + 1; i < n; i++) {
+            L(i, j) = (L(i, j) + sign * s * v[i]) / c;
+            v[i] = c * v[i] - s * L(i, j);
+        }
+    }
+    return 0;
+}
+
+// luFactor - LU factorization with partial pivoting, done in place.
+// @param A - square matrix, overwritten with L (unit diagonal, below) and U.
+// @param pivot - output row swapped into each row.
+// @return - 0 on success, -1 if A is singular.
+template <typename T, int N>
+int luFactor(Matrix<T, N, N> &A, int *pivot)
+{
+    using std::fabs;
+    for (int j = 0; j < N; j++) {
+        int p = j;
+        for (int i = j + 1; i < N; i++) {
+            if (fabs(A(i, j)) > fabs(A(p, j))) { p = i; }
+        }
+        pivot[j] = p;
+        if (!(A(p, j) != T(0))) {
+            return -1;
+        }
+        if (p != j) {
+            for (int c = 0; c < N; c++) {
+                T tmp = A(j, c);
+                A(j, c) = A(p, c);
+                A(p, c) = tmp;
+            }
+        }
+        for (int i = j + 1; i < N; i++) {
+            T l = A(i, j) / A(j, j);
+            A(i, j) = l;
+            for (int c = j + 1; c < N; c++) {
+                A(i, c) -= l * A(j, c);
+            }
+        }
+    }
+    return 0;
+}
+
+// luSolve - solves A * x = b in place with the factors from luFactor.
+// @param LU - the factored matrix.
+// @param pivot - the pivots from luFactor.
+// @param b - right hand side, overwritten with the solution x.
+template <typename T, int N>
+void luSolve(const Matrix<T, N, N> &LU, const int *pivot, Matrix<T, N, 1> &b)
+{
+    for (int j = 0; j < N; j++) {
+        if (pivot[j] != j) {
+            T tmp = b[j];
+            b[j] = b[pivot[j]];
+            b[pivot[j]] = tmp;
+        }
+    }
+    for (int i = 0; i < N; i++) {
+        T s = b[i];
+        for (int p = 0; p < i; p++) { s -= LU(i, p) * b[p]; }
+        b[i] = s;
+    }
+    for (int i = N - 1; i >= 0; i--) {
+        T s = b[i];
+        for (int p = i + 1; p < N; p++) { s -= LU(i, p) * b[p]; }
+        b[i] = s / LU(i, i);
+    }
+}
+
+// matrixCast - the matrix with each element converted to T.
+template <typename T, typename S, int R, int C>
+Matrix<T, R, C> matrixCast(const Matrix<S, R, C> &a)
+{
+    Matrix<T, R, C> m;
+    for (int i = 0; i < R*C; i++) { m[i] = T(a[i]); }
+    return m;
+}
+
+typedef Matrix<double, 3, 1> Vec3;
+typedef Matrix<double, 4, 1> Vec4;
+typedef Matrix<double, 3, 3> Mat3;
+
+#endif /* Matrix_hpp */
@@ -0,0 +1,105 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  MeasurementModel.cpp
+//
+// Measurement models for the ADACS sensors used by the kalman filter.
+
+#include "MeasurementModel.hpp"
+#include "Quaternion.hpp"
+
+// gyroMeasurement - rate gyro model from KalmanFilterDerivation/H_Derivation.m
+// z = R_eb * Xi(q)' * q_dot, with the q partials from Hout.txt
+// @param x - the state [q; q_dot]
+// @param z - output predicted measurement.
+// @param H - output jacobian.
+template <typename T>
+void gyroMeasurement(const Matrix<T, STATE_SIZE, 1> &x, Matrix<T, 3, 1> *z, Matrix<T, 3, STATE_SIZE> *H)
+{
+    Matrix<T, 4, 1> q, qDot;
+    for (int i = 0; i < 4; i++) {
+        q[i] = x[i];
+        qDot[i] = x[i + 4];
+    }
+
+    // partial with respect to q_dot is just R_eb * Xi(q)'
+    Matrix<T, 3, 4> RXiT = rotationMatrix(q) * Xi(q).transpose();
+    *z = RXiT * qDot;
+
+    T q1 = q[0], q2 = q[1], q3 = q[2], q4 = q[3];
+    T q1d = qDot[0], q2d = qDot[1], q3d = qDot[2], q4d = qDot[3];
+
+    // Hout.txt
+    (*H)(0,0) = q3d*(2*q1*q2 + 4*q3*q4) - q2d*(2*q1*q3 - 4*q2*q4) - q4d*(3*q1*q1 + q2*q2 + q3*q3 + q4*q4) + 2*q1*q4*q1d;
+    (*H)(0,1) = q3d*(q1*q1 + 3*q2*q2 + q3*q3 - 3*q4*q4) + q2d*(4*q1*q4 - 2*q2*q3) - 2*q1*q2*q4d - 6*q2*q4*q1d;
+    (*H)(0,2) = q3d*(4*q1*q4 + 2*q2*q3) - q2d*(q1*q1 + q2*q2 + 3*q3*q3 - 3*q4*q4) - 2*q1*q3*q4d - 6*q3*q4*q1d;
+    (*H)(0,3) = q1d*(q1*q1 - 3*q2*q2 - 3*q3*q3 + 3*q4*q4) + q2d*(4*q1*q2 + 6*q3*q4) + q3d*(4*q1*q3 - 6*q2*q4) - 2*q1*q4*q4d;
+
+    (*H)(1,0) = q1d*(2*q1*q3 + 4*q2*q4) - q3d*(3*q1*q1 + q2*q2 + q3*q3 - 3*q4*q4) - 2*q1*q2*q4d - 6*q1*q4*q2d;
+    (*H)(1,1) = q1d*(4*q1*q4 + 2*q2*q3) - q3d*(2*q1*q2 - 4*q3*q4) - q4d*(q1*q1 + 3*q2*q2 + q3*q3 + q4*q4) + 2*q2*q4*q2d;
+    (*H)(1,2) = q1d*(q1*q1 + q2*q2 + 3*q3*q3 - 3*q4*q4) - q3d*(2*q1*q3 - 4*q2*q4) - 2*q2*q3*q4d - 6*q3*q4*q2d;
+    (*H)(1,3) = q1d*(4*q1*q2 - 6*q3*q4) + q3d*(6*q1*q4 + 4*q2*q3) - q2d*(3*q1*q1 - q2*q2 + 3*q3*q3 - 3*q4*q4) - 2*q2*q4*q4d;
+
+    (*H)(2,0) = q2d*(3*q1*q1 + q2*q2 + q3*q3 - 3*q4*q4) - q1d*(2*q1*q2 - 4*q3*q4) - 2*q1*q3*q4d - 6*q1*q4*q3d;
+    (*H)(2,1) = q2d*(2*q1*q2 + 4*q3*q4) - q1d*(q1*q1 + 3*q2*q2 + q3*q3 - 3*q4*q4) - 2*q2*q3*q4d - 6*q2*q4*q3d;
+    (*H)(2,2) = q1d*(4*q1*q4 - 2*q2*q3) + q2d*(2*q1*q3 + 4*q2*q4) - q4d*(q1*q1 + q2*q2 + 3*q3*q3 + q4*q4) + 2*q3*q4*q3d;
+    (*H)(2,3) = q1d*(4*q1*q3 + 6*q2*q4) - q2d*(6*q1*q4 - 4*q2*q3) - q3d*(3*q1*q1 + 3*q2*q2 - q3*q3 - 3*q4*q4) - 2*q3*q4*q4d;
+
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 4; c++) {
+            (*H)(r, c + 4) = RXiT(r, c);
+        }
+    }
+}
+
+// vectorMeasurement - body frame measurement of a known inertial vector
+// such as the magnetic field (magnetometer) or the sun vector (sun sensor).
+// z = quatTrans(q, ref)
+// @param x - the state [q; q_dot]
+// @param ref - the reference vector in the inertial frame.
+// @param z - output predicted measurement.
+// @param H - output jacobian.
+template <typename T>
+void vectorMeasurement(const Matrix<T, STATE_SIZE, 1> &x, const Matrix<T, 3, 1> &ref,
+                       Matrix<T, 3, 1> *z, Matrix<T, 3, STATE_SIZE> *H)
+{
+    Matrix<T, 4, 1> q;
+    for (int i = 0; i < 4; i++) {
+        q[i] = x[i];
+    }
+
+    *z = quatTrans(q, ref);
+    Matrix<T, 3, 4> J = quatTransJacobian(q, ref);
+
+    *H = Matrix<T, 3, STATE_SIZE>::zeros();
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 4; c++) {
+            (*H)(r, c) = J(r, c);
+        }
+    }
+}
+
+template void gyroMeasurement(const Matrix<float, STATE_SIZE, 1> &, Matrix<float, 3, 1> *,
+                              Matrix<float, 3, STATE_SIZE> *);
+template void gyroMeasurement(const Matrix<double, STATE_SIZE, 1> &, Matrix<double, 3, 1> *,
+                              Matrix<double, 3, STATE_SIZE> *);
+template void vectorMeasurement(const Matrix<float, STATE_SIZE, 1> &, const Matrix<float, 3, 1> &,
+                                Matrix<float, 3, 1> *, Matrix<float, 3, STATE_SIZE> *);
+template void vectorMeasurement(const Matrix<double, STATE_SIZE, 1> &, const Matrix<double, 3, 1> &,
+                                Matrix<double, 3, 1> *, Matrix<double, 3, STATE_SIZE> *);
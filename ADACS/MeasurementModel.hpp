@@ -0,0 +1,100 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  MeasurementModel.hpp
+//
+// Measurement models for the ADACS sensors used by the kalman filter.
+// Each model returns the predicted measurement z = h(x) and its 3x8
+// jacobian H = dh/dx evaluated at the given state, in float or double. The
+// Lanes versions give only z, for N states at once.
+
+#ifndef MeasurementModel_hpp
+#define MeasurementModel_hpp
+
+#include "StateModel.hpp"
+
+typedef Matrix<double, 3, STATE_SIZE> MeasurementJacobian;
+
+// gyroMeasurement - rate gyro model from KalmanFilterDerivation/H_Derivation.m
+// z = R_eb * Xi(q)' * q_dot, with the q partials from Hout.txt
+// @param x - the state [q; q_dot]
+// @param z - output predicted measurement.
+// @param H - output jacobian.
+template <typename T>
+void gyroMeasurement(const Matrix<T, STATE_SIZE, 1> &x, Matrix<T, 3, 1> *z, Matrix<T, 3, STATE_SIZE> *H);
+
+// vectorMeasurement - body frame measurement of a known inertial vector
+// such as the magnetic field (magnetometer) or the sun vector (sun sensor).
+// z = quatTrans(q, ref)
+// @param x - the state [q; q_dot]
+// @param ref - the reference vector in the inertial frame.
+// @param z - output predicted measurement.
+// @param H - output jacobian.
+template <typename T>
+void vectorMeasurement(const Matrix<T, STATE_SIZE, 1> &x, const Matrix<T, 3, 1> &ref,
+                       Matrix<T, 3, 1> *z, Matrix<T, 3, STATE_SIZE> *H);
+
+// gyroMeasurement - the gyro model for N states stored as lanes.
+// @param x - the states [q; q_dot]
+// @param z - output predicted measurements.
+template <int N>
+void gyroMeasurement(const Matrix<Lanes<N>, STATE_SIZE, 1> &x, Matrix<Lanes<N>, 3, 1> *z)
+{
+    for (int k = 0; k < N; k++) {
+        double q0 = x[0].v[k], q1 = x[1].v[k], q2 = x[2].v[k], q3 = x[3].v[k];
+        double qd0 = x[4].v[k], qd1 = x[5].v[k], qd2 = x[6].v[k], qd3 = x[7].v[k];
+
+        // w = Xi(q)' * q_dot
+        double w0 = q3 * qd0 + q2 * qd1 - q1 * qd2 - q0 * qd3;
+        double w1 = -q2 * qd0 + q3 * qd1 + q0 * qd2 - q1 * qd3;
+        double w2 = q1 * qd0 - q0 * qd1 + q3 * qd2 - q2 * qd3;
+
+        // z = R_eb * w, rotationMatrix(q)
+        (*z)[0].v[k] = (q0*q0 - q1*q1 - q2*q2 + q3*q3) * w0 + 2 * (q0*q1 + q2*q3) * w1
+                     + 2 * (q0*q2 - q1*q3) * w2;
+        (*z)[1].v[k] = 2 * (q1*q0 - q2*q3) * w0 + (-q0*q0 + q1*q1 - q2*q2 + q3*q3) * w1
+                     + 2 * (q1*q2 + q0*q3) * w2;
+        (*z)[2].v[k] = 2 * (q2*q0 + q1*q3) * w0 + 2 * (q2*q1 - q0*q3) * w1
+                     + (-q0*q0 - q1*q1 + q2*q2 + q3*q3) * w2;
+    }
+}
+
+// vectorMeasurement - the vector sensor model for N states stored as lanes.
+// @param x - the states [q; q_dot]
+// @param ref - the reference vector in the inertial frame.
+// @param z - output predicted measurements.
+template <int N>
+void vectorMeasurement(const Matrix<Lanes<N>, STATE_SIZE, 1> &x, const Vec3 &ref,
+                       Matrix<Lanes<N>, 3, 1> *z)
+{
+    for (int k = 0; k < N; k++) {
+        double q0 = x[0].v[k], q1 = x[1].v[k], q2 = x[2].v[k], q3 = x[3].v[k];
+
+        // quatTrans(q, ref) = q * [ref; 0] * q^-1
+        double a0 = q3 * ref[0] + q1 * ref[2] - q2 * ref[1];
+        double a1 = q3 * ref[1] - q0 * ref[2] + q2 * ref[0];
+        double a2 = q3 * ref[2] + q0 * ref[1] - q1 * ref[0];
+        double a3 = -(q0 * ref[0] + q1 * ref[1] + q2 * ref[2]);
+        (*z)[0].v[k] = -a3 * q0 + a0 * q3 - a1 * q2 + a2 * q1;
+        (*z)[1].v[k] = -a3 * q1 + a0 * q2 + a1 * q3 - a2 * q0;
+        (*z)[2].v[k] = -a3 * q2 - a0 * q1 + a1 * q0 + a2 * q3;
+    }
+}
+
+#endif /* MeasurementModel_hpp */
@@ -0,0 +1,135 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  OrbitModel.cpp
+//
+// Orbit and magnetic field models used by the attitude simulator.
+
+#include "OrbitModel.hpp"
+
+// defaultOrbit - the orbit from INCA_Dynamics_Solution.m
+OrbitParameters defaultOrbit()
+{
+    OrbitParameters orbit;
+    orbit.rp = 6878;
+    orbit.ecc = 0;
+    orbit.RAAN = 0;
+    orbit.inc = 90;
+    orbit.ArgPer = 0;
+    return orbit;
+}
+
+// orbitPeriod - period of the orbit (s)
+double orbitPeriod(const OrbitParameters &orbit)
+{
+    double a = orbit.rp / (1 - orbit.ecc);
+    return (2 * M_PI / sqrt(EARTH_MU)) * pow(a, 1.5);
+}
+
+// rotation about z by angle, matching the matrices in KeplOrbitModel.m
+static Mat3 rotZ(double angle)
+{
+    Mat3 R;
+    R(0,0) = cos(angle);  R(0,1) = sin(angle);
+    R(1,0) = -sin(angle); R(1,1) = cos(angle);
+    R(2,2) = 1.0;
+    return R;
+}
+
+// rotation about x by angle, matching the matrices in KeplOrbitModel.m
+static Mat3 rotX(double angle)
+{
+    Mat3 R;
+    R(0,0) = 1.0;
+    R(1,1) = cos(angle);  R(1,2) = sin(angle);
+    R(2,1) = -sin(angle); R(2,2) = cos(angle);
+    return R;
+}
+
+// keplOrbitModel - position of the spacecraft in ECI coordinates with the
+// J2 drift of RAAN and the argument of perigee.
+// @param orbit - the orbit parameters
+// @param t - time since perigee (s)
+// @return - position (km)
+Vec3 keplOrbitModel(const OrbitParameters &orbit, double t)
+{
+    double e = orbit.ecc;
+    double a = orbit.rp / (1 - e);
+    double h = sqrt(a * EARTH_MU * (1 - e * e));
+
+    double RAAN = orbit.RAAN * M_PI / 180;
+    double inc = orbit.inc * M_PI / 180;
+    double ArgPer = orbit.ArgPer * M_PI / 180;
+
+    // Calculate Mean Anomaly, reduced to be less then 2pi
+    double Me = (EARTH_MU * EARTH_MU / (h * h * h)) * pow(1 - e * e, 1.5) * t;
+    if (Me > 2 * M_PI) {
+        Me = fmod(Me, 2 * M_PI);
+    }
+
+    // Calculate Eccentric Anomaly
+    double E = (Me < M_PI) ? Me + e / 2 : Me - e / 2;
+    double err = 1;
+    for (int k = 0; err > 1e-14 && k < 100; k++) {
+        double Eold = E;
+        E = Eold - ((Eold - e * sin(Eold) - Me) / (1 - e * cos(Eold)));
+        err = fabs(Eold - E);
+    }
+
+    // Calculate position in the perifocal frame
+    double s = sqrt((1 - e) / (1 + e));
+    double radius = a * (1 - e * cos(E));
+    double nu = 2 * atan((-e * s * tan(E / 2) - s * tan(E / 2)) / (e - 1));
+    if (nu < 0) {
+        nu += 2 * M_PI;
+    }
+    Vec3 r = makeVec3(radius * cos(nu), radius * sin(nu), 0.0);
+
+    // J2 Effects - Assumes constant veriation
+    double k = (3 * sqrt(EARTH_MU) * EARTH_J2 * EARTH_RADIUS * EARTH_RADIUS) /
+               (2 * (1 - e * e) * (1 - e * e) * pow(a, 3.5));
+    RAAN += -k * cos(inc) * t;
+    ArgPer += -k * (2.5 * sin(inc) * sin(inc) - 2) * t;
+
+    // Rotate into ECI Coordinats
+    return rotZ(-RAAN) * (rotX(-inc) * (rotZ(-ArgPer) * r));
+}
+
+// magFieldModel - dipole model of the earth magnetic field at the spacecraft.
+// @param orbit - the orbit parameters
+// @param t - time since perigee (s)
+// @return - the magnetic field in the inertial frame (T)
+Vec3 magFieldModel(const OrbitParameters &orbit, double t)
+{
+    Vec3 rvec = keplOrbitModel(orbit, t);
+
+    double r = norm(rvec);
+    double theta = acos(rvec[2] / r);
+    double phi = atan2(rvec[1] / r, rvec[0] / r);
+
+    // Calculate Magnetic Field - Dipole Model (spherical coordinates)
+    double scale = EARTH_B0 * pow(EARTH_RADIUS / r, 3);
+    double Br = -2 * scale * cos(theta);
+    double Btheta = -scale * sin(theta);
+
+    // Convert Magnetic Field to cartision Coordinats
+    return makeVec3(sin(theta) * cos(phi) * Br + cos(theta) * cos(phi) * Btheta,
+                    sin(theta) * sin(phi) * Br + cos(theta) * sin(phi) * Btheta,
+                    -cos(theta) * Br + sin(theta) * Btheta);
+}
@@ -0,0 +1,77 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  OrbitModel.hpp
+//
+// Orbit and magnetic field models used by the attitude simulator.
+// These are the C++ versions of ADACSDynamics/KeplOrbitModel.m and
+// ADACSDynamics/Mag_Field_Model.m
+//
+// Example code for use is shown below:
+//
+// OrbitParameters orbit = defaultOrbit();
+// Vec3 r = keplOrbitModel(orbit, t);
+// Vec3 Binr = magFieldModel(orbit, t);
+
+#ifndef OrbitModel_hpp
+#define OrbitModel_hpp
+
+#include "Matrix.hpp"
+
+// mue of earth (km^3 * s^-2)
+#define EARTH_MU 398600.44189
+// Radius of earth (km)
+#define EARTH_RADIUS 6378.0
+#define EARTH_J2 1.08263e-3
+// Mean earth magnetic field at eaquator on surface (T)
+#define EARTH_B0 3.12e-5
+
+struct OrbitParameters {
+    // perigee radius (km)
+    double rp;
+    // eccentricity
+    double ecc;
+    // Initial Right Assention of the Assending Node (deg)
+    double RAAN;
+    // Initial Inclination (deg)
+    double inc;
+    // Initial Argument of Perigee (deg)
+    double ArgPer;
+};
+
+// defaultOrbit - the orbit from INCA_Dynamics_Solution.m
+OrbitParameters defaultOrbit();
+
+// orbitPeriod - period of the orbit (s)
+double orbitPeriod(const OrbitParameters &orbit);
+
+// keplOrbitModel - position of the spacecraft in ECI coordinates with the
+// J2 drift of RAAN and the argument of perigee.
+// @param orbit - the orbit parameters
+// @param t - time since perigee (s)
+// @return - position (km)
+Vec3 keplOrbitModel(const OrbitParameters &orbit, double t);
+
+// magFieldModel - dipole model of the earth magnetic field at the spacecraft.
+// @param orbit - the orbit parameters
+// @param t - time since perigee (s)
+// @return - the magnetic field in the inertial frame (T)
+Vec3 magFieldModel(const OrbitParameters &orbit, double t);
+
+#endif /* OrbitModel_hpp */
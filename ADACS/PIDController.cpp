@@ -0,0 +1,158 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  PIDController.cpp
+//
+// Sun pointing PID controller, the C++ version of
+// ADACSDynamics/INCA_PID_Controller.m
+
+#include "PIDController.hpp"
+#include "Quaternion.hpp"
+
+// constructor for the controller
+// @param Kp - proportional gain matrix
+// @param Kd - derivative gain matrix
+// @param Ko - rotation rate gain matrix
+// @param Ki - integral gain matrix
+// @param rTarget - the body axis to point at the sun
+// @param omegaTarget - the desired rotation rate (rad/s)
+template <typename T, typename Time>
+PIDControllerT<T, Time>::PIDControllerT(const Matrix3 &Kp, const Matrix3 &Kd, const Matrix3 &Ko,
+                                        const Matrix3 &Ki, const Vector3 &rTarget,
+                                        const Vector3 &omegaTarget) :
+    Kp(Kp), Kd(Kd), Ko(Ko), Ki(Ki), rTarget(rTarget), omegaTarget(omegaTarget)
+{
+}
+
+// reset - clears the controller history
+template <typename T, typename Time>
+void PIDControllerT<T, Time>::reset(PIDStateT<T, Time> *state) const
+{
+    state->Eold = Vector3();
+    state->Esum = Vector3();
+    state->told = Time(0);
+    state->iOld = 0;
+    state->initialized = false;
+}
+
+// step - calculates the commanded dipole.
+// @param state - the controller history.
+// @param rSun - the sun vector in the body frame.
+// @param B - the magnetic field in the body frame (T)
+// @param t - the current time (s)
+// @param x - the attitude state [q; q_dot]
+// @param i - the step index.
+// @return - the commanded dipole (A*m^2)
+template <typename T, typename Time>
+Matrix<T, 3, 1> PIDControllerT<T, Time>::step(PIDStateT<T, Time> *state, const Vector3 &rSun,
+                                              const Vector3 &B, Time t,
+                                              const Matrix<T, STATE_SIZE, 1> &x, long i) const
+{
+    using std::acos;
+
+    if (!state->initialized ||
+        !(std::isfinite(state->Esum[0]) && std::isfinite(state->Esum[1]) && std::isfinite(state->Esum[2]))) {
+        reset(state);
+        state->initialized = true;
+    }
+
+    // Normalize target and sun vectors
+    Vector3 sun = rSun * (T(1) / norm(rSun));
+    Vector3 target = rTarget * (T(1) / norm(rTarget));
+
+    // Calculate Rotation Rate
+    Matrix<T, 4, 1> q, qDot;
+    for (int k = 0; k < 4; k++) {
+        q[k] = x[k];
+        qDot[k] = x[k + 4];
+    }
+    Vector3 omega = T(-2) * (Xi(q).transpose() * qDot);
+    Vector3 omegaErr = omega - omegaTarget;
+
+    // Calculate Error Vector
+    T c = dot(sun, target);
+    if (c > T(1)) { c = T(1); }
+    if (c < T(-1)) { c = T(-1); }
+    T angle = acos(c) / T(M_PI);
+
+    Vector3 targCrossSun = cross(sun, target);
+    T n = norm(targCrossSun);
+    Vector3 Edes;
+    if (n != T(0)) {
+        Edes = targCrossSun * (angle / n);
+    } else {
+        // Handle error case error is 180deg off
+        Edes = makeVec3(angle, T(0), T(0));
+    }
+
+    // Project Err_des and omegaT onto B plane
+    T B2 = dot(B, B);
+    Vector3 Eact = cross(B, cross(Edes, B)) * (T(1) / B2);
+    omegaErr = cross(B, cross(omegaErr, B)) * (T(1) / B2);
+
+    // Calculate Desired Torque (PID Controller)
+    T delT = T(t - state->told);
+
+    // Integral Term
+    // NOTE: like the MATLAB version this is summed on every call, not only
+    // once per step.
+    state->Esum += Edes * delT;
+
+    // Derivitive Term
+    Vector3 Edot;
+    if (delT != T(0)) {
+        Edot = cross(Eact, state->Eold) * (T(1) / delT);
+    }
+
+    Vector3 tau = Kp * Eact + Kd * Edot + Ko * omegaErr + Ki * state->Esum;
+
+    // Update old terms
+    if (state->iOld < i) {
+        state->told = t;
+        state->Eold = Eact;
+        state->iOld = i;
+    }
+
+    // Convert torque to dipole
+    return cross(B, tau) * (T(1) / B2);
+}
+
+// hold - moves the history on to step i without a sun vector (eclipse).
+// The old error is dropped, it is from before the gap, so the derivative
+// of the first step after it is 0.
+// @param state - the controller history.
+// @param t - the current time (s)
+// @param i - the step index.
+template <typename T, typename Time>
+void PIDControllerT<T, Time>::hold(PIDStateT<T, Time> *state, Time t, long i) const
+{
+    if (!state->initialized) {
+        reset(state);
+        state->initialized = true;
+    } else if (state->iOld >= i) {
+        return;
+    }
+    state->told = t;
+    state->Eold = Vector3();
+    state->iOld = i;
+}
+
+template class PIDControllerT<double>;
+template class PIDControllerT<float>;
+template class PIDControllerT<float, double>;
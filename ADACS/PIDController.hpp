@@ -0,0 +1,112 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  PIDController.hpp
+//
+// Sun pointing PID controller, the C++ version of
+// ADACSDynamics/INCA_PID_Controller.m
+//
+// The error vector is the rotation from the body sun vector to the target
+// axis, projected onto the plane perpendicular to B since the torquers can
+// only make torque in that plane.
+//
+// tau = Kp * E_act + Kd * E_dot + Ko * omegaErr + Ki * E_sum
+// D = cross(B, tau) / norm(B)^2
+//
+// Like BdotController the history is kept in a PIDState that is passed in
+// and nothing in here allocates memory. PIDControllerT<T, Time> is compiled
+// for the same scalar types as BdotControllerT.
+//
+// Example code for use is shown below:
+//
+// PIDController pid(Kp, Kd, Ko, Ki, rTarget, omegaTarget);
+// PIDState state;
+// pid.reset(&state);
+//
+// Vec3 D = pid.step(&state, rSunBody, Bbody, t, x, i);
+
+#ifndef PIDController_hpp
+#define PIDController_hpp
+
+#include "StateModel.hpp"
+
+// history of the PID controller (the MATLAB persistent variables)
+template <typename T, typename Time = T>
+struct PIDStateT {
+    Matrix<T, 3, 1> Eold;
+    Matrix<T, 3, 1> Esum;
+    Time told;
+    long iOld;
+    bool initialized;
+};
+
+template <typename T, typename Time = T>
+class PIDControllerT {
+public:
+    typedef Matrix<T, 3, 1> Vector3;
+    typedef Matrix<T, 3, 3> Matrix3;
+
+    // constructor for the controller
+    // @param Kp - proportional gain matrix
+    // @param Kd - derivative gain matrix
+    // @param Ko - rotation rate gain matrix
+    // @param Ki - integral gain matrix
+    // @param rTarget - the body axis to point at the sun
+    // @param omegaTarget - the desired rotation rate (rad/s)
+    PIDControllerT(const Matrix3 &Kp, const Matrix3 &Kd, const Matrix3 &Ko, const Matrix3 &Ki,
+                   const Vector3 &rTarget, const Vector3 &omegaTarget);
+
+    // reset - clears the controller history
+    void reset(PIDStateT<T, Time> *state) const;
+
+    // step - calculates the commanded dipole.
+    // The derivative history is only updated the first time step is called
+    // with a new step index i.
+    // @param state - the controller history.
+    // @param rSun - the sun vector in the body frame.
+    // @param B - the magnetic field in the body frame (T)
+    // @param t - the current time (s)
+    // @param x - the attitude state [q; q_dot]
+    // @param i - the step index.
+    // @return - the commanded dipole (A*m^2)
+    Vector3 step(PIDStateT<T, Time> *state, const Vector3 &rSun, const Vector3 &B, Time t,
+                 const Matrix<T, STATE_SIZE, 1> &x, long i) const;
+
+    // hold - moves the history on to step i without a sun vector (eclipse),
+    // so the first step() after it does not integrate or differentiate the
+    // error over the time the controller was not running. The integral is
+    // kept.
+    // @param state - the controller history.
+    // @param t - the current time (s)
+    // @param i - the step index.
+    void hold(PIDStateT<T, Time> *state, Time t, long i) const;
+
+private:
+    Matrix3 Kp;
+    Matrix3 Kd;
+    Matrix3 Ko;
+    Matrix3 Ki;
+    Vector3 rTarget;
+    Vector3 omegaTarget;
+};
+
+typedef PIDStateT<double> PIDState;
+typedef PIDControllerT<double> PIDController;
+
+#endif /* PIDController_hpp */
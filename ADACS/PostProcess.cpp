@@ -0,0 +1,406 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  PostProcess.cpp
+//
+// Streaming post processing of trajectory files on a pool of threads.
+
+#include "PostProcess.hpp"
+#include "Quaternion.hpp"
+#include "Lanes.hpp"
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cmath>
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+#define POSTPROCESS_BUCKETS (POSTPROCESS_BUCKETS_PER_DECADE * POSTPROCESS_DECADES + 1)
+
+// defaultPostProcessOptions - 1 deg/s and 5 deg thresholds, no channels.
+PostProcessOptions defaultPostProcessOptions()
+{
+    PostProcessOptions options;
+    options.rateThreshold = 1.0;
+    options.pointingThreshold = 5.0;
+    options.threads = 0;
+    options.channelInterval = 0.0;
+    return options;
+}
+
+// deriveChannels - the derived channels of every sample in a chunk.
+void deriveChannels(const TrajectoryHeader &header, const TrajectoryChunk &chunk,
+                    DerivedChannels *channels)
+{
+    typedef Lanes<POSTPROCESS_LANES> L;
+    const int n = chunk.count;
+    channels->count = n;
+
+    for (int start = 0; start < n; start += POSTPROCESS_LANES) {
+        // the lanes past the end of the chunk repeat the last sample
+        int index[POSTPROCESS_LANES];
+        for (int i = 0; i < POSTPROCESS_LANES; i++) {
+            index[i] = start + i < n ? start + i : n - 1;
+        }
+
+        Matrix<L, 4, 1> q, qDot;
+        Matrix<L, 3, 1> sun;
+        for (int c = 0; c < 4; c++) {
+            for (int i = 0; i < POSTPROCESS_LANES; i++) {
+                q[c].v[i] = chunk.x[c][index[i]];
+                qDot[c].v[i] = chunk.x[c + 4][index[i]];
+            }
+        }
+        for (int i = 0; i < POSTPROCESS_LANES; i++) {
+            Vec3 rSun = sunDirection(header.sunModel, header.rSun, header.epochJD, chunk.t[index[i]]);
+            for (int c = 0; c < 3; c++) {
+                sun[c].v[i] = rSun[c];
+            }
+        }
+
+        Matrix<L, 3, 1> omega = (Xi(q).transpose() * qDot) * L(2.0);
+        L omegaNorm = norm(omega);
+        L qNorm = norm(q);
+        Matrix<L, 3, 1> sunBody = quatTrans(q, sun);
+
+        int count = n - start < POSTPROCESS_LANES ? n - start : POSTPROCESS_LANES;
+        for (int i = 0; i < count; i++) {
+            for (int c = 0; c < 3; c++) {
+                channels->omega[c][start + i] = omega[c].v[i];
+                channels->sunBody[c][start + i] = sunBody[c].v[i];
+            }
+            channels->omegaNorm[start + i] = omegaNorm.v[i];
+            channels->qNorm[start + i] = qNorm.v[i];
+        }
+    }
+
+    for (int k = 0; k < n; k++) {
+        Vec3 sunBody = makeVec3(channels->sunBody[0][k], channels->sunBody[1][k],
+                                channels->sunBody[2][k]);
+        channels->pointing[k] = pointingAngle(sunBody, header.rTarget);
+    }
+}
+
+// time weighted histogram for the percentiles of one channel
+class WeightedHistogram {
+public:
+    WeightedHistogram() : weights(POSTPROCESS_BUCKETS, 0.0), total(0.0) {}
+
+    void add(double value, double weight)
+    {
+        weights[bucketIndex(value)] += weight;
+        total += weight;
+    }
+
+    void merge(const WeightedHistogram &other)
+    {
+        for (int k = 0; k < POSTPROCESS_BUCKETS; k++) {
+            weights[k] += other.weights[k];
+        }
+        total += other.total;
+    }
+
+    // percentile - the upper bound of the bucket holding percentile p, or
+    // max if that is smaller.
+    double percentile(double p, double max) const
+    {
+        double target = total * p / 100;
+        double sum = 0.0;
+        for (int k = 0; k < POSTPROCESS_BUCKETS; k++) {
+            sum += weights[k];
+            if (sum >= target && sum > 0.0) {
+                return fmin(bucketUpper(k), max);
+            }
+        }
+        return max;
+    }
+
+private:
+    vector<double> weights;
+    double total;
+
+    // bucket 0 is everything up to 10^POSTPROCESS_MIN_DECADE
+    static int bucketIndex(double value)
+    {
+        static const double lowest = pow(10.0, POSTPROCESS_MIN_DECADE);
+        if (!(value > lowest)) {
+            return 0;
+        }
+        double k = ceil((log10(value) - POSTPROCESS_MIN_DECADE) * POSTPROCESS_BUCKETS_PER_DECADE);
+        return k < POSTPROCESS_BUCKETS - 1 ? (int)k : POSTPROCESS_BUCKETS - 1;
+    }
+
+    static double bucketUpper(int index)
+    {
+        return pow(10.0, POSTPROCESS_MIN_DECADE + (double)index / POSTPROCESS_BUCKETS_PER_DECADE);
+    }
+};
+
+// running statistics of one channel
+struct ChannelStats {
+    double sumSq;
+    double max;
+    // last time above the threshold, and if the last sample was
+    bool above;
+    double lastAbove;
+    bool endAbove;
+    WeightedHistogram histogram;
+
+    ChannelStats() : sumSq(0.0), max(0.0), above(false), lastAbove(0.0), endAbove(false) {}
+
+    void add(double t, double value, double weight, double threshold)
+    {
+        sumSq += weight * value * value;
+        max = fmax(max, value);
+        histogram.add(value, weight);
+        endAbove = value > threshold;
+        if (endAbove) {
+            above = true;
+            lastAbove = t;
+        }
+    }
+
+    // merge - adds the statistics of the chunk after this one.
+    void merge(const ChannelStats &next)
+    {
+        sumSq += next.sumSq;
+        max = fmax(max, next.max);
+        histogram.merge(next.histogram);
+        if (next.above) {
+            above = true;
+            lastAbove = next.lastAbove;
+        }
+        endAbove = next.endAbove;
+    }
+
+    void summary(double weight, ChannelSummary *out) const
+    {
+        out->rms = weight > 0.0 ? sqrt(sumSq / weight) : max;
+        out->p50 = histogram.percentile(50, max);
+        out->p90 = histogram.percentile(90, max);
+        out->p99 = histogram.percentile(99, max);
+        out->max = max;
+        out->settled = endAbove ? -1.0 : (above ? lastAbove : 0.0);
+    }
+};
+
+// the statistics and channel rows of a run of chunks
+struct ChunkResult {
+    uint64_t samples;
+    double t;
+    double weight;
+    double qNormError;
+    ChannelStats rate;
+    ChannelStats pointing;
+    string rows;
+
+    ChunkResult() : samples(0), t(0.0), weight(0.0), qNormError(0.0) {}
+
+    void merge(const ChunkResult &next)
+    {
+        samples += next.samples;
+        t = next.t;
+        weight += next.weight;
+        qNormError = fmax(qNormError, next.qNormError);
+        rate.merge(next.rate);
+        pointing.merge(next.pointing);
+    }
+};
+
+// processChunk - the statistics of one chunk, and its rows of the channels
+// table.
+static void processChunk(const TrajectoryChunk &chunk, const DerivedChannels &channels,
+                         const PostProcessOptions &options, bool first, ChunkResult *result)
+{
+    const bool writeRows = !options.channelsPath.empty();
+    char buffer[320];
+    double tPrev = chunk.tPrev;
+    for (int k = 0; k < chunk.count; k++) {
+        double t = chunk.t[k];
+        double weight = t - tPrev;
+        double rate = channels.omegaNorm[k] * 180 / M_PI;
+        result->rate.add(t, rate, weight, options.rateThreshold);
+        result->pointing.add(t, channels.pointing[k], weight, options.pointingThreshold);
+        result->qNormError = fmax(result->qNormError, fabs(channels.qNorm[k] - 1.0));
+        result->weight += weight;
+
+        bool row = writeRows && (options.channelInterval <= 0.0 || (first && k == 0) ||
+                                 floor(t / options.channelInterval) > floor(tPrev / options.channelInterval));
+        if (row) {
+            snprintf(buffer, sizeof(buffer), "%.9g %.9g %.9g %.9g %.9g %.12g %.9g %.9g %.9g %.9g\n", t,
+                     channels.omega[0][k], channels.omega[1][k], channels.omega[2][k],
+                     channels.omegaNorm[k], channels.qNorm[k], channels.sunBody[0][k],
+                     channels.sunBody[1][k], channels.sunBody[2][k], channels.pointing[k]);
+            result->rows += buffer;
+        }
+        tPrev = t;
+    }
+    result->samples = chunk.count;
+    result->t = tPrev;
+}
+
+// processTrajectory - the summary of a trajectory file, and the table of
+// derived channels if options.channelsPath is set.
+// @return - 0 on success, -1 on failure.
+int processTrajectory(const string &path, const PostProcessOptions &options,
+                      TrajectorySummary *summary)
+{
+    TrajectoryReader reader;
+    if (reader.open(path) != 0) {
+        return -1;
+    }
+
+    ofstream out;
+    if (!options.channelsPath.empty()) {
+        out.open(options.channelsPath.c_str(), ios::trunc);
+        if (!out.is_open()) {
+            ErrorManager::ERROR(ADACS_TRAJECTORY_WRITE_FAILED);
+            return -1;
+        }
+        out << "# t omega1 omega2 omega3 omega_norm q_norm sun1 sun2 sun3 pointing" << endl;
+    }
+
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = thread::hardware_concurrency();
+        if (threads <= 0) { threads = 1; }
+    }
+
+    const size_t chunks = reader.chunks();
+    const size_t window = (size_t)threads * POSTPROCESS_WINDOW_PER_THREAD;
+
+    // everything below is guarded by lock
+    mutex lock;
+    condition_variable ready;
+    size_t next = 0;
+    size_t merged = 0;
+    bool failed = false;
+    ChunkResult total;
+    // finished chunks waiting for the chunks before them
+    map<size_t, ChunkResult *> pending;
+
+    auto worker = [&]() {
+        TrajectoryChunk *chunk = new TrajectoryChunk;
+        DerivedChannels *channels = new DerivedChannels;
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            ready.wait(guard, [&]() { return next >= chunks || failed || next < merged + window; });
+            if (next >= chunks || failed) {
+                break;
+            }
+            size_t index = next++;
+            guard.unlock();
+
+            ChunkResult *result = new ChunkResult;
+            int ret = reader.readChunk(index, chunk);
+            if (ret == 0) {
+                deriveChannels(reader.getHeader(), *chunk, channels);
+                processChunk(*chunk, *channels, options, index == 0, result);
+            }
+
+            guard.lock();
+            if (ret != 0) {
+                failed = true;
+                delete result;
+                ready.notify_all();
+                break;
+            }
+            pending[index] = result;
+            map<size_t, ChunkResult *>::iterator itr;
+            while ((itr = pending.find(merged)) != pending.end()) {
+                total.merge(*itr->second);
+                out << itr->second->rows;
+                delete itr->second;
+                pending.erase(itr);
+                merged++;
+            }
+            ready.notify_all();
+        }
+        guard.unlock();
+        delete chunk;
+        delete channels;
+    };
+
+    vector<thread> pool;
+    for (int k = 1; k < threads; k++) {
+        pool.push_back(thread(worker));
+    }
+    worker();
+    for (size_t k = 0; k < pool.size(); k++) {
+        pool[k].join();
+    }
+    for (map<size_t, ChunkResult *>::iterator itr = pending.begin(); itr != pending.end(); itr++) {
+        delete itr->second;
+    }
+    if (failed) {
+        return -1;
+    }
+
+    if (out.is_open()) {
+        out.close();
+        if (!out) {
+            ErrorManager::ERROR(ADACS_TRAJECTORY_WRITE_FAILED);
+            return -1;
+        }
+    }
+
+    summary->samples = total.samples;
+    summary->t = total.t;
+    total.rate.summary(total.weight, &summary->rate);
+    total.pointing.summary(total.weight, &summary->pointing);
+    summary->qNormError = total.qNormError;
+    return 0;
+}
+
+// writeSummaryTable - one line per trajectory.
+// @return - 0 on success, -1 if the table can't be written.
+int writeSummaryTable(const string &path, const vector<string> &names,
+                      const vector<TrajectorySummary> &summaries)
+{
+    ofstream out(path.c_str(), ios::trunc);
+    if (!out.is_open()) {
+        ErrorManager::ERROR(ADACS_TRAJECTORY_WRITE_FAILED);
+        return -1;
+    }
+    out << "# name samples t rate_rms rate_p50 rate_p90 rate_p99 rate_max detumbled"
+           " pointing_rms pointing_p50 pointing_p90 pointing_p99 pointing_max settled q_norm_error"
+        << endl;
+
+    char buffer[512];
+    for (size_t k = 0; k < summaries.size() && k < names.size(); k++) {
+        const TrajectorySummary &s = summaries[k];
+        snprintf(buffer, sizeof(buffer),
+                 " %llu %.9g %.6g %.6g %.6g %.6g %.6g %.9g %.6g %.6g %.6g %.6g %.6g %.9g %.3g\n",
+                 (unsigned long long)s.samples, s.t, s.rate.rms, s.rate.p50, s.rate.p90,
+                 s.rate.p99, s.rate.max, s.rate.settled, s.pointing.rms, s.pointing.p50,
+                 s.pointing.p90, s.pointing.p99, s.pointing.max, s.pointing.settled, s.qNormError);
+        out << names[k] << buffer;
+    }
+
+    out.close();
+    if (!out) {
+        ErrorManager::ERROR(ADACS_TRAJECTORY_WRITE_FAILED);
+        return -1;
+    }
+    return 0;
+}
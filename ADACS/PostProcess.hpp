@@ -0,0 +1,147 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  PostProcess.hpp
+//
+// Post processing of trajectory files, the "Format Output" and plot sections
+// of INCA_Dynamics_Solution.m without holding the run in memory.
+//
+// The chunks of a trajectory are read and processed on a pool of threads.
+// deriveChannels() makes the derived channels of a chunk:
+//  omega_out  = 2 * Xi(q)' * q_dot (rad/s) and omega_norm
+//  q_norm     = |q|
+//  r_sun_body = quatTrans(q, r_sun)
+//  pointing   = the ErrorAngle between r_sun_body and rTarget (deg)
+// evaluated LANES samples at a time on Lanes (see Lanes.hpp). The summary of
+// each chunk is merged into the summary of the run in chunk order, so the
+// result does not depend on the number of threads, and a thread never gets
+// more than POSTPROCESS_WINDOW_PER_THREAD chunks ahead of the merge per
+// thread.
+//
+// The samples are the accepted steps, not the spline resampled tOut, so every
+// statistic is weighted by the time since the sample before it. Percentiles
+// come from a histogram with POSTPROCESS_BUCKETS_PER_DECADE log spaced
+// buckets, and are the upper bound of their bucket (within 4%).
+//
+// Example code for use is shown below:
+//
+// PostProcessOptions options = defaultPostProcessOptions();
+// options.channelsPath = "run.txt";
+// options.channelInterval = 10;
+// TrajectorySummary summary;
+// if (processTrajectory("run.traj", options, &summary) != 0) {
+// // handle error, the trajectory could not be read
+// }
+
+#ifndef PostProcess_hpp
+#define PostProcess_hpp
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Trajectory.hpp"
+
+using namespace std;
+
+// samples evaluated together by deriveChannels()
+#define POSTPROCESS_LANES 8
+// how far ahead of the merge each thread can run
+#define POSTPROCESS_WINDOW_PER_THREAD 4
+// percentile histogram, log spaced from 10^POSTPROCESS_MIN_DECADE up
+#define POSTPROCESS_BUCKETS_PER_DECADE 64
+#define POSTPROCESS_MIN_DECADE -9
+#define POSTPROCESS_DECADES 18
+
+// the derived channels of one chunk, sample k of a channel is [.][k]
+struct DerivedChannels {
+    int count;
+    // omega_out (rad/s) and omega_norm
+    double omega[3][TRAJECTORY_CHUNK_SAMPLES];
+    double omegaNorm[TRAJECTORY_CHUNK_SAMPLES];
+    double qNorm[TRAJECTORY_CHUNK_SAMPLES];
+    // sun vector in the body frame
+    double sunBody[3][TRAJECTORY_CHUNK_SAMPLES];
+    // angle between the sun and rTarget (deg)
+    double pointing[TRAJECTORY_CHUNK_SAMPLES];
+};
+
+// deriveChannels - the derived channels of every sample in a chunk.
+void deriveChannels(const TrajectoryHeader &header, const TrajectoryChunk &chunk,
+                    DerivedChannels *channels);
+
+// time weighted statistics of one channel
+struct ChannelSummary {
+    double rms;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+    // settling time, the last time the channel was above its threshold. 0 if
+    // it never was, -1 if it still is at the end of the run.
+    double settled;
+};
+
+struct TrajectorySummary {
+    uint64_t samples;
+    // end time (s)
+    double t;
+    // omega_norm (deg/s), settled is the detumble time
+    ChannelSummary rate;
+    // pointing error (deg)
+    ChannelSummary pointing;
+    // largest ||q| - 1|
+    double qNormError;
+};
+
+struct PostProcessOptions {
+    // the rate (deg/s) and pointing error (deg) thresholds of the settling
+    // times
+    double rateThreshold;
+    double pointingThreshold;
+    // number of threads, 0 for one per core.
+    int threads;
+    // text table of the derived channels, empty for none
+    string channelsPath;
+    // the first sample at or after every multiple of channelInterval (s) is
+    // written, 0 for every sample.
+    double channelInterval;
+};
+
+// defaultPostProcessOptions - 1 deg/s and 5 deg thresholds, no channels.
+PostProcessOptions defaultPostProcessOptions();
+
+// processTrajectory - the summary of a trajectory file, and the table of
+// derived channels if options.channelsPath is set.
+// @param path - the trajectory file
+// @param options - thresholds, threads and the channels table
+// @param summary - output summary.
+// @return - 0 on success, -1 on failure.
+int processTrajectory(const string &path, const PostProcessOptions &options,
+                      TrajectorySummary *summary);
+
+// writeSummaryTable - one line per trajectory:
+//  name samples t rate_rms rate_p50 rate_p90 rate_p99 rate_max detumbled
+//  pointing_rms pointing_p50 pointing_p90 pointing_p99 pointing_max settled
+//  q_norm_error
+// @return - 0 on success, -1 if the table can't be written.
+int writeSummaryTable(const string &path, const vector<string> &names,
+                      const vector<TrajectorySummary> &summaries);
+
+#endif /* PostProcess_hpp */
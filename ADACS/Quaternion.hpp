@@ -0,0 +1,131 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Quaternion.hpp
+//
+// Quaternion helper functions matching the ones used in the MATLAB models
+// (ADACSDynamics/INCA_State_Model.m).
+// Quaternions are stored as q = [q1, q2, q3, q4] where q4 is the scalar part.
+
+#ifndef Quaternion_hpp
+#define Quaternion_hpp
+
+#include "Matrix.hpp"
+
+// hamMult - hamiltonian multiplication x * y
+template <typename T>
+Matrix<T, 4, 1> hamMult(const Matrix<T, 4, 1> &x, const Matrix<T, 4, 1> &y)
+{
+    Matrix<T, 4, 1> z;
+    // i component
+    z[0] = x[3] * y[0] + x[0] * y[3] + x[1] * y[2] - x[2] * y[1];
+    // j component
+    z[1] = x[3] * y[1] - x[0] * y[2] + x[1] * y[3] + x[2] * y[0];
+    // k component
+    z[2] = x[3] * y[2] + x[0] * y[1] - x[1] * y[0] + x[2] * y[3];
+    // scalar component
+    z[3] = x[3] * y[3] - x[0] * y[0] - x[1] * y[1] - x[2] * y[2];
+    return z;
+}
+
+// quatInv - conjugate of the quaternion (inverse for a unit quaternion)
+template <typename T>
+Matrix<T, 4, 1> quatInv(const Matrix<T, 4, 1> &q)
+{
+    Matrix<T, 4, 1> r;
+    r[0] = -q[0]; r[1] = -q[1]; r[2] = -q[2]; r[3] = q[3];
+    return r;
+}
+
+// quatTrans - rotates the vector v by q (q * [v; 0] * q^-1)
+template <typename T>
+Matrix<T, 3, 1> quatTrans(const Matrix<T, 4, 1> &q, const Matrix<T, 3, 1> &v)
+{
+    Matrix<T, 4, 1> vq;
+    vq[0] = v[0]; vq[1] = v[1]; vq[2] = v[2]; vq[3] = T(0);
+    Matrix<T, 4, 1> r = hamMult(hamMult(q, vq), quatInv(q));
+
+    Matrix<T, 3, 1> out;
+    out[0] = r[0]; out[1] = r[1]; out[2] = r[2];
+    return out;
+}
+
+// quatTransJacobian - the 3x4 jacobian of quatTrans(q, v) with respect to q
+// column j is the vector part of e_j * v * q^-1 + q * v * e_j^-1
+template <typename T>
+Matrix<T, 3, 4> quatTransJacobian(const Matrix<T, 4, 1> &q, const Matrix<T, 3, 1> &v)
+{
+    Matrix<T, 4, 1> vq;
+    vq[0] = v[0]; vq[1] = v[1]; vq[2] = v[2]; vq[3] = T(0);
+    Matrix<T, 4, 1> vqInv = hamMult(vq, quatInv(q));
+    Matrix<T, 4, 1> qv = hamMult(q, vq);
+
+    Matrix<T, 3, 4> J;
+    for (int j = 0; j < 4; j++) {
+        Matrix<T, 4, 1> e;
+        e[j] = T(1);
+        Matrix<T, 4, 1> d = hamMult(e, vqInv) + hamMult(qv, quatInv(e));
+        J(0, j) = d[0]; J(1, j) = d[1]; J(2, j) = d[2];
+    }
+    return J;
+}
+
+// Xi - the 4x3 matrix relating quaternion rates to the body rotation rate
+// q_dot = 0.5 * Xi(q) * omega
+template <typename T>
+Matrix<T, 4, 3> Xi(const Matrix<T, 4, 1> &q)
+{
+    Matrix<T, 4, 3> m;
+    m(0,0) =  q[3]; m(0,1) = -q[2]; m(0,2) =  q[1];
+    m(1,0) =  q[2]; m(1,1) =  q[3]; m(1,2) = -q[0];
+    m(2,0) = -q[1]; m(2,1) =  q[0]; m(2,2) =  q[3];
+    m(3,0) = -q[0]; m(3,1) = -q[1]; m(3,2) = -q[2];
+    return m;
+}
+
+// rotationMatrix - R_eb from KalmanFilterDerivation/H_Derivation.m
+template <typename T>
+Matrix<T, 3, 3> rotationMatrix(const Matrix<T, 4, 1> &q)
+{
+    T q1 = q[0], q2 = q[1], q3 = q[2], q4 = q[3];
+    Matrix<T, 3, 3> R;
+    R(0,0) = q1*q1 - q2*q2 - q3*q3 + q4*q4;
+    R(0,1) = T(2) * (q1*q2 + q3*q4);
+    R(0,2) = T(2) * (q1*q3 - q2*q4);
+    R(1,0) = T(2) * (q2*q1 - q3*q4);
+    R(1,1) = -q1*q1 + q2*q2 - q3*q3 + q4*q4;
+    R(1,2) = T(2) * (q2*q3 + q1*q4);
+    R(2,0) = T(2) * (q3*q1 + q2*q4);
+    R(2,1) = T(2) * (q3*q2 - q1*q4);
+    R(2,2) = -q1*q1 - q2*q2 + q3*q3 + q4*q4;
+    return R;
+}
+
+// normalizeQuat - normalizes the quaternion part of a vector in place.
+template <typename T, int N>
+void normalizeQuat(Matrix<T, N, 1> &x)
+{
+    using std::sqrt;
+    T n = sqrt(x[0]*x[0] + x[1]*x[1] + x[2]*x[2] + x[3]*x[3]);
+    if (n > T(0)) {
+        for (int i = 0; i < 4; i++) { x[i] = x[i] / n; }
+    }
+}
+
+#endif /* Quaternion_hpp */
@@ -0,0 +1,76 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Random.hpp
+//
+// Small random number generator for the simulations. The whole generator
+// state is a single uint64_t (splitmix64) so it can be copied into a
+// checkpoint and restored bit exactly, unlike the <random> engines whose
+// state can only be saved as text.
+//
+// Example code for use is shown below:
+//
+// Random rng(42);
+// double n = rng.normal();
+// uint64_t saved = rng.getState();
+// ...
+// rng.setState(saved);
+
+#ifndef Random_hpp
+#define Random_hpp
+
+#include <cstdint>
+#include <cmath>
+
+class Random {
+public:
+    Random(uint64_t seed = 0) : state(seed) {}
+
+    // next - next 64 random bits
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // uniform - uniform random number in (0, 1]
+    double uniform()
+    {
+        return ((next() >> 11) + 1) * (1.0 / 9007199254740992.0);
+    }
+
+    // normal - standard normal random number (Box-Muller, no cached value so
+    // the state stays a single integer)
+    double normal()
+    {
+        double u1 = uniform();
+        double u2 = uniform();
+        return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+    }
+
+    uint64_t getState() const { return state; }
+    void setState(uint64_t s) { state = s; }
+
+private:
+    uint64_t state;
+};
+
+#endif /* Random_hpp */
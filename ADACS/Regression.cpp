@@ -0,0 +1,495 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Regression.cpp
+//
+// Reference scenarios, golden outputs and the regression report.
+
+#include "Regression.hpp"
+#include "Quaternion.hpp"
+#include "Timing.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cmath>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+// referenceScenarios - the scenarios of the harness.
+vector<RegressionScenario> referenceScenarios()
+{
+    vector<RegressionScenario> scenarios;
+
+    RegressionScenario defaults;
+    defaults.name = "default";
+    defaults.scenario = defaultScenario();
+    defaults.pointingTolerance = 1.0;
+    defaults.rateTolerance = 1e-3;
+    scenarios.push_back(defaults);
+
+    // D = Kb * Bdot / |B| so Kb has to be negative to take energy out
+    RegressionScenario detumble;
+    detumble.name = "detumble";
+    detumble.scenario = defaultScenario();
+    detumble.scenario.sim.runTime = 4 * 3600;
+    ControllerGains &gains = detumble.scenario.gains;
+    gains.Kb = Mat3::identity() * -1.0;
+    gains.Kp = Mat3::zeros();
+    gains.Kd = Mat3::zeros();
+    gains.Ko = Mat3::zeros();
+    gains.Ki = Mat3::zeros();
+    detumble.pointingTolerance = 1.0;
+    detumble.rateTolerance = 1e-3;
+    scenarios.push_back(detumble);
+
+    RegressionScenario pointing;
+    pointing.name = "pointing";
+    pointing.scenario = defaultScenario();
+    pointing.scenario.sim.runTime = 4 * 3600;
+    pointing.scenario.initAxis = makeVec3(1.0, 1.0, 0.0);
+    pointing.scenario.initTheta = 30;
+    pointing.scenario.initOmega = makeVec3(0.2, -0.1, 0.1);
+    pointing.scenario.x0 = initialState(pointing.scenario.initAxis, pointing.scenario.initTheta * M_PI / 180,
+                                        pointing.scenario.initOmega * (M_PI / 180));
+    pointing.pointingTolerance = 0.01;
+    pointing.rateTolerance = 1e-5;
+    scenarios.push_back(pointing);
+
+    return scenarios;
+}
+
+// sampleOf - the pointing error and rate of a state
+static RegressionSample sampleOf(const Scenario &scenario, double t, const StateVector &w)
+{
+    Vec4 q, qDot;
+    for (int k = 0; k < 4; k++) {
+        q[k] = w[k];
+        qDot[k] = w[k + 4];
+    }
+    const SimulatorConfig &sim = scenario.sim;
+    Vec3 rSun = sunDirection(sim.sunModel, sim.rSun, sim.epochJD, t);
+
+    RegressionSample sample;
+    sample.t = t;
+    sample.pointing = pointingAngle(q, rSun, scenario.gains.rTarget);
+    sample.rate = norm(2.0 * (Xi(q).transpose() * qDot)) * 180 / M_PI;
+    return sample;
+}
+
+// simulate - runs a scenario in this process, everything but peakRSS.
+static void simulate(const RegressionScenario &scenario, RegressionRun *run)
+{
+    SimulatorConfig config = scenario.scenario.sim;
+    config.statusInterval = 0;
+    const double tEnd = config.runTime;
+
+    run->samples.clear();
+    Simulator sim(config, scenario.scenario.gains);
+    sim.init(scenario.scenario.x0);
+    RegressionSample last = sampleOf(scenario.scenario, 0.0, sim.getState().w);
+    run->samples.push_back(last);
+
+    // the samples between the last step and this one
+    double next = REGRESSION_OUTPUT_INTERVAL;
+    sim.setOutputHandler([&](const SimulatorState &s) {
+        RegressionSample current = sampleOf(scenario.scenario, s.t, s.w);
+        while (next <= s.t && next <= tEnd) {
+            double a = (next - last.t) / (s.t - last.t);
+            RegressionSample sample;
+            sample.t = next;
+            sample.pointing = last.pointing + a * (current.pointing - last.pointing);
+            sample.rate = last.rate + a * (current.rate - last.rate);
+            run->samples.push_back(sample);
+            next += REGRESSION_OUTPUT_INTERVAL;
+        }
+        last = current;
+    });
+
+    uint64_t start = monotonicNs();
+    int ret = sim.run(tEnd);
+    run->wallTime = (monotonicNs() - start) * 1e-9;
+
+    const SimulatorState &state = sim.getState();
+    run->status = ret == 0 ? 0 : -1;
+    run->steps = state.i - 1;
+    run->rejected = state.rejected;
+    run->evaluations = state.evaluations;
+    run->peakRSS = -1;
+}
+
+// the fixed size part of a run sent back by the child
+struct RunHeader {
+    int status;
+    double wallTime;
+    long steps;
+    long rejected;
+    long evaluations;
+    uint64_t count;
+};
+
+// writeAll / readAll - the whole buffer through a pipe.
+// @return - true on success.
+static bool writeAll(int fd, const void *data, size_t size)
+{
+    const char *p = (const char *)data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) { return false; }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, void *data, size_t size)
+{
+    char *p = (char *)data;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n <= 0) { return false; }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// runRegression - simulates one reference scenario in a child process, so
+// the peak RSS is of that scenario alone.
+// @return - 0 on success, -1 if the solution diverged or the child failed.
+int runRegression(const RegressionScenario &scenario, RegressionRun *run)
+{
+    run->status = -1;
+    run->wallTime = 0.0;
+    run->peakRSS = 0;
+    run->steps = 0;
+    run->rejected = 0;
+    run->evaluations = 0;
+    run->samples.clear();
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        ErrorManager::ERROR(ADACS_REGRESSION_CHILD_FAILED);
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        ErrorManager::ERROR(ADACS_REGRESSION_CHILD_FAILED);
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        RegressionRun result;
+        simulate(scenario, &result);
+        RunHeader header = {result.status, result.wallTime, result.steps, result.rejected,
+                            result.evaluations, result.samples.size()};
+        bool ok = writeAll(fds[1], &header, sizeof(header)) &&
+                  writeAll(fds[1], result.samples.data(), header.count * sizeof(RegressionSample));
+        _exit(ok ? 0 : 1);
+    }
+
+    close(fds[1]);
+    RunHeader header;
+    bool ok = readAll(fds[0], &header, sizeof(header));
+    if (ok) {
+        run->samples.resize(header.count);
+        ok = readAll(fds[0], run->samples.data(), header.count * sizeof(RegressionSample));
+    }
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        run->samples.clear();
+        ErrorManager::ERROR(ADACS_REGRESSION_CHILD_FAILED);
+        return -1;
+    }
+
+    run->status = header.status;
+    run->wallTime = header.wallTime;
+    run->steps = header.steps;
+    run->rejected = header.rejected;
+    run->evaluations = header.evaluations;
+    run->peakRSS = usage.ru_maxrss;
+    return run->status;
+}
+
+// writeGolden - the golden output of a scenario.
+// @return - 0 on success, -1 on failure.
+int writeGolden(const string &path, const RegressionRun &run)
+{
+    ofstream out(path.c_str(), ios::trunc);
+    if (!out.is_open()) {
+        ErrorManager::ERROR(ADACS_REGRESSION_GOLDEN_WRITE_FAILED);
+        return -1;
+    }
+    char buffer[128];
+    out << "# regression golden output, written by regressionHarness -u" << endl;
+    out << "steps " << run.steps << endl;
+    out << "rejected " << run.rejected << endl;
+    out << "evaluations " << run.evaluations << endl;
+    out << "# t pointing (deg) rate (deg/s)" << endl;
+    for (size_t k = 0; k < run.samples.size(); k++) {
+        const RegressionSample &s = run.samples[k];
+        snprintf(buffer, sizeof(buffer), "%.9g %.15g %.15g\n", s.t, s.pointing, s.rate);
+        out << buffer;
+    }
+    out.close();
+    if (!out) {
+        ErrorManager::ERROR(ADACS_REGRESSION_GOLDEN_WRITE_FAILED);
+        return -1;
+    }
+    return 0;
+}
+
+// readGolden - the golden output of a scenario.
+// @return - 0 on success, -1 on failure.
+int readGolden(const string &path, RegressionRun *run)
+{
+    run->status = -1;
+    run->wallTime = -1.0;
+    run->peakRSS = -1;
+    run->steps = 0;
+    run->rejected = 0;
+    run->evaluations = 0;
+    run->samples.clear();
+    ifstream in(path.c_str());
+    if (!in.is_open()) {
+        ErrorManager::ERROR(ADACS_REGRESSION_GOLDEN_READ_FAILED);
+        return -1;
+    }
+
+    int keys = 0;
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        istringstream fields(line);
+        string key;
+        fields >> key;
+        if (key == "steps") {
+            keys += (bool)(fields >> run->steps);
+        } else if (key == "rejected") {
+            keys += (bool)(fields >> run->rejected);
+        } else if (key == "evaluations") {
+            keys += (bool)(fields >> run->evaluations);
+        } else {
+            RegressionSample s;
+            istringstream values(line);
+            if (!(values >> s.t >> s.pointing >> s.rate)) {
+                ErrorManager::ERROR(ADACS_REGRESSION_GOLDEN_READ_FAILED);
+                return -1;
+            }
+            run->samples.push_back(s);
+        }
+    }
+    if (keys != 3 || run->samples.empty()) {
+        ErrorManager::ERROR(ADACS_REGRESSION_GOLDEN_READ_FAILED);
+        return -1;
+    }
+    run->status = 0;
+    return 0;
+}
+
+// writeBaseline - the wall time and peak RSS of every run on this machine.
+// @return - 0 on success, -1 on failure.
+int writeBaseline(const string &path, const vector<RegressionScenario> &scenarios,
+                  const vector<RegressionRun> &runs)
+{
+    ofstream out(path.c_str(), ios::trunc);
+    if (!out.is_open()) {
+        ErrorManager::ERROR(ADACS_REGRESSION_GOLDEN_WRITE_FAILED);
+        return -1;
+    }
+    char buffer[128];
+    out << "# regression baseline of this machine, written by regressionHarness -B" << endl;
+    out << "# name wallTime (s) peakRSS (KB)" << endl;
+    for (size_t k = 0; k < scenarios.size() && k < runs.size(); k++) {
+        snprintf(buffer, sizeof(buffer), "%s %.4g %ld\n", scenarios[k].name.c_str(),
+                 runs[k].wallTime, runs[k].peakRSS);
+        out << buffer;
+    }
+    out.close();
+    if (!out) {
+        ErrorManager::ERROR(ADACS_REGRESSION_GOLDEN_WRITE_FAILED);
+        return -1;
+    }
+    return 0;
+}
+
+// readBaseline - sets wallTime and peakRSS of the golden output of each
+// scenario in the baseline, the others are left as they are.
+// @return - 0 on success, -1 on failure.
+int readBaseline(const string &path, const vector<RegressionScenario> &scenarios,
+                 vector<RegressionRun> *goldens)
+{
+    ifstream in(path.c_str());
+    if (!in.is_open()) {
+        ErrorManager::ERROR(ADACS_REGRESSION_GOLDEN_READ_FAILED);
+        return -1;
+    }
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        istringstream fields(line);
+        string name;
+        double wallTime;
+        long peakRSS;
+        if (!(fields >> name >> wallTime >> peakRSS)) {
+            ErrorManager::ERROR(ADACS_REGRESSION_GOLDEN_READ_FAILED);
+            return -1;
+        }
+        for (size_t k = 0; k < scenarios.size() && k < goldens->size(); k++) {
+            if (scenarios[k].name == name) {
+                (*goldens)[k].wallTime = wallTime;
+                (*goldens)[k].peakRSS = peakRSS;
+            }
+        }
+    }
+    return 0;
+}
+
+// defaultRegressionLimits - 2% more evaluations or steps, 25% more wall
+// time and 50% more memory.
+RegressionLimits defaultRegressionLimits()
+{
+    RegressionLimits limits;
+    limits.countTolerance = 0.02;
+    limits.timeTolerance = 0.25;
+    limits.memoryTolerance = 0.5;
+    return limits;
+}
+
+// exceeds - value is more than tolerance above golden, and more than
+// resolution above it. A negative golden is one that wasn't recorded.
+static bool exceeds(double value, double golden, double tolerance, double resolution = 0.0)
+{
+    return tolerance >= 0.0 && golden >= 0.0 && value > golden * (1.0 + tolerance) &&
+           value - golden > resolution;
+}
+
+// compareRegression - checks a run against its golden output.
+void compareRegression(const RegressionScenario &scenario, const RegressionRun &golden,
+                       const RegressionRun &run, const RegressionLimits &limits,
+                       RegressionResult *result)
+{
+    result->pointingError = 0.0;
+    result->rateError = 0.0;
+    result->accuracyPassed = golden.status == 0 && run.status == 0 &&
+                             golden.samples.size() == run.samples.size();
+    for (size_t k = 0; result->accuracyPassed && k < run.samples.size(); k++) {
+        const RegressionSample &a = golden.samples[k];
+        const RegressionSample &b = run.samples[k];
+        if (fabs(a.t - b.t) > 1e-6) {
+            result->accuracyPassed = false;
+            break;
+        }
+        result->pointingError = fmax(result->pointingError, fabs(a.pointing - b.pointing));
+        result->rateError = fmax(result->rateError, fabs(a.rate - b.rate));
+    }
+    // NaN fails too
+    if (!(result->pointingError <= scenario.pointingTolerance) ||
+        !(result->rateError <= scenario.rateTolerance)) {
+        result->accuracyPassed = false;
+    }
+
+    result->performancePassed = golden.status == 0 && run.status == 0 &&
+        !exceeds(run.evaluations, golden.evaluations, limits.countTolerance) &&
+        !exceeds(run.steps, golden.steps, limits.countTolerance) &&
+        !exceeds(run.wallTime, golden.wallTime, limits.timeTolerance, REGRESSION_TIME_RESOLUTION) &&
+        !exceeds(run.peakRSS, golden.peakRSS, limits.memoryTolerance);
+}
+
+// writeRegressionReport - JSON report of every scenario.
+// @return - 0 on success, -1 if it can't be written.
+int writeRegressionReport(const string &path, const vector<RegressionScenario> &scenarios,
+                          const vector<RegressionRun> &goldens, const vector<RegressionRun> &runs,
+                          const vector<RegressionResult> &results, const RegressionLimits &limits)
+{
+    ofstream out(path.c_str(), ios::trunc);
+    if (!out.is_open()) {
+        ErrorManager::ERROR(ADACS_REGRESSION_REPORT_WRITE_FAILED);
+        return -1;
+    }
+
+    bool passed = true;
+    for (size_t k = 0; k < results.size(); k++) {
+        passed = passed && results[k].accuracyPassed && results[k].performancePassed;
+    }
+
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+             "{\"harness\": \"ADACS regression\", \"passed\": %s,\n"
+             " \"limits\": {\"countTolerance\": %g, \"timeTolerance\": %g, \"memoryTolerance\": %g},\n"
+             " \"scenarios\": [",
+             passed ? "true" : "false", limits.countTolerance, limits.timeTolerance, limits.memoryTolerance);
+    out << buffer;
+
+    for (size_t k = 0; k < results.size(); k++) {
+        const RegressionRun &g = goldens[k];
+        const RegressionRun &r = runs[k];
+        const RegressionResult &res = results[k];
+        snprintf(buffer, sizeof(buffer),
+                 "%s\n  {\"name\": \"%s\", \"status\": \"%s\", \"golden\": %s,\n"
+                 "   \"accuracy\": {\"passed\": %s, \"samples\": %zu, \"pointingError\": %.6g,"
+                 " \"pointingTolerance\": %g, \"rateError\": %.6g, \"rateTolerance\": %g},\n",
+                 k == 0 ? "" : ",", scenarios[k].name.c_str(), r.status == 0 ? "ok" : "diverged",
+                 g.status == 0 ? "true" : "false", res.accuracyPassed ? "true" : "false",
+                 r.samples.size(), res.pointingError, scenarios[k].pointingTolerance, res.rateError,
+                 scenarios[k].rateTolerance);
+        out << buffer;
+        // the baseline is null when there isn't one
+        char baselineWallTime[32] = "null";
+        char baselinePeakRSS[32] = "null";
+        if (g.wallTime >= 0.0) {
+            snprintf(baselineWallTime, sizeof(baselineWallTime), "%.4g", g.wallTime);
+        }
+        if (g.peakRSS >= 0) {
+            snprintf(baselinePeakRSS, sizeof(baselinePeakRSS), "%ld", g.peakRSS);
+        }
+        snprintf(buffer, sizeof(buffer),
+                 "   \"performance\": {\"passed\": %s, \"wallTime\": %.4g, \"baselineWallTime\": %s,"
+                 " \"evaluations\": %ld, \"goldenEvaluations\": %ld, \"steps\": %ld,"
+                 " \"goldenSteps\": %ld, \"rejected\": %ld, \"goldenRejected\": %ld,"
+                 " \"peakRSS\": %ld, \"baselinePeakRSS\": %s}}",
+                 res.performancePassed ? "true" : "false", r.wallTime, baselineWallTime, r.evaluations,
+                 g.evaluations, r.steps, g.steps, r.rejected, g.rejected, r.peakRSS, baselinePeakRSS);
+        out << buffer;
+    }
+    out << "]}" << endl;
+
+    out.close();
+    if (!out) {
+        ErrorManager::ERROR(ADACS_REGRESSION_REPORT_WRITE_FAILED);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Regression.hpp
+//
+// Regression harness for the attitude simulator. A fixed set of reference
+// scenarios is run and each one is compared against its golden output, so a
+// speedup can't silently change the physics or a change slow the simulator
+// down without it being seen.
+//
+// Each scenario is run in a child process, which records its wall time,
+// derivative evaluations, accepted and rejected steps and peak RSS, and the
+// pointing error (deg) and rotation rate (deg/s) every
+// REGRESSION_OUTPUT_INTERVAL s, linearly interpolated between the accepted
+// steps. Only those two are compared: the rotation about the sun line is not
+// controlled, so the full attitude of two runs that differ in round off
+// drifts apart while the physics is the same.
+//
+// A run fails on accuracy if a sample is further from the golden one than
+// the tolerances of its scenario, and on performance if it takes more
+// evaluations or steps than countTolerance allows. Wall time and RSS depend
+// on the machine, so the golden outputs don't have them. They are only
+// checked, against timeTolerance and memoryTolerance, when a baseline
+// recorded on the same machine is read in (wall time differences under
+// REGRESSION_TIME_RESOLUTION are ignored).
+//
+// Golden files are text:
+//  # comments
+//  steps 171782
+//  rejected 178
+//  evaluations 1031761
+//  t pointing rate    (one line per sample)
+//
+// Baseline files are text with one line per scenario:
+//  # comments
+//  name wallTime peakRSS
+//
+// Example code for use is shown below:
+//
+// vector<RegressionScenario> scenarios = referenceScenarios();
+// RegressionRun run, golden;
+// runRegression(scenarios[0], &run);
+// readGolden("golden/default.txt", &golden);
+// RegressionResult result;
+// compareRegression(scenarios[0], golden, run, defaultRegressionLimits(), &result);
+
+#ifndef Regression_hpp
+#define Regression_hpp
+
+#include <string>
+#include <vector>
+
+#include "Scenario.hpp"
+
+using namespace std;
+
+// time between the compared samples (s)
+#define REGRESSION_OUTPUT_INTERVAL 60
+// wall time differences smaller than this are timer noise (s)
+#define REGRESSION_TIME_RESOLUTION 0.05
+
+struct RegressionScenario {
+    string name;
+    Scenario scenario;
+    // largest pointing (deg) and rate (deg/s) difference from golden
+    double pointingTolerance;
+    double rateTolerance;
+};
+
+// referenceScenarios - the scenarios of the harness:
+//  default  - INCA_Dynamics_Solution.m, 16 h
+//  detumble - B-dot only (Kb = -I, the others 0) from the default state, 4 h
+//  pointing - the default gains 30 deg off the sun at 0.25 deg/s, 4 h
+vector<RegressionScenario> referenceScenarios();
+
+struct RegressionSample {
+    double t;
+    double pointing;
+    double rate;
+};
+
+struct RegressionRun {
+    // 0 for a run that finished, -1 if it diverged
+    int status;
+    // wall time (s) and peak RSS of the child process (KB), negative in a
+    // golden output without a baseline.
+    double wallTime;
+    long peakRSS;
+    long steps;
+    long rejected;
+    long evaluations;
+    vector<RegressionSample> samples;
+};
+
+// runRegression - simulates one reference scenario in a child process.
+// @return - 0 on success, -1 if the solution diverged or the child failed.
+int runRegression(const RegressionScenario &scenario, RegressionRun *run);
+
+// writeGolden / readGolden - the golden output of a scenario, readGolden
+// leaves wallTime and peakRSS at -1.
+// @return - 0 on success, -1 on failure.
+int writeGolden(const string &path, const RegressionRun &run);
+int readGolden(const string &path, RegressionRun *run);
+
+// writeBaseline - the wall time and peak RSS of every run on this machine.
+// @return - 0 on success, -1 on failure.
+int writeBaseline(const string &path, const vector<RegressionScenario> &scenarios,
+                  const vector<RegressionRun> &runs);
+
+// readBaseline - sets wallTime and peakRSS of the golden output of each
+// scenario in the baseline, the others are left as they are.
+// @return - 0 on success, -1 on failure.
+int readBaseline(const string &path, const vector<RegressionScenario> &scenarios,
+                 vector<RegressionRun> *goldens);
+
+struct RegressionLimits {
+    // allowed increase of evaluations and steps, wall time and peak RSS as a
+    // fraction of golden, negative to not check it. Wall time and peak RSS
+    // are also not checked without a baseline.
+    double countTolerance;
+    double timeTolerance;
+    double memoryTolerance;
+};
+
+// defaultRegressionLimits - 2% more evaluations or steps, 25% more wall
+// time and 50% more memory.
+RegressionLimits defaultRegressionLimits();
+
+struct RegressionResult {
+    bool accuracyPassed;
+    bool performancePassed;
+    // largest difference from golden of each sample
+    double pointingError;
+    double rateError;
+};
+
+// compareRegression - checks a run against its golden output.
+void compareRegression(const RegressionScenario &scenario, const RegressionRun &golden,
+                       const RegressionRun &run, const RegressionLimits &limits,
+                       RegressionResult *result);
+
+// writeRegressionReport - JSON report of every scenario:
+// {"harness": "ADACS regression", "passed": false, "limits": {...},
+//  "scenarios": [
+//   {"name": "default", "status": "ok", "golden": true,
+//    "accuracy": {"passed": true, "samples": 961, "pointingError": 0,
+//                 "pointingTolerance": 1, "rateError": 0, "rateTolerance": 0.001},
+//    "performance": {"passed": false, "wallTime": 1.9, "baselineWallTime": 1.2,
+//                    "evaluations": ..., "goldenEvaluations": ..., "steps": ...,
+//                    "goldenSteps": ..., "rejected": ..., "goldenRejected": ...,
+//                    "peakRSS": ..., "baselinePeakRSS": ...}}, ...]}
+// golden is false when the scenario has no golden output, which fails it, and
+// the baseline values are null without a baseline.
+// @return - 0 on success, -1 if it can't be written.
+int writeRegressionReport(const string &path, const vector<RegressionScenario> &scenarios,
+                          const vector<RegressionRun> &goldens, const vector<RegressionRun> &runs,
+                          const vector<RegressionResult> &results, const RegressionLimits &limits);
+
+#endif /* Regression_hpp */
@@ -0,0 +1,104 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  RingBuffer.hpp
+//
+// Lock-free single producer / single consumer ring buffer.
+// One thread may call push() and one other thread may call pop() without
+// any locking. The storage is fixed size and inside of the object so
+// neither side ever allocates memory.
+//
+// Example code for use is shown below:
+//
+// RingBuffer<SensorSample, 64> queue;
+//
+// // producer thread
+// if (!queue.push(sample)) {
+// // handle queue full
+// }
+//
+// // consumer thread
+// SensorSample s;
+// while (queue.pop(&s)) { ... }
+
+#ifndef RingBuffer_hpp
+#define RingBuffer_hpp
+
+#include <atomic>
+#include <cstddef>
+
+// N must be a power of 2
+template <typename T, size_t N>
+class RingBuffer {
+public:
+    RingBuffer() : head(0), tail(0) {
+        static_assert((N & (N - 1)) == 0, "RingBuffer size must be a power of 2");
+    }
+
+    // push - adds an item to the buffer (producer thread only)
+    // @return - true on success, false if the buffer is full.
+    bool push(const T &item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        items[t & (N - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // pop - removes the oldest item from the buffer (consumer thread only)
+    // @return - true if an item was returned, false if the buffer is empty.
+    bool pop(T *item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *item = items[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // peek - returns the oldest item without removing it (consumer thread only)
+    // @return - a pointer to the item, or NULL if the buffer is empty.
+    const T *peek() const {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return NULL;
+        }
+        return &items[h & (N - 1)];
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+private:
+    T items[N];
+    // head and tail on separate cache lines so the two threads don't fight
+    // over the same line.
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+#endif /* RingBuffer_hpp */
@@ -0,0 +1,299 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Scenario.cpp
+//
+// Simulation scenarios and sweeps read from .inca files.
+
+#include "Scenario.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+// more jobs than this is almost surely a typo in a range.
+#define SCENARIO_MAX_JOBS (1ULL << 48)
+
+// defaultScenario - the settings from INCA_Dynamics_Solution.m
+Scenario defaultScenario()
+{
+    Scenario scenario;
+    scenario.sim = defaultSimulatorConfig();
+    scenario.gains = defaultControllerGains();
+    scenario.initAxis = makeVec3(1.0, 0.5, 0.0);
+    scenario.initTheta = 120;
+    scenario.initOmega = makeVec3(1.0, 5.0, -30.0);
+    scenario.x0 = defaultInitialState();
+    return scenario;
+}
+
+// loadVec3 - reads a 3 element array.
+// @return - 1 if it was read, 0 if the key is missing, -1 on failure.
+static int loadVec3(ConfigFile &configFile, const string &key, Vec3 *vec)
+{
+    if (!configFile.contains(key)) {
+        return 0;
+    }
+    return configFile.getVec3(key, &(*vec)[0]) == 0 ? 1 : -1;
+}
+
+// loadDouble - reads a number, a missing key keeps the value.
+static void loadDouble(ConfigFile &configFile, const string &key, double *value)
+{
+    if (configFile.contains(key)) {
+        configFile.getDouble(key, value);
+    }
+}
+
+// loadScenario - reads a scenario from a config file.
+// @return - 0 on success, -1 on failure.
+int loadScenario(ConfigFile &configFile, Scenario *scenario)
+{
+    if (loadSimulatorConfig(configFile, &scenario->sim) != 0) {
+        return -1;
+    }
+
+    // the inertia is either the diagonal or the full matrix
+    if (configFile.contains("scInertia")) {
+        Mat3 inertia;
+        Vec3 diagonal;
+        if (configFile.getMat3("scInertia", &inertia[0]) != 0) {
+            if (configFile.getVec3("scInertia", &diagonal[0]) != 0) {
+                ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+                return -1;
+            }
+            for (int k = 0; k < 3; k++) {
+                inertia(k, k) = diagonal[k];
+            }
+        }
+        scenario->sim.inertia = inertia;
+    }
+
+    OrbitParameters &orbit = scenario->sim.orbit;
+    loadDouble(configFile, "orbitRp", &orbit.rp);
+    loadDouble(configFile, "orbitEcc", &orbit.ecc);
+    loadDouble(configFile, "orbitInc", &orbit.inc);
+    loadDouble(configFile, "orbitRAAN", &orbit.RAAN);
+    loadDouble(configFile, "orbitArgPer", &orbit.ArgPer);
+
+    if (loadVec3(configFile, "initAxis", &scenario->initAxis) < 0 ||
+        loadVec3(configFile, "initOmega", &scenario->initOmega) < 0) {
+        ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+        return -1;
+    }
+    loadDouble(configFile, "initTheta", &scenario->initTheta);
+    if (!(norm(scenario->initAxis) > 0.0)) {
+        ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+        return -1;
+    }
+    scenario->x0 = initialState(scenario->initAxis, scenario->initTheta * M_PI / 180,
+                                scenario->initOmega * (M_PI / 180));
+
+    if (configFile.contains("controllerGains")) {
+        string path;
+        configFile.getString("controllerGains", &path);
+        ConfigFile gainsFile(path);
+        if (gainsFile.load() != 0 || loadControllerGains(gainsFile, &scenario->gains) != 0) {
+            ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+            return -1;
+        }
+    }
+
+    if (!(orbit.rp > EARTH_RADIUS) || orbit.ecc < 0.0 || !(orbit.ecc < 1.0)) {
+        ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+        return -1;
+    }
+    return 0;
+}
+
+// value - the k'th value of the sweep
+string SweepAxis::value(uint64_t k) const
+{
+    if (!values.empty()) {
+        return values[k];
+    }
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.15g", start + (double)k * step);
+    return buffer;
+}
+
+// trim - the string without the spaces at the start and end
+static string trim(const string &value)
+{
+    size_t first = value.find_first_not_of(" \t");
+    if (first == string::npos) {
+        return "";
+    }
+    size_t last = value.find_last_not_of(" \t");
+    return value.substr(first, last - first + 1);
+}
+
+// splitList - splits the inside of {a,b,c} on the commas that are not
+// inside of an array.
+static int splitList(const string &list, vector<string> *values)
+{
+    int depth = 0;
+    string current;
+    for (size_t k = 0; k < list.size(); k++) {
+        char c = list[k];
+        if (c == '[') {
+            depth++;
+        } else if (c == ']') {
+            depth--;
+            if (depth < 0) {
+                return -1;
+            }
+        }
+        if (c == ',' && depth == 0) {
+            current = trim(current);
+            if (current.empty()) {
+                return -1;
+            }
+            values->push_back(current);
+            current.clear();
+        } else {
+            current.push_back(c);
+        }
+    }
+    current = trim(current);
+    if (depth != 0 || current.empty()) {
+        return -1;
+    }
+    values->push_back(current);
+    return 0;
+}
+
+// parseSweep - parses {a,b,c} or {start:step:end}
+// @return - 0 on success, -1 on failure.
+static int parseSweep(const string &value, SweepAxis *axis)
+{
+    string inside = value.substr(1, value.size() - 2);
+    if (inside.find(':') != string::npos && inside.find('[') == string::npos) {
+        inside.erase(remove_if(inside.begin(), inside.end(), ::isspace), inside.end());
+        double end;
+        char *next;
+        const char *p = inside.c_str();
+        axis->start = strtod(p, &next);
+        if (next == p || *next != ':') {
+            return -1;
+        }
+        p = next + 1;
+        axis->step = strtod(p, &next);
+        if (next == p || *next != ':') {
+            return -1;
+        }
+        p = next + 1;
+        end = strtod(p, &next);
+        if (next == p || *next != '\0') {
+            return -1;
+        }
+
+        double n = (end - axis->start) / axis->step;
+        if (!(axis->step != 0.0) || !(n > -1e-9) || !(n < (double)SCENARIO_MAX_JOBS)) {
+            return -1;
+        }
+        // end is included, allowing for round off in the step
+        axis->count = (uint64_t)floor(n + 1e-9) + 1;
+        return 0;
+    }
+
+    if (splitList(inside, &axis->values) != 0) {
+        return -1;
+    }
+    axis->count = axis->values.size();
+    return 0;
+}
+
+ScenarioSweep::ScenarioSweep()
+{
+    jobs = 1;
+}
+
+// load - finds the sweeps in a scenario file.
+// @return - 0 on success, -1 for a bad sweep or too many jobs.
+int ScenarioSweep::load(ConfigFile &configFile)
+{
+    fixed.clear();
+    axes.clear();
+    jobs = 1;
+
+    vector<string> keys = configFile.getKeys();
+    sort(keys.begin(), keys.end());
+
+    for (size_t k = 0; k < keys.size(); k++) {
+        string value;
+        configFile.getString(keys[k], &value);
+        if (value.size() < 2 || value[0] != '{') {
+            fixed.push_back(make_pair(keys[k], value));
+            continue;
+        }
+
+        SweepAxis axis;
+        axis.key = keys[k];
+        axis.start = 0.0;
+        axis.step = 0.0;
+        axis.count = 0;
+        if (value[value.size() - 1] != '}' || parseSweep(value, &axis) != 0 ||
+            axis.count > SCENARIO_MAX_JOBS / jobs) {
+            ErrorManager::ERROR(ADACS_SCENARIO_BAD_SWEEP);
+            fixed.clear();
+            axes.clear();
+            jobs = 1;
+            return -1;
+        }
+        jobs *= axis.count;
+        axes.push_back(axis);
+    }
+    return 0;
+}
+
+// jobValues - the swept values of a job, in the order of getAxes()
+void ScenarioSweep::jobValues(uint64_t index, vector<string> *values) const
+{
+    values->resize(axes.size());
+    for (size_t k = axes.size(); k-- > 0;) {
+        (*values)[k] = axes[k].value(index % axes[k].count);
+        index /= axes[k].count;
+    }
+}
+
+// job - the scenario file for one job, the fixed keys and one value of
+// each sweep, set in one batch.
+// @return - 0 on success, -1 if index is out of range or a swept value
+//           is a bad array, nothing is set then.
+int ScenarioSweep::job(uint64_t index, ConfigFile *configFile) const
+{
+    if (index >= jobs) {
+        return -1;
+    }
+    vector<string> swept;
+    jobValues(index, &swept);
+    vector<pair<string, string> > values(fixed);
+    values.reserve(fixed.size() + axes.size());
+    for (size_t k = 0; k < axes.size(); k++) {
+        values.push_back(make_pair(axes[k].key, swept[k]));
+    }
+    // a list value can be a bad array
+    return configFile->setValues(values) == 0 ? 0 : -1;
+}
@@ -0,0 +1,140 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Scenario.hpp
+//
+// Simulation scenarios read from .inca files, in place of the settings that
+// are hardcoded at the top of INCA_Dynamics_Solution.m (Inr, V, theta,
+// omega, rp, ecc, inc, RunTime, T).
+//
+// Vectors and matrices are ConfigFile arrays, the inertia can be the full
+// matrix or the diagonal:
+//
+//  scInertia = [0.031, 0.031134, 0.0183645]
+//  initAxis = [1, 0.5, 0]
+//
+// Any key can also be a sweep, either a list of values or a MATLAB style
+// start:step:end range (end included):
+//
+//  initTheta = {0:30:180}
+//  initAxis = {[1, 0, 0], [0, 1, 0], [1, 0.5, 0]}
+//
+// A ScenarioSweep is the Cartesian product of all of the sweeps. Job k is
+// made from k when it is asked for, so a sweep of millions of jobs never
+// holds more than one value list per swept key. The swept keys are ordered by
+// name and the last one changes the fastest.
+//
+// Example code for use is shown below:
+//
+// ConfigFile file("Scenario.inca");
+// file.load();
+// ScenarioSweep sweep;
+// if (sweep.load(file) != 0) {
+// // handle error, bad sweep value
+// }
+// ConfigFile job("");
+// sweep.job(12, &job);
+// Scenario scenario;
+// loadScenario(job, &scenario);
+
+#ifndef Scenario_hpp
+#define Scenario_hpp
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Simulator.hpp"
+#include "ConfigFile.hpp"
+
+using namespace std;
+
+// everything needed to start a simulation.
+struct Scenario {
+    SimulatorConfig sim;
+    ControllerGains gains;
+    // initial rotation axis, angle (deg) and rotation rate (deg/s)
+    Vec3 initAxis;
+    double initTheta;
+    Vec3 initOmega;
+    // initial state [q; q_dot] from the values above
+    StateVector x0;
+};
+
+// defaultScenario - the settings from INCA_Dynamics_Solution.m
+Scenario defaultScenario();
+
+// loadScenario - reads a scenario from a config file. Keys:
+//  scInertia - inertia matrix (kg*m^2), the diagonal or the 3x3 matrix
+//  initAxis, initTheta, initOmega - initial rotation axis, angle (deg) and
+//                                   rotation rate (deg/s)
+//  orbitRp, orbitEcc, orbitInc, orbitRAAN, orbitArgPer - orbit (km, deg)
+//  controllerGains - path of a gains file for loadControllerGains()
+// and the simulator keys of loadSimulatorConfig(). Any key that is missing
+// keeps its default value.
+// @return - 0 on success, -1 on failure.
+int loadScenario(ConfigFile &configFile, Scenario *scenario);
+
+// one swept key
+struct SweepAxis {
+    string key;
+    // list of values, empty for a range
+    vector<string> values;
+    // range start:step:end
+    double start;
+    double step;
+    // number of values
+    uint64_t count;
+
+    // value - the k'th value of the sweep
+    string value(uint64_t k) const;
+};
+
+class ScenarioSweep {
+public:
+    ScenarioSweep();
+
+    // load - finds the sweeps in a scenario file.
+    // @return - 0 on success, -1 for a bad sweep or too many jobs.
+    int load(ConfigFile &configFile);
+
+    // size - the number of jobs in the sweep, 1 when nothing is swept.
+    uint64_t size() const { return jobs; }
+
+    // job - the scenario file for one job, the fixed keys and one value of
+    // each sweep, set in one batch.
+    // @param index - job number, 0 to size() - 1
+    // @param configFile - output config, any values in it are kept.
+    // @return - 0 on success, -1 if index is out of range or a swept value
+    //           is a bad array, nothing is set then.
+    int job(uint64_t index, ConfigFile *configFile) const;
+
+    // jobValues - the swept values of a job, in the order of getAxes()
+    void jobValues(uint64_t index, vector<string> *values) const;
+
+    const vector<SweepAxis> &getAxes() const { return axes; }
+
+private:
+    // keys that are not swept
+    vector<pair<string, string> > fixed;
+    vector<SweepAxis> axes;
+    uint64_t jobs;
+};
+
+#endif /* Scenario_hpp */
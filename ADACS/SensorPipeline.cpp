@@ -0,0 +1,406 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  SensorPipeline.cpp
+//
+// Pipeline for getting sensor readings from the driver threads to the estimator.
+
+#include "SensorPipeline.hpp"
+
+// for ERROR
+#include <ErrorManager.hpp>
+#include <sstream>
+#include <system_error>
+#include <cmath>
+
+/////////////////////////////////////////// ReplaySensor
+
+// constructor for the replay sensor
+// @param path - the replay file
+// @param errorCode - the error the real sensor reports on a failed read.
+// @param speed - replay speed relative to real time, 0 for as fast as possible.
+ReplaySensor::ReplaySensor(string path, int errorCode, double speed) :
+    errorCode(errorCode), speed(speed)
+{
+    started = false;
+    startNs = 0;
+    startTimestamp = 0.0;
+
+    file.open(path.c_str(), ios::in);
+    if (!file.is_open()) {
+        ErrorManager::ERROR(SENSOR_REPLAY_FILE_FAILED_TO_OPEN);
+    }
+}
+
+// read - returns the next sample in the file, sleeping until it is due
+// if the replay is running in real time.
+// @return - 0 on success, 1 at the end of the file, -1 on a simulated read
+// failure or a line with missing or bad values.
+int ReplaySensor::read(SensorSample *sample)
+{
+    if (!file.is_open()) {
+        return 1;
+    }
+
+    string line;
+    while (getline(file, line)) {
+        istringstream stream(line);
+        double timestamp;
+        if (line.empty() || line[0] == '#' || !(stream >> timestamp)) {
+            continue;
+        }
+
+        // wait until the sample would have been taken
+        if (speed > 0.0) {
+            if (!started) {
+                started = true;
+                startNs = monotonicNs();
+                startTimestamp = timestamp;
+            }
+            uint64_t due = startNs + (uint64_t)((timestamp - startTimestamp) / speed * 1e9);
+            uint64_t now = monotonicNs();
+            if (due > now) {
+                this_thread::sleep_for(chrono::nanoseconds(due - now));
+            }
+        }
+
+        string token;
+        if (!(stream >> token) || token == "ERROR") {
+            return -1;
+        }
+
+        // a line with missing or bad values is a failed read, not zeros
+        char *end;
+        sample->timestamp = timestamp;
+        sample->value = Vec3();
+        sample->value[0] = strtod(token.c_str(), &end);
+        if (*end != '\0' || !(stream >> sample->value[1] >> sample->value[2])) {
+            return -1;
+        }
+        return 0;
+    }
+
+    return 1;
+}
+
+
+/////////////////////////////////////////// SensorPipeline
+
+// constructor for the pipeline
+// @param epochStart - time of the first filter epoch (s)
+// @param epochPeriod - time between filter epochs (s)
+// @param maxAge - the oldest a held sample can be and still be used (s)
+SensorPipeline::SensorPipeline(double epochStart, double epochPeriod, double maxAge) :
+    epochStart(epochStart), epochPeriod(epochPeriod), maxAge(maxAge)
+{
+    numSensors = 0;
+    running.store(false);
+    started = false;
+    pushCount.store(0);
+    popCount.store(0);
+    estimatorSleeping.store(false);
+    driversSleeping.store(0);
+    epochCount.store(0);
+    droppedCount.store(0);
+    readErrorCount.store(0);
+    staleCount.store(0);
+}
+
+SensorPipeline::~SensorPipeline()
+{
+    stop();
+}
+
+// addSensor - adds a sensor to the pipeline, must be called before start()
+// @return - the index of the sensor in the aligned samples, -1 on failure.
+int SensorPipeline::addSensor(SensorSource *source)
+{
+    if (numSensors >= PIPELINE_MAX_SENSORS || started) {
+        ErrorManager::ERROR(SENSOR_PIPELINE_TOO_MANY_SENSORS);
+        return -1;
+    }
+
+    SensorChannel &c = channels[numSensors];
+    c.source = source;
+    c.finished.store(false);
+    c.havePrev = false;
+    c.haveLatest = false;
+
+    return numSensors++;
+}
+
+// start - starts the driver threads and the estimator thread.
+// @return - 0 on success, -1 on failure.
+int SensorPipeline::start()
+{
+    if (started) {
+        return -1;
+    }
+    started = true;
+    running.store(true);
+
+    try {
+        for (int i = 0; i < numSensors; i++) {
+            channels[i].driver = thread(&SensorPipeline::driverLoop, this, i);
+        }
+        estimator = thread(&SensorPipeline::estimatorLoop, this);
+    } catch (const system_error &e) {
+        ErrorManager::ERROR(SENSOR_PIPELINE_FAILED_TO_START_THREAD);
+        stop();
+        return -1;
+    }
+
+    return 0;
+}
+
+// wait - waits for all of the sensors to run out of data and the
+// estimator to finish the last epoch (for replayed sensors).
+void SensorPipeline::wait()
+{
+    if (estimator.joinable()) {
+        estimator.join();
+    }
+    stop();
+}
+
+// stop - stops all of the threads.
+void SensorPipeline::stop()
+{
+    running.store(false);
+    {
+        // taking the lock makes sure a thread that saw running is asleep
+        lock_guard<mutex> lock(wakeMutex);
+    }
+    sampleReady.notify_all();
+    spaceReady.notify_all();
+    joinAll();
+}
+
+// notifySample - wakes the estimator after a push or a finished sensor.
+// The lock is only taken if the estimator marked itself sleeping, it holds
+// wakeMutex from the mark until it waits, so taking it means the estimator
+// either saw the new count or is waiting for the notify.
+void SensorPipeline::notifySample()
+{
+    pushCount.fetch_add(1);
+    if (estimatorSleeping.load()) {
+        {
+            lock_guard<mutex> lock(wakeMutex);
+        }
+        sampleReady.notify_one();
+    }
+}
+
+void SensorPipeline::joinAll()
+{
+    for (int i = 0; i < numSensors; i++) {
+        if (channels[i].driver.joinable()) {
+            channels[i].driver.join();
+        }
+    }
+    if (estimator.joinable()) {
+        estimator.join();
+    }
+}
+
+// driverLoop - reads a single sensor and pushes the samples onto its queue.
+void SensorPipeline::driverLoop(int index)
+{
+    SensorChannel &c = channels[index];
+
+    while (running.load(memory_order_relaxed)) {
+        SensorSample sample;
+        int ret = c.source->read(&sample);
+        if (ret == 1) {
+            break;
+        } else if (ret < 0) {
+            readErrorCount.fetch_add(1);
+            ErrorManager::ERROR(c.source->getErrorCode());
+            continue;
+        }
+
+        sample.sensor = index;
+        sample.acquiredNs = monotonicNs();
+
+        if (c.queue.push(sample)) {
+            notifySample();
+        } else if (!c.source->isReplay()) {
+            // real hardware can't wait, so the sample is lost.
+            droppedCount.fetch_add(1);
+            ErrorManager::ERROR(SENSOR_PIPELINE_QUEUE_FULL);
+        } else {
+            // sleep until the estimator pops something, the count is read
+            // before each push so a pop in between isn't missed.
+            while (running.load(memory_order_relaxed)) {
+                uint64_t seen = popCount.load();
+                if (c.queue.push(sample)) {
+                    notifySample();
+                    break;
+                }
+                unique_lock<mutex> lock(wakeMutex);
+                driversSleeping.fetch_add(1);
+                spaceReady.wait(lock, [&]() {
+                    return popCount.load() != seen || !running.load(memory_order_relaxed);
+                });
+                driversSleeping.fetch_sub(1);
+            }
+        }
+    }
+
+    c.finished.store(true, memory_order_release);
+    notifySample();
+}
+
+// estimatorLoop - pulls samples off of the queues and runs each epoch once
+// every sensor has a sample at or after the epoch (or has finished).
+void SensorPipeline::estimatorLoop()
+{
+    long epochIndex = 0;
+    double nextEpoch = epochStart;
+    uint64_t waitStart = 0;
+
+    while (true) {
+        bool ready = true;
+        bool allFinished = true;
+        bool popped = false;
+        bool waitingOnHardware = false;
+        double lastTimestamp = -1e300;
+        uint64_t seen = pushCount.load();
+        uint64_t now = monotonicNs();
+        bool timedOut = waitStart != 0 && now - waitStart > PIPELINE_EPOCH_TIMEOUT_NS;
+
+        for (int i = 0; i < numSensors; i++) {
+            SensorChannel &c = channels[i];
+
+            // only take samples up to the first one at or after the epoch, so the
+            // two samples around the epoch are kept for interpolation.
+            // finished must be checked before pulling so no sample is missed.
+            bool finished = c.finished.load(memory_order_acquire);
+            SensorSample sample;
+            while ((!c.haveLatest || c.latest.timestamp < nextEpoch) && c.queue.pop(&sample)) {
+                c.prev = c.latest;
+                c.havePrev = c.haveLatest;
+                c.latest = sample;
+                c.haveLatest = true;
+                popped = true;
+            }
+
+            bool done = finished && c.queue.empty();
+            if (c.haveLatest && c.latest.timestamp > lastTimestamp) {
+                lastTimestamp = c.latest.timestamp;
+            }
+            if (!done) {
+                allFinished = false;
+                bool hasEpoch = c.haveLatest && c.latest.timestamp >= nextEpoch;
+                if (!hasEpoch && (c.source->isReplay() || !timedOut)) {
+                    ready = false;
+                    waitingOnHardware = waitingOnHardware || !c.source->isReplay();
+                }
+            }
+        }
+
+        if (popped) {
+            popCount.fetch_add(1);
+            // like notifySample(), only a sleeping driver needs the lock
+            if (driversSleeping.load() != 0) {
+                {
+                    lock_guard<mutex> lock(wakeMutex);
+                }
+                spaceReady.notify_all();
+            }
+        }
+
+        if (ready) {
+            if (allFinished && nextEpoch > lastTimestamp) {
+                break;
+            }
+            processEpoch(nextEpoch);
+            epochIndex++;
+            nextEpoch = epochStart + epochIndex * epochPeriod;
+            waitStart = 0;
+            continue;
+        }
+
+        if (!running.load(memory_order_relaxed)) {
+            break;
+        }
+        if (waitStart == 0) {
+            waitStart = now;
+        }
+
+        // sleep until a driver pushes a sample, or until a late hardware
+        // sensor times out.
+        unique_lock<mutex> lock(wakeMutex);
+        estimatorSleeping.store(true);
+        auto woken = [&]() { return pushCount.load() != seen || !running.load(memory_order_relaxed); };
+        if (waitingOnHardware) {
+            uint64_t deadline = waitStart + PIPELINE_EPOCH_TIMEOUT_NS + 1;
+            now = monotonicNs();
+            if (deadline > now) {
+                sampleReady.wait_for(lock, chrono::nanoseconds(deadline - now), woken);
+            }
+        } else {
+            sampleReady.wait(lock, woken);
+        }
+        estimatorSleeping.store(false);
+    }
+}
+
+// processEpoch - aligns each sensor to time t and calls the epoch handler.
+void SensorPipeline::processEpoch(double t)
+{
+    SensorSample aligned[PIPELINE_MAX_SENSORS];
+    int count = 0;
+
+    for (int i = 0; i < numSensors; i++) {
+        SensorChannel &c = channels[i];
+        if (!c.haveLatest) {
+            continue;
+        }
+
+        SensorSample &s = aligned[count];
+        s.sensor = i;
+        s.timestamp = t;
+        s.acquiredNs = c.latest.acquiredNs;
+
+        if (c.havePrev && c.prev.timestamp <= t && t <= c.latest.timestamp &&
+            c.latest.timestamp > c.prev.timestamp) {
+            // interpolate between the samples around the epoch
+            double a = (t - c.prev.timestamp) / (c.latest.timestamp - c.prev.timestamp);
+            s.value = c.prev.value * (1.0 - a) + c.latest.value * a;
+            count++;
+        } else if (fabs(t - c.latest.timestamp) <= maxAge) {
+            // hold the closest sample
+            s.value = c.latest.value;
+            count++;
+        } else {
+            staleCount.fetch_add(1);
+        }
+    }
+
+    if (count > 0 && epochHandler) {
+        epochHandler(t, aligned, count);
+    }
+
+    uint64_t done = monotonicNs();
+    for (int i = 0; i < count; i++) {
+        latency.record(done - aligned[i].acquiredNs);
+    }
+    epochCount.fetch_add(1);
+}
@@ -0,0 +1,224 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  SensorPipeline.hpp
+//
+// Pipeline for getting sensor readings from the driver threads to the estimator.
+// Each sensor gets its own driver thread that reads samples and pushes them onto
+// a lock-free single producer / single consumer ring buffer. A single estimator
+// thread pulls from all of the buffers and aligns the samples to the filter epoch
+// (t = epochStart + k * epochPeriod) by linear interpolation between the two
+// samples around the epoch, or by holding the last sample if it is new enough.
+// The aligned samples for each epoch are then handed to the epoch handler,
+// which is where the kalman filter predict and update are run.
+//
+// Read failures are reported to the ErrorManager using the error code of the
+// sensor (GYRO_*, ADACS_ADC_*, INA219_*, ...).
+//
+// Sensors can be replaced by ReplaySensor which reads the samples from a text
+// file, so the whole pipeline can be run on a normal linux computer.
+//
+// Example code for use is shown below:
+//
+// ReplaySensor gyro("gyro.txt", GYRO_FAILED_COMM_TEST, 1.0);
+// SensorPipeline pipeline(0.0, 0.1, 0.5);
+// int gyroIndex = pipeline.addSensor(&gyro);
+// pipeline.setEpochHandler([&](double t, const SensorSample *samples, int count) {
+//     // run filter.predict() and filter.update() with the samples
+// });
+// if (pipeline.start() != 0) {
+// // handle error
+// }
+// ...
+// pipeline.stop();
+// pipeline.getLatencyHistogram().print("latency (ns)");
+
+#ifndef SensorPipeline_hpp
+#define SensorPipeline_hpp
+
+#include <string>
+#include <fstream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+#include "Matrix.hpp"
+#include "RingBuffer.hpp"
+#include "Histogram.hpp"
+#include "Timing.hpp"
+
+using namespace std;
+
+#define PIPELINE_MAX_SENSORS 8
+#define PIPELINE_QUEUE_SIZE 256
+
+// how long the estimator waits on a late hardware sensor before running the
+// epoch without it.
+#define PIPELINE_EPOCH_TIMEOUT_NS 20000000ULL
+
+// a single timestamped reading from a sensor, up to 3 values.
+struct SensorSample {
+    // index of the sensor in the pipeline
+    int sensor;
+    // time the sample was taken (s)
+    double timestamp;
+    // the measured values
+    Vec3 value;
+    // monotonic clock time the sample was read by the driver (ns)
+    uint64_t acquiredNs;
+};
+
+// base class for anything that produces sensor samples.
+class SensorSource {
+public:
+    virtual ~SensorSource() {}
+
+    // read - waits for and returns the next sample.
+    // @param sample - output sample, timestamp and value must be filled in.
+    // @return - 0 on success, 1 when the sensor has no more data, -1 on a read failure.
+    virtual int read(SensorSample *sample) = 0;
+
+    // getErrorCode - the error given to the ErrorManager when read fails.
+    virtual int getErrorCode() const = 0;
+
+    // isReplay - replayed sensors are not tied to real time, so the driver
+    // waits for room in the queue instead of dropping samples.
+    virtual bool isReplay() const { return false; }
+};
+
+// Sensor stand in that reads samples from a text file.
+// Each line of the file is either
+// timestamp v1 v2 v3
+// timestamp ERROR        (simulates a failed read)
+// Lines starting with # are comments, a line with missing or bad values is a
+// failed read.
+class ReplaySensor : public SensorSource {
+public:
+    // constructor for the replay sensor
+    // @param path - the replay file
+    // @param errorCode - the error the real sensor reports on a failed read.
+    // @param speed - replay speed relative to real time, 0 for as fast as possible.
+    ReplaySensor(string path, int errorCode, double speed);
+
+    int read(SensorSample *sample);
+    int getErrorCode() const { return errorCode; }
+    bool isReplay() const { return speed <= 0.0; }
+    bool isOpen() const { return file.is_open(); }
+
+private:
+    ifstream file;
+    int errorCode;
+    double speed;
+    bool started;
+    uint64_t startNs;
+    double startTimestamp;
+};
+
+typedef function<void(double epoch, const SensorSample *samples, int count)> EpochHandler;
+
+class SensorPipeline {
+public:
+    // constructor for the pipeline
+    // @param epochStart - time of the first filter epoch (s)
+    // @param epochPeriod - time between filter epochs (s)
+    // @param maxAge - the oldest a held sample can be and still be used (s)
+    SensorPipeline(double epochStart, double epochPeriod, double maxAge);
+    ~SensorPipeline();
+
+    // addSensor - adds a sensor to the pipeline, must be called before start()
+    // @return - the index of the sensor in the aligned samples, -1 on failure.
+    int addSensor(SensorSource *source);
+
+    // setEpochHandler - function called by the estimator thread for each epoch.
+    void setEpochHandler(EpochHandler handler) { epochHandler = handler; }
+
+    // start - starts the driver threads and the estimator thread.
+    // @return - 0 on success, -1 on failure.
+    int start();
+
+    // wait - waits for all of the sensors to run out of data and the
+    // estimator to finish the last epoch (for replayed sensors).
+    void wait();
+
+    // stop - stops all of the threads.
+    void stop();
+
+    const Histogram &getLatencyHistogram() const { return latency; }
+    uint64_t getEpochCount() const { return epochCount.load(); }
+    uint64_t getDroppedCount() const { return droppedCount.load(); }
+    uint64_t getReadErrorCount() const { return readErrorCount.load(); }
+    uint64_t getStaleCount() const { return staleCount.load(); }
+
+private:
+    struct SensorChannel {
+        SensorSource *source;
+        RingBuffer<SensorSample, PIPELINE_QUEUE_SIZE> queue;
+        thread driver;
+        atomic<bool> finished;
+
+        // only used by the estimator thread
+        SensorSample prev;
+        SensorSample latest;
+        bool havePrev;
+        bool haveLatest;
+    };
+
+    SensorChannel channels[PIPELINE_MAX_SENSORS];
+    int numSensors;
+
+    double epochStart;
+    double epochPeriod;
+    double maxAge;
+
+    EpochHandler epochHandler;
+    thread estimator;
+    atomic<bool> running;
+    bool started;
+
+    // the estimator sleeps on sampleReady until a driver pushes a sample or
+    // finishes, replayed drivers sleep on spaceReady while their queue is
+    // full. A thread marks itself sleeping with wakeMutex held before it
+    // checks the count one last time, the other side bumps the count and
+    // only takes wakeMutex to notify when it sees the mark, so a push or a
+    // pop does not lock while nobody is asleep.
+    mutex wakeMutex;
+    condition_variable sampleReady;
+    condition_variable spaceReady;
+    atomic<uint64_t> pushCount;
+    atomic<uint64_t> popCount;
+    atomic<bool> estimatorSleeping;
+    atomic<int> driversSleeping;
+
+    Histogram latency;
+    atomic<uint64_t> epochCount;
+    atomic<uint64_t> droppedCount;
+    atomic<uint64_t> readErrorCount;
+    atomic<uint64_t> staleCount;
+
+    void driverLoop(int index);
+    void estimatorLoop();
+    void processEpoch(double t);
+    void notifySample();
+    void joinAll();
+};
+
+#endif /* SensorPipeline_hpp */
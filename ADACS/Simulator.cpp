@@ -0,0 +1,709 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Simulator.cpp
+//
+// Attitude simulator, the C++ version of ADACSDynamics/INCA_Dynamics_Solution.m
+
+#include "Simulator.hpp"
+#include "Quaternion.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+#define CHECKPOINT_MAGIC "INCASIM1"
+#define CHECKPOINT_VERSION 3
+
+// defaultSimulatorConfig - the settings from INCA_Dynamics_Solution.m
+SimulatorConfig defaultSimulatorConfig()
+{
+    SimulatorConfig config;
+    config.runTime = 16 * 3600;
+    config.tolerance = 1e-8;
+    config.initialStep = 0.0001;
+    config.maxStep = 20;
+    config.integrator = SIM_INTEGRATOR_DP45;
+    config.inertia = Mat3::zeros();
+    config.inertia(0,0) = 0.031000;
+    config.inertia(1,1) = 0.031134;
+    config.inertia(2,2) = 0.0183645;
+    config.orbit = defaultOrbit();
+    config.sunModel = SIM_SUN_FIXED;
+    config.rSun = makeVec3(1.0, 0.0, 0.0);
+    config.epochJD = J2000_JD;
+    config.shadowModel = SHADOW_CONICAL;
+    config.stateNoise = 0.0;
+    config.seed = 0;
+    config.statusInterval = 10000;
+    config.controlPeriod = 0.0;
+    return config;
+}
+
+// initialState - the state for a rotation of theta about axis with a
+// rotation rate of omega, like xhat_init in INCA_Dynamics_Solution.m
+// @param axis - initial vector of rotation (normalized here)
+// @param theta - initial rotation angle (rad)
+// @param omega - initial rotation rate (rad/s)
+StateVector initialState(const Vec3 &axis, double theta, const Vec3 &omega)
+{
+    Vec3 V = axis * (1.0 / norm(axis));
+    Vec4 q;
+    for (int k = 0; k < 3; k++) {
+        q[k] = V[k] * sin(theta / 2);
+    }
+    q[3] = cos(theta / 2);
+    Vec4 qDot = 0.5 * (Xi(q) * omega);
+
+    StateVector x;
+    for (int k = 0; k < 4; k++) {
+        x[k] = q[k];
+        x[k + 4] = qDot[k];
+    }
+    return x;
+}
+
+// defaultInitialState - the initial state from INCA_Dynamics_Solution.m
+StateVector defaultInitialState()
+{
+    return initialState(makeVec3(1.0, 0.5, 0.0), M_PI / 180 * 120,
+                        makeVec3(1.0, 5.0, -30.0) * (M_PI / 180));
+}
+
+// sunDirection - the sun vector in the inertial frame at time t of a run,
+// ignoring the earth shadow.
+// @param sunModel, rSun, epochJD - as in SimulatorConfig
+// @param t - time since the start of the run (s)
+Vec3 sunDirection(int sunModel, const Vec3 &rSun, double epochJD, double t)
+{
+    if (sunModel == SIM_SUN_EPHEMERIS) {
+        return sunPosition(epochJD + t / 86400);
+    }
+    return rSun;
+}
+
+// pointingAngle - angle between the sun and the target in the body frame,
+// acosd((r_sun_body' * r_target) / (norm(r_sun_body) * norm(r_target)))
+// @param q - attitude quaternion
+// @param rSun - sun vector in the inertial frame
+// @param rTarget - target vector in the body frame
+// @return - the angle (deg)
+double pointingAngle(const Vec4 &q, const Vec3 &rSun, const Vec3 &rTarget)
+{
+    return pointingAngle(quatTrans(q, rSun), rTarget);
+}
+
+double pointingAngle(const Vec3 &sunBody, const Vec3 &rTarget)
+{
+    double c = dot(sunBody, rTarget) / (norm(sunBody) * norm(rTarget));
+    return acos(fmax(-1.0, fmin(1.0, c))) * 180 / M_PI;
+}
+
+// loadSimulatorConfig - reads the simulator settings from a config file.
+// Keys: simRunTime, simTolerance, simMaxStep, simIntegrator (dp45, lie or
+// rosenbrock), simStateNoise, simSeed, simStatusInterval, simSunModel (fixed or
+// ephemeris), simEpochJD, simShadowModel (cylindrical or conical),
+// simControlPeriod. Any key that is missing keeps its value.
+// @return - 0 on success, -1 on failure.
+int loadSimulatorConfig(ConfigFile &configFile, SimulatorConfig *config)
+{
+    double value;
+    long longValue;
+    string name;
+
+    if (configFile.getDouble("simRunTime", &value) == 0) {
+        config->runTime = value;
+    }
+    if (configFile.getDouble("simTolerance", &value) == 0) {
+        config->tolerance = value;
+    }
+    if (configFile.getDouble("simMaxStep", &value) == 0) {
+        config->maxStep = value;
+    }
+    if (configFile.getString("simIntegrator", &name) == 0) {
+        config->integrator = integratorType(name);
+    }
+    if (configFile.getDouble("simStateNoise", &value) == 0) {
+        config->stateNoise = value;
+    }
+    if (configFile.getLong("simSeed", &longValue) == 0) {
+        config->seed = (uint64_t)longValue;
+    }
+    if (configFile.getLong("simStatusInterval", &longValue) == 0) {
+        config->statusInterval = longValue;
+    }
+    if (configFile.getString("simSunModel", &name) == 0) {
+        config->sunModel = name == "fixed" ? SIM_SUN_FIXED : name == "ephemeris" ? SIM_SUN_EPHEMERIS : -1;
+    }
+    if (configFile.getDouble("simEpochJD", &value) == 0) {
+        config->epochJD = value;
+    }
+    if (configFile.getString("simShadowModel", &name) == 0) {
+        config->shadowModel = name == "cylindrical" ? SHADOW_CYLINDRICAL : name == "conical" ? SHADOW_CONICAL : -1;
+    }
+    if (configFile.getDouble("simControlPeriod", &value) == 0) {
+        config->controlPeriod = value;
+    }
+
+    if (!(config->runTime > 0.0) || !(config->tolerance > 0.0) || !(config->maxStep > 0.0) ||
+        config->stateNoise < 0.0 || !(config->controlPeriod >= 0.0) || getIntegrator(config->integrator) == NULL ||
+        (config->sunModel != SIM_SUN_FIXED && config->sunModel != SIM_SUN_EPHEMERIS) ||
+        (config->shadowModel != SHADOW_CYLINDRICAL && config->shadowModel != SHADOW_CONICAL)) {
+        ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+        return -1;
+    }
+    return 0;
+}
+
+Simulator::Simulator(const SimulatorConfig &config, const ControllerGains &gains) :
+    config(config), model(config.inertia), controller(gains),
+    sun(config.orbit, config.epochJD, config.shadowModel, 0.0,
+        config.sunModel == SIM_SUN_EPHEMERIS ? config.runTime : 0.0)
+{
+    sunHint = 0;
+    integrator = getIntegrator(config.integrator);
+    if (integrator == NULL) {
+        integrator = getIntegrator(SIM_INTEGRATOR_DP45);
+    }
+    checkpointInterval = 0;
+    init(StateVector());
+}
+
+// init - starts a new run at t = 0
+// @param x0 - the initial state [q; q_dot]
+void Simulator::init(const StateVector &x0)
+{
+    state.t = 0.0;
+    state.w = x0;
+    state.h = config.initialStep;
+    state.err = 0.0;
+    state.i = 1;
+    state.rejected = 0;
+    state.evaluations = 0;
+    state.D = Vec3();
+    state.tick = 0;
+    state.noise = StateVector();
+    state.noiseIndex = 0;
+    state.rng = config.seed;
+    controller.reset(&state.controller);
+
+    if (config.controlPeriod > 0.0) {
+        controlTick();
+    }
+    derivative(state.t, state.w, &state.s7);
+}
+
+// sunVector - the sun vector at time t, zero in eclipse.
+Vec3 Simulator::sunVector(double t)
+{
+    if (config.sunModel == SIM_SUN_FIXED) {
+        return config.rSun;
+    }
+    if (!sun.isVisible(t, &sunHint)) {
+        return Vec3();
+    }
+    return sun.sunVector(t);
+}
+
+// command - runs the controllers for step index i on the state seen by
+// them, x plus the state noise for that index.
+// @return - the commanded dipole (A*m^2)
+Vec3 Simulator::command(double t, const StateVector &x, const Vec3 &Binr, long i)
+{
+    // Add System Noise, a new sample for each step like the (commented out)
+    // noise in INCA_PID_Controller.m
+    if (config.stateNoise > 0.0 && state.noiseIndex < i) {
+        Random rng(state.rng);
+        for (int k = 0; k < STATE_SIZE; k++) {
+            state.noise[k] = config.stateNoise * rng.normal();
+        }
+        state.rng = rng.getState();
+        state.noiseIndex = i;
+    }
+
+    return controller.step(&state.controller, x + state.noise, Binr, sunVector(t), t, i);
+}
+
+// controlTick - runs the controllers at the current time and holds the
+// dipole until the next tick. The tick index is the controller step index.
+void Simulator::controlTick()
+{
+    state.tick++;
+    state.D = command(state.t, state.w, magFieldModel(config.orbit, state.t), state.tick);
+}
+
+// derivative - the state model with the controllers in the loop for the
+// current step, the f() of INCA_Dynamics_Solution.m. With a control period
+// the held dipole is used instead.
+void Simulator::derivative(double t, const StateVector &x, StateVector *xDot)
+{
+    state.evaluations++;
+    Vec3 Binr = magFieldModel(config.orbit, t);
+    if (!(config.controlPeriod > 0.0)) {
+        state.D = command(t, x, Binr, state.i);
+    }
+    model.derivative(x, Binr, state.D, xDot);
+}
+
+// jacobian - the state model jacobian with the last commanded dipole.
+void Simulator::jacobian(double t, const StateVector &x, StateMatrix *F)
+{
+    model.jacobian(x, magFieldModel(config.orbit, t), state.D, F);
+}
+
+// step - takes one accepted integration step.
+// @return - 0 on success, -1 if the solution diverged.
+int Simulator::step()
+{
+    const double T = config.tolerance;
+    StateVector &w = state.w;
+    double h = state.h;
+
+    // Calculate Step Size
+    if (state.i > 1) {
+        double exponent = 1.0 / (integrator->errorOrder() + 1);
+        double scale = 1e300;
+        for (int k = 0; k < STATE_SIZE; k++) {
+            double s = pow(T * (fabs(w[k]) + 1e-3) / state.err, exponent);
+            if (s < scale) { scale = s; }
+        }
+        h = 0.8 * scale * h;
+
+        // Set max time step
+        if (h > config.maxStep || std::isnan(h) || h == 0) {
+            h = config.maxStep;
+        }
+    }
+
+    // Normalize w(1:4) (q) vector
+    if (!integrator->preservesNorm()) {
+        double qNorm = sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2] + w[3] * w[3]);
+        for (int k = 0; k < 4; k++) {
+            w[k] /= qNorm;
+        }
+    }
+
+    // Controller tick, the new dipole changes the derivative at the start of
+    // the step. The step is cut short to end on the next tick, a step that
+    // would end just short of it is stretched to it so no tiny step is left.
+    bool toTick = false;
+    double tTick = 0.0;
+    if (config.controlPeriod > 0.0) {
+        if (state.t >= state.tick * config.controlPeriod) {
+            controlTick();
+            derivative(state.t, w, &state.s7);
+        }
+        tTick = state.tick * config.controlPeriod;
+        if (state.t + h > tTick - 1e-9 * config.controlPeriod) {
+            h = tTick - state.t;
+            toTick = true;
+        }
+    }
+
+    // Run Itteration
+    // NOTE: DormandPrince45.m is given the time at the end of the step so its
+    // stages are evaluated at t + h + c*h. Here they are at t + c*h.
+    StateVector zNew, fNew;
+    double err;
+
+    while (true) {
+        int ret = integrator->attempt(*this, state.t, w, h, state.s7, &zNew, &fNew, &err);
+
+        // Check solution tolerence
+        if (ret == 0) {
+            double minAbs = 1e300;
+            for (int k = 0; k < STATE_SIZE; k++) {
+                if (fabs(zNew[k]) < minAbs) { minAbs = fabs(zNew[k]); }
+            }
+            if (err / (1e-1 + minAbs) < T) {
+                break;
+            }
+        }
+        h = h / 15;
+        toTick = false;
+        state.rejected++;
+
+        if (!(h > 1e-12)) {
+            ErrorManager::ERROR(ADACS_SIMULATOR_DIVERGED);
+            return -1;
+        }
+    }
+
+    state.w = zNew;
+    state.s7 = fNew;
+    state.i++;
+    // a step cut short for a tick leaves the step size control alone, so the
+    // next step is tried at the size this one would have been.
+    if (toTick) {
+        state.t = tTick;
+    } else {
+        state.t += h;
+        state.h = h;
+        state.err = err;
+    }
+
+    // Break simulation if solution System exceads permitable perameters
+    for (int k = 0; k < STATE_SIZE; k++) {
+        if (!(fabs(zNew[k]) <= 1e4)) {
+            ErrorManager::ERROR(ADACS_SIMULATOR_DIVERGED);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// setCheckpoint - write a checkpoint to path every interval steps during
+// run(), 0 to turn it off.
+void Simulator::setCheckpoint(const string &path, long interval)
+{
+    checkpointPath = path;
+    checkpointInterval = interval;
+}
+
+// run - steps until t >= tEnd, writing checkpoints and calling the output
+// handler along the way.
+// @return - 0 on success, -1 if the solution diverged.
+int Simulator::run(double tEnd)
+{
+    while (state.t < tEnd) {
+        if (step() != 0) {
+            cout << "Solution Exceaded Permitable Perameters at t = " << state.t << " s" << endl;
+            return -1;
+        }
+
+        if (outputHandler) {
+            outputHandler(state);
+        }
+
+        // Write Out Status
+        if (config.statusInterval > 0 && state.i % config.statusInterval == 0) {
+            cout << fixed << setprecision(1) << " Completed: " << state.t / 3600 << " h of "
+                 << tEnd / 3600 << " h (" << state.t / tEnd * 100 << "%)" << endl;
+            cout.unsetf(ios::floatfield);
+        }
+
+        if (checkpointInterval > 0 && state.i % checkpointInterval == 0) {
+            saveCheckpoint(checkpointPath);
+        }
+    }
+    return 0;
+}
+
+// saveCheckpoint - writes the run state to path
+// @return - 0 on success, -1 on failure.
+int Simulator::saveCheckpoint(const string &path) const
+{
+    return writeCheckpoint(path, config, state);
+}
+
+// loadCheckpoint - reads the run state from path, the state is unchanged on
+// failure.
+// @return - 0 on success, -1 on failure.
+int Simulator::loadCheckpoint(const string &path)
+{
+    SimulatorState loaded;
+    if (readCheckpoint(path, config, &loaded) != 0) {
+        return -1;
+    }
+    state = loaded;
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////// checkpoint files
+
+// fnv1a - 64 bit FNV-1a hash used for the config fingerprint and checksum
+static uint64_t fnv1a(const char *data, size_t length, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+    for (size_t k = 0; k < length; k++) {
+        hash ^= (unsigned char)data[k];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// appends raw values to a checkpoint buffer
+class CheckpointWriter {
+public:
+    string buffer;
+
+    template <typename T>
+    void put(const T &value)
+    {
+        buffer.append((const char *)&value, sizeof(T));
+    }
+
+    template <int R>
+    void put(const Matrix<double, R, 1> &v)
+    {
+        for (int k = 0; k < R; k++) {
+            put(v[k]);
+        }
+    }
+};
+
+// reads raw values back out of a checkpoint buffer
+class CheckpointReader {
+public:
+    CheckpointReader(const string &buffer) : buffer(buffer), offset(0), failed(false) {}
+
+    template <typename T>
+    void get(T *value)
+    {
+        if (offset + sizeof(T) > buffer.size()) {
+            failed = true;
+            return;
+        }
+        memcpy(value, buffer.data() + offset, sizeof(T));
+        offset += sizeof(T);
+    }
+
+    template <int R>
+    void get(Matrix<double, R, 1> *v)
+    {
+        for (int k = 0; k < R; k++) {
+            get(&(*v)[k]);
+        }
+    }
+
+    bool ok() const { return !failed && offset == buffer.size(); }
+
+private:
+    const string &buffer;
+    size_t offset;
+    bool failed;
+};
+
+// configFingerprint - hash of the settings that change the solution, a
+// checkpoint can only be loaded with the same settings.
+static uint64_t configFingerprint(const SimulatorConfig &config)
+{
+    CheckpointWriter w;
+    w.put(config.tolerance);
+    w.put(config.initialStep);
+    w.put(config.maxStep);
+    w.put(config.integrator);
+    for (int k = 0; k < 9; k++) {
+        w.put(config.inertia[k]);
+    }
+    w.put(config.orbit.rp);
+    w.put(config.orbit.ecc);
+    w.put(config.orbit.RAAN);
+    w.put(config.orbit.inc);
+    w.put(config.orbit.ArgPer);
+    w.put(config.sunModel);
+    w.put(config.rSun);
+    if (config.sunModel == SIM_SUN_EPHEMERIS) {
+        w.put(config.epochJD);
+        w.put(config.shadowModel);
+    }
+    w.put(config.stateNoise);
+    w.put(config.seed);
+    w.put(config.controlPeriod);
+    return fnv1a(w.buffer.data(), w.buffer.size());
+}
+
+// writeCheckpoint - binary checkpoint file for a run of the given config.
+// @return - 0 on success, -1 on failure.
+int writeCheckpoint(const string &path, const SimulatorConfig &config, const SimulatorState &state)
+{
+    CheckpointWriter payload;
+    payload.put(state.t);
+    payload.put(state.w);
+    payload.put(state.s7);
+    payload.put(state.h);
+    payload.put(state.err);
+    payload.put((int64_t)state.i);
+    payload.put((int64_t)state.rejected);
+    payload.put((int64_t)state.evaluations);
+    payload.put(state.D);
+    payload.put((int64_t)state.tick);
+
+    const BdotState &bdot = state.controller.bdot;
+    payload.put(bdot.Bold);
+    payload.put(bdot.told);
+    payload.put(bdot.Dold);
+    payload.put((int64_t)bdot.iOld);
+    payload.put((uint8_t)bdot.initialized);
+
+    const PIDState &pid = state.controller.pid;
+    payload.put(pid.Eold);
+    payload.put(pid.Esum);
+    payload.put(pid.told);
+    payload.put((int64_t)pid.iOld);
+    payload.put((uint8_t)pid.initialized);
+
+    payload.put(state.noise);
+    payload.put((int64_t)state.noiseIndex);
+    payload.put(state.rng);
+
+    CheckpointWriter file;
+    file.buffer.append(CHECKPOINT_MAGIC, 8);
+    file.put((uint32_t)CHECKPOINT_VERSION);
+    file.put((uint32_t)payload.buffer.size());
+    file.put(configFingerprint(config));
+    file.buffer.append(payload.buffer);
+    file.put(fnv1a(payload.buffer.data(), payload.buffer.size()));
+
+    string tmpPath = path + ".tmp";
+    ofstream out(tmpPath.c_str(), ios::binary | ios::trunc);
+    out.write(file.buffer.data(), file.buffer.size());
+    out.close();
+    if (!out || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        remove(tmpPath.c_str());
+        ErrorManager::ERROR(ADACS_SIMULATOR_CHECKPOINT_WRITE_FAILED);
+        return -1;
+    }
+    return 0;
+}
+
+// readCheckpoint - reads a checkpoint written by writeCheckpoint() for the
+// same config.
+// @return - 0 on success, -1 on failure.
+int readCheckpoint(const string &path, const SimulatorConfig &config, SimulatorState *state)
+{
+    ifstream in(path.c_str(), ios::binary);
+    if (!in.is_open()) {
+        ErrorManager::ERROR(ADACS_SIMULATOR_CHECKPOINT_READ_FAILED);
+        return -1;
+    }
+    string file((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    const size_t headerSize = 8 + 4 + 4 + 8;
+    if (file.size() < headerSize + 8 || file.compare(0, 8, CHECKPOINT_MAGIC) != 0) {
+        ErrorManager::ERROR(ADACS_SIMULATOR_CHECKPOINT_INVALID);
+        return -1;
+    }
+
+    uint32_t version, size;
+    uint64_t fingerprint, checksum;
+    memcpy(&version, file.data() + 8, 4);
+    memcpy(&size, file.data() + 12, 4);
+    memcpy(&fingerprint, file.data() + 16, 8);
+    if (version != CHECKPOINT_VERSION || file.size() != headerSize + size + 8 ||
+        fingerprint != configFingerprint(config)) {
+        ErrorManager::ERROR(ADACS_SIMULATOR_CHECKPOINT_INVALID);
+        return -1;
+    }
+
+    string payload = file.substr(headerSize, size);
+    memcpy(&checksum, file.data() + headerSize + size, 8);
+    if (checksum != fnv1a(payload.data(), payload.size())) {
+        ErrorManager::ERROR(ADACS_SIMULATOR_CHECKPOINT_INVALID);
+        return -1;
+    }
+
+    CheckpointReader r(payload);
+    int64_t i = 0, rejected = 0, evaluations = 0, tick = 0, bdotIOld = 0, pidIOld = 0, noiseIndex = 0;
+    uint8_t bdotInit = 0, pidInit = 0;
+
+    r.get(&state->t);
+    r.get(&state->w);
+    r.get(&state->s7);
+    r.get(&state->h);
+    r.get(&state->err);
+    r.get(&i);
+    r.get(&rejected);
+    r.get(&evaluations);
+    r.get(&state->D);
+    r.get(&tick);
+
+    BdotState &bdot = state->controller.bdot;
+    r.get(&bdot.Bold);
+    r.get(&bdot.told);
+    r.get(&bdot.Dold);
+    r.get(&bdotIOld);
+    r.get(&bdotInit);
+
+    PIDState &pid = state->controller.pid;
+    r.get(&pid.Eold);
+    r.get(&pid.Esum);
+    r.get(&pid.told);
+    r.get(&pidIOld);
+    r.get(&pidInit);
+
+    r.get(&state->noise);
+    r.get(&noiseIndex);
+    r.get(&state->rng);
+
+    if (!r.ok()) {
+        ErrorManager::ERROR(ADACS_SIMULATOR_CHECKPOINT_INVALID);
+        return -1;
+    }
+
+    state->i = i;
+    state->rejected = rejected;
+    state->evaluations = evaluations;
+    state->tick = tick;
+    bdot.iOld = bdotIOld;
+    bdot.initialized = bdotInit != 0;
+    pid.iOld = pidIOld;
+    pid.initialized = pidInit != 0;
+    state->noiseIndex = noiseIndex;
+    return 0;
+}
+
+// runBranches - runs each set of gains from the same starting state to tEnd
+// on a pool of threads.
+// @return - the number of branches that diverged.
+int runBranches(const SimulatorConfig &config, const SimulatorState &start,
+                const vector<ControllerGains> &variants, double tEnd,
+                vector<SimulatorState> *results, int threads)
+{
+    if (threads <= 0) {
+        threads = thread::hardware_concurrency();
+        if (threads <= 0) { threads = 1; }
+    }
+
+    SimulatorConfig branchConfig = config;
+    branchConfig.statusInterval = 0;
+
+    results->assign(variants.size(), start);
+    atomic<size_t> next(0);
+    atomic<int> diverged(0);
+
+    auto worker = [&]() {
+        size_t k;
+        while ((k = next.fetch_add(1)) < variants.size()) {
+            Simulator sim(branchConfig, variants[k]);
+            sim.setState(start);
+            if (sim.run(tEnd) != 0) {
+                diverged++;
+            }
+            (*results)[k] = sim.getState();
+        }
+    };
+
+    vector<thread> pool;
+    for (int k = 1; k < threads; k++) {
+        pool.push_back(thread(worker));
+    }
+    worker();
+    for (size_t k = 0; k < pool.size(); k++) {
+        pool[k].join();
+    }
+    return diverged.load();
+}
@@ -0,0 +1,271 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Simulator.hpp
+//
+// Attitude simulator, the C++ version of ADACSDynamics/INCA_Dynamics_Solution.m
+// The state x = [q; q_dot] is propagated with the same adaptive step loop
+// (tolerance, h / 15 on a rejected step, max step of 20 s and q normalized
+// every step) with the AttitudeController closing the loop. The integrator is
+// picked with SimulatorConfig::integrator (see Integrator.hpp), the default is
+// the Dormand Prince 4/5 pair of DormandPrince45.m
+//
+// Everything needed to continue a run is kept in SimulatorState: the
+// integrator state including the FSAL derivative s7 and the current h, the
+// controller history, the step index and the random number generator. The
+// state can be written to a compact binary checkpoint, either by hand or every
+// N steps during run(), and a run resumed from a checkpoint is bit exact with
+// the run that was never stopped.
+//
+// runBranches() forks any number of controller gain variants from one
+// checkpoint so the shared part of the run is only simulated once.
+//
+// By default the controllers are run in every derivative evaluation like
+// INCA_Dynamics_Solution.m, with the i_old < i trick keeping their history
+// to one update per accepted step. With SimulatorConfig::controlPeriod > 0
+// they are a discrete time system instead: they run once at each tick
+// t_k = k * controlPeriod, the dipole is held (zero order hold) until the
+// next tick and no step crosses a tick. The derivative evaluations are then
+// just the state model, and the result no longer depends on where the
+// integrator put its steps.
+//
+// Example code for use is shown below:
+//
+// SimulatorConfig config = defaultSimulatorConfig();
+// Simulator sim(config, gains);
+// sim.init(x0);
+// sim.setCheckpoint("run.ckpt", 10000);
+// if (sim.run(config.runTime) != 0) {
+// // the solution diverged, restart from the checkpoint with other settings
+// }
+//
+// // later, continue the run
+// Simulator resumed(config, gains);
+// resumed.loadCheckpoint("run.ckpt");
+// resumed.run(config.runTime);
+
+#ifndef Simulator_hpp
+#define Simulator_hpp
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include "StateModel.hpp"
+#include "AttitudeController.hpp"
+#include "OrbitModel.hpp"
+#include "SunModel.hpp"
+#include "Random.hpp"
+#include "Integrator.hpp"
+#include "ConfigFile.hpp"
+
+using namespace std;
+
+#define SIM_SUN_FIXED 0
+#define SIM_SUN_EPHEMERIS 1
+
+struct SimulatorConfig {
+    // Run Time in Seconds
+    double runTime;
+    // integration tolerance
+    double tolerance;
+    // Initial Step Size (s)
+    double initialStep;
+    // max time step (s)
+    double maxStep;
+    // SIM_INTEGRATOR_DP45, SIM_INTEGRATOR_LIE_GROUP or SIM_INTEGRATOR_ROSENBROCK
+    int integrator;
+    // INCA Inertial Matrix (kg*m^2)
+    Mat3 inertia;
+    OrbitParameters orbit;
+    // SIM_SUN_FIXED uses rSun for the whole run, SIM_SUN_EPHEMERIS uses the
+    // SunModel with the earth shadow, the controllers only get a sun vector
+    // while the sun is visible.
+    int sunModel;
+    // sun direction in the inertial frame for SIM_SUN_FIXED
+    Vec3 rSun;
+    // julian date at t = 0 and SHADOW_CYLINDRICAL or SHADOW_CONICAL for
+    // SIM_SUN_EPHEMERIS
+    double epochJD;
+    int shadowModel;
+    // standard deviation of the noise added to the state seen by the
+    // controllers, 0 to turn it off.
+    double stateNoise;
+    uint64_t seed;
+    // print the progress every N steps, 0 to turn it off.
+    long statusInterval;
+    // controller sample period (s), 0 to run the controllers in every
+    // derivative evaluation.
+    double controlPeriod;
+};
+
+// everything needed to continue a run.
+struct SimulatorState {
+    double t;
+    StateVector w;
+    // FSAL derivative at (t, w)
+    StateVector s7;
+    // current step size and error estimate of the last step
+    double h;
+    double err;
+    // step index
+    long i;
+    long rejected;
+    long evaluations;
+    // dipole commanded in the last derivative evaluation, or held since the
+    // last controller tick
+    Vec3 D;
+    // index of the next controller tick, at t = tick * controlPeriod
+    long tick;
+    ControllerState controller;
+    // noise added to the state for step noiseIndex
+    StateVector noise;
+    long noiseIndex;
+    uint64_t rng;
+};
+
+// defaultSimulatorConfig - the settings from INCA_Dynamics_Solution.m
+SimulatorConfig defaultSimulatorConfig();
+
+// initialState - the state for a rotation of theta about axis with a
+// rotation rate of omega, like xhat_init in INCA_Dynamics_Solution.m
+// @param axis - initial vector of rotation (normalized here)
+// @param theta - initial rotation angle (rad)
+// @param omega - initial rotation rate (rad/s)
+StateVector initialState(const Vec3 &axis, double theta, const Vec3 &omega);
+
+// defaultInitialState - the initial state from INCA_Dynamics_Solution.m
+StateVector defaultInitialState();
+
+// sunDirection - the sun vector in the inertial frame at time t of a run,
+// ignoring the earth shadow.
+// @param sunModel, rSun, epochJD - as in SimulatorConfig
+// @param t - time since the start of the run (s)
+Vec3 sunDirection(int sunModel, const Vec3 &rSun, double epochJD, double t);
+
+// pointingAngle - angle between the sun and the target in the body frame,
+// acosd((r_sun_body' * r_target) / (norm(r_sun_body) * norm(r_target)))
+// @param q - attitude quaternion
+// @param rSun - sun vector in the inertial frame
+// @param rTarget - target vector in the body frame
+// @return - the angle (deg)
+double pointingAngle(const Vec4 &q, const Vec3 &rSun, const Vec3 &rTarget);
+double pointingAngle(const Vec3 &sunBody, const Vec3 &rTarget);
+
+// loadSimulatorConfig - reads the simulator settings from a config file.
+// Keys: simRunTime, simTolerance, simMaxStep, simIntegrator (dp45, lie or
+// rosenbrock), simStateNoise, simSeed, simStatusInterval, simSunModel (fixed or
+// ephemeris), simEpochJD, simShadowModel (cylindrical or conical),
+// simControlPeriod. Any key that is missing keeps its value.
+// @return - 0 on success, -1 on failure.
+int loadSimulatorConfig(ConfigFile &configFile, SimulatorConfig *config);
+
+class Simulator : private IntegratorSystem {
+public:
+    Simulator(const SimulatorConfig &config, const ControllerGains &gains);
+
+    // init - starts a new run at t = 0
+    // @param x0 - the initial state [q; q_dot]
+    void init(const StateVector &x0);
+
+    // step - takes one accepted integration step. With a control period the
+    // controllers are run first if a tick is due, and the step is cut short
+    // to end on the next tick.
+    // @return - 0 on success, -1 if the solution diverged.
+    int step();
+
+    // run - steps until t >= tEnd, writing checkpoints and calling the output
+    // handler along the way.
+    // @return - 0 on success, -1 if the solution diverged.
+    int run(double tEnd);
+
+    // setOutputHandler - called with the state after every accepted step.
+    void setOutputHandler(function<void(const SimulatorState &)> handler) { outputHandler = handler; }
+
+    // setCheckpoint - write a checkpoint to path every interval steps during
+    // run(), 0 to turn it off.
+    void setCheckpoint(const string &path, long interval);
+
+    // saveCheckpoint / loadCheckpoint - write or read the run state.
+    // @return - 0 on success, -1 on failure.
+    int saveCheckpoint(const string &path) const;
+    int loadCheckpoint(const string &path);
+
+    const SimulatorState &getState() const { return state; }
+    void setState(const SimulatorState &s) { state = s; }
+    const SimulatorConfig &getConfig() const { return config; }
+
+private:
+    SimulatorConfig config;
+    StateModel model;
+    AttitudeController controller;
+    const Integrator *integrator;
+    SimulatorState state;
+
+    // eclipses for the whole run, and the index of the last one looked up
+    SunModel sun;
+    size_t sunHint;
+
+    function<void(const SimulatorState &)> outputHandler;
+    string checkpointPath;
+    long checkpointInterval;
+
+    // sunVector - the sun vector at time t, zero in eclipse.
+    Vec3 sunVector(double t);
+
+    // command - runs the controllers for step index i on the state seen by
+    // them, x plus the state noise for that index.
+    // @return - the commanded dipole (A*m^2)
+    Vec3 command(double t, const StateVector &x, const Vec3 &Binr, long i);
+
+    // controlTick - runs the controllers at the current time and holds the
+    // dipole until the next tick.
+    void controlTick();
+
+    // derivative - the state model with the controllers in the loop for the
+    // current step, the f() of INCA_Dynamics_Solution.m
+    void derivative(double t, const StateVector &x, StateVector *xDot);
+
+    // jacobian - the state model jacobian with the last commanded dipole.
+    void jacobian(double t, const StateVector &x, StateMatrix *F);
+};
+
+// writeCheckpoint / readCheckpoint - binary checkpoint file for a run of the
+// given config. The file is written to a temp file first and then renamed so
+// an interrupted write never leaves a broken checkpoint behind. Checkpoints
+// are in the byte order of the machine that wrote them.
+// @return - 0 on success, -1 on failure.
+int writeCheckpoint(const string &path, const SimulatorConfig &config, const SimulatorState &state);
+int readCheckpoint(const string &path, const SimulatorConfig &config, SimulatorState *state);
+
+// runBranches - runs each set of gains from the same starting state to tEnd
+// on a pool of threads.
+// @param config - the simulator config used to make start.
+// @param start - the shared starting state, usually from readCheckpoint()
+// @param variants - the gains for each branch.
+// @param tEnd - end time of each branch (s)
+// @param results - output final state of each branch.
+// @param threads - number of threads, 0 for one per core.
+// @return - the number of branches that diverged.
+int runBranches(const SimulatorConfig &config, const SimulatorState &start,
+                const vector<ControllerGains> &variants, double tEnd,
+                vector<SimulatorState> *results, int threads);
+
+#endif /* Simulator_hpp */
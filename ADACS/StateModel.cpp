@@ -0,0 +1,117 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  StateModel.cpp
+//
+// The INCA attitude state model used by the kalman filter and the simulator.
+// This is the C++ version of ADACSDynamics/INCA_State_Model.m without the
+// controllers, the commanded dipole D is passed in instead.
+
+#include "StateModel.hpp"
+#include "Quaternion.hpp"
+#include "Dual.hpp"
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+// constructor for the state model, the inverse is found in double and
+// then rounded to T.
+// @param inertia - the spacecraft inertia matrix (kg*m^2)
+template <typename T>
+StateModelT<T>::StateModelT(const Mat3 &inertia)
+{
+    Mat3 inv;
+    if (invert3(inertia, &inv) != 0) {
+        ErrorManager::ERROR(ADACS_STATE_MODEL_SINGULAR_INERTIA);
+        inv = Mat3::zeros();
+    }
+    inertiaInv = matrixCast<T>(inv);
+}
+
+// jacobian - calculates F = d(x_dot)/dx analytically.
+// Xi() is linear in its argument so each partial is found by swapping the
+// differentiated quaternion for the unit quaternion e_j.
+// @param x - the current state [q; q_dot]
+// @param Binr - the magnetic field in the inertial frame (T)
+// @param D - the commanded magnetic dipole (A*m^2)
+// @param F - output 8x8 jacobian.
+template <typename T>
+void StateModelT<T>::jacobian(const Vector &x, const Vector3 &Binr, const Vector3 &D, Jacobian *F) const
+{
+    Matrix<T, 4, 1> q, qDot;
+    for (int i = 0; i < 4; i++) {
+        q[i] = x[i];
+        qDot[i] = x[i + 4];
+    }
+
+    Matrix<T, 4, 3> XiQ = Xi(q);
+    Matrix<T, 4, 3> XiQDot = Xi(qDot);
+    Vector3 w = XiQ.transpose() * qDot;
+    Matrix<T, 4, 4> XiQDotXiQT = XiQDot * XiQ.transpose();
+
+    Vector3 Bbody = quatTrans(q, Binr);
+    Vector3 c = inertiaInv * cross(D, Bbody);
+    Matrix<T, 3, 4> dBbody = quatTransJacobian(q, Binr);
+
+    *F = Jacobian::zeros();
+    for (int i = 0; i < 4; i++) {
+        (*F)(i, i + 4) = T(1);
+    }
+
+    for (int j = 0; j < 4; j++) {
+        Matrix<T, 4, 1> e;
+        e[j] = T(1);
+        Matrix<T, 4, 3> XiE = Xi(e);
+
+        Vector3 dB;
+        dB[0] = dBbody(0, j); dB[1] = dBbody(1, j); dB[2] = dBbody(2, j);
+
+        // partial with respect to q_j
+        Matrix<T, 4, 1> dq = XiQDot * (XiE.transpose() * qDot)
+                + T(0.5) * (XiE * c)
+                + T(0.5) * (XiQ * (inertiaInv * cross(D, dB)));
+
+        // partial with respect to q_dot_j
+        Matrix<T, 4, 1> dqDot = XiE * w;
+
+        for (int i = 0; i < 4; i++) {
+            (*F)(i + 4, j) = dq[i];
+            (*F)(i + 4, j + 4) = dqDot[i] + XiQDotXiQT(i, j);
+        }
+    }
+}
+
+template class StateModelT<float>;
+template class StateModelT<double>;
+
+// autoJacobian - calculates F by evaluating derivative() once on
+// Dual<STATE_SIZE> numbers.
+// @param x - the current state [q; q_dot]
+// @param Binr - the magnetic field in the inertial frame (T)
+// @param D - the commanded magnetic dipole (A*m^2)
+// @param F - output 8x8 jacobian.
+void StateModel::autoJacobian(const StateVector &x, const Vec3 &Binr, const Vec3 &D, StateMatrix *F) const
+{
+    typedef Matrix<Dual<STATE_SIZE>, STATE_SIZE, 1> DualState;
+    ::autoJacobian([&](const DualState &xd) {
+        DualState xDot;
+        derivative(xd, Binr, D, &xDot);
+        return xDot;
+    }, x, (StateVector *)NULL, F);
+}
@@ -0,0 +1,182 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  StateModel.hpp
+//
+// The INCA attitude state model used by the kalman filter and the simulator.
+// This is the C++ version of ADACSDynamics/INCA_State_Model.m without the
+// controllers, the commanded dipole D is passed in instead.
+//
+// The state vector is x = [q; q_dot] where q = [q1, q2, q3, q4] (q4 scalar).
+//
+// x_dot = [q_dot;
+//          Xi(q_dot) * Xi(q)' * q_dot + 0.5 * Xi(q) * I^-1 * cross(D, B_body)]
+//
+// StateModelT<T> is the model in float or double, StateModel is the double
+// model used by the simulator and the ground tools. derivative() is written
+// once for any scalar type of the state, Dual<N> gives its derivatives and
+// the lanes version runs it on every lane.
+
+#ifndef StateModel_hpp
+#define StateModel_hpp
+
+#include "Matrix.hpp"
+#include "Quaternion.hpp"
+#include "Lanes.hpp"
+
+#define STATE_SIZE 8
+
+typedef Matrix<double, STATE_SIZE, 1> StateVector;
+typedef Matrix<double, STATE_SIZE, STATE_SIZE> StateMatrix;
+
+// StateModelT - the model in the scalar type T. The model is compiled for
+// float and double (StateModel.cpp), float is for the flight processors
+// that are much faster in single precision.
+template <typename T>
+class StateModelT {
+public:
+    typedef Matrix<T, STATE_SIZE, 1> Vector;
+    typedef Matrix<T, STATE_SIZE, STATE_SIZE> Jacobian;
+    typedef Matrix<T, 3, 1> Vector3;
+
+    // constructor for the state model, the inverse is found in double and
+    // then rounded to T.
+    // @param inertia - the spacecraft inertia matrix (kg*m^2)
+    StateModelT(const Mat3 &inertia);
+
+    // derivative - calculates the state derivative. The state can be of
+    // another scalar type S than the model, Dual<N> gives its derivatives.
+    // @param x - the current state [q; q_dot]
+    // @param Binr - the magnetic field in the inertial frame (T)
+    // @param D - the commanded magnetic dipole (A*m^2)
+    // @param xDot - output state derivative.
+    template <typename S>
+    void derivative(const Matrix<S, STATE_SIZE, 1> &x, const Vector3 &Binr, const Vector3 &D,
+                    Matrix<S, STATE_SIZE, 1> *xDot) const;
+
+    // jacobian - calculates F = d(x_dot)/dx analytically.
+    // This is the same model as KalmanFilterDerivation/F_Derivation.m but using
+    // the full inertia matrix.
+    // @param x - the current state [q; q_dot]
+    // @param Binr - the magnetic field in the inertial frame (T)
+    // @param D - the commanded magnetic dipole (A*m^2)
+    // @param F - output 8x8 jacobian.
+    void jacobian(const Vector &x, const Vector3 &Binr, const Vector3 &D, Jacobian *F) const;
+
+    const Matrix<T, 3, 3> &getInertiaInv() const { return inertiaInv; }
+
+protected:
+    Matrix<T, 3, 3> inertiaInv;
+};
+
+// StateModel - the double model used on the ground, with the lanes version
+// of derivative() and the jacobian from Dual numbers.
+class StateModel : public StateModelT<double> {
+public:
+    // constructor for the state model
+    // @param inertia - the spacecraft inertia matrix (kg*m^2)
+    StateModel(const Mat3 &inertia) : StateModelT<double>(inertia) {}
+
+    using StateModelT<double>::derivative;
+
+    // derivative - the derivative of N states at once, stored as lanes.
+    template <int N>
+    void derivative(const Matrix<Lanes<N>, STATE_SIZE, 1> &x, const Vec3 &Binr, const Vec3 &D,
+                    Matrix<Lanes<N>, STATE_SIZE, 1> *xDot) const;
+
+    // autoJacobian - calculates F by evaluating derivative() once on
+    // Dual<STATE_SIZE> numbers. This is exact like jacobian() but follows
+    // any change to derivative() without a new derivation.
+    // @param x - the current state [q; q_dot]
+    // @param Binr - the magnetic field in the inertial frame (T)
+    // @param D - the commanded magnetic dipole (A*m^2)
+    // @param F - output 8x8 jacobian.
+    void autoJacobian(const StateVector &x, const Vec3 &Binr, const Vec3 &D, StateMatrix *F) const;
+};
+
+// derivative - calculates the state derivative. The state can be of
+// another scalar type S than the model, Dual<N> gives its derivatives.
+// The model is written out with scalars, so it costs no Matrix temporaries
+// and the lanes version below vectorizes over the lanes.
+// @param x - the current state [q; q_dot]
+// @param Binr - the magnetic field in the inertial frame (T)
+// @param D - the commanded magnetic dipole (A*m^2)
+// @param xDot - output state derivative.
+template <typename T>
+template <typename S>
+void StateModelT<T>::derivative(const Matrix<S, STATE_SIZE, 1> &x, const Vector3 &Binr, const Vector3 &D,
+                                Matrix<S, STATE_SIZE, 1> *xDot) const
+{
+    const Matrix<T, 3, 3> &Ii = inertiaInv;
+    S q0 = x[0], q1 = x[1], q2 = x[2], q3 = x[3];
+    S qd0 = x[4], qd1 = x[5], qd2 = x[6], qd3 = x[7];
+
+    // Bbody = quatTrans(q, Binr) = q * [Binr; 0] * q^-1
+    S a0 = q3 * Binr[0] + q1 * Binr[2] - q2 * Binr[1];
+    S a1 = q3 * Binr[1] - q0 * Binr[2] + q2 * Binr[0];
+    S a2 = q3 * Binr[2] + q0 * Binr[1] - q1 * Binr[0];
+    S a3 = -(q0 * Binr[0] + q1 * Binr[1] + q2 * Binr[2]);
+    S b0 = -a3 * q0 + a0 * q3 - a1 * q2 + a2 * q1;
+    S b1 = -a3 * q1 + a0 * q2 + a1 * q3 - a2 * q0;
+    S b2 = -a3 * q2 - a0 * q1 + a1 * q0 + a2 * q3;
+
+    // c = I^-1 * cross(D, Bbody)
+    S t0 = D[1] * b2 - D[2] * b1;
+    S t1 = D[2] * b0 - D[0] * b2;
+    S t2 = D[0] * b1 - D[1] * b0;
+    S c0 = Ii(0,0) * t0 + Ii(0,1) * t1 + Ii(0,2) * t2;
+    S c1 = Ii(1,0) * t0 + Ii(1,1) * t1 + Ii(1,2) * t2;
+    S c2 = Ii(2,0) * t0 + Ii(2,1) * t1 + Ii(2,2) * t2;
+
+    // w = Xi(q)' * q_dot
+    S w0 = q3 * qd0 + q2 * qd1 - q1 * qd2 - q0 * qd3;
+    S w1 = -q2 * qd0 + q3 * qd1 + q0 * qd2 - q1 * qd3;
+    S w2 = q1 * qd0 - q0 * qd1 + q3 * qd2 - q2 * qd3;
+
+    // q_dot_dot = Xi(q_dot) * w + 0.5 * Xi(q) * c
+    (*xDot)[0] = qd0;
+    (*xDot)[1] = qd1;
+    (*xDot)[2] = qd2;
+    (*xDot)[3] = qd3;
+    (*xDot)[4] = qd3 * w0 - qd2 * w1 + qd1 * w2 + T(0.5) * (q3 * c0 - q2 * c1 + q1 * c2);
+    (*xDot)[5] = qd2 * w0 + qd3 * w1 - qd0 * w2 + T(0.5) * (q2 * c0 + q3 * c1 - q0 * c2);
+    (*xDot)[6] = -qd1 * w0 + qd0 * w1 + qd3 * w2 + T(0.5) * (-q1 * c0 + q0 * c1 + q3 * c2);
+    (*xDot)[7] = -qd0 * w0 - qd1 * w1 - qd2 * w2 + T(0.5) * (-q0 * c0 - q1 * c1 - q2 * c2);
+}
+
+// derivative - the derivative of N states at once, stored as lanes. Each
+// lane goes through derivative() above, which is inlined into the loop so
+// the loop over the lanes vectorizes.
+template <int N>
+void StateModel::derivative(const Matrix<Lanes<N>, STATE_SIZE, 1> &x, const Vec3 &Binr, const Vec3 &D,
+                            Matrix<Lanes<N>, STATE_SIZE, 1> *xDot) const
+{
+    for (int k = 0; k < N; k++) {
+        StateVector xk, xkDot;
+        for (int i = 0; i < STATE_SIZE; i++) {
+            xk[i] = x[i].v[k];
+        }
+        derivative(xk, Binr, D, &xkDot);
+        for (int i = 0; i < STATE_SIZE; i++) {
+            (*xDot)[i].v[k] = xkDot[i];
+        }
+    }
+}
+
+#endif /* StateModel_hpp */
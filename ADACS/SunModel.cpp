@@ -0,0 +1,200 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  SunModel.cpp
+//
+// Sun vector and earth shadow model for the attitude simulator.
+
+#include "SunModel.hpp"
+
+#include <algorithm>
+
+// sunPosition - position of the sun in ECI coordinates, the low precision
+// ephemeris from Vallado (Fundamentals of Astrodynamics, Algorithm 29).
+// @param jd - julian date
+// @return - position (km)
+Vec3 sunPosition(double jd)
+{
+    double T = (jd - J2000_JD) / 36525;
+    double deg = M_PI / 180;
+
+    double lambdaM = 280.460 + 36000.771 * T;
+    double M = (357.5291092 + 35999.05034 * T) * deg;
+    double lambda = (lambdaM + 1.914666471 * sin(M) + 0.019994643 * sin(2 * M)) * deg;
+    double r = 1.000140612 - 0.016708617 * cos(M) - 0.000139589 * cos(2 * M);
+    double epsilon = (23.439291 - 0.0130042 * T) * deg;
+
+    r *= ASTRONOMICAL_UNIT;
+    return makeVec3(r * cos(lambda), r * cos(epsilon) * sin(lambda), r * sin(epsilon) * sin(lambda));
+}
+
+// illumination - fraction of the sun disk seen from the spacecraft.
+// @param r - spacecraft position (km)
+// @param rSun - sun position (km)
+// @param shadowModel - SHADOW_CYLINDRICAL or SHADOW_CONICAL
+// @return - 0 in full shadow to 1 in full sun.
+double illumination(const Vec3 &r, const Vec3 &rSun, int shadowModel)
+{
+    if (shadowModel == SHADOW_CYLINDRICAL) {
+        Vec3 s = rSun * (1.0 / norm(rSun));
+        double along = dot(r, s);
+        if (along < 0 && norm(r - along * s) < EARTH_RADIUS) {
+            return 0.0;
+        }
+        return 1.0;
+    }
+
+    // conical, apparent radius of the sun (a) and earth (b) and the angle
+    // between their centers (c).
+    Vec3 d = rSun - r;
+    double a = asin(SUN_RADIUS / norm(d));
+    double b = asin(EARTH_RADIUS / norm(r));
+    double cosC = -dot(r, d) / (norm(r) * norm(d));
+    double c = acos(fmax(-1.0, fmin(1.0, cosC)));
+
+    if (c >= a + b) {
+        return 1.0;
+    }
+    if (c <= b - a) {
+        return 0.0;
+    }
+    if (c <= a - b) {
+        // earth fully inside the sun disk
+        return 1.0 - (b * b) / (a * a);
+    }
+
+    // area of the overlap of the two disks
+    double area = a * a * acos((c * c + a * a - b * b) / (2 * c * a))
+                + b * b * acos((c * c + b * b - a * a) / (2 * c * b))
+                - 0.5 * sqrt((-c + a + b) * (c + a - b) * (c - a + b) * (c + a + b));
+    return 1.0 - area / (M_PI * a * a);
+}
+
+// constructor, finds all of the eclipses between tStart and tEnd.
+// The visibility is sampled every 1/720 of an orbit (about 8 s in LEO), then
+// each sign change is found to 0.1 ms by bisection. Eclipses shorter than the
+// sample time (grazing orbits) can be missed.
+SunModel::SunModel(const OrbitParameters &orbit, double epochJD, int shadowModel,
+                   double tStart, double tEnd) :
+    orbit(orbit), epochJD(epochJD), shadowModel(shadowModel), tStart(tStart), tEnd(tEnd)
+{
+    double dt = orbitPeriod(orbit) / 720;
+    int samples = (int)ceil((tEnd - tStart) / dt);
+    dt = (tEnd - tStart) / fmax(samples, 1);
+
+    double tOld = tStart;
+    double vOld = visibility(tOld);
+    EclipseInterval current;
+    current.start = tStart;
+    bool inEclipse = vOld <= 0.0;
+
+    for (int k = 1; k <= samples; k++) {
+        double t = tStart + k * dt;
+        double v = visibility(t);
+
+        if ((v <= 0.0) != (vOld <= 0.0)) {
+            // bisection for the crossing
+            double lo = tOld, hi = t;
+            while (hi - lo > 1e-4) {
+                double mid = 0.5 * (lo + hi);
+                if ((visibility(mid) <= 0.0) == (vOld <= 0.0)) {
+                    lo = mid;
+                } else {
+                    hi = mid;
+                }
+            }
+
+            if (inEclipse) {
+                current.end = hi;
+                eclipses.push_back(current);
+            } else {
+                current.start = hi;
+            }
+            inEclipse = !inEclipse;
+        }
+        tOld = t;
+        vOld = v;
+    }
+
+    if (inEclipse) {
+        current.end = tEnd;
+        eclipses.push_back(current);
+    }
+}
+
+// visibility - illuminated fraction minus SUN_VISIBLE_FRACTION, positive
+// when the sun is visible.
+double SunModel::visibility(double t) const
+{
+    Vec3 r = keplOrbitModel(orbit, t);
+    Vec3 rSun = sunPosition(epochJD + t / 86400);
+    return illumination(r, rSun, shadowModel) - SUN_VISIBLE_FRACTION;
+}
+
+// sunVector - unit vector to the sun in the inertial frame at time t
+Vec3 SunModel::sunVector(double t) const
+{
+    Vec3 rSun = sunPosition(epochJD + t / 86400);
+    return rSun * (1.0 / norm(rSun));
+}
+
+// isVisibleDirect - checks if the sun can be seen at time t from the
+// orbit and ephemeris without the eclipse list.
+bool SunModel::isVisibleDirect(double t) const
+{
+    return visibility(t) > 0.0;
+}
+
+// isVisible - checks if the sun can be seen at time t using the eclipse
+// list. Times outside of [tStart, tEnd) are checked directly.
+// @param t - time (s)
+// @param hint - index from the last call, or NULL to always binary search.
+bool SunModel::isVisible(double t, size_t *hint) const
+{
+    if (t < tStart || t >= tEnd) {
+        return isVisibleDirect(t);
+    }
+
+    // index of the first eclipse that ends after t
+    const size_t n = eclipses.size();
+    size_t index = n + 1;
+    if (hint != NULL) {
+        // the same or the next eclipse covers nearly every call
+        for (size_t k = *hint; k <= n && k <= *hint + 1; k++) {
+            if ((k == 0 || eclipses[k - 1].end <= t) && (k == n || eclipses[k].end > t)) {
+                index = k;
+                break;
+            }
+        }
+    }
+    if (index > n) {
+        EclipseInterval key;
+        key.start = t;
+        key.end = t;
+        index = upper_bound(eclipses.begin(), eclipses.end(), key,
+                            [](const EclipseInterval &a, const EclipseInterval &b) {
+                                return a.end < b.end;
+                            }) - eclipses.begin();
+    }
+    if (hint != NULL) {
+        *hint = index;
+    }
+
+    return index == n || t < eclipses[index].start;
+}
@@ -0,0 +1,124 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  SunModel.hpp
+//
+// Sun vector and earth shadow model for the attitude simulator. This replaces
+// the fixed r_sun = [1,0,0] test value in INCA_Dynamics_Solution.m
+//
+// The sun position comes from the low precision solar ephemeris in Vallado
+// (about 0.01 deg). The shadow is either the cylindrical model, or the
+// conical model where the illuminated fraction of the sun disk is found from
+// the overlap of the sun and earth disks. The sun counts as visible while at
+// least SUN_VISIBLE_FRACTION of the disk can be seen.
+//
+// The eclipse entry and exit times for the orbit from keplOrbitModel are
+// found once when the model is made and kept in a sorted list, so checking
+// if the sun is visible is a binary search, or O(1) when the caller keeps a
+// hint between calls with increasing times like the simulator does.
+//
+// Example code for use is shown below:
+//
+// SunModel sun(defaultOrbit(), J2000_JD, SHADOW_CONICAL, 0.0, 16 * 3600);
+// size_t hint = 0;
+// if (sun.isVisible(t, &hint)) {
+//     Vec3 rSun = sun.sunVector(t);
+// }
+
+#ifndef SunModel_hpp
+#define SunModel_hpp
+
+#include <vector>
+#include <cstddef>
+
+#include "OrbitModel.hpp"
+
+using namespace std;
+
+#define SHADOW_CYLINDRICAL 0
+#define SHADOW_CONICAL 1
+
+// Julian date of the J2000 epoch
+#define J2000_JD 2451545.0
+// Astronomical unit (km)
+#define ASTRONOMICAL_UNIT 149597870.7
+// Radius of the sun (km)
+#define SUN_RADIUS 696000.0
+// fraction of the sun disk that has to be seen for it to be visible
+#define SUN_VISIBLE_FRACTION 0.5
+
+struct EclipseInterval {
+    // entry and exit time (s)
+    double start;
+    double end;
+};
+
+// sunPosition - position of the sun in ECI coordinates.
+// @param jd - julian date
+// @return - position (km)
+Vec3 sunPosition(double jd);
+
+// illumination - fraction of the sun disk seen from the spacecraft.
+// @param r - spacecraft position (km)
+// @param rSun - sun position (km)
+// @param shadowModel - SHADOW_CYLINDRICAL or SHADOW_CONICAL
+// @return - 0 in full shadow to 1 in full sun.
+double illumination(const Vec3 &r, const Vec3 &rSun, int shadowModel);
+
+class SunModel {
+public:
+    // constructor, finds all of the eclipses between tStart and tEnd.
+    // @param orbit - the spacecraft orbit
+    // @param epochJD - julian date at t = 0
+    // @param shadowModel - SHADOW_CYLINDRICAL or SHADOW_CONICAL
+    // @param tStart, tEnd - time span to find the eclipses for (s)
+    SunModel(const OrbitParameters &orbit, double epochJD, int shadowModel,
+             double tStart, double tEnd);
+
+    // sunVector - unit vector to the sun in the inertial frame at time t
+    Vec3 sunVector(double t) const;
+
+    // isVisible - checks if the sun can be seen at time t using the eclipse
+    // list. Times outside of [tStart, tEnd) are checked directly.
+    // @param t - time (s)
+    // @param hint - index from the last call, or NULL to always binary search.
+    bool isVisible(double t, size_t *hint = NULL) const;
+
+    // isVisibleDirect - checks if the sun can be seen at time t from the
+    // orbit and ephemeris without the eclipse list.
+    bool isVisibleDirect(double t) const;
+
+    const vector<EclipseInterval> &getEclipses() const { return eclipses; }
+
+private:
+    OrbitParameters orbit;
+    double epochJD;
+    int shadowModel;
+    double tStart;
+    double tEnd;
+
+    // sorted, non overlapping eclipses
+    vector<EclipseInterval> eclipses;
+
+    // visibility - illuminated fraction minus SUN_VISIBLE_FRACTION, positive
+    // when the sun is visible.
+    double visibility(double t) const;
+};
+
+#endif /* SunModel_hpp */
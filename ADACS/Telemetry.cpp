@@ -0,0 +1,468 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Telemetry.cpp
+//
+// Packed telemetry frames of the attitude state.
+
+#include "Telemetry.hpp"
+
+#include <cmath>
+#include <cstring>
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+#define TELEMETRY_MAGIC 0x4E49
+#define TELEMETRY_HEADER_SIZE 12
+#define TELEMETRY_CRC_SIZE 2
+
+// bytes of the attitude for each kind of frame
+#define ATTITUDE_FULL_SIZE 28
+#define ATTITUDE_COMPACT_SIZE 14
+#define ATTITUDE_DELTA_SIZE 7
+
+// readTelemetryConfig - fills the config values of a snapshot, the id of
+// each value is its index in keys.
+// @return - 0 on success, -1 if a key is missing or there are too many.
+int readTelemetryConfig(ConfigFile &configFile, const vector<string> &keys,
+                        TelemetrySnapshot *snapshot)
+{
+    if (keys.size() > TELEMETRY_MAX_CONFIG) {
+        ErrorManager::ERROR(ADACS_TELEMETRY_BAD_FRAME);
+        return -1;
+    }
+    for (size_t k = 0; k < keys.size(); k++) {
+        snapshot->configIds[k] = (uint16_t)k;
+        if (configFile.getDouble(keys[k], &snapshot->configValues[k]) != 0) {
+            snapshot->configCount = 0;
+            return -1;
+        }
+    }
+    snapshot->configCount = (int)keys.size();
+    return 0;
+}
+
+// floatToHalf - IEEE half precision, round to nearest even
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    int exponent = (int)((bits >> 23) & 0xff);
+    uint32_t mantissa = bits & 0x7fffff;
+
+    // inf and nan, nan keeps a mantissa bit so it stays a nan
+    if (exponent == 0xff) {
+        return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+    }
+    int e = exponent - 127 + 15;
+    if (e >= 31) {
+        return sign | 0x7c00;
+    }
+    if (e <= 0) {
+        // subnormal, or zero below half of the smallest subnormal
+        if (e < -10) {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        int shift = 14 - e;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) {
+            half++;
+        }
+        return sign | (uint16_t)half;
+    }
+    // a carry out of the mantissa moves to the exponent, up to inf
+    uint32_t half = ((uint32_t)e << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return sign | (uint16_t)half;
+}
+
+// halfToFloat - IEEE half precision to float
+float halfToFloat(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    int exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((uint32_t)(exponent - 15 + 127) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // subnormal, normalize the mantissa
+        exponent = 1;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | ((uint32_t)(exponent - 15 + 127) << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// table of the CRC of each byte, made once
+struct Crc16Table {
+    uint16_t value[256];
+
+    Crc16Table()
+    {
+        for (int b = 0; b < 256; b++) {
+            uint16_t crc = (uint16_t)(b << 8);
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (uint16_t)(crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1);
+            }
+            value[b] = crc;
+        }
+    }
+};
+static const Crc16Table crcTable;
+
+// crc16 - CRC-16/CCITT (polynomial 0x1021, start 0xffff)
+static uint16_t crc16(const uint8_t *data, int length)
+{
+    uint16_t crc = 0xffff;
+    for (int k = 0; k < length; k++) {
+        crc = (uint16_t)((crc << 8) ^ crcTable.value[(crc >> 8) ^ data[k]]);
+    }
+    return crc;
+}
+
+// little endian writes and reads, the length is checked before any of them
+static inline void put16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static inline void putFloat(uint8_t *p, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put32(p, bits);
+}
+
+static inline uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline float getFloat(const uint8_t *p)
+{
+    uint32_t bits = get32(p);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// quantize - value / range as an int16, clamped to +-range
+static inline int16_t quantize(double value, double range)
+{
+    double scaled = value / range * 32767.0;
+    if (!(scaled > -32767.0)) {
+        // also nan
+        return scaled != scaled ? 0 : -32767;
+    }
+    if (scaled > 32767.0) {
+        return 32767;
+    }
+    return (int16_t)lround(scaled);
+}
+
+// frameTime - the time in TELEMETRY_TIME_UNIT steps
+static inline uint32_t frameTime(double t)
+{
+    double steps = floor(t / TELEMETRY_TIME_UNIT + 0.5);
+    if (!(steps > 0.0)) {
+        return 0;
+    }
+    if (steps > 4294967295.0) {
+        return 0xffffffff;
+    }
+    return (uint32_t)steps;
+}
+
+// constructor for the encoder
+// @param encoding - TELEMETRY_ENCODING_FULL or TELEMETRY_ENCODING_COMPACT
+// @param keyframeInterval - frames from one key frame to the next, 1 (or
+//                           less) for no delta frames. Delta frames are
+//                           only made in the compact encoding.
+TelemetryEncoder::TelemetryEncoder(int encoding, int keyframeInterval) :
+    encoding(encoding), keyframeInterval(keyframeInterval)
+{
+    sequence = 0;
+    sinceKeyframe = -1;
+    lastConfigCount = 0;
+}
+
+// encode - writes the next frame into buffer.
+// @return - the length of the frame, -1 if it does not fit in size
+//           bytes or the snapshot has too many errors or values.
+int TelemetryEncoder::encode(const TelemetrySnapshot &snapshot, uint8_t *buffer, int size)
+{
+    if (snapshot.errorCount < 0 || snapshot.errorCount > TELEMETRY_MAX_ERRORS ||
+        snapshot.configCount < 0 || snapshot.configCount > TELEMETRY_MAX_CONFIG) {
+        ErrorManager::ERROR(ADACS_TELEMETRY_BAD_FRAME);
+        return -1;
+    }
+    bool compact = encoding == TELEMETRY_ENCODING_COMPACT;
+    int count = snapshot.configCount;
+
+    int16_t attitude[7];
+    uint16_t config[TELEMETRY_MAX_CONFIG];
+    bool delta = false;
+    int changed = count;
+    if (compact) {
+        for (int i = 0; i < 4; i++) {
+            attitude[i] = quantize(snapshot.q[i], 1.0);
+        }
+        for (int i = 0; i < 3; i++) {
+            attitude[i + 4] = quantize(snapshot.omega[i], TELEMETRY_OMEGA_RANGE);
+        }
+        for (int k = 0; k < count; k++) {
+            config[k] = floatToHalf((float)snapshot.configValues[k]);
+        }
+
+        // a delta frame needs the same config values as the last frame and
+        // every change of the attitude in an int8
+        delta = sinceKeyframe >= 0 && sinceKeyframe + 1 < keyframeInterval &&
+                count == lastConfigCount;
+        for (int i = 0; delta && i < 7; i++) {
+            int d = attitude[i] - lastAttitude[i];
+            delta = d >= -128 && d <= 127;
+        }
+        if (delta) {
+            changed = 0;
+            for (int k = 0; k < count; k++) {
+                if (snapshot.configIds[k] != lastConfigIds[k]) {
+                    delta = false;
+                    break;
+                }
+                changed += config[k] != lastConfig[k];
+            }
+        }
+        if (!delta) {
+            changed = count;
+        }
+    }
+
+    int attitudeSize = delta ? ATTITUDE_DELTA_SIZE : (compact ? ATTITUDE_COMPACT_SIZE : ATTITUDE_FULL_SIZE);
+    int length = TELEMETRY_HEADER_SIZE + attitudeSize + 2 * snapshot.errorCount +
+                 changed * (compact ? 4 : 6) + TELEMETRY_CRC_SIZE;
+    if (length > size) {
+        ErrorManager::ERROR(ADACS_TELEMETRY_BUFFER_TOO_SMALL);
+        return -1;
+    }
+
+    uint8_t *p = buffer;
+    put16(p, TELEMETRY_MAGIC);
+    p[2] = TELEMETRY_VERSION;
+    p[3] = (uint8_t)((compact ? TELEMETRY_FLAG_COMPACT : 0) | (delta ? TELEMETRY_FLAG_DELTA : 0));
+    put16(p + 4, sequence);
+    put32(p + 6, frameTime(snapshot.t));
+    p[10] = (uint8_t)snapshot.errorCount;
+    p[11] = (uint8_t)changed;
+    p += TELEMETRY_HEADER_SIZE;
+
+    if (delta) {
+        for (int i = 0; i < 7; i++) {
+            *p++ = (uint8_t)(int8_t)(attitude[i] - lastAttitude[i]);
+        }
+    } else if (compact) {
+        for (int i = 0; i < 7; i++, p += 2) {
+            put16(p, (uint16_t)attitude[i]);
+        }
+    } else {
+        for (int i = 0; i < 4; i++, p += 4) {
+            putFloat(p, (float)snapshot.q[i]);
+        }
+        for (int i = 0; i < 3; i++, p += 4) {
+            putFloat(p, (float)snapshot.omega[i]);
+        }
+    }
+
+    for (int k = 0; k < snapshot.errorCount; k++, p += 2) {
+        put16(p, snapshot.errors[k]);
+    }
+
+    for (int k = 0; k < count; k++) {
+        if (delta && config[k] == lastConfig[k]) {
+            continue;
+        }
+        put16(p, snapshot.configIds[k]);
+        if (compact) {
+            put16(p + 2, config[k]);
+            p += 4;
+        } else {
+            putFloat(p + 2, (float)snapshot.configValues[k]);
+            p += 6;
+        }
+    }
+
+    put16(p, crc16(buffer, length - TELEMETRY_CRC_SIZE));
+
+    // the frame is written, keep what the next delta frame is made from
+    sequence++;
+    if (compact) {
+        sinceKeyframe = delta ? sinceKeyframe + 1 : 0;
+        memcpy(lastAttitude, attitude, sizeof(lastAttitude));
+        memcpy(lastConfig, config, count * sizeof(config[0]));
+        memcpy(lastConfigIds, snapshot.configIds, count * sizeof(snapshot.configIds[0]));
+        lastConfigCount = count;
+    }
+    return length;
+}
+
+// constructor for the decoder
+TelemetryDecoder::TelemetryDecoder()
+{
+    haveLast = false;
+    lastSequence = 0;
+}
+
+// decode - reads one frame. Config values missing from a delta frame
+// keep the value they had in the last frame.
+// @return - the length of the frame, -1 for a bad frame or a delta frame
+//           that does not follow the last frame.
+int TelemetryDecoder::decode(const uint8_t *buffer, int size, TelemetrySnapshot *snapshot)
+{
+    if (size < TELEMETRY_HEADER_SIZE + TELEMETRY_CRC_SIZE || get16(buffer) != TELEMETRY_MAGIC ||
+        buffer[2] != TELEMETRY_VERSION || (buffer[3] & ~(TELEMETRY_FLAG_COMPACT | TELEMETRY_FLAG_DELTA))) {
+        ErrorManager::ERROR(ADACS_TELEMETRY_BAD_FRAME);
+        return -1;
+    }
+    bool compact = (buffer[3] & TELEMETRY_FLAG_COMPACT) != 0;
+    bool delta = (buffer[3] & TELEMETRY_FLAG_DELTA) != 0;
+    uint16_t sequence = get16(buffer + 4);
+    int errorCount = buffer[10];
+    int count = buffer[11];
+
+    int attitudeSize = delta ? ATTITUDE_DELTA_SIZE : (compact ? ATTITUDE_COMPACT_SIZE : ATTITUDE_FULL_SIZE);
+    int length = TELEMETRY_HEADER_SIZE + attitudeSize + 2 * errorCount +
+                 count * (compact ? 4 : 6) + TELEMETRY_CRC_SIZE;
+    if (errorCount > TELEMETRY_MAX_ERRORS || count > TELEMETRY_MAX_CONFIG || length > size ||
+        get16(buffer + length - TELEMETRY_CRC_SIZE) != crc16(buffer, length - TELEMETRY_CRC_SIZE)) {
+        ErrorManager::ERROR(ADACS_TELEMETRY_BAD_FRAME);
+        return -1;
+    }
+    // a delta frame only means something after the frame before it
+    if (delta && (!compact || !haveLast || sequence != (uint16_t)(lastSequence + 1))) {
+        ErrorManager::ERROR(ADACS_TELEMETRY_BAD_FRAME);
+        return -1;
+    }
+
+    const uint8_t *p = buffer + TELEMETRY_HEADER_SIZE;
+    TelemetrySnapshot frame;
+    int16_t attitude[7];
+    frame.t = get32(buffer + 6) * TELEMETRY_TIME_UNIT;
+
+    if (delta) {
+        for (int i = 0; i < 7; i++) {
+            attitude[i] = (int16_t)(lastAttitude[i] + (int8_t)*p++);
+        }
+    } else if (compact) {
+        for (int i = 0; i < 7; i++, p += 2) {
+            attitude[i] = (int16_t)get16(p);
+        }
+    } else {
+        for (int i = 0; i < 4; i++, p += 4) {
+            frame.q[i] = getFloat(p);
+        }
+        for (int i = 0; i < 3; i++, p += 4) {
+            frame.omega[i] = getFloat(p);
+        }
+    }
+    if (compact) {
+        for (int i = 0; i < 4; i++) {
+            frame.q[i] = attitude[i] / 32767.0;
+        }
+        for (int i = 0; i < 3; i++) {
+            frame.omega[i] = attitude[i + 4] * (TELEMETRY_OMEGA_RANGE / 32767.0);
+        }
+    }
+
+    frame.errorCount = errorCount;
+    for (int k = 0; k < errorCount; k++, p += 2) {
+        frame.errors[k] = get16(p);
+    }
+
+    if (delta) {
+        // start from the last values and apply the ones that changed
+        frame.configCount = last.configCount;
+        memcpy(frame.configIds, last.configIds, sizeof(frame.configIds));
+        memcpy(frame.configValues, last.configValues, sizeof(frame.configValues));
+        for (int k = 0; k < count; k++, p += 4) {
+            uint16_t id = get16(p);
+            int index = 0;
+            while (index < frame.configCount && frame.configIds[index] != id) {
+                index++;
+            }
+            if (index == frame.configCount) {
+                ErrorManager::ERROR(ADACS_TELEMETRY_BAD_FRAME);
+                return -1;
+            }
+            frame.configValues[index] = halfToFloat(get16(p + 2));
+        }
+    } else {
+        frame.configCount = count;
+        for (int k = 0; k < count; k++) {
+            frame.configIds[k] = get16(p);
+            if (compact) {
+                frame.configValues[k] = halfToFloat(get16(p + 2));
+                p += 4;
+            } else {
+                frame.configValues[k] = getFloat(p + 2);
+                p += 6;
+            }
+        }
+    }
+
+    haveLast = compact;
+    lastSequence = sequence;
+    if (compact) {
+        memcpy(lastAttitude, attitude, sizeof(lastAttitude));
+        last = frame;
+    }
+    *snapshot = frame;
+    return length;
+}
@@ -0,0 +1,169 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Telemetry.hpp
+//
+// Packed telemetry frames of the attitude state for the UHF and UART
+// downlinks. A frame is written byte by byte (little endian) straight into
+// the buffer given to encode(), so the layout does not depend on the
+// compiler and nothing is allocated.
+//
+// Frame layout (bytes):
+//  0  magic 0x49 0x4E ("IN")
+//  2  version
+//  3  flags - TELEMETRY_FLAG_COMPACT, TELEMETRY_FLAG_DELTA
+//  4  sequence (uint16)
+//  6  time (uint32, TELEMETRY_TIME_UNIT s)
+//  10 number of errors, 11 number of config values
+//  12 attitude
+//       full:    q (4 float32), omega (3 float32, rad/s)
+//       compact: q (4 int16, q * 32767), omega (3 int16 over
+//                +-TELEMETRY_OMEGA_RANGE)
+//       delta:   change of each compact int16 from the last frame (7 int8)
+//  .. errors - error codes (uint16 each)
+//  .. config values - id (uint16) and value, float32 in full frames and
+//     float16 in compact frames. A delta frame only has the values that
+//     changed.
+//  .. CRC-16/CCITT of everything before it
+//
+// A delta frame can only be read after the frame before it, the encoder
+// sends a key frame every keyframeInterval frames, or sooner when a change
+// is too large for a delta, so a lost frame costs at most that many frames.
+//
+// Example code for use is shown below:
+//
+// TelemetryEncoder encoder(TELEMETRY_ENCODING_COMPACT, 10);
+// TelemetrySnapshot snapshot;
+// snapshot.t = t;
+// snapshot.q = q;
+// snapshot.omega = omega;
+// readTelemetryConfig(configFile, keys, &snapshot);
+// uint8_t frame[TELEMETRY_MAX_FRAME];
+// int length = encoder.encode(snapshot, frame, sizeof(frame));
+// // send length bytes of frame
+// ...
+// TelemetryDecoder decoder;
+// decoder.decode(frame, length, &snapshot);
+
+#ifndef Telemetry_hpp
+#define Telemetry_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Matrix.hpp"
+#include "ConfigFile.hpp"
+
+using namespace std;
+
+#define TELEMETRY_VERSION 1
+
+#define TELEMETRY_ENCODING_FULL 0
+#define TELEMETRY_ENCODING_COMPACT 1
+
+#define TELEMETRY_FLAG_COMPACT 0x01
+#define TELEMETRY_FLAG_DELTA 0x02
+
+#define TELEMETRY_MAX_ERRORS 16
+#define TELEMETRY_MAX_CONFIG 16
+// header, full attitude, every error and config value and the CRC
+#define TELEMETRY_MAX_FRAME (12 + 28 + 2 * TELEMETRY_MAX_ERRORS + 6 * TELEMETRY_MAX_CONFIG + 2)
+
+// time step of the frame time (s)
+#define TELEMETRY_TIME_UNIT 0.01
+// largest rotation rate in compact frames (rad/s)
+#define TELEMETRY_OMEGA_RANGE 4.0
+
+// what goes in one frame
+struct TelemetrySnapshot {
+    // time (s)
+    double t;
+    // attitude quaternion (scalar last) and rotation rate (rad/s)
+    Vec4 q;
+    Vec3 omega;
+    // active error codes
+    uint16_t errors[TELEMETRY_MAX_ERRORS];
+    int errorCount;
+    // config values, the id is the index in the list of keys both ends use
+    uint16_t configIds[TELEMETRY_MAX_CONFIG];
+    double configValues[TELEMETRY_MAX_CONFIG];
+    int configCount;
+
+    TelemetrySnapshot() : t(0.0), errorCount(0), configCount(0) {}
+};
+
+// readTelemetryConfig - fills the config values of a snapshot, the id of
+// each value is its index in keys.
+// @return - 0 on success, -1 if a key is missing or there are too many.
+int readTelemetryConfig(ConfigFile &configFile, const vector<string> &keys,
+                        TelemetrySnapshot *snapshot);
+
+// float16 conversions (IEEE half precision, round to nearest even)
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t half);
+
+class TelemetryEncoder {
+public:
+    // @param encoding - TELEMETRY_ENCODING_FULL or TELEMETRY_ENCODING_COMPACT
+    // @param keyframeInterval - frames from one key frame to the next, 1 (or
+    //                           less) for no delta frames. Delta frames are
+    //                           only made in the compact encoding.
+    TelemetryEncoder(int encoding, int keyframeInterval);
+
+    // encode - writes the next frame into buffer.
+    // @return - the length of the frame, -1 if it does not fit in size
+    //           bytes or the snapshot has too many errors or values.
+    int encode(const TelemetrySnapshot &snapshot, uint8_t *buffer, int size);
+
+    // reset - the next frame is a key frame.
+    void reset() { sinceKeyframe = -1; }
+
+private:
+    int encoding;
+    int keyframeInterval;
+    uint16_t sequence;
+    // frames since the last key frame, -1 before the first one
+    int sinceKeyframe;
+    // the compact attitude and config values of the last frame
+    int16_t lastAttitude[7];
+    uint16_t lastConfigIds[TELEMETRY_MAX_CONFIG];
+    uint16_t lastConfig[TELEMETRY_MAX_CONFIG];
+    int lastConfigCount;
+};
+
+class TelemetryDecoder {
+public:
+    TelemetryDecoder();
+
+    // decode - reads one frame. Config values missing from a delta frame
+    // keep the value they had in the last frame.
+    // @return - the length of the frame, -1 for a bad frame or a delta frame
+    //           that does not follow the last frame.
+    int decode(const uint8_t *buffer, int size, TelemetrySnapshot *snapshot);
+
+private:
+    // the last frame was read, so a delta frame can follow it
+    bool haveLast;
+    uint16_t lastSequence;
+    int16_t lastAttitude[7];
+    TelemetrySnapshot last;
+};
+
+#endif /* Telemetry_hpp */
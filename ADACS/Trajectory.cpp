@@ -0,0 +1,276 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Trajectory.cpp
+//
+// Chunked trajectory files.
+
+#include "Trajectory.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+#define TRAJECTORY_MAGIC "INCATRJ1"
+#define TRAJECTORY_HEADER_SIZE 72
+#define TRAJECTORY_CHUNK_HEADER_SIZE 16
+
+// trajectoryHeader - the header for a run of config with gains.
+TrajectoryHeader trajectoryHeader(const SimulatorConfig &config, const ControllerGains &gains)
+{
+    TrajectoryHeader header;
+    header.sunModel = config.sunModel;
+    header.rSun = config.rSun;
+    header.epochJD = config.epochJD;
+    header.rTarget = gains.rTarget;
+    return header;
+}
+
+TrajectoryWriter::TrajectoryWriter()
+{
+    file = NULL;
+    chunk = new TrajectoryChunk;
+    chunk->count = 0;
+    tLast = 0.0;
+    started = false;
+    failed = false;
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    close();
+    delete chunk;
+}
+
+// open - starts a new trajectory file.
+// @return - 0 on success, -1 on failure.
+int TrajectoryWriter::open(const string &path, const TrajectoryHeader &header)
+{
+    close();
+    chunk->count = 0;
+    started = false;
+    failed = false;
+
+    file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        ErrorManager::ERROR(ADACS_TRAJECTORY_WRITE_FAILED);
+        return -1;
+    }
+
+    char buffer[TRAJECTORY_HEADER_SIZE];
+    uint32_t version = TRAJECTORY_VERSION;
+    uint32_t sunModel = header.sunModel;
+    memcpy(buffer, TRAJECTORY_MAGIC, 8);
+    memcpy(buffer + 8, &version, 4);
+    memcpy(buffer + 12, &sunModel, 4);
+    memcpy(buffer + 16, &header.rSun[0], 24);
+    memcpy(buffer + 40, &header.epochJD, 8);
+    memcpy(buffer + 48, &header.rTarget[0], 24);
+    if (fwrite(buffer, 1, sizeof(buffer), file) != sizeof(buffer)) {
+        failed = true;
+        ErrorManager::ERROR(ADACS_TRAJECTORY_WRITE_FAILED);
+        return -1;
+    }
+    return 0;
+}
+
+// write - adds one sample, a full chunk is written to the file.
+// @return - 0 on success, -1 if the file could not be written.
+int TrajectoryWriter::write(const SimulatorState &state)
+{
+    if (file == NULL || failed) {
+        return -1;
+    }
+    if (chunk->count == 0) {
+        // the first sample of the file is its own previous sample
+        chunk->tPrev = started ? tLast : state.t;
+    }
+    started = true;
+    int k = chunk->count++;
+    chunk->t[k] = state.t;
+    for (int c = 0; c < STATE_SIZE; c++) {
+        chunk->x[c][k] = state.w[c];
+    }
+    tLast = state.t;
+
+    if (chunk->count == TRAJECTORY_CHUNK_SAMPLES) {
+        flush();
+    }
+    return failed ? -1 : 0;
+}
+
+// flush - writes the samples in chunk.
+void TrajectoryWriter::flush()
+{
+    if (chunk->count == 0 || failed) {
+        return;
+    }
+    size_t n = chunk->count;
+    uint32_t head[2] = { (uint32_t)chunk->count, 0 };
+    bool ok = fwrite(head, sizeof(head), 1, file) == 1 &&
+              fwrite(&chunk->tPrev, sizeof(double), 1, file) == 1 &&
+              fwrite(chunk->t, sizeof(double), n, file) == n;
+    for (int c = 0; ok && c < STATE_SIZE; c++) {
+        ok = fwrite(chunk->x[c], sizeof(double), n, file) == n;
+    }
+    chunk->count = 0;
+    if (!ok) {
+        failed = true;
+        ErrorManager::ERROR(ADACS_TRAJECTORY_WRITE_FAILED);
+    }
+}
+
+// close - writes the last chunk and closes the file.
+// @return - 0 if every sample was written, -1 on failure.
+int TrajectoryWriter::close()
+{
+    if (file == NULL) {
+        return failed ? -1 : 0;
+    }
+    flush();
+    if (fclose(file) != 0 && !failed) {
+        failed = true;
+        ErrorManager::ERROR(ADACS_TRAJECTORY_WRITE_FAILED);
+    }
+    file = NULL;
+    return failed ? -1 : 0;
+}
+
+TrajectoryReader::TrajectoryReader()
+{
+    fd = -1;
+    sampleCount = 0;
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    close();
+}
+
+void TrajectoryReader::close()
+{
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    offsets.clear();
+    counts.clear();
+    sampleCount = 0;
+}
+
+// readAll - pread of exactly size bytes.
+static bool readAll(int fd, void *buffer, size_t size, uint64_t offset)
+{
+    char *p = (char *)buffer;
+    while (size > 0) {
+        ssize_t n = pread(fd, p, size, (off_t)offset);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
+// open - reads the header and finds every chunk of a trajectory file.
+// @return - 0 on success, -1 if it can't be read or is truncated.
+int TrajectoryReader::open(const string &path)
+{
+    close();
+    fd = ::open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        close();
+        ErrorManager::ERROR(ADACS_TRAJECTORY_READ_FAILED);
+        return -1;
+    }
+    uint64_t size = info.st_size;
+
+    char buffer[TRAJECTORY_HEADER_SIZE];
+    uint32_t version, sunModel;
+    if (!readAll(fd, buffer, sizeof(buffer), 0) || memcmp(buffer, TRAJECTORY_MAGIC, 8) != 0) {
+        close();
+        ErrorManager::ERROR(ADACS_TRAJECTORY_INVALID);
+        return -1;
+    }
+    memcpy(&version, buffer + 8, 4);
+    memcpy(&sunModel, buffer + 12, 4);
+    memcpy(&header.rSun[0], buffer + 16, 24);
+    memcpy(&header.epochJD, buffer + 40, 8);
+    memcpy(&header.rTarget[0], buffer + 48, 24);
+    header.sunModel = sunModel;
+    if (version != TRAJECTORY_VERSION) {
+        close();
+        ErrorManager::ERROR(ADACS_TRAJECTORY_INVALID);
+        return -1;
+    }
+
+    // only the chunk headers are read, the chunks are skipped over
+    uint64_t offset = TRAJECTORY_HEADER_SIZE;
+    while (offset < size) {
+        uint32_t head[2];
+        if (!readAll(fd, head, sizeof(head), offset) || head[0] < 1 ||
+            head[0] > TRAJECTORY_CHUNK_SAMPLES) {
+            close();
+            ErrorManager::ERROR(ADACS_TRAJECTORY_INVALID);
+            return -1;
+        }
+        uint64_t length = TRAJECTORY_CHUNK_HEADER_SIZE + (uint64_t)head[0] * (STATE_SIZE + 1) * sizeof(double);
+        if (offset + length > size) {
+            close();
+            ErrorManager::ERROR(ADACS_TRAJECTORY_INVALID);
+            return -1;
+        }
+        offsets.push_back(offset);
+        counts.push_back(head[0]);
+        sampleCount += head[0];
+        offset += length;
+    }
+    return 0;
+}
+
+// readChunk - reads one chunk, safe to call from many threads at once.
+// @return - 0 on success, -1 on failure.
+int TrajectoryReader::readChunk(size_t index, TrajectoryChunk *chunk) const
+{
+    if (index >= offsets.size()) {
+        return -1;
+    }
+    size_t n = counts[index];
+    uint64_t offset = offsets[index] + 8;
+    bool ok = readAll(fd, &chunk->tPrev, sizeof(double), offset);
+    offset += sizeof(double);
+    ok = ok && readAll(fd, chunk->t, n * sizeof(double), offset);
+    for (int c = 0; ok && c < STATE_SIZE; c++) {
+        offset += n * sizeof(double);
+        ok = readAll(fd, chunk->x[c], n * sizeof(double), offset);
+    }
+    if (!ok) {
+        ErrorManager::ERROR(ADACS_TRAJECTORY_READ_FAILED);
+        return -1;
+    }
+    chunk->count = (int)n;
+    return 0;
+}
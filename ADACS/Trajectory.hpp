@@ -0,0 +1,158 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Trajectory.hpp
+//
+// Trajectory files, the [t, q, q_dot] of every accepted simulator step
+// written as the run goes, so a run of days never has to be held in memory.
+//
+// The samples are written in chunks of up to TRAJECTORY_CHUNK_SAMPLES. Each
+// chunk is stored channel by channel (all of t, then all of q1, ...) so it
+// can be read straight into the structure of arrays a vectorized kernel
+// wants, and each chunk can be read on its own, in any order and from any
+// number of threads.
+//
+// File layout, in the byte order of the machine that wrote it:
+//  0  magic "INCATRJ1"
+//  8  version (uint32), sun model (uint32)
+//  16 rSun (3 float64), epochJD (float64), rTarget (3 float64)
+//  then each chunk:
+//  0  number of samples (uint32), 0 (uint32)
+//  8  time of the sample before the first one (float64)
+//  16 t, then each of the 8 state channels (count float64 each)
+//
+// Example code for use is shown below:
+//
+// TrajectoryWriter writer;
+// writer.open("run.traj", trajectoryHeader(config, gains));
+// sim.setOutputHandler([&](const SimulatorState &s) { writer.write(s); });
+// sim.run(config.runTime);
+// if (writer.close() != 0) {
+// // handle error, the file is incomplete
+// }
+//
+// TrajectoryReader reader;
+// reader.open("run.traj");
+// TrajectoryChunk *chunk = new TrajectoryChunk;
+// for (size_t k = 0; k < reader.chunks(); k++) {
+//     reader.readChunk(k, chunk);
+// }
+
+#ifndef Trajectory_hpp
+#define Trajectory_hpp
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+
+#include "Simulator.hpp"
+
+using namespace std;
+
+#define TRAJECTORY_VERSION 1
+// samples per chunk, a multiple of the widest kernel
+#define TRAJECTORY_CHUNK_SAMPLES 4096
+
+// what the post processing needs besides the samples
+struct TrajectoryHeader {
+    // SIM_SUN_FIXED or SIM_SUN_EPHEMERIS, with rSun or epochJD
+    int sunModel;
+    Vec3 rSun;
+    double epochJD;
+    // body axis to point at the sun
+    Vec3 rTarget;
+};
+
+// trajectoryHeader - the header for a run of config with gains.
+TrajectoryHeader trajectoryHeader(const SimulatorConfig &config, const ControllerGains &gains);
+
+// one chunk of samples, sample k of state channel c is x[c][k].
+struct TrajectoryChunk {
+    int count;
+    // time of the sample before x[.][0], or t[0] for the first sample
+    double tPrev;
+    double t[TRAJECTORY_CHUNK_SAMPLES];
+    double x[STATE_SIZE][TRAJECTORY_CHUNK_SAMPLES];
+};
+
+class TrajectoryWriter {
+public:
+    TrajectoryWriter();
+    ~TrajectoryWriter();
+
+    // open - starts a new trajectory file.
+    // @return - 0 on success, -1 on failure.
+    int open(const string &path, const TrajectoryHeader &header);
+
+    // write - adds one sample, a full chunk is written to the file.
+    // @return - 0 on success, -1 if the file could not be written.
+    int write(const SimulatorState &state);
+
+    // close - writes the last chunk and closes the file.
+    // @return - 0 if every sample was written, -1 on failure.
+    int close();
+
+private:
+    FILE *file;
+    TrajectoryChunk *chunk;
+    // time of the last sample written, if one was
+    double tLast;
+    bool started;
+    bool failed;
+
+    // flush - writes the samples in chunk.
+    void flush();
+
+    TrajectoryWriter(const TrajectoryWriter &);
+    TrajectoryWriter &operator=(const TrajectoryWriter &);
+};
+
+class TrajectoryReader {
+public:
+    TrajectoryReader();
+    ~TrajectoryReader();
+
+    // open - reads the header and finds every chunk of a trajectory file.
+    // @return - 0 on success, -1 if it can't be read or is truncated.
+    int open(const string &path);
+    void close();
+
+    const TrajectoryHeader &getHeader() const { return header; }
+    size_t chunks() const { return offsets.size(); }
+    uint64_t samples() const { return sampleCount; }
+
+    // readChunk - reads one chunk, safe to call from many threads at once.
+    // @param index - chunk number, 0 to chunks() - 1
+    // @return - 0 on success, -1 on failure.
+    int readChunk(size_t index, TrajectoryChunk *chunk) const;
+
+private:
+    int fd;
+    TrajectoryHeader header;
+    // file offset and number of samples of each chunk
+    vector<uint64_t> offsets;
+    vector<int> counts;
+    uint64_t sampleCount;
+
+    TrajectoryReader(const TrajectoryReader &);
+    TrajectoryReader &operator=(const TrajectoryReader &);
+};
+
+#endif /* Trajectory_hpp */
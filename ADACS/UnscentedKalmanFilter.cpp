@@ -0,0 +1,317 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  UnscentedKalmanFilter.cpp
+//
+// Square root unscented kalman filter for the INCA attitude state x = [q; q_dot].
+
+#include "UnscentedKalmanFilter.hpp"
+
+// for ERROR
+#include <ErrorManager.hpp>
+// for INSTRUMENT_TIMER
+#include <Instrumentation.hpp>
+
+// scaled unscented transform, a small alpha keeps the sigma points close to
+// the estimate where the additive quaternion is still a good attitude.
+#define UKF_ALPHA 0.5
+#define UKF_BETA 2.0
+#define UKF_KAPPA 0.0
+
+static const double UKF_LAMBDA = UKF_ALPHA * UKF_ALPHA * (STATE_SIZE + UKF_KAPPA) - STATE_SIZE;
+// spread of the sigma points
+static const double UKF_GAMMA = sqrt(STATE_SIZE + UKF_LAMBDA);
+// weight of the outer points, mean and covariance
+static const double UKF_WEIGHT = 0.5 / (STATE_SIZE + UKF_LAMBDA);
+static const double UKF_SQRT_WEIGHT = sqrt(UKF_WEIGHT);
+// weights of the center point, the covariance weight is negative so it is
+// taken out of the factor with a cholesky downdate
+static const double UKF_CENTER_MEAN_WEIGHT = UKF_LAMBDA / (STATE_SIZE + UKF_LAMBDA);
+static const double UKF_CENTER_WEIGHT = UKF_CENTER_MEAN_WEIGHT + 1.0 - UKF_ALPHA * UKF_ALPHA + UKF_BETA;
+static const double UKF_CENTER_SIGN = UKF_CENTER_WEIGHT < 0.0 ? -1.0 : 1.0;
+static const double UKF_SQRT_CENTER_WEIGHT = sqrt(fabs(UKF_CENTER_WEIGHT));
+
+// mean - the weighted mean of the sigma points in one set of lanes
+static inline double mean(const SigmaLanes &lanes)
+{
+    double sum = 0.0;
+    for (int k = 1; k < UKF_SIGMA_POINTS; k++) {
+        sum += lanes.v[k];
+    }
+    return sum * UKF_WEIGHT + lanes.v[0] * UKF_CENTER_MEAN_WEIGHT;
+}
+
+// addScaled - out = a + b * s
+static void addScaled(const SigmaStates &a, const SigmaStates &b, double s, SigmaStates *out)
+{
+    for (int r = 0; r < STATE_SIZE; r++) {
+        for (int k = 0; k < UKF_SIGMA_POINTS; k++) {
+            (*out)[r].v[k] = a[r].v[k] + b[r].v[k] * s;
+        }
+    }
+}
+
+// lowerFactor - the n x n lower triangle of an lqFactor() result, with the
+// center point column added or removed.
+// @return - 0 on success, -1 if the center point downdate failed.
+template <int N, int K>
+static int lowerFactor(Matrix<double, N, K> &A, int n, double *center, Matrix<double, N, N> *L)
+{
+    for (int r = 0; r < n; r++) {
+        for (int c = 0; c < n; c++) {
+            (*L)(r, c) = c <= r ? A(r, c) : 0.0;
+        }
+    }
+    if (center == NULL) {
+        return 0;
+    }
+    return choleskyUpdate(*L, center, UKF_CENTER_SIGN, n);
+}
+
+// constructor for the unscented kalman filter
+// @param model - the state model used for prediction
+// @param x0 - the initial state estimate
+// @param P0 - the initial state covariance
+// @param Q - the process noise added on each predict step
+UnscentedKalmanFilter::UnscentedKalmanFilter(const StateModel &model, const StateVector &x0,
+                                             const StateMatrix &P0, const StateMatrix &Q) :
+    model(model), x(x0)
+{
+    if (choleskyFactor(P0, &S) != 0 || choleskyFactor(Q, &sqrtQ) != 0) {
+        ErrorManager::ERROR(KALMAN_FILTER_BAD_COVARIANCE);
+    }
+    lastNIS = 0.0;
+}
+
+// getCovariance - P = S * S'
+StateMatrix UnscentedKalmanFilter::getCovariance() const
+{
+    return S * S.transpose();
+}
+
+// drawSigmaPoints - x and x +- gamma * the columns of S.
+void UnscentedKalmanFilter::drawSigmaPoints()
+{
+    for (int r = 0; r < STATE_SIZE; r++) {
+        SigmaLanes &lanes = sigma[r];
+        lanes.v[0] = x[r];
+        for (int c = 0; c < STATE_SIZE; c++) {
+            double offset = UKF_GAMMA * S(r, c);
+            lanes.v[1 + c] = x[r] + offset;
+            lanes.v[1 + STATE_SIZE + c] = x[r] - offset;
+        }
+    }
+}
+
+// predict - propagates the sigma points forward in time with RK4, then
+// finds the new factor from [sqrt(W) * (sigma - x), sqrt(Q)] and the center
+// point.
+// @param dt - time step (s)
+// @param Binr - magnetic field in the inertial frame (T)
+// @param D - the commanded magnetic dipole (A*m^2)
+void UnscentedKalmanFilter::predict(double dt, const Vec3 &Binr, const Vec3 &D)
+{
+    INSTRUMENT_TIMER("UnscentedKalmanFilter::predict");
+    drawSigmaPoints();
+
+    model.derivative(sigma, Binr, D, &k1);
+    addScaled(sigma, k1, 0.5 * dt, &stage);
+    model.derivative(stage, Binr, D, &k2);
+    addScaled(sigma, k2, 0.5 * dt, &stage);
+    model.derivative(stage, Binr, D, &k3);
+    addScaled(sigma, k3, dt, &stage);
+    model.derivative(stage, Binr, D, &k4);
+    for (int r = 0; r < STATE_SIZE; r++) {
+        for (int k = 0; k < UKF_SIGMA_POINTS; k++) {
+            sigma[r].v[k] += (k1[r].v[k] + 2.0 * (k2[r].v[k] + k3[r].v[k]) + k4[r].v[k]) * (dt / 6.0);
+        }
+    }
+
+    // NOTE: like KalmanFilter, q is not normalized.
+    double center[STATE_SIZE];
+    for (int r = 0; r < STATE_SIZE; r++) {
+        x[r] = mean(sigma[r]);
+        center[r] = UKF_SQRT_CENTER_WEIGHT * (sigma[r].v[0] - x[r]);
+        for (int k = 1; k < UKF_SIGMA_POINTS; k++) {
+            stateSqrt(r, k - 1) = UKF_SQRT_WEIGHT * (sigma[r].v[k] - x[r]);
+        }
+        for (int c = 0; c < STATE_SIZE; c++) {
+            stateSqrt(r, UKF_SIGMA_POINTS - 1 + c) = sqrtQ(r, c);
+        }
+    }
+
+    lqFactor(stateSqrt, STATE_SIZE, UKF_SIGMA_POINTS - 1 + STATE_SIZE);
+    if (lowerFactor(stateSqrt, STATE_SIZE, center, &S) != 0) {
+        // keep the factor without the downdate, it only over states P
+        ErrorManager::ERROR(KALMAN_FILTER_UPDATE_FAILED);
+        lowerFactor(stateSqrt, STATE_SIZE, NULL, &S);
+    }
+}
+
+// update - applies a batch of measurements jointly.
+// The measurement factor Sz comes from [sqrt(W) * (Z - z), sqrt(R)], the gain
+// from K * Sz * Sz' = Pxz and the new state factor from the Joseph form
+// [sqrt(W) * ((X - x) - K * (Z - z)), K * sqrt(R)].
+// @param measurements - array of measurements taken at the same time.
+// @param count - number of measurements in the array (1 to KALMAN_MAX_BATCH)
+// @return - 0 on success, -1 on failure (the state is left unchanged).
+int UnscentedKalmanFilter::update(const Measurement *measurements, int count)
+{
+    INSTRUMENT_TIMER("UnscentedKalmanFilter::update");
+    if (count < 1 || count > KALMAN_MAX_BATCH) {
+        ErrorManager::ERROR(KALMAN_FILTER_BAD_MEASUREMENT);
+        return -1;
+    }
+
+    drawSigmaPoints();
+
+    double sqrtR[KALMAN_MAX_MEASUREMENT_SIZE];
+    Matrix<double, KALMAN_MAX_MEASUREMENT_SIZE, 1> y;
+    int m = 3 * count;
+    for (int k = 0; k < count; k++) {
+        const Measurement &meas = measurements[k];
+        Matrix<SigmaLanes, 3, 1> z;
+        switch (meas.type) {
+            case SENSOR_GYRO :
+                gyroMeasurement(sigma, &z);
+                break;
+            case SENSOR_MAGNETOMETER :
+            case SENSOR_SUN :
+                vectorMeasurement(sigma, meas.reference, &z);
+                break;
+            default:
+                ErrorManager::ERROR(KALMAN_FILTER_BAD_MEASUREMENT);
+                return -1;
+        }
+        for (int i = 0; i < 3; i++) {
+            if (!(meas.variance[i] > 0.0)) {
+                ErrorManager::ERROR(KALMAN_FILTER_BAD_MEASUREMENT);
+                return -1;
+            }
+            zSigma[3 * k + i] = z[i];
+            sqrtR[3 * k + i] = sqrt(meas.variance[i]);
+            y[3 * k + i] = meas.z[i];
+        }
+    }
+
+    // deviations from the means, in place
+    for (int r = 0; r < m; r++) {
+        double zMean = mean(zSigma[r]);
+        y[r] -= zMean;
+        for (int k = 0; k < UKF_SIGMA_POINTS; k++) {
+            zSigma[r].v[k] -= zMean;
+        }
+    }
+    for (int r = 0; r < STATE_SIZE; r++) {
+        for (int k = 0; k < UKF_SIGMA_POINTS; k++) {
+            sigma[r].v[k] -= x[r];
+        }
+    }
+
+    // Sz = lq([sqrt(W) * dZ, sqrt(R)]) and the center point
+    double center[KALMAN_MAX_MEASUREMENT_SIZE];
+    for (int r = 0; r < m; r++) {
+        center[r] = UKF_SQRT_CENTER_WEIGHT * zSigma[r].v[0];
+        for (int k = 1; k < UKF_SIGMA_POINTS; k++) {
+            measurementSqrt(r, k - 1) = UKF_SQRT_WEIGHT * zSigma[r].v[k];
+        }
+        for (int c = 0; c < m; c++) {
+            measurementSqrt(r, UKF_SIGMA_POINTS - 1 + c) = r == c ? sqrtR[r] : 0.0;
+        }
+    }
+    lqFactor(measurementSqrt, m, UKF_SIGMA_POINTS - 1 + m);
+    if (choleskyUpdate(measurementSqrt, center, UKF_CENTER_SIGN, m) != 0) {
+        ErrorManager::ERROR(KALMAN_FILTER_UPDATE_FAILED);
+        return -1;
+    }
+
+    // K' = Sz'^-1 * Sz^-1 * Pxz' with Pxz = dX * W * dZ', and Sz^-1 * y for
+    // the NIS
+    for (int r = 0; r < m; r++) {
+        for (int c = 0; c < STATE_SIZE; c++) {
+            double s = 0.0;
+            for (int k = 1; k < UKF_SIGMA_POINTS; k++) {
+                s += zSigma[r].v[k] * sigma[c].v[k];
+            }
+            gainT(r, c) = s * UKF_WEIGHT + UKF_CENTER_WEIGHT * zSigma[r].v[0] * sigma[c].v[0];
+        }
+    }
+    double nis = 0.0;
+    Matrix<double, KALMAN_MAX_MEASUREMENT_SIZE, 1> w = y;
+    for (int i = 0; i < m; i++) {
+        double d = measurementSqrt(i, i);
+        for (int p = 0; p < i; p++) {
+            w[i] -= measurementSqrt(i, p) * w[p];
+            for (int c = 0; c < STATE_SIZE; c++) {
+                gainT(i, c) -= measurementSqrt(i, p) * gainT(p, c);
+            }
+        }
+        w[i] /= d;
+        nis += w[i] * w[i];
+        for (int c = 0; c < STATE_SIZE; c++) {
+            gainT(i, c) /= d;
+        }
+    }
+    for (int i = m - 1; i >= 0; i--) {
+        double d = measurementSqrt(i, i);
+        for (int p = i + 1; p < m; p++) {
+            for (int c = 0; c < STATE_SIZE; c++) {
+                gainT(i, c) -= measurementSqrt(p, i) * gainT(p, c);
+            }
+        }
+        for (int c = 0; c < STATE_SIZE; c++) {
+            gainT(i, c) /= d;
+        }
+    }
+
+    // S = lq([sqrt(W) * (dX - K * dZ), K * sqrt(R)]) and the center point
+    double stateCenter[STATE_SIZE];
+    for (int r = 0; r < STATE_SIZE; r++) {
+        for (int k = 0; k < UKF_SIGMA_POINTS; k++) {
+            double s = sigma[r].v[k];
+            for (int i = 0; i < m; i++) {
+                s -= gainT(i, r) * zSigma[i].v[k];
+            }
+            if (k == 0) {
+                stateCenter[r] = UKF_SQRT_CENTER_WEIGHT * s;
+            } else {
+                stateSqrt(r, k - 1) = UKF_SQRT_WEIGHT * s;
+            }
+        }
+        for (int i = 0; i < m; i++) {
+            stateSqrt(r, UKF_SIGMA_POINTS - 1 + i) = gainT(i, r) * sqrtR[i];
+        }
+    }
+    lqFactor(stateSqrt, STATE_SIZE, UKF_SIGMA_POINTS - 1 + m);
+    StateMatrix newS;
+    if (lowerFactor(stateSqrt, STATE_SIZE, stateCenter, &newS) != 0) {
+        ErrorManager::ERROR(KALMAN_FILTER_UPDATE_FAILED);
+        return -1;
+    }
+
+    // x = x + K * y
+    for (int r = 0; r < STATE_SIZE; r++) {
+        for (int i = 0; i < m; i++) {
+            x[r] += gainT(i, r) * y[i];
+        }
+    }
+    S = newS;
+    lastNIS = nis;
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  UnscentedKalmanFilter.hpp
+//
+// Square root unscented kalman filter for the INCA attitude state
+// x = [q; q_dot], a drop in alternative to KalmanFilter for when the
+// linearization of the EKF is poor, such as the fast tumble at the start of
+// INCA_Dynamics_Solution.m (omega = [1, 5, -30] deg/s).
+//
+// Instead of the jacobians, 2n + 1 sigma points around the estimate are
+// pushed through StateModel::derivative (RK4, like KalmanFilter) and the
+// measurement models. The sigma points are stored as Lanes, one lane per
+// point (structure of arrays), so the models are evaluated for all of them
+// at once in loops that vectorize.
+//
+// The filter keeps the lower triangular factor S of P = S * S' instead of P.
+// Both the predict and the update build S from an LQ factorization of the
+// weighted sigma point deviations plus a rank one cholesky update for the
+// center point, so P stays symmetric and positive definite without ever
+// being formed or factored. The update uses the Joseph form.
+//
+// All of the work space is inside of the object, predict and update never
+// allocate memory.
+//
+// Example code for use is shown below:
+//
+// UnscentedKalmanFilter filter(model, x0, P0, Q);
+//
+// filter.predict(dt, Binr, D);
+//
+// Measurement m[2];
+// m[0].type = SENSOR_GYRO; ...
+// m[1].type = SENSOR_MAGNETOMETER; ...
+// if (filter.update(m, 2) != 0) {
+// // handle error, the filter state was not changed
+// }
+
+#ifndef UnscentedKalmanFilter_hpp
+#define UnscentedKalmanFilter_hpp
+
+#include "KalmanFilter.hpp"
+#include "Lanes.hpp"
+
+#define UKF_SIGMA_POINTS (2 * STATE_SIZE + 1)
+
+typedef Lanes<UKF_SIGMA_POINTS> SigmaLanes;
+typedef Matrix<SigmaLanes, STATE_SIZE, 1> SigmaStates;
+
+class UnscentedKalmanFilter {
+public:
+    // constructor for the unscented kalman filter
+    // @param model - the state model used for prediction
+    // @param x0 - the initial state estimate
+    // @param P0 - the initial state covariance
+    // @param Q - the process noise added on each predict step
+    UnscentedKalmanFilter(const StateModel &model, const StateVector &x0,
+                          const StateMatrix &P0, const StateMatrix &Q);
+
+    // predict - propagates the sigma points forward in time.
+    // @param dt - time step (s)
+    // @param Binr - magnetic field in the inertial frame (T)
+    // @param D - the commanded magnetic dipole (A*m^2)
+    void predict(double dt, const Vec3 &Binr, const Vec3 &D);
+
+    // update - applies a batch of measurements jointly.
+    // @param measurements - array of measurements taken at the same time.
+    // @param count - number of measurements in the array (1 to KALMAN_MAX_BATCH)
+    // @return - 0 on success, -1 on failure (the state is left unchanged).
+    int update(const Measurement *measurements, int count);
+
+    const StateVector &getState() const { return x; }
+
+    // getCovariance - P = S * S'
+    StateMatrix getCovariance() const;
+    const StateMatrix &getCovarianceFactor() const { return S; }
+
+    // getLastNIS - normalized innovation squared y' * Pzz^-1 * y of the
+    // last update.
+    double getLastNIS() const { return lastNIS; }
+
+private:
+    const StateModel &model;
+    StateVector x;
+    // lower triangular, P = S * S'
+    StateMatrix S;
+    // lower triangular, Q = sqrtQ * sqrtQ'
+    StateMatrix sqrtQ;
+    double lastNIS;
+
+    // work space
+    SigmaStates sigma;
+    SigmaStates stage, k1, k2, k3, k4;
+    Matrix<SigmaLanes, KALMAN_MAX_MEASUREMENT_SIZE, 1> zSigma;
+    Matrix<double, STATE_SIZE, UKF_SIGMA_POINTS + KALMAN_MAX_MEASUREMENT_SIZE> stateSqrt;
+    Matrix<double, KALMAN_MAX_MEASUREMENT_SIZE, UKF_SIGMA_POINTS + KALMAN_MAX_MEASUREMENT_SIZE> measurementSqrt;
+    Matrix<double, KALMAN_MAX_MEASUREMENT_SIZE, STATE_SIZE> gainT;
+
+    // drawSigmaPoints - x and x +- gamma * the columns of S.
+    void drawSigmaPoints();
+};
+
+#endif /* UnscentedKalmanFilter_hpp */
@@ -0,0 +1,147 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  controlLoopTest.cpp
+//
+// This is the set of test code for the ControlLoop class.
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include "ControlLoop.hpp"
+
+using namespace std;
+
+struct StageCall {
+    int stage;
+    double t;
+    double dt;
+};
+
+int main(void) {
+    int numFailed = 0;
+
+    /////////////////////////////////////////// Test 1 - config file
+    ConfigFile newConfig("controlLoopTest.inca");
+    newConfig.setDouble("controlLoopRate", 200.0);
+    newConfig.setInt("controlLoopCpu", 0);
+    newConfig.setInt("controlLoopPriority", 0);
+    newConfig.save();
+
+    ConfigFile configFile("controlLoopTest.inca");
+    ControlLoopConfig config;
+    int ret = configFile.load();
+    ret += loadControlLoopConfig(configFile, &config);
+    remove("controlLoopTest.inca");
+
+    cout << "TEST  - [ControlLoopConfig]" << endl;
+    if (ret == 0 && config.rate == 200.0 && config.cpu == 0 && config.priority == 0) {
+        cout << "Passed - load config" << endl;
+    } else {
+        cout << "Failed - load config" << endl;
+        numFailed++;
+    }
+
+    /////////////////////////////////////////// Test 2 - stage order and nominal times
+    vector<StageCall> calls;
+    calls.reserve(1000);
+    ControlLoop loop(config);
+    for (int s = 0; s < CONTROL_NUM_STAGES; s++) {
+        loop.setStage(s, [s, &calls](double t, double dt) {
+            StageCall c = {s, t, dt};
+            calls.push_back(c);
+            return 0;
+        });
+    }
+    ret = loop.run(100);
+
+    bool orderOk = calls.size() == 400;
+    bool timesOk = true;
+    for (size_t i = 0; i < calls.size() && orderOk; i++) {
+        long cycle = (long)(i / CONTROL_NUM_STAGES);
+        if (calls[i].stage != (int)(i % CONTROL_NUM_STAGES)) { orderOk = false; }
+        if (fabs(calls[i].t - cycle * 0.005) > 1e-12) { timesOk = false; }
+        if (cycle > 0 && fabs(calls[i].dt - 0.005) > 1e-12 && loop.getOverrunCount() == 0) { timesOk = false; }
+    }
+
+    cout << "TEST  - [ControlLoop run]" << endl;
+    loop.printStatistics();
+    if (ret == 0 && loop.getCycleCount() == 100) { cout << "Passed - cycle count" << endl; }
+    else { cout << "Failed - cycle count" << endl; numFailed++; }
+    if (orderOk) { cout << "Passed - sense, estimate, control, actuate order" << endl; }
+    else { cout << "Failed - sense, estimate, control, actuate order" << endl; numFailed++; }
+    // if the test machine was too busy and overran, the times are checked below instead
+    if (timesOk) { cout << "Passed - nominal cycle times" << endl; }
+    else { cout << "Failed - nominal cycle times" << endl; numFailed++; }
+    if (loop.getCycleHistogram().getCount() == 100 && loop.getWakeJitterHistogram().getCount() == 100 &&
+        loop.getPeriodJitterHistogram().getCount() == 99) {
+        cout << "Passed - histogram counts" << endl;
+    } else {
+        cout << "Failed - histogram counts" << endl;
+        numFailed++;
+    }
+
+    /////////////////////////////////////////// Test 3 - deadline overrun
+    calls.clear();
+    ControlLoop overrunLoop(config);
+    overrunLoop.setStage(CONTROL_STAGE_CONTROL, [&calls](double t, double dt) {
+        StageCall c = {CONTROL_STAGE_CONTROL, t, dt};
+        calls.push_back(c);
+        // take 2.4 periods on the 10th cycle
+        if (calls.size() == 10) {
+            struct timespec ts = {0, 12000000};
+            nanosleep(&ts, NULL);
+        }
+        return 0;
+    });
+    overrunLoop.run(20);
+
+    bool skipOk = overrunLoop.getOverrunCount() >= 1 && overrunLoop.getSkippedCount() >= 2;
+    for (size_t i = 1; i < calls.size(); i++) {
+        // every time is still on the nominal grid and dt matches the gap
+        double cycles = calls[i].t / 0.005;
+        if (fabs(cycles - floor(cycles + 0.5)) > 1e-9) { skipOk = false; }
+        if (fabs(calls[i].t - calls[i - 1].t - calls[i].dt) > 1e-12) { skipOk = false; }
+    }
+    if (calls.size() > 10 && calls[10].dt < 3 * 0.005 - 1e-12) { skipOk = false; }
+
+    cout << "TEST  - [ControlLoop overrun]" << endl;
+    if (skipOk) { cout << "Passed - overrun detected and cycles skipped" << endl; }
+    else { cout << "Failed - overrun detected and cycles skipped" << endl; numFailed++; }
+
+    /////////////////////////////////////////// Test 4 - own thread
+    ControlLoop threaded(config);
+    ret = threaded.start();
+    struct timespec ts = {0, 50000000};
+    nanosleep(&ts, NULL);
+    threaded.stop();
+    if (ret == 0 && threaded.getCycleCount() > 0) { cout << "Passed - start and stop" << endl; }
+    else { cout << "Failed - start and stop" << endl; numFailed++; }
+
+    ////////////////////////////////////////// Print tests results
+    if (numFailed == 0) {
+        cout << "ALL ControlLoop TESTS PASSED!" << endl;
+        return 0;
+    }
+    else {
+        cout << "FAILED - Failed " << numFailed << " ControlLoop Test Failed..." << endl;
+        return -numFailed;
+    }
+}
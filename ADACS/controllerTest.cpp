@@ -0,0 +1,313 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  controllerTest.cpp
+//
+// This is the set of test code for the BdotController, PIDController and
+// AttitudeController classes, in double and in float.
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "AttitudeController.hpp"
+#include "Quaternion.hpp"
+
+using namespace std;
+
+// count every allocation made by the program so the controller steps can be
+// checked to be allocation free.
+static long allocationCount = 0;
+
+void *operator new(size_t size)
+{
+    allocationCount++;
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == NULL) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+bool equal(const Vec3 &a, const Vec3 &b)
+{
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+// state rotating about the body x axis with the given rate (rad/s)
+StateVector rotatingState(double angle, double rate)
+{
+    Vec4 q;
+    q[0] = sin(angle / 2);
+    q[3] = cos(angle / 2);
+    Vec4 qDot = 0.5 * (Xi(q) * makeVec3(rate, 0.0, 0.0));
+
+    StateVector x;
+    for (int i = 0; i < 4; i++) {
+        x[i] = q[i];
+        x[i + 4] = qDot[i];
+    }
+    return x;
+}
+
+int main(void) {
+    int numFailed = 0;
+
+    Vec3 B1 = makeVec3(1.2e-5, -2.0e-5, 2.6e-5);
+    Vec3 B2 = makeVec3(1.3e-5, -1.9e-5, 2.6e-5);
+
+    /////////////////////////////////////////// Test 1 - b-dot controller
+    BdotController bdot(Mat3::identity() * 2.0);
+    BdotState bState;
+    bdot.reset(&bState);
+
+    cout << "TEST  - [BdotController]" << endl;
+    Vec3 D0 = bdot.step(&bState, B1, 0.0, 1);
+    Vec3 D1 = bdot.step(&bState, B2, 0.5, 2);
+    Vec3 expected = (B2 - B1) * (2.0 / 0.5 / norm(B2));
+    if (norm(D0) == 0.0 && norm(D1 - expected) < 1e-12) {
+        cout << "Passed - b-dot dipole" << endl;
+    } else {
+        cout << "Failed - b-dot dipole" << endl;
+        numFailed++;
+    }
+
+    // calling again for the same step index must not change the history.
+    BdotState copy = bState;
+    bdot.step(&bState, B1, 0.75, 2);
+    if (equal(bState.Bold, copy.Bold) && bState.told == copy.told && equal(bState.Dold, copy.Dold)) {
+        cout << "Passed - history only updated on new step" << endl;
+    } else {
+        cout << "Failed - history only updated on new step" << endl;
+        numFailed++;
+    }
+
+    // del_t <= 0 returns the last dipole, a zero field returns zero.
+    Vec3 Dback = bdot.step(&bState, B1, 0.25, 3);
+    bdot.step(&bState, Vec3(), 1.0, 4);
+    Vec3 Dzero = bdot.step(&bState, Vec3(), 1.5, 5);
+    if (equal(Dback, D1) && norm(Dzero) == 0.0) {
+        cout << "Passed - b-dot del_t and NaN guards" << endl;
+    } else {
+        cout << "Failed - b-dot del_t and NaN guards" << endl;
+        numFailed++;
+    }
+
+
+    /////////////////////////////////////////// Test 2 - PID controller
+    Vec3 rTarget = makeVec3(0.0, 0.0, 1.0);
+    PIDController pid(Mat3::identity() * 1e-6, Mat3::identity() * 1e-5,
+                      Mat3::identity() * 1e-3, Mat3(), rTarget, Vec3());
+    PIDState pState;
+    pid.reset(&pState);
+
+    cout << "TEST  - [PIDController]" << endl;
+    StateVector x = rotatingState(0.3, 0.1);
+    Vec3 D = pid.step(&pState, makeVec3(1.0, 0.0, 0.0), B1, 0.0, x, 1);
+    // the dipole is always perpendicular to B
+    if (fabs(dot(D, B1)) < 1e-12 * norm(D) * norm(B1) && norm(D) > 0.0) {
+        cout << "Passed - PID dipole perpendicular to B" << endl;
+    } else {
+        cout << "Failed - PID dipole perpendicular to B" << endl;
+        numFailed++;
+    }
+
+    // sun on the target axis and no rotation gives no dipole.
+    PIDState aligned;
+    pid.reset(&aligned);
+    Vec3 Daligned = pid.step(&aligned, rTarget * 3.0, B1, 0.0, rotatingState(0.0, 0.0), 1);
+    // sun exactly opposite the target uses the [1,0,0] error axis.
+    PIDState opposite;
+    pid.reset(&opposite);
+    Vec3 Dopposite = pid.step(&opposite, rTarget * -1.0, B1, 0.0, rotatingState(0.0, 0.0), 1);
+    if (norm(Daligned) == 0.0 && norm(Dopposite) > 0.0 && isfinite(norm(Dopposite))) {
+        cout << "Passed - PID aligned and 180 deg cases" << endl;
+    } else {
+        cout << "Failed - PID aligned and 180 deg cases" << endl;
+        numFailed++;
+    }
+
+    // a long hold (eclipse) between two steps integrates like a 1 s gap.
+    PIDState held, direct;
+    pid.reset(&held);
+    pid.reset(&direct);
+    pid.step(&held, makeVec3(1.0, 0.0, 0.0), B1, 0.0, x, 1);
+    pid.step(&direct, makeVec3(1.0, 0.0, 0.0), B1, 0.0, x, 1);
+    for (long i = 2; i <= 1000; i++) {
+        pid.hold(&held, (double)(i - 1), i);
+    }
+    Vec3 Dheld = pid.step(&held, makeVec3(1.0, 0.0, 0.0), B1, 1000.0, x, 1001);
+    Vec3 Ddirect = pid.step(&direct, makeVec3(1.0, 0.0, 0.0), B1, 1.0, x, 2);
+    if (equal(held.Esum, direct.Esum) && equal(Dheld, Ddirect)) {
+        cout << "Passed - PID integral kept through a hold" << endl;
+    } else {
+        cout << "Failed - PID integral kept through a hold" << endl;
+        numFailed++;
+    }
+
+
+    /////////////////////////////////////////// Test 3 - gains from the config file
+    ConfigFile configFile("ExampleControllerGains.inca");
+    ControllerGains gains;
+    int ret = configFile.load();
+    ret += loadControllerGains(configFile, &gains);
+
+    cout << "TEST  - [AttitudeController]" << endl;
+    if (ret == 0 && gains.Kp(0, 0) == 1e-6 && gains.Kp(0, 1) == 0.0 && gains.Kd(2, 2) == 1e-5 &&
+        gains.Ko(0, 0) == 1e-3 && gains.Ko(2, 2) == 0.0 && gains.rTarget[2] == 1.0) {
+        cout << "Passed - load gains" << endl;
+    } else {
+        cout << "Failed - load gains" << endl;
+        numFailed++;
+    }
+
+    ConfigFile emptyConfig("doesNotExist.inca");
+    ControllerGains badGains;
+    if (loadControllerGains(emptyConfig, &badGains) != 0) {
+        cout << "Passed - missing gains rejected" << endl;
+    } else {
+        cout << "Failed - missing gains rejected" << endl;
+        numFailed++;
+    }
+
+
+    /////////////////////////////////////////// Test 4 - saturation
+    ControllerGains bigGains = gains;
+    bigGains.Kb = Mat3::identity() * 1e3;
+    bigGains.Kp = Mat3::identity() * 1e3;
+    AttitudeController big(bigGains);
+    ControllerState bigState;
+    big.reset(&bigState);
+    Vec3 rSun = makeVec3(1.0, 0.0, 0.0);
+    Vec3 Dsat;
+    for (int i = 0; i < 10; i++) {
+        Dsat = big.step(&bigState, rotatingState(0.1 * i, 0.5), B1, rSun, 0.1 * i, i + 1);
+    }
+    Vec3 Dnan = big.step(&bigState, x, Vec3(), rSun, 2.0, 20);
+    if (fabs(norm(Dsat) - ADACS_MAX_DIPOLE) < 1e-15 && norm(Dnan) == 0.0) {
+        cout << "Passed - dipole saturation" << endl;
+    } else {
+        cout << "Failed - dipole saturation" << endl;
+        numFailed++;
+    }
+
+
+    /////////////////////////////////////////// Test 5 - independent allocation free instances
+    int instances = 2000;
+    int steps = 100;
+    AttitudeController controller(gains);
+    vector<ControllerState> states(instances);
+    vector<Vec3> outputs(instances);
+    for (int k = 0; k < instances; k++) {
+        controller.reset(&states[k]);
+    }
+
+    long allocationsBefore = allocationCount;
+    for (int i = 1; i <= steps; i++) {
+        double t = 0.1 * (i - 1);
+        for (int k = 0; k < instances; k++) {
+            // each instance sees its own rotation rate
+            StateVector xk = rotatingState(0.01 * i, 0.001 * (k % 50));
+            outputs[k] = controller.step(&states[k], xk, B1, rSun, t, i);
+        }
+    }
+    long allocations = allocationCount - allocationsBefore;
+
+    // instances with the same inputs must give the same result, so running
+    // side by side does not leak any history between them.
+    bool independent = true;
+    for (int k = 50; k < instances; k++) {
+        if (!equal(outputs[k], outputs[k % 50])) {
+            independent = false;
+        }
+    }
+    if (equal(outputs[1], outputs[2])) {
+        independent = false;
+    }
+
+    cout << "allocations in " << instances * steps << " steps = " << allocations << endl;
+    if (allocations == 0) {
+        cout << "Passed - allocation free steps" << endl;
+    } else {
+        cout << "Failed - allocation free steps" << endl;
+        numFailed++;
+    }
+    if (independent) {
+        cout << "Passed - independent instances" << endl;
+    } else {
+        cout << "Failed - independent instances" << endl;
+        numFailed++;
+    }
+
+    /////////////////////////////////////////// Test 6 - float and mixed precision
+    // 100 steps at the start and at the end of the 16 hour reference run. A
+    // float time is only good to 4 ms at the end, which the PID derivative
+    // and integral terms see, the mixed controller keeps the time in double.
+    cout << "TEST  - [Float and mixed precision]" << endl;
+    AttitudeControllerT<float> controllerFloat(gains);
+    AttitudeControllerT<float, double> controllerMixed(gains);
+    double startErr[2] = {0.0, 0.0};
+    double endErr[2] = {0.0, 0.0};
+    for (int run = 0; run < 2; run++) {
+        double t0 = run == 0 ? 0.0 : 16 * 3600;
+        ControllerState sDouble;
+        ControllerStateT<float> sFloat;
+        ControllerStateT<float, double> sMixed;
+        controller.reset(&sDouble);
+        controllerFloat.reset(&sFloat);
+        controllerMixed.reset(&sMixed);
+        double *err = run == 0 ? startErr : endErr;
+        for (int i = 1; i <= 100; i++) {
+            double t = t0 + 0.1 * (i - 1);
+            StateVector xi = rotatingState(0.01 * i, 0.02);
+            Vec3 Dd = controller.step(&sDouble, xi, B1, rSun, t, i);
+            Vec3 Df = matrixCast<double>(controllerFloat.step(&sFloat, matrixCast<float>(xi),
+                matrixCast<float>(B1), matrixCast<float>(rSun), (float)t, i));
+            Vec3 Dm = matrixCast<double>(controllerMixed.step(&sMixed, matrixCast<float>(xi),
+                matrixCast<float>(B1), matrixCast<float>(rSun), t, i));
+            err[0] = fmax(err[0], norm(Df - Dd) / norm(Dd));
+            err[1] = fmax(err[1], norm(Dm - Dd) / norm(Dd));
+        }
+    }
+    cout << "relative dipole err at t = 0: float = " << startErr[0] << " mixed = " << startErr[1]
+         << ", at 16 h: float = " << endErr[0] << " mixed = " << endErr[1] << endl;
+    if (startErr[0] < 1e-4 && startErr[1] < 1e-4 && endErr[1] < 1e-4) {
+        cout << "Passed - float and mixed controllers" << endl;
+    } else {
+        cout << "Failed - float and mixed controllers" << endl;
+        numFailed++;
+    }
+
+    ////////////////////////////////////////// Print tests results
+    if (numFailed == 0) {
+        cout << "ALL Controller TESTS PASSED!" << endl;
+        return 0;
+    }
+    else {
+        cout << "FAILED - Failed " << numFailed << " Controller Test Failed..." << endl;
+        return -numFailed;
+    }
+}
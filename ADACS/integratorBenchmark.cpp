@@ -0,0 +1,180 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  integratorBenchmark.cpp
+//
+// Benchmark comparing the simulator integrators on the reference scenario
+// from INCA_Dynamics_Solution.m, with the default gains and with aggressive
+// rotation rate gains (Ko 100 times larger).
+//
+// The second table compares running the controllers in every derivative
+// evaluation (period 0, INCA_Dynamics_Solution.m) with the zero order hold
+// controllers at a few control periods, each at two tolerances. The attitude
+// at the end is compared with the period 0 run at the default tolerance and
+// with the same period at the tight tolerance, the second shows how much the
+// result depends on where the integrator put its steps. Once the sun is
+// pointed at the rotation about the sun line is hardly controlled, so the
+// attitude differences of long runs are mostly about that axis, the
+// pointing error is what the controllers are for.
+//
+// Usage: ./integratorBenchmark [simulated seconds]
+//
+// Output is one line per integrator and scenario:
+// scenario integrator steps rejected evaluations wall(ms) final |omega|(deg/s)
+// then one line per control period and tolerance:
+// period(s) tolerance steps evaluations controller calls wall(ms)
+// final |omega|(deg/s) final sun pointing error(deg) attitude diff from
+// period 0(deg) attitude diff from the tight tolerance(deg)
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "Simulator.hpp"
+#include "Quaternion.hpp"
+
+using namespace std;
+
+// rotationRate - |omega| of the state (deg/s)
+double rotationRate(const StateVector &x)
+{
+    Vec4 q, qDot;
+    for (int k = 0; k < 4; k++) {
+        q[k] = x[k];
+        qDot[k] = x[k + 4];
+    }
+    return norm(2.0 * (Xi(q).transpose() * qDot)) * 180 / M_PI;
+}
+
+// attitudeDiff - angle between the attitudes of two states (deg), from
+// |qa - qb| = 2 * sin(angle / 4) which unlike acos stays accurate for
+// small angles.
+double attitudeDiff(const StateVector &a, const StateVector &b)
+{
+    double d = 0.0;
+    for (int k = 0; k < 4; k++) {
+        d += a[k] * b[k];
+    }
+    double sign = d < 0.0 ? -1.0 : 1.0;
+    double n = 0.0;
+    for (int k = 0; k < 4; k++) {
+        n += (a[k] - sign * b[k]) * (a[k] - sign * b[k]);
+    }
+    return 4.0 * asin(fmin(sqrt(n) / 2, 1.0)) * 180 / M_PI;
+}
+
+// pointingError - angle between the target axis and the sun (deg)
+double pointingError(const StateVector &x, const Vec3 &rTarget, const Vec3 &rSun)
+{
+    Vec4 q;
+    for (int k = 0; k < 4; k++) {
+        q[k] = x[k];
+    }
+    Vec3 sunBody = quatTrans(q, rSun);
+    double c = dot(sunBody, rTarget) / (norm(sunBody) * norm(rTarget));
+    return acos(fmax(-1.0, fmin(c, 1.0))) * 180 / M_PI;
+}
+
+void runScenario(const char *scenario, const ControllerGains &gains, double runTime)
+{
+    for (int type = 0; type < SIM_NUM_INTEGRATORS; type++) {
+        SimulatorConfig config = defaultSimulatorConfig();
+        config.integrator = type;
+        config.statusInterval = 0;
+
+        Simulator sim(config, gains);
+        sim.init(defaultInitialState());
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        int ret = sim.run(runTime);
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+        const SimulatorState &s = sim.getState();
+        cout << scenario << " " << getIntegrator(type)->name() << " " << s.i << " " << s.rejected
+             << " " << s.evaluations << " " << chrono::duration<double, milli>(end - start).count()
+             << " " << rotationRate(s.w) << (ret == 0 ? "" : " DIVERGED") << endl;
+    }
+}
+
+struct ControlRun {
+    SimulatorState state;
+    double wall;
+    int ret;
+};
+
+ControlRun runControl(const ControllerGains &gains, double period, double tolerance, double runTime)
+{
+    SimulatorConfig config = defaultSimulatorConfig();
+    config.controlPeriod = period;
+    config.tolerance = tolerance;
+    config.statusInterval = 0;
+
+    Simulator sim(config, gains);
+    sim.init(defaultInitialState());
+
+    ControlRun run;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    run.ret = sim.run(runTime);
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    run.wall = chrono::duration<double, milli>(end - start).count();
+    run.state = sim.getState();
+    return run;
+}
+
+void compareControl(const ControllerGains &gains, double runTime)
+{
+    const double periods[4] = {0.0, 0.1, 1.0, 5.0};
+    const double tolerances[2] = {1e-8, 1e-10};
+
+    ControlRun reference = runControl(gains, 0.0, tolerances[0], runTime);
+    for (int p = 0; p < 4; p++) {
+        ControlRun tight = runControl(gains, periods[p], tolerances[1], runTime);
+        for (int k = 0; k < 2; k++) {
+            ControlRun run = k == 0 ? runControl(gains, periods[p], tolerances[0], runTime) : tight;
+            const SimulatorState &s = run.state;
+            long calls = periods[p] > 0.0 ? s.tick : s.evaluations;
+            cout << periods[p] << " " << tolerances[k] << " " << s.i << " " << s.evaluations << " "
+                 << calls << " " << run.wall << " " << rotationRate(s.w) << " "
+                 << pointingError(s.w, gains.rTarget, defaultSimulatorConfig().rSun) << " "
+                 << attitudeDiff(s.w, reference.state.w) << " " << attitudeDiff(s.w, tight.state.w)
+                 << (run.ret == 0 ? "" : " DIVERGED") << endl;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    double runTime = 3600;
+    if (argc > 1) {
+        runTime = atof(argv[1]);
+    }
+
+    ControllerGains gains = defaultControllerGains();
+    ControllerGains aggressive = gains;
+    aggressive.Ko *= 100.0;
+
+    cout << "scenario integrator steps rejected evaluations wall(ms) |omega|(deg/s)" << endl;
+    runScenario("reference", gains, runTime);
+    runScenario("aggressive", aggressive, runTime);
+
+    cout << "period(s) tolerance steps evaluations controllerCalls wall(ms) |omega|(deg/s) pointing(deg) diffFromPeriod0(deg) diffFromTight(deg)"
+         << endl;
+    compareControl(gains, runTime);
+
+    return 0;
+}
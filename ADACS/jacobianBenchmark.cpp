@@ -0,0 +1,138 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  jacobianBenchmark.cpp
+//
+// Benchmark of the ways to get the 8x8 state model jacobian F: the hand
+// derived StateModel::jacobian(), forward mode automatic differentiation
+// (StateModel::autoJacobian()) and forward and central finite differences
+// of StateModel::derivative().
+//
+// Output is one line per method:
+// method  ns/jacobian  max relative error against autoJacobian
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include "StateModel.hpp"
+
+using namespace std;
+
+#define BENCHMARK_ITERATIONS 200000
+
+// forwardDifference - F from 9 evaluations of the derivative.
+void forwardDifference(const StateModel &model, const StateVector &x, const Vec3 &Binr,
+                       const Vec3 &D, StateMatrix *F)
+{
+    StateVector f0;
+    model.derivative(x, Binr, D, &f0);
+    for (int j = 0; j < STATE_SIZE; j++) {
+        double h = 1e-8 * fmax(fabs(x[j]), 1.0);
+        StateVector xp = x, fp;
+        xp[j] += h;
+        model.derivative(xp, Binr, D, &fp);
+        for (int i = 0; i < STATE_SIZE; i++) {
+            (*F)(i, j) = (fp[i] - f0[i]) / h;
+        }
+    }
+}
+
+// centralDifference - F from 16 evaluations of the derivative.
+void centralDifference(const StateModel &model, const StateVector &x, const Vec3 &Binr,
+                       const Vec3 &D, StateMatrix *F)
+{
+    for (int j = 0; j < STATE_SIZE; j++) {
+        double h = 1e-5 * fmax(fabs(x[j]), 1.0);
+        StateVector xp = x, xm = x, fp, fm;
+        xp[j] += h;
+        xm[j] -= h;
+        model.derivative(xp, Binr, D, &fp);
+        model.derivative(xm, Binr, D, &fm);
+        for (int i = 0; i < STATE_SIZE; i++) {
+            (*F)(i, j) = (fp[i] - fm[i]) / (2 * h);
+        }
+    }
+}
+
+// maxRelativeError - largest element error, relative to the largest element
+// of the exact jacobian.
+double maxRelativeError(const StateMatrix &F, const StateMatrix &exact)
+{
+    double scale = 0.0, err = 0.0;
+    for (int i = 0; i < STATE_SIZE * STATE_SIZE; i++) {
+        scale = fmax(scale, fabs(exact[i]));
+        err = fmax(err, fabs(F[i] - exact[i]));
+    }
+    return err / scale;
+}
+
+int main(void) {
+    Mat3 Inr;
+    Inr(0,0) = 0.031000;
+    Inr(1,1) = 0.031134;
+    Inr(2,2) = 0.0183645;
+    Inr(0,1) = Inr(1,0) = 0.0004;
+    StateModel model(Inr);
+
+    StateVector x;
+    x[0] = 0.5; x[1] = 0.5; x[2] = 0.5; x[3] = 0.5;
+    x[4] = 0.01; x[5] = -0.02; x[6] = 0.03; x[7] = -0.02;
+    Vec3 Binr = makeVec3(1.2e-5, -2.0e-5, 2.6e-5);
+    Vec3 D = makeVec3(0.004, -0.002, 0.006);
+
+    StateMatrix exact;
+    model.autoJacobian(x, Binr, D, &exact);
+
+    const char *names[4] = {"analytic", "autodiff", "forwardDiff", "centralDiff"};
+
+    cout << "method ns/jacobian maxRelErr" << endl;
+    for (int method = 0; method < 4; method++) {
+        StateMatrix F;
+        double sum = 0.0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int k = 0; k < BENCHMARK_ITERATIONS; k++) {
+            // a different state each time keeps the compiler from
+            // hoisting the work out of the loop
+            x[7] = -0.02 + 1e-12 * (k & 1);
+            switch (method) {
+                case 0 : model.jacobian(x, Binr, D, &F); break;
+                case 1 : model.autoJacobian(x, Binr, D, &F); break;
+                case 2 : forwardDifference(model, x, Binr, D, &F); break;
+                default: centralDifference(model, x, Binr, D, &F); break;
+            }
+            sum += F(4, 0);
+        }
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+        if (sum == 12345.0) { cout << sum << endl; }
+
+        x[7] = -0.02;
+        switch (method) {
+            case 0 : model.jacobian(x, Binr, D, &F); break;
+            case 1 : model.autoJacobian(x, Binr, D, &F); break;
+            case 2 : forwardDifference(model, x, Binr, D, &F); break;
+            default: centralDifference(model, x, Binr, D, &F); break;
+        }
+
+        cout << names[method] << " "
+             << chrono::duration<double, nano>(end - start).count() / BENCHMARK_ITERATIONS << " "
+             << maxRelativeError(F, exact) << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  kalmanBenchmark.cpp
+//
+// Benchmark comparing the joint and sequential kalman filter updates for
+// different batches of sensors arriving in the same tick.
+//
+// Output is one line per batch:
+// sensors  joint(ns/update)  sequential(ns/update)  speedup  max state diff
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include "KalmanFilter.hpp"
+
+using namespace std;
+
+#define BENCHMARK_ITERATIONS 200000
+
+// timeUpdates - runs the same update from the same prior many times.
+// @return - average ns per update.
+double timeUpdates(const StateModel &model, const StateVector &x0, const StateMatrix &P0,
+                   int mode, const Measurement *m, int count, StateVector *result)
+{
+    StateMatrix Q;
+    KalmanFilter filter(model, x0, P0, Q);
+    filter.setUpdateMode(mode);
+
+    double sum = 0.0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        KalmanFilter f = filter;
+        f.update(m, count);
+        // keep the compiler from removing the loop
+        sum += f.getState()[0];
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    filter.update(m, count);
+    *result = filter.getState();
+    if (sum == 12345.0) { cout << sum << endl; }
+
+    return chrono::duration<double, nano>(end - start).count() / BENCHMARK_ITERATIONS;
+}
+
+int main(void) {
+    Mat3 Inr;
+    Inr(0,0) = 0.031000;
+    Inr(1,1) = 0.031134;
+    Inr(2,2) = 0.0183645;
+    StateModel model(Inr);
+
+    StateVector x0;
+    x0[0] = 0.5; x0[1] = 0.5; x0[2] = 0.5; x0[3] = 0.5;
+    x0[4] = 0.01; x0[5] = -0.02; x0[6] = 0.03; x0[7] = -0.02;
+
+    StateMatrix P0;
+    for (int i = 0; i < STATE_SIZE; i++) {
+        P0(i, i) = 1e-4;
+        for (int j = 0; j < i; j++) {
+            P0(i, j) = P0(j, i) = 1e-6;
+        }
+    }
+
+    Measurement m[3];
+    m[0].type = SENSOR_GYRO;
+    m[0].z = makeVec3(0.01, -0.03, 0.02);
+    m[0].variance = makeVec3(1e-6, 1e-6, 1e-6);
+
+    m[1].type = SENSOR_MAGNETOMETER;
+    m[1].reference = makeVec3(1.2e-5, -2.0e-5, 2.6e-5);
+    m[1].z = makeVec3(2.0e-5, 1.0e-5, -2.5e-5);
+    m[1].variance = makeVec3(4e-14, 4e-14, 4e-14);
+
+    m[2].type = SENSOR_SUN;
+    m[2].reference = makeVec3(1.0, 0.0, 0.0);
+    m[2].z = makeVec3(0.1, 0.9, -0.4);
+    m[2].variance = makeVec3(1e-4, 1e-4, 1e-4);
+
+    const char *names[3] = {"gyro", "gyro+mag", "gyro+mag+sun"};
+
+    cout << "sensors joint(ns) sequential(ns) speedup maxDiff" << endl;
+    for (int count = 1; count <= 3; count++) {
+        StateVector xJoint, xSeq;
+        double joint = timeUpdates(model, x0, P0, KALMAN_UPDATE_JOINT, m, count, &xJoint);
+        double seq = timeUpdates(model, x0, P0, KALMAN_UPDATE_SEQUENTIAL, m, count, &xSeq);
+
+        double maxDiff = 0.0;
+        for (int i = 0; i < STATE_SIZE; i++) {
+            maxDiff = fmax(maxDiff, fabs(xJoint[i] - xSeq[i]));
+        }
+
+        cout << names[count - 1] << " " << joint << " " << seq << " "
+             << joint / seq << " " << maxDiff << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,487 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  kalmanTest.cpp
+//
+// This is the set of test code for the StateModel, MeasurementModel and
+// KalmanFilter classes, in double and in float.
+
+#include <iostream>
+#include <random>
+#include <cmath>
+#include "KalmanFilter.hpp"
+#include "UnscentedKalmanFilter.hpp"
+#include "Quaternion.hpp"
+#include "Dual.hpp"
+
+using namespace std;
+
+// INCA inertia matrix from INCA_Dynamics_Solution.m
+Mat3 incaInertia()
+{
+    Mat3 Inr;
+    Inr(0,0) = 0.031000;
+    Inr(1,1) = 0.031134;
+    Inr(2,2) = 0.0183645;
+    return Inr;
+}
+
+// initial state from INCA_Dynamics_Solution.m
+StateVector initialState()
+{
+    Vec3 V = makeVec3(1.0, 0.5, 0.0);
+    V *= 1.0 / norm(V);
+    double theta = M_PI / 180.0 * 120.0;
+    Vec3 omega = makeVec3(1.0, 5.0, -30.0) * (M_PI / 180.0);
+
+    Vec4 q;
+    for (int i = 0; i < 3; i++) { q[i] = V[i] * sin(theta / 2); }
+    q[3] = cos(theta / 2);
+    Vec4 qDot = 0.5 * (Xi(q) * omega);
+
+    StateVector x;
+    for (int i = 0; i < 4; i++) {
+        x[i] = q[i];
+        x[i + 4] = qDot[i];
+    }
+    return x;
+}
+
+template <int R>
+double maxRelativeError(const Matrix<double, R, STATE_SIZE> &a, const Matrix<double, R, STATE_SIZE> &b)
+{
+    double maxErr = 0.0;
+    for (int i = 0; i < R * STATE_SIZE; i++) {
+        double err = fabs(a[i] - b[i]) / (fabs(b[i]) + 1e-6);
+        if (err > maxErr) { maxErr = err; }
+    }
+    return maxErr;
+}
+
+// gyroModel - the gyro measurement from gyroMeasurement() without its
+// hand derived jacobian.
+Matrix<Dual<STATE_SIZE>, 3, 1> gyroModel(const Matrix<Dual<STATE_SIZE>, STATE_SIZE, 1> &x)
+{
+    Matrix<Dual<STATE_SIZE>, 4, 1> q, qDot;
+    for (int i = 0; i < 4; i++) {
+        q[i] = x[i];
+        qDot[i] = x[i + 4];
+    }
+    return rotationMatrix(q) * (Xi(q).transpose() * qDot);
+}
+
+// nees - normalized estimation error squared e' * P^-1 * e
+template <typename Filter>
+double nees(const StateVector &truth, const Filter &filter)
+{
+    StateMatrix P = filter.getCovariance();
+    Matrix<double, STATE_SIZE, 1> e = truth - filter.getState();
+    Matrix<double, STATE_SIZE, 1> Pe = e;
+    if (choleskySolve(P, Pe, STATE_SIZE, 1) != 0) {
+        return 1e300;
+    }
+    return dot(e, Pe);
+}
+
+int main(void) {
+    int numFailed = 0;
+
+    StateModel model(incaInertia());
+    StateVector x = initialState();
+    Vec3 Binr = makeVec3(1.2e-5, -2.0e-5, 2.6e-5);
+    Vec3 D = makeVec3(0.004, -0.002, 0.006);
+    Vec3 rSun = makeVec3(1.0, 0.0, 0.0);
+
+    /////////////////////////////////////////// Test 1 - jacobians vs finite differences
+    StateMatrix F, Ffd;
+    Matrix<double, 3, STATE_SIZE> Hg, Hgfd, Hv, Hvfd;
+    Vec3 z;
+    model.jacobian(x, Binr, D, &F);
+    gyroMeasurement(x, &z, &Hg);
+    vectorMeasurement(x, Binr, &z, &Hv);
+
+    double eps = 1e-6;
+    for (int j = 0; j < STATE_SIZE; j++) {
+        StateVector xp = x, xm = x;
+        xp[j] += eps;
+        xm[j] -= eps;
+
+        StateVector fp, fm;
+        model.derivative(xp, Binr, D, &fp);
+        model.derivative(xm, Binr, D, &fm);
+
+        Vec3 gp, gm, vp, vm;
+        MeasurementJacobian tmp;
+        gyroMeasurement(xp, &gp, &tmp);
+        gyroMeasurement(xm, &gm, &tmp);
+        vectorMeasurement(xp, Binr, &vp, &tmp);
+        vectorMeasurement(xm, Binr, &vm, &tmp);
+
+        for (int i = 0; i < STATE_SIZE; i++) {
+            Ffd(i, j) = (fp[i] - fm[i]) / (2 * eps);
+        }
+        for (int i = 0; i < 3; i++) {
+            Hgfd(i, j) = (gp[i] - gm[i]) / (2 * eps);
+            Hvfd(i, j) = (vp[i] - vm[i]) / (2 * eps) / norm(Binr);
+            Hv(i, j) /= norm(Binr);
+        }
+    }
+
+    cout << "TEST  - [Jacobians]" << endl;
+    if (maxRelativeError(F, Ffd) < 1e-5) { cout << "Passed - F jacobian" << endl; }
+    else { cout << "Failed - F jacobian" << endl; numFailed++; }
+    if (maxRelativeError(Hg, Hgfd) < 1e-5) { cout << "Passed - gyro H jacobian (Hout.txt)" << endl; }
+    else { cout << "Failed - gyro H jacobian (Hout.txt)" << endl; numFailed++; }
+    if (maxRelativeError(Hv, Hvfd) < 1e-5) { cout << "Passed - vector H jacobian" << endl; }
+    else { cout << "Failed - vector H jacobian" << endl; numFailed++; }
+
+    // automatic differentiation matches the hand derived jacobians, also
+    // with a full inertia matrix
+    StateMatrix Fad;
+    Matrix<double, 3, STATE_SIZE> Hgad;
+    Mat3 fullInertia = incaInertia();
+    fullInertia(0, 1) = fullInertia(1, 0) = 0.0004;
+    fullInertia(1, 2) = fullInertia(2, 1) = -0.0002;
+    StateModel fullModel(fullInertia);
+    StateMatrix Ffull, Ffullad;
+    model.autoJacobian(x, Binr, D, &Fad);
+    fullModel.jacobian(x, Binr, D, &Ffull);
+    fullModel.autoJacobian(x, Binr, D, &Ffullad);
+    autoJacobian(gyroModel, x, &z, &Hgad);
+    if (maxRelativeError(Fad, F) < 1e-12 && maxRelativeError(Ffullad, Ffull) < 1e-12) {
+        cout << "Passed - F automatic differentiation" << endl;
+    } else {
+        cout << "Failed - F automatic differentiation" << endl;
+        numFailed++;
+    }
+    if (maxRelativeError(Hgad, Hg) < 1e-12) { cout << "Passed - gyro H automatic differentiation" << endl; }
+    else { cout << "Failed - gyro H automatic differentiation" << endl; numFailed++; }
+
+
+    /////////////////////////////////////////// Test 2 - joint vs sequential consistency run
+    mt19937 gen(42);
+    normal_distribution<double> normal(0.0, 1.0);
+
+    double gyroStd = 1e-3;
+    double magStd = 2e-7;
+    double sunStd = 1e-2;
+    double dt = 0.1;
+    int steps = 2000;
+
+    StateMatrix P0, Q;
+    for (int i = 0; i < 4; i++) {
+        P0(i, i) = 1e-6;
+        P0(i + 4, i + 4) = 1e-6;
+        Q(i, i) = 1e-14;
+        Q(i + 4, i + 4) = 1e-12;
+    }
+
+    StateVector truth = x;
+    StateVector x0 = x;
+    for (int i = 0; i < STATE_SIZE; i++) { x0[i] += 1e-3 * normal(gen); }
+
+    KalmanFilter joint(model, x0, P0, Q);
+    KalmanFilter sequential(model, x0, P0, Q);
+    joint.setUpdateMode(KALMAN_UPDATE_JOINT);
+    sequential.setUpdateMode(KALMAN_UPDATE_SEQUENTIAL);
+    UnscentedKalmanFilter ukf(model, x0, P0, Q);
+
+    Vec3 zero;
+    double maxStateDiff = 0.0;
+    double maxNISDiff = 0.0;
+    double neesSum = 0.0;
+    double nisSum = 0.0;
+    int nisDof = 0;
+    int updateErrors = 0;
+    double ukfNeesSum = 0.0;
+    double ukfNisSum = 0.0;
+    int ukfErrors = 0;
+
+    for (int k = 0; k < steps; k++) {
+        // truth propagation uses the same integrator without process noise.
+        KalmanFilter truthProp(model, truth, P0, Q);
+        truthProp.predict(dt, Binr, zero);
+        truth = truthProp.getState();
+
+        joint.predict(dt, Binr, zero);
+        sequential.predict(dt, Binr, zero);
+        ukf.predict(dt, Binr, zero);
+
+        // every step has a gyro reading, magnetometer and sun sensor are batched in
+        // on alternating steps.
+        Measurement m[3];
+        int count = 0;
+        MeasurementJacobian H;
+
+        m[count].type = SENSOR_GYRO;
+        gyroMeasurement(truth, &m[count].z, &H);
+        for (int i = 0; i < 3; i++) {
+            m[count].z[i] += gyroStd * normal(gen);
+            m[count].variance[i] = gyroStd * gyroStd;
+        }
+        count++;
+
+        if (k % 2 == 0) {
+            m[count].type = SENSOR_MAGNETOMETER;
+            m[count].reference = Binr;
+            vectorMeasurement(truth, Binr, &m[count].z, &H);
+            for (int i = 0; i < 3; i++) {
+                m[count].z[i] += magStd * normal(gen);
+                m[count].variance[i] = magStd * magStd;
+            }
+            count++;
+
+            m[count].type = SENSOR_SUN;
+            m[count].reference = rSun;
+            vectorMeasurement(truth, rSun, &m[count].z, &H);
+            for (int i = 0; i < 3; i++) {
+                m[count].z[i] += sunStd * normal(gen);
+                m[count].variance[i] = sunStd * sunStd;
+            }
+            count++;
+        }
+
+        updateErrors += joint.update(m, count) != 0;
+        updateErrors += sequential.update(m, count) != 0;
+        ukfErrors += ukf.update(m, count) != 0;
+
+        for (int i = 0; i < STATE_SIZE; i++) {
+            double diff = fabs(joint.getState()[i] - sequential.getState()[i]);
+            if (diff > maxStateDiff) { maxStateDiff = diff; }
+        }
+        double nisDiff = fabs(joint.getLastNIS() - sequential.getLastNIS());
+        if (nisDiff > maxNISDiff) { maxNISDiff = nisDiff; }
+
+        neesSum += nees(truth, sequential);
+        nisSum += sequential.getLastNIS();
+        nisDof += 3 * count;
+        ukfNeesSum += nees(truth, ukf);
+        ukfNisSum += ukf.getLastNIS();
+    }
+
+    double avgNEES = neesSum / steps;
+    double avgNIS = nisSum / steps;
+    double avgNISDof = (double)nisDof / steps;
+
+    cout << "TEST  - [Joint vs Sequential update]" << endl;
+    cout << "max state diff = " << maxStateDiff << " max NIS diff = " << maxNISDiff << endl;
+    cout << "avg NEES = " << avgNEES << " (n = " << STATE_SIZE << ") avg NIS = " << avgNIS
+         << " (m = " << avgNISDof << ")" << endl;
+
+    if (updateErrors == 0) { cout << "Passed - no update errors" << endl; }
+    else { cout << "Failed - no update errors" << endl; numFailed++; }
+    if (maxStateDiff < 1e-9 && maxNISDiff < 1e-6) { cout << "Passed - identical estimates" << endl; }
+    else { cout << "Failed - identical estimates" << endl; numFailed++; }
+    // the filter should be consistent, the averages should be close to the
+    // number of degrees of freedom.
+    if (avgNEES > 0.5 * STATE_SIZE && avgNEES < 1.5 * STATE_SIZE) { cout << "Passed - NEES consistency" << endl; }
+    else { cout << "Failed - NEES consistency" << endl; numFailed++; }
+    if (avgNIS > 0.8 * avgNISDof && avgNIS < 1.2 * avgNISDof) { cout << "Passed - NIS consistency" << endl; }
+    else { cout << "Failed - NIS consistency" << endl; numFailed++; }
+
+    double ukfNEES = ukfNeesSum / steps;
+    double ukfNIS = ukfNisSum / steps;
+    cout << "TEST  - [Unscented filter]" << endl;
+    cout << "avg NEES = " << ukfNEES << " avg NIS = " << ukfNIS << endl;
+    if (ukfErrors == 0 && ukfNEES > 0.5 * STATE_SIZE && ukfNEES < 1.5 * STATE_SIZE &&
+        ukfNIS > 0.8 * avgNISDof && ukfNIS < 1.2 * avgNISDof) {
+        cout << "Passed - UKF consistency" << endl;
+    } else {
+        cout << "Failed - UKF consistency" << endl;
+        numFailed++;
+    }
+
+    // the lanes models match the scalar ones
+    SigmaStates lanes, lanesDot;
+    for (int r = 0; r < STATE_SIZE; r++) {
+        for (int k = 0; k < UKF_SIGMA_POINTS; k++) { lanes[r].v[k] = x[r] + 0.01 * normal(gen); }
+    }
+    Matrix<SigmaLanes, 3, 1> gyroLanes, magLanes;
+    model.derivative(lanes, Binr, D, &lanesDot);
+    gyroMeasurement(lanes, &gyroLanes);
+    vectorMeasurement(lanes, Binr, &magLanes);
+    double lanesErr = 0.0;
+    for (int k = 0; k < UKF_SIGMA_POINTS; k++) {
+        StateVector xk, xkDot;
+        for (int r = 0; r < STATE_SIZE; r++) { xk[r] = lanes[r].v[k]; }
+        Vec3 gk, vk;
+        MeasurementJacobian Hk;
+        model.derivative(xk, Binr, D, &xkDot);
+        gyroMeasurement(xk, &gk, &Hk);
+        vectorMeasurement(xk, Binr, &vk, &Hk);
+        for (int r = 0; r < STATE_SIZE; r++) {
+            lanesErr = fmax(lanesErr, fabs(lanesDot[r].v[k] - xkDot[r]));
+        }
+        for (int i = 0; i < 3; i++) {
+            lanesErr = fmax(lanesErr, fabs(gyroLanes[i].v[k] - gk[i]));
+            lanesErr = fmax(lanesErr, fabs(magLanes[i].v[k] - vk[i]) / norm(Binr));
+        }
+    }
+    if (lanesErr < 1e-12) { cout << "Passed - sigma point models" << endl; }
+    else { cout << "Failed - sigma point models" << endl; numFailed++; }
+
+    // the square root form gives back the same covariance
+    Matrix<double, 3, 5> A;
+    for (int i = 0; i < 15; i++) { A[i] = normal(gen); }
+    Matrix<double, 3, 3> AAt = A * A.transpose();
+    lqFactor(A, 3, 5);
+    Matrix<double, 3, 3> L;
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c <= r; c++) { L(r, c) = A(r, c); }
+    }
+    Matrix<double, 3, 3> LLt = L * L.transpose();
+    double lqErr = 0.0;
+    for (int i = 0; i < 9; i++) { lqErr = fmax(lqErr, fabs(LLt[i] - AAt[i])); }
+    if (lqErr < 1e-12 && A(0, 1) == 0.0 && A(0, 3) == 0.0 && L(2, 2) >= 0.0) {
+        cout << "Passed - LQ factor" << endl;
+    } else {
+        cout << "Failed - LQ factor" << endl;
+        numFailed++;
+    }
+
+    // an update and a downdate by the same vector give back L
+    Matrix<double, 3, 3> L0 = L;
+    double v[3] = {0.3, -1.2, 0.7};
+    double v2[3] = {0.3, -1.2, 0.7};
+    int updateRet = choleskyUpdate(L, v, 1.0, 3);
+    updateRet += choleskyUpdate(L, v2, -1.0, 3);
+    double updateErr = 0.0;
+    for (int i = 0; i < 9; i++) { updateErr = fmax(updateErr, fabs(L[i] - L0[i])); }
+    double big[3] = {10.0, 0.0, 0.0};
+    updateRet += choleskyUpdate(L, big, -1.0, 3) + 1;
+    if (updateRet == 0 && updateErr < 1e-12) { cout << "Passed - cholesky update and downdate" << endl; }
+    else { cout << "Failed - cholesky update and downdate" << endl; numFailed++; }
+
+
+    /////////////////////////////////////////// Test 3 - bad batches are rejected
+    KalmanFilter bad(model, x0, P0, Q);
+    Measurement m;
+    m.type = 45;
+    m.variance = makeVec3(1.0, 1.0, 1.0);
+    int ret = bad.update(&m, 1);
+    m.type = SENSOR_GYRO;
+    m.variance = makeVec3(1.0, 0.0, 1.0);
+    ret += bad.update(&m, 1);
+    ret += bad.update(&m, 0);
+    UnscentedKalmanFilter badUkf(model, x0, P0, Q);
+    ret += badUkf.update(&m, 1);
+    ret += badUkf.update(&m, KALMAN_MAX_BATCH + 1);
+
+    bool unchanged = true;
+    for (int i = 0; i < STATE_SIZE; i++) {
+        if (bad.getState()[i] != x0[i] || badUkf.getState()[i] != x0[i]) { unchanged = false; }
+    }
+    if (ret == -5 && unchanged) { cout << "Passed - bad measurement checks" << endl; }
+    else { cout << "Failed - bad measurement checks" << endl; numFailed++; }
+
+    /////////////////////////////////////////// Test 4 - float and mixed precision
+    cout << "TEST  - [Float and mixed precision]" << endl;
+    StateModelT<float> modelFloat(incaInertia());
+    Matrix<float, STATE_SIZE, 1> xFloat = matrixCast<float>(x);
+    Matrix<float, 3, 1> BinrFloat = matrixCast<float>(Binr);
+    Matrix<float, 3, 1> DFloat = matrixCast<float>(D);
+    StateVector xDotDouble;
+    Matrix<float, STATE_SIZE, 1> xDotFloat;
+    model.derivative(x, Binr, D, &xDotDouble);
+    modelFloat.derivative(xFloat, BinrFloat, DFloat, &xDotFloat);
+    StateMatrix Fdouble;
+    Matrix<float, STATE_SIZE, STATE_SIZE> Ffloat;
+    model.jacobian(x, Binr, D, &Fdouble);
+    modelFloat.jacobian(xFloat, BinrFloat, DFloat, &Ffloat);
+    // errors relative to the largest element, small elements are mostly
+    // cancellation
+    double derivativeErr = 0.0, derivativeMax = 0.0, jacobianErr = 0.0, jacobianMax = 0.0;
+    for (int i = 0; i < STATE_SIZE; i++) {
+        derivativeErr = fmax(derivativeErr, fabs(xDotFloat[i] - xDotDouble[i]));
+        derivativeMax = fmax(derivativeMax, fabs(xDotDouble[i]));
+    }
+    for (int i = 0; i < STATE_SIZE * STATE_SIZE; i++) {
+        jacobianErr = fmax(jacobianErr, fabs(Ffloat[i] - Fdouble[i]));
+        jacobianMax = fmax(jacobianMax, fabs(Fdouble[i]));
+    }
+    derivativeErr /= derivativeMax;
+    jacobianErr /= jacobianMax;
+    cout << "float derivative err = " << derivativeErr << " jacobian err = " << jacobianErr << endl;
+    if (derivativeErr < 1e-5 && jacobianErr < 1e-5) { cout << "Passed - float state model" << endl; }
+    else { cout << "Failed - float state model" << endl; numFailed++; }
+
+    // the float and mixed filters follow the double one on the same readings
+    KalmanFilter filterDouble(model, x0, P0, Q);
+    KalmanFilterT<float> filterFloat(modelFloat, matrixCast<float>(x0), matrixCast<float>(P0),
+                                     matrixCast<float>(Q));
+    KalmanFilterT<float, double> filterMixed(modelFloat, matrixCast<float>(x0), P0, Q);
+    filterMixed.setUpdateMode(KALMAN_UPDATE_SEQUENTIAL);
+    truth = x;
+    double floatDiff = 0.0, mixedDiff = 0.0;
+    int precisionErrors = 0;
+    for (int k = 0; k < 500; k++) {
+        KalmanFilter truthProp(model, truth, P0, Q);
+        truthProp.predict(dt, Binr, zero);
+        truth = truthProp.getState();
+
+        Measurement m[2];
+        MeasurementT<float> mFloat[2];
+        MeasurementJacobian H;
+        m[0].type = SENSOR_GYRO;
+        gyroMeasurement(truth, &m[0].z, &H);
+        m[1].type = SENSOR_MAGNETOMETER;
+        m[1].reference = Binr;
+        vectorMeasurement(truth, Binr, &m[1].z, &H);
+        double stds[2] = {gyroStd, magStd};
+        for (int j = 0; j < 2; j++) {
+            for (int i = 0; i < 3; i++) {
+                m[j].z[i] += stds[j] * normal(gen);
+                m[j].variance[i] = stds[j] * stds[j];
+            }
+            mFloat[j].type = m[j].type;
+            mFloat[j].z = matrixCast<float>(m[j].z);
+            mFloat[j].variance = matrixCast<float>(m[j].variance);
+            mFloat[j].reference = matrixCast<float>(m[j].reference);
+        }
+
+        filterDouble.predict(dt, Binr, zero);
+        filterFloat.predict(dt, BinrFloat, matrixCast<float>(zero));
+        filterMixed.predict(dt, BinrFloat, matrixCast<float>(zero));
+        precisionErrors += filterDouble.update(m, 2) != 0;
+        precisionErrors += filterFloat.update(mFloat, 2) != 0;
+        precisionErrors += filterMixed.update(mFloat, 2) != 0;
+
+        for (int i = 0; i < STATE_SIZE; i++) {
+            floatDiff = fmax(floatDiff, fabs(filterFloat.getState()[i] - filterDouble.getState()[i]));
+            mixedDiff = fmax(mixedDiff, fabs(filterMixed.getState()[i] - filterDouble.getState()[i]));
+        }
+    }
+    cout << "max state diff from double: float = " << floatDiff << " mixed = " << mixedDiff << endl;
+    if (precisionErrors == 0 && floatDiff < 1e-4 && mixedDiff < 1e-4) {
+        cout << "Passed - float and mixed filters" << endl;
+    } else {
+        cout << "Failed - float and mixed filters" << endl;
+        numFailed++;
+    }
+
+    ////////////////////////////////////////// Print tests results
+    if (numFailed == 0) {
+        cout << "ALL KalmanFilter TESTS PASSED!" << endl;
+        return 0;
+    }
+    else {
+        cout << "FAILED - Failed " << numFailed << " KalmanFilter Test Failed..." << endl;
+        return -numFailed;
+    }
+}
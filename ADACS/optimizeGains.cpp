@@ -0,0 +1,67 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  optimizeGains.cpp
+//
+// Command line driver for GainOptimizer. The scenario and optimizer settings
+// are read from a config file (see loadSimulatorConfig and
+// loadOptimizerConfig) and the best gains are written to an .inca file that
+// can be loaded with loadControllerGains.
+//
+// Usage: ./optimizeGains <settings.inca> <output gains.inca> [start gains.inca]
+
+#include <iostream>
+#include "GainOptimizer.hpp"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " <settings.inca> <output gains.inca> [start gains.inca]" << endl;
+        return -1;
+    }
+
+    OptimizerConfig config = defaultOptimizerConfig();
+    ConfigFile settings(argv[1]);
+    if (settings.load() != 0 || loadOptimizerConfig(settings, &config) != 0) {
+        return -1;
+    }
+
+    ControllerGains base = defaultControllerGains();
+    if (argc > 3) {
+        ConfigFile startGains(argv[3]);
+        if (startGains.load() != 0 || loadControllerGains(startGains, &base) != 0) {
+            return -1;
+        }
+    }
+
+    GainOptimizer optimizer(config, defaultGainSearchSpace(), base);
+    OptimizerResult result;
+    if (optimizer.run(&result) != 0) {
+        cout << "No candidate finished the scenario" << endl;
+        return -1;
+    }
+
+    cout << "best cost = " << result.cost.total << " settling time = " << result.cost.settlingTime
+         << " s pointing error = " << result.cost.pointingError << " deg dipole effort = "
+         << result.cost.dipoleEffort << endl;
+    cout << "evaluations = " << result.evaluations << " rejected = " << result.rejected << endl;
+
+    return saveControllerGains(argv[2], result.gains);
+}
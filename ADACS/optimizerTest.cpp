@@ -0,0 +1,159 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  optimizerTest.cpp
+//
+// This is the set of test code for the GainOptimizer.
+
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include "GainOptimizer.hpp"
+
+using namespace std;
+
+int main(void) {
+    int numFailed = 0;
+
+    OptimizerConfig config = defaultOptimizerConfig();
+    config.horizon = 600;
+    config.population = 6;
+    config.generations = 4;
+    config.verbose = false;
+    GainSearchSpace space = defaultGainSearchSpace();
+    ControllerGains base = defaultControllerGains();
+
+    /////////////////////////////////////////// Test 1 - cost and early rejection
+    GainCost full, stopped;
+    int ret = evaluateGains(config, base, 1e300, &full);
+    int stoppedRet = evaluateGains(config, base, 0.5 * full.total, &stopped);
+
+    cout << "TEST  - [evaluateGains]" << endl;
+    cout << "cost = " << full.total << " settling = " << full.settlingTime << " pointing = "
+         << full.pointingError << " effort = " << full.dipoleEffort << endl;
+    if (ret == 0 && !full.rejected && full.total > 0.0 && full.dipoleEffort > 0.0) {
+        cout << "Passed - full evaluation" << endl;
+    } else {
+        cout << "Failed - full evaluation" << endl;
+        numFailed++;
+    }
+    if (stoppedRet == -1 && stopped.rejected && stopped.total > 0.5 * full.total &&
+        stopped.total <= full.total) {
+        cout << "Passed - early rejection" << endl;
+    } else {
+        cout << "Failed - early rejection" << endl;
+        numFailed++;
+    }
+
+    // with the ephemeris the pointing is scored against the modeled sun, so
+    // the fixed sun vector mustn't change the cost
+    OptimizerConfig ephemeris = config;
+    ephemeris.sim.sunModel = SIM_SUN_EPHEMERIS;
+    GainCost ephemerisCost, flippedCost;
+    evaluateGains(ephemeris, base, 1e300, &ephemerisCost);
+    ephemeris.sim.rSun = ephemeris.sim.rSun * -1.0;
+    evaluateGains(ephemeris, base, 1e300, &flippedCost);
+    if (ephemerisCost.pointingError == flippedCost.pointingError &&
+        ephemerisCost.total == flippedCost.total) {
+        cout << "Passed - ephemeris sun" << endl;
+    } else {
+        cout << "Failed - ephemeris sun" << endl;
+        numFailed++;
+    }
+
+    // the parameters map onto the gain structure
+    double x[NUM_GAIN_PARAMETERS] = {0, -6, -5, -3, 0};
+    ControllerGains mapped = gainsFromParameters(space, base, x);
+    if (fabs(mapped.Kp(1,1) - 1e-6) < 1e-18 && fabs(mapped.Ko(0,0) - 1e-3) < 1e-15 &&
+        mapped.Ko(2,2) == 0.0 && mapped.Kb(0,0) == base.Kb(0,0)) {
+        cout << "Passed - gain parameters" << endl;
+    } else {
+        cout << "Failed - gain parameters" << endl;
+        numFailed++;
+    }
+
+
+    /////////////////////////////////////////// Test 2 - optimizer
+    OptimizerResult result, serialResult;
+    config.threads = 3;
+    GainOptimizer optimizer(config, space, base);
+    ret = optimizer.run(&result);
+
+    config.threads = 1;
+    GainOptimizer serial(config, space, base);
+    ret += serial.run(&serialResult);
+
+    cout << "TEST  - [GainOptimizer]" << endl;
+    cout << "best cost = " << result.cost.total << " evaluations = " << result.evaluations
+         << " rejected = " << result.rejected << endl;
+    if (ret == 0 && result.cost.total <= full.total && result.evaluations == 1 + 4 * 6) {
+        cout << "Passed - optimizer improves on the start" << endl;
+    } else {
+        cout << "Failed - optimizer improves on the start" << endl;
+        numFailed++;
+    }
+    if (serialResult.cost.total == result.cost.total && serialResult.rejected == result.rejected) {
+        cout << "Passed - same result for any number of threads" << endl;
+    } else {
+        cout << "Failed - same result for any number of threads" << endl;
+        numFailed++;
+    }
+
+    // nothing to search
+    GainSearchSpace empty = space;
+    for (int k = 0; k < NUM_GAIN_PARAMETERS; k++) {
+        empty.enabled[k] = false;
+    }
+    OptimizerResult emptyResult;
+    GainOptimizer emptyOptimizer(config, empty, base);
+    if (emptyOptimizer.run(&emptyResult) == -1) {
+        cout << "Passed - empty search space" << endl;
+    } else {
+        cout << "Failed - empty search space" << endl;
+        numFailed++;
+    }
+
+
+    /////////////////////////////////////////// Test 3 - write the gains
+    ret = saveControllerGains("optimizerTest.inca", result.gains);
+    ConfigFile configFile("optimizerTest.inca");
+    ControllerGains loaded;
+    ret += configFile.load();
+    ret += loadControllerGains(configFile, &loaded);
+    remove("optimizerTest.inca");
+
+    // the arrays are written with enough digits to read back exactly
+    if (ret == 0 && loaded.Kp(0,0) == result.gains.Kp(0,0) && loaded.Ko(1,1) == result.gains.Ko(1,1) &&
+        loaded.rTarget[2] == 1.0) {
+        cout << "Passed - save gains" << endl;
+    } else {
+        cout << "Failed - save gains" << endl;
+        numFailed++;
+    }
+
+    ////////////////////////////////////////// Print tests results
+    if (numFailed == 0) {
+        cout << "ALL GainOptimizer TESTS PASSED!" << endl;
+        return 0;
+    }
+    else {
+        cout << "FAILED - Failed " << numFailed << " GainOptimizer Test Failed..." << endl;
+        return -numFailed;
+    }
+}
@@ -0,0 +1,255 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  pipelineTest.cpp
+//
+// This is the set of test code for the RingBuffer and SensorPipeline classes.
+// The sensors are replayed from files so the test runs on any linux computer.
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include "SensorPipeline.hpp"
+
+// for error codes
+#include <ErrorManager.hpp>
+
+using namespace std;
+
+#define GYRO_FILE "replayGyro.txt"
+#define MAG_FILE "replayMag.txt"
+#define TEMP_FILE "replayTemp.txt"
+
+// signals are linear in time so interpolation is exact.
+Vec3 gyroSignal(double t) { return makeVec3(0.1 + 0.01 * t, -0.2 * t, 0.3); }
+Vec3 magSignal(double t) { return makeVec3(1e-5 * t, 2e-5, -3e-5 + 1e-6 * t); }
+
+// writeReplayFile - writes samples from t0 to t1 every dt.
+// @param errorIndex - sample index to replace with a read failure, -1 for none.
+void writeReplayFile(const char *path, Vec3 (*signal)(double), double t0, double t1,
+                     double dt, int errorIndex)
+{
+    ofstream out(path);
+    out.precision(17);
+    out << "# replay file for pipelineTest" << endl;
+    int n = (int)floor((t1 - t0) / dt + 0.5);
+    for (int i = 0; i <= n; i++) {
+        double t = t0 + i * dt;
+        if (i == errorIndex) {
+            out << t << " ERROR" << endl;
+            continue;
+        }
+        Vec3 v = signal(t);
+        out << t << " " << v[0] << " " << v[1] << " " << v[2] << endl;
+    }
+}
+
+Vec3 tempSignal(double t) { return makeVec3(20.0 + t, 0.0, 0.0); }
+
+struct EpochRecord {
+    double t;
+    int count;
+    SensorSample samples[PIPELINE_MAX_SENSORS];
+};
+
+// runReplay - runs the three replay sensors through the pipeline.
+// The pipeline holds alignas(64) ring buffers, so it is kept on the stack of
+// the caller instead of being allocated with new (no aligned new in c++0x).
+int runReplay(double speed, vector<EpochRecord> *records, SensorPipeline *pipeline)
+{
+    ReplaySensor gyro(GYRO_FILE, GYRO_FAILED_COMM_TEST, speed);
+    ReplaySensor mag(MAG_FILE, ADACS_ADC_FAILED_VOLTAGE_READ, speed);
+    ReplaySensor temp(TEMP_FILE, EPS_TEMP_SENSOR_FAILED_TO_READ_TEMP, speed);
+
+    pipeline->addSensor(&gyro);
+    pipeline->addSensor(&mag);
+    pipeline->addSensor(&temp);
+    pipeline->setEpochHandler([records](double t, const SensorSample *samples, int count) {
+        EpochRecord r;
+        r.t = t;
+        r.count = count;
+        for (int i = 0; i < count; i++) { r.samples[i] = samples[i]; }
+        records->push_back(r);
+    });
+
+    int ret = pipeline->start();
+    pipeline->wait();
+    return ret;
+}
+
+// checkRecords - checks that every epoch has the interpolated values.
+// @param gyroOnly - only check the gyro, in real time the estimator doesn't
+//                   wait for the slow sensors so they may be held instead.
+bool checkRecords(const vector<EpochRecord> &records, bool gyroOnly)
+{
+    for (size_t k = 0; k < records.size(); k++) {
+        const EpochRecord &r = records[k];
+        if (fabs(r.t - 0.1 * k) > 1e-12) {
+            cout << "epoch " << k << " has time " << r.t << endl;
+            return false;
+        }
+        for (int i = 0; i < r.count; i++) {
+            const SensorSample &s = r.samples[i];
+            if (gyroOnly && s.sensor != 0) {
+                continue;
+            }
+            Vec3 expected;
+            double tol;
+            if (s.sensor == 0) {
+                expected = gyroSignal(r.t);
+                tol = 1e-12;
+            } else if (s.sensor == 1) {
+                expected = magSignal(r.t);
+                tol = 1e-15;
+                // the first and last epochs are outside of the magnetometer
+                // samples so the closest sample is held.
+                if (r.t < 0.05) {
+                    expected = magSignal(0.05);
+                } else if (r.t > 1.95) {
+                    expected = magSignal(1.95);
+                }
+            } else {
+                // temperature is interpolated between the 0.5 s samples
+                expected = tempSignal(r.t);
+                tol = 1e-12;
+            }
+            if (norm(s.value - expected) > tol) {
+                cout << "epoch " << r.t << " sensor " << s.sensor << " value " << s.value[0]
+                     << " expected " << expected[0] << endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(void) {
+    int numFailed = 0;
+
+    /////////////////////////////////////////// Test 1 - ring buffer between two threads
+    RingBuffer<long, 64> queue;
+    const long numItems = 1000000;
+    thread producer([&queue, numItems]() {
+        for (long i = 0; i < numItems; i++) {
+            while (!queue.push(i)) { this_thread::yield(); }
+        }
+    });
+    long expected = 0;
+    bool inOrder = true;
+    while (expected < numItems) {
+        long v;
+        if (queue.pop(&v)) {
+            if (v != expected) { inOrder = false; }
+            expected++;
+        } else {
+            this_thread::yield();
+        }
+    }
+    producer.join();
+
+    cout << "TEST  - [RingBuffer]" << endl;
+    if (inOrder && expected == numItems) { cout << "Passed - SPSC order" << endl; }
+    else { cout << "Failed - SPSC order" << endl; numFailed++; }
+
+
+    /////////////////////////////////////////// Test 2 - replay as fast as possible
+    writeReplayFile(GYRO_FILE, gyroSignal, 0.0, 2.0, 0.02, -1);
+    writeReplayFile(MAG_FILE, magSignal, 0.05, 1.95, 0.1, 5);
+    writeReplayFile(TEMP_FILE, tempSignal, 0.0, 2.0, 0.5, -1);
+
+    vector<EpochRecord> records;
+    SensorPipeline fastPipeline(0.0, 0.1, 0.6);
+    int ret = runReplay(0.0, &records, &fastPipeline);
+
+    cout << "TEST  - [SensorPipeline replay]" << endl;
+    if (ret == 0 && fastPipeline.getEpochCount() == 21 && records.size() == 21) {
+        cout << "Passed - epoch count" << endl;
+    } else {
+        cout << "Failed - epoch count " << fastPipeline.getEpochCount() << endl;
+        numFailed++;
+    }
+    if (checkRecords(records, false)) { cout << "Passed - aligned values" << endl; }
+    else { cout << "Failed - aligned values" << endl; numFailed++; }
+    if (fastPipeline.getReadErrorCount() == 1 && fastPipeline.getDroppedCount() == 0) {
+        cout << "Passed - read errors routed" << endl;
+    } else {
+        cout << "Failed - read errors routed" << endl;
+        numFailed++;
+    }
+    fastPipeline.getLatencyHistogram().print("end-to-end latency, fast replay (ns)");
+
+
+    /////////////////////////////////////////// Test 3 - replay in 10x real time
+    records.clear();
+    SensorPipeline realTimePipeline(0.0, 0.1, 0.6);
+    ret = runReplay(10.0, &records, &realTimePipeline);
+    if (ret == 0 && records.size() == 21 && checkRecords(records, true)) {
+        cout << "Passed - real time replay" << endl;
+    } else {
+        cout << "Failed - real time replay" << endl;
+        numFailed++;
+    }
+    realTimePipeline.getLatencyHistogram().print("end-to-end latency, 10x replay (ns)");
+
+    /////////////////////////////////////////// Test 4 - missing replay file
+    ReplaySensor missing("doesNotExist.txt", GYRO_FAILED_COMM_TEST, 0.0);
+    SensorSample s;
+    if (!missing.isOpen() && missing.read(&s) == 1) { cout << "Passed - missing replay file" << endl; }
+    else { cout << "Failed - missing replay file" << endl; numFailed++; }
+
+    /////////////////////////////////////////// Test 5 - malformed replay lines
+    {
+        ofstream out(GYRO_FILE);
+        out << "0.0 1 2 3" << endl;
+        out << "0.1" << endl;
+        out << "0.2 1 2" << endl;
+        out << "0.3 1x 2 3" << endl;
+        out << "0.4 1 two 3" << endl;
+        out << "0.5 4 5 6" << endl;
+    }
+    ReplaySensor malformed(GYRO_FILE, GYRO_FAILED_COMM_TEST, 0.0);
+    int reads[6];
+    SensorSample last;
+    for (int i = 0; i < 6; i++) {
+        reads[i] = malformed.read(&last);
+    }
+    if (reads[0] == 0 && reads[1] == -1 && reads[2] == -1 && reads[3] == -1 && reads[4] == -1 &&
+        reads[5] == 0 && last.value[2] == 6.0 && malformed.read(&s) == 1) {
+        cout << "Passed - malformed replay lines" << endl;
+    } else {
+        cout << "Failed - malformed replay lines" << endl;
+        numFailed++;
+    }
+
+    remove(GYRO_FILE);
+    remove(MAG_FILE);
+    remove(TEMP_FILE);
+
+    ////////////////////////////////////////// Print tests results
+    if (numFailed == 0) {
+        cout << "ALL SensorPipeline TESTS PASSED!" << endl;
+        return 0;
+    }
+    else {
+        cout << "FAILED - Failed " << numFailed << " SensorPipeline Test Failed..." << endl;
+        return -numFailed;
+    }
+}
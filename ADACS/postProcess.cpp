@@ -0,0 +1,75 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  postProcess.cpp
+//
+// Command line driver for the trajectory post processing. Every trajectory
+// is summarized into one line of the summary table, and with -c the derived
+// channels of each one are written to <trajectory>.txt every interval
+// seconds (0 for every sample).
+//
+// Usage: ./postProcess [-j threads] [-c interval] <summary.txt> <trajectory>...
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include "PostProcess.hpp"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    PostProcessOptions options = defaultPostProcessOptions();
+    bool channels = false;
+    vector<string> paths;
+    for (int k = 1; k < argc; k++) {
+        if (strcmp(argv[k], "-j") == 0 && k + 1 < argc) {
+            options.threads = atoi(argv[++k]);
+        } else if (strcmp(argv[k], "-c") == 0 && k + 1 < argc) {
+            channels = true;
+            options.channelInterval = atof(argv[++k]);
+        } else {
+            paths.push_back(argv[k]);
+        }
+    }
+    if (paths.size() < 2) {
+        cout << "Usage: " << argv[0] << " [-j threads] [-c interval] <summary.txt> <trajectory>..." << endl;
+        return -1;
+    }
+
+    vector<string> names;
+    vector<TrajectorySummary> summaries;
+    int failed = 0;
+    for (size_t k = 1; k < paths.size(); k++) {
+        options.channelsPath = channels ? paths[k] + ".txt" : "";
+        TrajectorySummary summary;
+        if (processTrajectory(paths[k], options, &summary) != 0) {
+            cout << "failed to process " << paths[k] << endl;
+            failed++;
+            continue;
+        }
+        names.push_back(paths[k]);
+        summaries.push_back(summary);
+    }
+
+    if (writeSummaryTable(paths[0], names, summaries) != 0) {
+        return -1;
+    }
+    cout << summaries.size() << " trajectories processed, " << failed << " failed" << endl;
+    return failed == 0 ? 0 : -1;
+}
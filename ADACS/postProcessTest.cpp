@@ -0,0 +1,323 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  postProcessTest.cpp
+//
+// This is the set of test code for the trajectory files and post processing.
+
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include "PostProcess.hpp"
+#include "Quaternion.hpp"
+
+using namespace std;
+
+#define TEST_SAMPLES 20000
+
+// decayingSpin - a spin about a fixed axis that decays from 10 deg/s with a
+// time constant of 1000 s, sampled with uneven steps.
+vector<SimulatorState> decayingSpin()
+{
+    vector<SimulatorState> states(TEST_SAMPLES);
+    Vec3 axis = makeVec3(1.0, 0.5, 0.25);
+    axis *= 1.0 / norm(axis);
+    double omega0 = 10 * M_PI / 180;
+    double tau = 1000;
+    double t = 0.0;
+    for (int k = 0; k < TEST_SAMPLES; k++) {
+        SimulatorState &s = states[k];
+        s.t = t;
+        double angle = omega0 * tau * (1 - exp(-t / tau));
+        Vec4 q;
+        for (int i = 0; i < 3; i++) {
+            q[i] = axis[i] * sin(angle / 2);
+        }
+        q[3] = cos(angle / 2);
+        // a small norm error for q_norm
+        q *= 1.0 + 1e-9 * sin(0.1 * k);
+        Vec4 qDot = 0.5 * (Xi(q) * (axis * (omega0 * exp(-t / tau))));
+        for (int i = 0; i < 4; i++) {
+            s.w[i] = q[i];
+            s.w[i + 4] = qDot[i];
+        }
+        t += 0.5 + 0.4 * sin(0.37 * k);
+    }
+    return states;
+}
+
+// writeTrajectory - writes states to path
+int writeTrajectory(const string &path, const TrajectoryHeader &header,
+                    const vector<SimulatorState> &states)
+{
+    TrajectoryWriter writer;
+    int ret = writer.open(path, header);
+    for (size_t k = 0; k < states.size(); k++) {
+        ret += writer.write(states[k]);
+    }
+    return ret + writer.close();
+}
+
+// weightedPercentile - the smallest value with p percent of the weight at or
+// below it.
+double weightedPercentile(vector<pair<double, double> > values, double p)
+{
+    sort(values.begin(), values.end());
+    double total = 0.0;
+    for (size_t k = 0; k < values.size(); k++) {
+        total += values[k].second;
+    }
+    double sum = 0.0;
+    for (size_t k = 0; k < values.size(); k++) {
+        sum += values[k].second;
+        if (sum >= total * p / 100) {
+            return values[k].first;
+        }
+    }
+    return values.back().first;
+}
+
+// closePercentile - a histogram percentile is the upper bound of its bucket
+bool closePercentile(double value, double exact)
+{
+    return value >= exact * (1 - 1e-12) && value <= exact * 1.04;
+}
+
+bool sameSummary(const TrajectorySummary &a, const TrajectorySummary &b)
+{
+    return a.samples == b.samples && a.t == b.t && a.qNormError == b.qNormError &&
+           memcmp(&a.rate, &b.rate, sizeof(ChannelSummary)) == 0 &&
+           memcmp(&a.pointing, &b.pointing, sizeof(ChannelSummary)) == 0;
+}
+
+int main(void) {
+    int numFailed = 0;
+
+    vector<SimulatorState> states = decayingSpin();
+    TrajectoryHeader header = trajectoryHeader(defaultSimulatorConfig(), defaultControllerGains());
+
+    /////////////////////////////////////////// Test 1 - trajectory files
+    int ret = writeTrajectory("postProcessTest.traj", header, states);
+    TrajectoryReader reader;
+    ret += reader.open("postProcessTest.traj");
+    TrajectoryChunk *chunk = new TrajectoryChunk;
+    bool same = reader.samples() == TEST_SAMPLES &&
+                reader.chunks() == (TEST_SAMPLES + TRAJECTORY_CHUNK_SAMPLES - 1) / TRAJECTORY_CHUNK_SAMPLES;
+    size_t sample = 0;
+    for (size_t k = 0; k < reader.chunks(); k++) {
+        ret += reader.readChunk(k, chunk);
+        double tPrev = sample == 0 ? states[0].t : states[sample - 1].t;
+        same = same && chunk->tPrev == tPrev;
+        for (int i = 0; i < chunk->count; i++, sample++) {
+            same = same && chunk->t[i] == states[sample].t;
+            for (int c = 0; c < STATE_SIZE; c++) {
+                same = same && chunk->x[c][i] == states[sample].w[c];
+            }
+        }
+    }
+    reader.close();
+
+    cout << "TEST  - [Trajectory files]" << endl;
+    cout << "samples = " << sample << " chunks = " << (TEST_SAMPLES + TRAJECTORY_CHUNK_SAMPLES - 1) / TRAJECTORY_CHUNK_SAMPLES << endl;
+    if (ret == 0 && same && sample == TEST_SAMPLES) {
+        cout << "Passed - write and read back" << endl;
+    } else {
+        cout << "Failed - write and read back" << endl;
+        numFailed++;
+    }
+
+    // a run that was stopped in the middle of a chunk
+    ifstream in("postProcessTest.traj", ios::binary);
+    string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+    ofstream truncated("postProcessTest2.traj", ios::binary | ios::trunc);
+    truncated.write(bytes.data(), bytes.size() - 100);
+    truncated.close();
+    TrajectorySummary summary;
+    int bad = reader.open("postProcessTest2.traj") == -1;
+    bad += reader.open("doesNotExist.traj") == -1;
+    bad += processTrajectory("postProcessTest2.traj", defaultPostProcessOptions(), &summary) == -1;
+    remove("postProcessTest2.traj");
+    if (bad == 3) {
+        cout << "Passed - truncated and missing files" << endl;
+    } else {
+        cout << "Failed - truncated and missing files" << endl;
+        numFailed++;
+    }
+
+    /////////////////////////////////////////// Test 2 - derived channels
+    DerivedChannels *channels = new DerivedChannels;
+    TrajectoryHeader ephemeris = header;
+    ephemeris.sunModel = SIM_SUN_EPHEMERIS;
+    ephemeris.epochJD = 2458849.5;
+    ephemeris.rTarget = makeVec3(0.0, 1.0, 1.0);
+    double maxError = 0.0;
+    ret = reader.open("postProcessTest.traj");
+    for (int h = 0; h < 2; h++) {
+        const TrajectoryHeader &test = h == 0 ? header : ephemeris;
+        sample = 0;
+        for (size_t k = 0; k < reader.chunks(); k++) {
+            ret += reader.readChunk(k, chunk);
+            deriveChannels(test, *chunk, channels);
+            for (int i = 0; i < chunk->count; i++, sample++) {
+                Vec4 q, qDot;
+                for (int c = 0; c < 4; c++) {
+                    q[c] = states[sample].w[c];
+                    qDot[c] = states[sample].w[c + 4];
+                }
+                Vec3 rSun = test.rSun;
+                if (test.sunModel == SIM_SUN_EPHEMERIS) {
+                    rSun = sunPosition(test.epochJD + states[sample].t / 86400);
+                }
+                Vec3 omega = 2.0 * (Xi(q).transpose() * qDot);
+                Vec3 sunBody = quatTrans(q, rSun);
+                double c = dot(sunBody, test.rTarget) / (norm(sunBody) * norm(test.rTarget));
+                double pointing = acos(fmax(-1.0, fmin(1.0, c))) * 180 / M_PI;
+
+                for (int j = 0; j < 3; j++) {
+                    maxError = fmax(maxError, fabs(channels->omega[j][i] - omega[j]));
+                    maxError = fmax(maxError, fabs(channels->sunBody[j][i] - sunBody[j]) / norm(rSun));
+                }
+                maxError = fmax(maxError, fabs(channels->omegaNorm[i] - norm(omega)));
+                maxError = fmax(maxError, fabs(channels->qNorm[i] - norm(q)));
+                maxError = fmax(maxError, fabs(channels->pointing[i] - pointing) / 180);
+            }
+        }
+    }
+    reader.close();
+
+    cout << "TEST  - [Derived channels]" << endl;
+    cout << "max error = " << maxError << endl;
+    if (ret == 0 && maxError < 1e-12) {
+        cout << "Passed - same as the scalar quaternion functions" << endl;
+    } else {
+        cout << "Failed - same as the scalar quaternion functions" << endl;
+        numFailed++;
+    }
+
+    /////////////////////////////////////////// Test 3 - summary statistics
+    PostProcessOptions options = defaultPostProcessOptions();
+    options.threads = 1;
+    TrajectorySummary single;
+    ret = processTrajectory("postProcessTest.traj", options, &single);
+    options.threads = 4;
+    options.channelsPath = "postProcessTest.txt";
+    options.channelInterval = 100;
+    TrajectorySummary threaded;
+    ret += processTrajectory("postProcessTest.traj", options, &threaded);
+
+    // the same statistics from the whole run in memory
+    vector<pair<double, double> > rates, pointings;
+    double sumRate = 0.0, sumPointing = 0.0, weight = 0.0, qNormError = 0.0;
+    double detumbled = 0.0, settled = 0.0;
+    long rows = 0;
+    ret += reader.open("postProcessTest.traj");
+    for (size_t k = 0; k < reader.chunks(); k++) {
+        ret += reader.readChunk(k, chunk);
+        deriveChannels(header, *chunk, channels);
+        for (int i = 0; i < chunk->count; i++) {
+            double t = chunk->t[i];
+            double tPrev = i == 0 ? chunk->tPrev : chunk->t[i - 1];
+            double w = t - tPrev;
+            double rate = channels->omegaNorm[i] * 180 / M_PI;
+            double pointing = channels->pointing[i];
+            rates.push_back(make_pair(rate, w));
+            pointings.push_back(make_pair(pointing, w));
+            sumRate += w * rate * rate;
+            sumPointing += w * pointing * pointing;
+            weight += w;
+            qNormError = fmax(qNormError, fabs(channels->qNorm[i] - 1.0));
+            if (rate > options.rateThreshold) { detumbled = t; }
+            if (pointing > options.pointingThreshold) { settled = t; }
+            rows += (k == 0 && i == 0) || floor(t / 100) > floor(tPrev / 100);
+        }
+    }
+    reader.close();
+    if (pointings.back().first > options.pointingThreshold) { settled = -1.0; }
+
+    long lines = -1;
+    ifstream table("postProcessTest.txt");
+    string line;
+    while (getline(table, line)) { lines++; }
+    table.close();
+
+    double rateRms = sqrt(sumRate / weight);
+    double pointingRms = sqrt(sumPointing / weight);
+    cout << "TEST  - [Summary statistics]" << endl;
+    cout << "rate rms = " << threaded.rate.rms << " p50 = " << threaded.rate.p50
+         << " p99 = " << threaded.rate.p99 << " detumbled = " << threaded.rate.settled << endl;
+    cout << "pointing rms = " << threaded.pointing.rms << " p50 = " << threaded.pointing.p50
+         << " max = " << threaded.pointing.max << " settled = " << threaded.pointing.settled << endl;
+    cout << "channel rows = " << lines << endl;
+    if (ret == 0 && sameSummary(single, threaded) && lines == rows) {
+        cout << "Passed - same with 1 and 4 threads" << endl;
+    } else {
+        cout << "Failed - same with 1 and 4 threads" << endl;
+        numFailed++;
+    }
+
+    bool matches = threaded.samples == TEST_SAMPLES && threaded.t == states.back().t &&
+                   fabs(threaded.rate.rms - rateRms) < 1e-9 * rateRms &&
+                   fabs(threaded.pointing.rms - pointingRms) < 1e-9 * pointingRms &&
+                   threaded.qNormError == qNormError &&
+                   threaded.rate.settled == detumbled && detumbled > 0.0 &&
+                   threaded.pointing.settled == settled;
+    double p[3] = { 50, 90, 99 };
+    double ratePercentiles[3] = { threaded.rate.p50, threaded.rate.p90, threaded.rate.p99 };
+    double pointingPercentiles[3] = { threaded.pointing.p50, threaded.pointing.p90, threaded.pointing.p99 };
+    for (int k = 0; k < 3; k++) {
+        matches = matches && closePercentile(ratePercentiles[k], weightedPercentile(rates, p[k]));
+        matches = matches && closePercentile(pointingPercentiles[k], weightedPercentile(pointings, p[k]));
+    }
+    if (matches) {
+        cout << "Passed - same as the whole run in memory" << endl;
+    } else {
+        cout << "Failed - same as the whole run in memory" << endl;
+        numFailed++;
+    }
+
+    vector<string> names(1, "postProcessTest.traj");
+    vector<TrajectorySummary> summaries(1, threaded);
+    ret = writeSummaryTable("postProcessTest.txt", names, summaries);
+    ret += writeSummaryTable("doesNotExist/summary.txt", names, summaries) == -1 ? 0 : 1;
+    if (ret == 0) {
+        cout << "Passed - summary table" << endl;
+    } else {
+        cout << "Failed - summary table" << endl;
+        numFailed++;
+    }
+    remove("postProcessTest.txt");
+    remove("postProcessTest.traj");
+    delete chunk;
+    delete channels;
+
+    ////////////////////////////////////////// Print tests results
+    if (numFailed == 0) {
+        cout << "ALL Post Processing TESTS PASSED!" << endl;
+        return 0;
+    }
+    else {
+        cout << "FAILED - Failed " << numFailed << " Post Processing Test Failed..." << endl;
+        return -numFailed;
+    }
+}
@@ -0,0 +1,338 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  precisionBenchmark.cpp
+//
+// Accuracy and throughput of the state model, controllers and filter in
+// double, float and mixed precision on the reference 16 hour scenario of
+// INCA_Dynamics_Solution.m (defaultSimulatorConfig, defaultInitialState and
+// defaultControllerGains). Mixed is float with the time, and for the filter
+// the covariance, kept in double.
+//
+// The closed loop is run the way the flight loop runs it: the controller is
+// called once every LOOP_DT and its dipole is held over a fixed RK4 step of
+// the state model, q is normalized after each step. The magnetic field comes
+// from the double orbit model at the time kept by the loop, so a float time
+// also moves the field.
+//
+// The filter then tracks the double loop at 1 Hz with the gyro,
+// magnetometer and sun sensor, every precision is given the same noisy
+// measurements rounded to its scalar type.
+//
+// Output is two tables:
+// loop: precision  ns/step(controller+RK4)  time error at 16 h(s)  attitude
+//       difference from double at 1 h and at 16 h(deg)  pointing error at
+//       16 h(deg)  rate at 16 h(deg/s)
+// filter: precision  ns/step(predict+update)  rms attitude error over the
+//       second half(deg)  max difference from the double filter(deg)
+//       failed updates
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include "Simulator.hpp"
+#include "KalmanFilter.hpp"
+#include "Quaternion.hpp"
+#include "Random.hpp"
+
+using namespace std;
+
+#define LOOP_DT 0.1
+#define FILTER_DT 1.0
+
+// attitudeError - angle between the attitudes of two states (deg)
+double attitudeError(const StateVector &a, const StateVector &b)
+{
+    Vec4 qa, qb;
+    for (int i = 0; i < 4; i++) {
+        qa[i] = a[i];
+        qb[i] = b[i];
+    }
+    double d = fabs(dot(qa, qb)) / (norm(qa) * norm(qb));
+    return 2.0 * acos(fmin(d, 1.0)) * 180.0 / M_PI;
+}
+
+// pointingError - angle between the target axis and the sun (deg)
+double pointingError(const StateVector &x, const Vec3 &rTarget, const Vec3 &rSun)
+{
+    Vec4 q;
+    for (int i = 0; i < 4; i++) {
+        q[i] = x[i];
+    }
+    Vec3 sunBody = quatTrans(q, rSun);
+    double c = dot(sunBody, rTarget) / (norm(sunBody) * norm(rTarget));
+    return acos(fmax(-1.0, fmin(c, 1.0))) * 180.0 / M_PI;
+}
+
+// rate - the norm of the body rotation rate of a state (deg/s)
+double rate(const StateVector &x)
+{
+    Vec4 q, qDot;
+    for (int i = 0; i < 4; i++) {
+        q[i] = x[i];
+        qDot[i] = x[i + 4];
+    }
+    return norm(Xi(q).transpose() * qDot) * (2.0 / dot(q, q) * 180.0 / M_PI);
+}
+
+struct LoopResult {
+    double nsPerStep;
+    double timeError;
+    // the state and the dipole commanded from it every FILTER_DT
+    vector<StateVector> states;
+    vector<Vec3> dipoles;
+};
+
+// runLoop - the closed loop for the whole run in T with the time in Time.
+template <typename T, typename Time>
+LoopResult runLoop(const SimulatorConfig &config, const ControllerGains &gains, const StateVector &x0)
+{
+    typedef Matrix<T, STATE_SIZE, 1> Vector;
+    typedef Matrix<T, 3, 1> Vector3;
+
+    long steps = (long)(config.runTime / LOOP_DT + 0.5);
+    int sampleSteps = (int)(FILTER_DT / LOOP_DT + 0.5);
+
+    // the field at the loop time, found first so only the loop is timed
+    vector<Vector3> fields(steps);
+    Time t = Time(0);
+    const Time dt = Time(LOOP_DT);
+    for (long i = 0; i < steps; i++) {
+        fields[i] = matrixCast<T>(magFieldModel(config.orbit, (double)t));
+        t += dt;
+    }
+
+    StateModelT<T> model(config.inertia);
+    AttitudeControllerT<T, Time> controller(gains);
+    ControllerStateT<T, Time> state;
+    controller.reset(&state);
+    const Vector3 rSun = matrixCast<T>(config.rSun);
+    const T h = T(LOOP_DT);
+
+    LoopResult result;
+    result.states.reserve(steps / sampleSteps + 1);
+    result.dipoles.reserve(steps / sampleSteps + 1);
+
+    Vector x = matrixCast<T>(x0);
+    t = Time(0);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (long i = 0; i < steps; i++) {
+        const Vector3 &Binr = fields[i];
+        Vector3 D = controller.step(&state, x, Binr, rSun, t, i + 1);
+
+        if (i % sampleSteps == 0) {
+            result.states.push_back(matrixCast<double>(x));
+            result.dipoles.push_back(matrixCast<double>(D));
+        }
+
+        Vector k1, k2, k3, k4;
+        model.derivative(x, Binr, D, &k1);
+        model.derivative(x + k1 * (T(0.5) * h), Binr, D, &k2);
+        model.derivative(x + k2 * (T(0.5) * h), Binr, D, &k3);
+        model.derivative(x + k3 * h, Binr, D, &k4);
+        x += (k1 + T(2) * k2 + T(2) * k3 + k4) * (h / T(6));
+        normalizeQuat(x);
+        t += dt;
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    result.nsPerStep = chrono::duration<double, nano>(end - start).count() / steps;
+    result.timeError = (double)t - steps * LOOP_DT;
+    return result;
+}
+
+// one filter step of sensor readings, made in double
+struct FilterSample {
+    Vec3 Binr;
+    Vec3 D;
+    Measurement m[3];
+};
+
+struct FilterResult {
+    double nsPerStep;
+    double rmsAttitude;
+    vector<StateVector> estimates;
+    int failed;
+};
+
+// makeSamples - noisy gyro, magnetometer and sun sensor readings of the
+// double loop every FILTER_DT.
+vector<FilterSample> makeSamples(const SimulatorConfig &config, const LoopResult &truth)
+{
+    double gyroStd = 2e-3;
+    double magStd = 5e-7;
+    double sunStd = 2e-2;
+    double stds[3] = {gyroStd, magStd, sunStd};
+    Random rng(7);
+
+    vector<FilterSample> samples(truth.states.size());
+    for (size_t k = 0; k < samples.size(); k++) {
+        FilterSample &s = samples[k];
+        const StateVector &x = truth.states[k];
+        s.Binr = magFieldModel(config.orbit, k * FILTER_DT);
+        s.D = truth.dipoles[k];
+
+        MeasurementJacobian H;
+        s.m[0].type = SENSOR_GYRO;
+        gyroMeasurement(x, &s.m[0].z, &H);
+        s.m[1].type = SENSOR_MAGNETOMETER;
+        s.m[1].reference = s.Binr;
+        vectorMeasurement(x, s.Binr, &s.m[1].z, &H);
+        s.m[2].type = SENSOR_SUN;
+        s.m[2].reference = config.rSun;
+        vectorMeasurement(x, config.rSun, &s.m[2].z, &H);
+        for (int j = 0; j < 3; j++) {
+            for (int i = 0; i < 3; i++) {
+                s.m[j].z[i] += stds[j] * rng.normal();
+                s.m[j].variance[i] = stds[j] * stds[j];
+            }
+        }
+    }
+    return samples;
+}
+
+// castMeasurement - the measurement rounded to T
+template <typename T>
+MeasurementT<T> castMeasurement(const Measurement &m)
+{
+    MeasurementT<T> out;
+    out.type = m.type;
+    out.z = matrixCast<T>(m.z);
+    out.variance = matrixCast<T>(m.variance);
+    out.reference = matrixCast<T>(m.reference);
+    return out;
+}
+
+// runFilter - tracks the double loop with the filter in T with the
+// covariance in Cov, starting 10 deg and 1 deg/s off.
+template <typename T, typename Cov>
+FilterResult runFilter(const SimulatorConfig &config, const LoopResult &truth,
+                       const vector<FilterSample> &samples)
+{
+    typedef typename KalmanFilterT<T, Cov>::Covariance Covariance;
+
+    const StateVector &x0 = truth.states[0];
+    Vec4 q, qDot;
+    for (int i = 0; i < 4; i++) {
+        q[i] = x0[i];
+        qDot[i] = x0[i + 4];
+    }
+    Vec3 omega = -2.0 * (Xi(q).transpose() * qDot);
+    double halfError = 0.5 * 10.0 * M_PI / 180.0;
+    Vec4 error;
+    error[0] = sin(halfError);
+    error[3] = cos(halfError);
+    Vec4 qEst = hamMult(q, error);
+    Vec4 qDotEst = 0.5 * (Xi(qEst) * (omega + makeVec3(1.0, 1.0, 1.0) * (M_PI / 180.0)));
+    StateVector xEst;
+    for (int i = 0; i < 4; i++) {
+        xEst[i] = qEst[i];
+        xEst[i + 4] = qDotEst[i];
+    }
+
+    Covariance P0, Q;
+    for (int i = 0; i < 4; i++) {
+        P0(i, i) = Cov(1e-2);
+        P0(i + 4, i + 4) = Cov(1e-4);
+        Q(i, i) = Cov(1e-10 * FILTER_DT);
+        Q(i + 4, i + 4) = Cov(1e-9 * FILTER_DT);
+    }
+
+    StateModelT<T> model(config.inertia);
+    KalmanFilterT<T, Cov> filter(model, matrixCast<T>(xEst), P0, Q);
+
+    FilterResult result;
+    result.failed = 0;
+    result.estimates.reserve(samples.size());
+    double filterTime = 0.0;
+    double attitudeSum = 0.0;
+    size_t half = samples.size() / 2;
+
+    for (size_t k = 1; k < samples.size(); k++) {
+        const FilterSample &s = samples[k];
+        const FilterSample &previous = samples[k - 1];
+        Matrix<T, 3, 1> Binr = matrixCast<T>(previous.Binr);
+        Matrix<T, 3, 1> D = matrixCast<T>(previous.D);
+        MeasurementT<T> m[3];
+        for (int j = 0; j < 3; j++) {
+            m[j] = castMeasurement<T>(s.m[j]);
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        filter.predict(T(FILTER_DT), Binr, D);
+        result.failed += filter.update(m, 3) != 0;
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+        filterTime += chrono::duration<double, nano>(end - start).count();
+
+        StateVector estimate = matrixCast<double>(filter.getState());
+        result.estimates.push_back(estimate);
+        if (k >= half) {
+            double e = attitudeError(estimate, truth.states[k]);
+            attitudeSum += e * e;
+        }
+    }
+
+    result.nsPerStep = filterTime / (samples.size() - 1);
+    result.rmsAttitude = sqrt(attitudeSum / (samples.size() - half));
+    return result;
+}
+
+int main(void) {
+    SimulatorConfig config = defaultSimulatorConfig();
+    ControllerGains gains = defaultControllerGains();
+    StateVector x0 = defaultInitialState();
+
+    const char *names[3] = {"double", "float", "mixed"};
+    LoopResult loops[3];
+    loops[0] = runLoop<double, double>(config, gains, x0);
+    loops[1] = runLoop<float, float>(config, gains, x0);
+    loops[2] = runLoop<float, double>(config, gains, x0);
+
+    size_t hour = (size_t)(3600 / FILTER_DT);
+    cout << "loop precision ns/step timeError(s) attitudeDiff1h(deg) attitudeDiffEnd(deg) pointingEnd(deg) rateEnd(deg/s)"
+         << endl;
+    for (int p = 0; p < 3; p++) {
+        const LoopResult &r = loops[p];
+        const StateVector &end = r.states.back();
+        cout << "loop " << names[p] << " " << r.nsPerStep << " " << r.timeError << " "
+             << attitudeError(r.states[hour], loops[0].states[hour]) << " "
+             << attitudeError(end, loops[0].states.back()) << " "
+             << pointingError(end, gains.rTarget, config.rSun) << " " << rate(end) << endl;
+    }
+
+    vector<FilterSample> samples = makeSamples(config, loops[0]);
+    FilterResult filters[3];
+    filters[0] = runFilter<double, double>(config, loops[0], samples);
+    filters[1] = runFilter<float, float>(config, loops[0], samples);
+    filters[2] = runFilter<float, double>(config, loops[0], samples);
+
+    cout << "filter precision ns/step rmsAttitude(deg) maxDiffFromDouble(deg) failed" << endl;
+    for (int p = 0; p < 3; p++) {
+        const FilterResult &r = filters[p];
+        double maxDiff = 0.0;
+        for (size_t k = 0; k < r.estimates.size(); k++) {
+            maxDiff = fmax(maxDiff, attitudeError(r.estimates[k], filters[0].estimates[k]));
+        }
+        cout << "filter " << names[p] << " " << r.nsPerStep << " " << r.rmsAttitude << " "
+             << maxDiff << " " << r.failed << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  regressionHarness.cpp
+//
+// Runs the reference scenarios of Regression.hpp, compares them against the
+// golden outputs in the golden directory and writes the JSON report. Returns
+// -1 if any scenario fails on accuracy or performance. With -u the golden
+// outputs are written from this run instead, do that only for a change that
+// is meant to change the results.
+//
+// Wall time and peak RSS are only checked with -b, against a baseline
+// recorded on the same machine with -B (for example once on the CI host).
+//
+// Usage: ./regressionHarness [-u] [-g goldenDir] [-r report.json]
+//                            [-b baseline.txt] [-B baseline.txt]
+//                            [-c countTolerance] [-t timeTolerance] [-m memoryTolerance]
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include "Regression.hpp"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    bool update = false;
+    string goldenDir = "golden";
+    string reportPath = "regressionReport.json";
+    string baselinePath, recordPath;
+    RegressionLimits limits = defaultRegressionLimits();
+    for (int k = 1; k < argc; k++) {
+        bool more = k + 1 < argc;
+        if (strcmp(argv[k], "-u") == 0) {
+            update = true;
+        } else if (strcmp(argv[k], "-g") == 0 && more) {
+            goldenDir = argv[++k];
+        } else if (strcmp(argv[k], "-r") == 0 && more) {
+            reportPath = argv[++k];
+        } else if (strcmp(argv[k], "-b") == 0 && more) {
+            baselinePath = argv[++k];
+        } else if (strcmp(argv[k], "-B") == 0 && more) {
+            recordPath = argv[++k];
+        } else if (strcmp(argv[k], "-c") == 0 && more) {
+            limits.countTolerance = atof(argv[++k]);
+        } else if (strcmp(argv[k], "-t") == 0 && more) {
+            limits.timeTolerance = atof(argv[++k]);
+        } else if (strcmp(argv[k], "-m") == 0 && more) {
+            limits.memoryTolerance = atof(argv[++k]);
+        } else {
+            cout << "Usage: " << argv[0] << " [-u] [-g goldenDir] [-r report.json]"
+                 << " [-b baseline.txt] [-B baseline.txt] [-c countTolerance] [-t timeTolerance] [-m memoryTolerance]" << endl;
+            return -1;
+        }
+    }
+
+    vector<RegressionScenario> scenarios = referenceScenarios();
+    vector<RegressionRun> goldens(scenarios.size());
+    vector<RegressionRun> runs(scenarios.size());
+    vector<RegressionResult> results(scenarios.size());
+    int failed = 0;
+
+    for (size_t k = 0; k < scenarios.size(); k++) {
+        string goldenPath = goldenDir + "/" + scenarios[k].name + ".txt";
+        runRegression(scenarios[k], &runs[k]);
+        if (update) {
+            if (writeGolden(goldenPath, runs[k]) != 0) {
+                return -1;
+            }
+        }
+        readGolden(goldenPath, &goldens[k]);
+    }
+    if (!recordPath.empty() && writeBaseline(recordPath, scenarios, runs) != 0) {
+        return -1;
+    }
+    if (!baselinePath.empty() && readBaseline(baselinePath, scenarios, &goldens) != 0) {
+        return -1;
+    }
+
+    printf("%-10s %9s %12s %9s %9s %9s %12s %12s %s\n", "scenario", "wall (s)", "evaluations",
+           "steps", "rejected", "RSS (KB)", "pointing", "rate", "result");
+    for (size_t k = 0; k < scenarios.size(); k++) {
+        RegressionResult &result = results[k];
+        compareRegression(scenarios[k], goldens[k], runs[k], limits, &result);
+        const RegressionRun &run = runs[k];
+        const char *status = "PASS";
+        if (!result.accuracyPassed) {
+            status = result.performancePassed ? "FAIL accuracy" : "FAIL accuracy, performance";
+        } else if (!result.performancePassed) {
+            status = "FAIL performance";
+        }
+        failed += !result.accuracyPassed || !result.performancePassed;
+        printf("%-10s %9.3f %12ld %9ld %9ld %9ld %12.3g %12.3g %s\n", scenarios[k].name.c_str(),
+               run.wallTime, run.evaluations, run.steps, run.rejected, run.peakRSS,
+               result.pointingError, result.rateError, status);
+    }
+
+    if (writeRegressionReport(reportPath, scenarios, goldens, runs, results, limits) != 0) {
+        return -1;
+    }
+    cout << failed << " of " << scenarios.size() << " scenarios failed, report in " << reportPath << endl;
+    return failed == 0 ? 0 : -1;
+}
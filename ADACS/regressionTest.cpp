@@ -0,0 +1,175 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  regressionTest.cpp
+//
+// This is the set of test code for the regression harness.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <cmath>
+#include "Regression.hpp"
+
+using namespace std;
+
+// shortScenario - the pointing reference scenario cut to 10 min
+RegressionScenario shortScenario()
+{
+    RegressionScenario scenario = referenceScenarios()[2];
+    scenario.name = "short";
+    scenario.scenario.sim.runTime = 600;
+    return scenario;
+}
+
+int main() {
+    int numFailed = 0;
+    bool passed;
+    string goldenPath = "regressionTestGolden.txt";
+    string reportPath = "regressionTestReport.json";
+    string baselinePath = "regressionTestBaseline.txt";
+    RegressionLimits limits = defaultRegressionLimits();
+
+    cout << "TEST  - [1] Reference scenarios" << endl;
+    vector<RegressionScenario> scenarios = referenceScenarios();
+    passed = scenarios.size() == 3 && scenarios[0].name == "default" &&
+             scenarios[1].name == "detumble" && scenarios[2].name == "pointing";
+    if (passed) {
+        cout << "Passed - referenceScenarios" << endl;
+    } else {
+        cout << "Failed - referenceScenarios" << endl;
+        numFailed++;
+    }
+
+    cout << "TEST  - [2] Run and golden round trip" << endl;
+    RegressionScenario scenario = shortScenario();
+    RegressionRun run, golden;
+    passed = runRegression(scenario, &run) == 0 &&
+             run.samples.size() == 600 / REGRESSION_OUTPUT_INTERVAL + 1 &&
+             run.evaluations > 0 && run.steps > 0 && run.peakRSS > 0 &&
+             writeGolden(goldenPath, run) == 0 && readGolden(goldenPath, &golden) == 0 &&
+             golden.samples.size() == run.samples.size() && golden.evaluations == run.evaluations &&
+             golden.steps == run.steps && golden.rejected == run.rejected;
+    RegressionResult result;
+    compareRegression(scenario, golden, run, limits, &result);
+    passed = passed && result.accuracyPassed && result.performancePassed &&
+             result.pointingError < 1e-12 && result.rateError < 1e-12;
+    if (passed) {
+        cout << "Passed - golden round trip" << endl;
+    } else {
+        cout << "Failed - golden round trip" << endl;
+        numFailed++;
+    }
+
+    cout << "TEST  - [3] Accuracy regression" << endl;
+    RegressionRun perturbed = golden;
+    perturbed.samples[perturbed.samples.size() / 2].pointing += 2 * scenario.pointingTolerance;
+    compareRegression(scenario, perturbed, run, limits, &result);
+    passed = !result.accuracyPassed && result.performancePassed;
+    perturbed = golden;
+    perturbed.samples.pop_back();
+    compareRegression(scenario, perturbed, run, limits, &result);
+    passed = passed && !result.accuracyPassed;
+    if (passed) {
+        cout << "Passed - accuracy regression" << endl;
+    } else {
+        cout << "Failed - accuracy regression" << endl;
+        numFailed++;
+    }
+
+    cout << "TEST  - [4] Performance regression" << endl;
+    RegressionRun faster = golden;
+    faster.evaluations = (long)(golden.evaluations / (1.0 + 2 * limits.countTolerance));
+    compareRegression(scenario, faster, run, limits, &result);
+    passed = result.accuracyPassed && !result.performancePassed;
+    RegressionLimits unchecked = limits;
+    unchecked.countTolerance = -1;
+    compareRegression(scenario, faster, run, unchecked, &result);
+    passed = passed && result.performancePassed;
+    RegressionRun timed = run;
+    faster = golden;
+    faster.wallTime = 1.0;
+    timed.wallTime = 2.0;
+    compareRegression(scenario, faster, timed, limits, &result);
+    passed = passed && !result.performancePassed;
+    // a slower run within the timer resolution isn't a regression
+    faster.wallTime = 0.001;
+    timed.wallTime = 0.01;
+    compareRegression(scenario, faster, timed, limits, &result);
+    passed = passed && result.performancePassed;
+    // wall time and RSS aren't checked without a baseline
+    timed.wallTime = 100.0 * run.wallTime + 1.0;
+    timed.peakRSS = 100 * run.peakRSS;
+    compareRegression(scenario, golden, timed, limits, &result);
+    passed = passed && golden.wallTime < 0.0 && golden.peakRSS < 0 && result.performancePassed;
+    vector<RegressionScenario> baselineScenarios(1, scenario);
+    vector<RegressionRun> baselineRuns(1, run);
+    vector<RegressionRun> baselineGoldens(1, golden);
+    passed = passed && writeBaseline(baselinePath, baselineScenarios, baselineRuns) == 0 &&
+             readBaseline(baselinePath, baselineScenarios, &baselineGoldens) == 0 &&
+             baselineGoldens[0].peakRSS == run.peakRSS &&
+             fabs(baselineGoldens[0].wallTime - run.wallTime) <= 1e-3 * run.wallTime;
+    compareRegression(scenario, baselineGoldens[0], timed, limits, &result);
+    passed = passed && !result.performancePassed;
+    if (passed) {
+        cout << "Passed - performance regression" << endl;
+    } else {
+        cout << "Failed - performance regression" << endl;
+        numFailed++;
+    }
+
+    cout << "TEST  - [5] Missing golden and report" << endl;
+    RegressionRun missing;
+    passed = readGolden("missingGolden.txt", &missing) != 0;
+    compareRegression(scenario, missing, run, limits, &result);
+    passed = passed && !result.accuracyPassed;
+    vector<RegressionScenario> reportScenarios(1, scenario);
+    vector<RegressionRun> goldens(1, missing);
+    vector<RegressionRun> runs(1, run);
+    vector<RegressionResult> results(1, result);
+    passed = passed && writeRegressionReport(reportPath, reportScenarios, goldens, runs, results, limits) == 0;
+    ifstream in(reportPath.c_str());
+    stringstream report;
+    report << in.rdbuf();
+    passed = passed && report.str().find("\"passed\": false") != string::npos &&
+             report.str().find("\"golden\": false") != string::npos &&
+             report.str().find("\"name\": \"short\"") != string::npos;
+    if (passed) {
+        cout << "Passed - missing golden and report" << endl;
+    } else {
+        cout << "Failed - missing golden and report" << endl;
+        numFailed++;
+    }
+
+    remove(goldenPath.c_str());
+    remove(reportPath.c_str());
+    remove(baselinePath.c_str());
+
+    ////////////////////////////////////////// Print tests results
+    if (numFailed == 0) {
+        cout << "ALL Regression TESTS PASSED!" << endl;
+        return 0;
+    }
+    else {
+        cout << "FAILED - Failed " << numFailed << " Regression Test Failed..." << endl;
+        return -numFailed;
+    }
+}
@@ -0,0 +1,56 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  runScenarios.cpp
+//
+// Command line driver for the batch runner. Every job of the scenario sweep
+// is simulated and the results table is written to the output file. With a
+// trajectory directory the trajectory of every job is written there too, for
+// ./postProcess
+//
+// Usage: ./runScenarios <scenario.inca> <results.txt> [threads] [trajectoryDir]
+
+#include <iostream>
+#include <cstdlib>
+#include "BatchRunner.hpp"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " <scenario.inca> <results.txt> [threads] [trajectoryDir]" << endl;
+        return -1;
+    }
+
+    ConfigFile scenarioFile(argv[1]);
+    ScenarioSweep sweep;
+    if (scenarioFile.load() != 0 || sweep.load(scenarioFile) != 0) {
+        return -1;
+    }
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+    string trajectoryDir = argc > 4 ? argv[4] : "";
+
+    cout << "running " << sweep.size() << " jobs" << endl;
+    long failed = runBatch(sweep, argv[2], threads, trajectoryDir);
+    if (failed < 0) {
+        return -1;
+    }
+    cout << failed << " jobs failed" << endl;
+    return failed == 0 ? 0 : -1;
+}
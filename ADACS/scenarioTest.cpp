@@ -0,0 +1,190 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  scenarioTest.cpp
+//
+// This is the set of test code for the Scenario files and the BatchRunner.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cmath>
+#include "BatchRunner.hpp"
+
+using namespace std;
+
+// writeFile - writes a scenario file for the test
+void writeFile(const string &path, const string &text)
+{
+    ofstream out(path.c_str(), ios::trunc);
+    out << text;
+}
+
+// readLines - all of the lines of a file
+vector<string> readLines(const string &path)
+{
+    ifstream in(path.c_str());
+    vector<string> lines;
+    string line;
+    while (getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// loadSweep - loads a sweep from the text of a scenario file
+int loadSweep(const string &text, ScenarioSweep *sweep)
+{
+    writeFile("scenarioTest.inca", text);
+    ConfigFile file("scenarioTest.inca");
+    int ret = file.load();
+    ret += sweep->load(file);
+    remove("scenarioTest.inca");
+    return ret;
+}
+
+int main(void) {
+    int numFailed = 0;
+
+    /////////////////////////////////////////// Test 2 - sweeps
+    cout << "TEST  - [Scenario sweeps]" << endl;
+    ConfigFile example("ExampleScenario.inca");
+    ScenarioSweep sweep;
+    int ret = example.load();
+    ret += sweep.load(example);
+    ConfigFile job("");
+    ret += sweep.job(5, &job);
+    string axis, theta, rp;
+    job.getString("initAxis", &axis);
+    job.getString("initTheta", &theta);
+    job.getString("orbitRp", &rp);
+    if (ret == 0 && sweep.size() == 8 && sweep.getAxes().size() == 2 && axis == "[0, 0, 1]" &&
+        theta == "60" && rp == "6878" && sweep.job(8, &job) == -1) {
+        cout << "Passed - example sweep" << endl;
+    }
+    else { cout << "Failed - example sweep" << endl; numFailed++; }
+
+    // ranges include the end even with round off in the step
+    ScenarioSweep ranges;
+    ret = loadSweep("a = {0:0.1:1}\nb = {10:-5:0}\nc = {2:1:2}\n", &ranges);
+    vector<string> values;
+    ranges.jobValues(ranges.size() - 1, &values);
+    if (ret == 0 && ranges.size() == 11 * 3 && values[0] == "1" && values[1] == "0" && values[2] == "2") {
+        cout << "Passed - ranges" << endl;
+    }
+    else { cout << "Failed - ranges" << endl; numFailed++; }
+
+    // a sweep of 3 million jobs is only expanded one job at a time
+    ScenarioSweep large;
+    ret = loadSweep("simSeed = {1:1:1000000}\ninitAxis = {[1,0,0],[0,1,0],[0,0,1]}\n", &large);
+    large.jobValues(2999999, &values);
+    ConfigFile lastJob("");
+    ret += large.job(2999999, &lastJob);
+    long seed;
+    lastJob.getLong("simSeed", &seed);
+    if (ret == 0 && large.size() == 3000000 && values[0] == "[0,0,1]" && seed == 1000000) {
+        cout << "Passed - lazy expansion" << endl;
+    }
+    else { cout << "Failed - lazy expansion" << endl; numFailed++; }
+
+    ScenarioSweep rejected;
+    int badSweeps = loadSweep("a = {1:0:2}\n", &rejected) + loadSweep("a = {1,,2}\n", &rejected) +
+                    loadSweep("a = {5:1:0}\n", &rejected) + loadSweep("a = {[1,0]]}\n", &rejected) +
+                    loadSweep("a = {1:1:1e9}\nb = {1:1:1e9}\n", &rejected);
+    if (badSweeps == -5 && rejected.size() == 1) { cout << "Passed - bad sweeps rejected" << endl; }
+    else { cout << "Failed - bad sweeps rejected" << endl; numFailed++; }
+
+
+    /////////////////////////////////////////// Test 3 - scenarios
+    Scenario scenario = defaultScenario();
+    ConfigFile empty("");
+    ret = loadScenario(empty, &scenario);
+    bool same = true;
+    StateVector x0 = defaultInitialState();
+    for (int k = 0; k < STATE_SIZE; k++) {
+        if (fabs(scenario.x0[k] - x0[k]) > 1e-15) { same = false; }
+    }
+    ConfigFile custom("");
+    custom.setString("scInertia", "[1 2 3; 4 5 6; 7 8 9]");
+    custom.setString("initAxis", "[0, 0, 2]");
+    custom.setString("initTheta", "90");
+    custom.setString("orbitRp", "7000");
+    Scenario customScenario = defaultScenario();
+    ret += loadScenario(custom, &customScenario);
+    Scenario badScenario = defaultScenario();
+    ConfigFile badVector("");
+    badVector.setString("initOmega", "[1, 2]");
+    int badRet = loadScenario(badVector, &badScenario);
+    if (ret == 0 && badRet == -1 && same && customScenario.sim.inertia(1, 2) == 6.0 && customScenario.sim.orbit.rp == 7000 &&
+        fabs(customScenario.x0[2] - sin(M_PI / 4)) < 1e-15) {
+        cout << "Passed - load scenario" << endl;
+    }
+    else { cout << "Failed - load scenario" << endl; numFailed++; }
+
+
+    /////////////////////////////////////////// Test 4 - batch runs
+    cout << "TEST  - [Batch runner]" << endl;
+    ScenarioSweep batch;
+    ret = loadSweep("simRunTime = 120\nsimIntegrator = lie\ninitTheta = {0:30:150}\n"
+                    "initAxis = {[1, 0, 0], [0, 0, 0]}\n", &batch);
+    long failed = runBatch(batch, "scenarioTest1.txt", 1);
+    long failedThreads = runBatch(batch, "scenarioTest3.txt", 3);
+    vector<string> table = readLines("scenarioTest1.txt");
+    vector<string> tableThreads = readLines("scenarioTest3.txt");
+    remove("scenarioTest1.txt");
+    remove("scenarioTest3.txt");
+
+    // every row is in job order and matches running the job on its own
+    bool ordered = table.size() == 13 && table[0] == "# job initAxis initTheta status t steps rejected "
+                                                      "evaluations pointing rate";
+    int badJobs = 0;
+    for (uint64_t k = 0; ordered && k < batch.size(); k++) {
+        BatchResult result;
+        badJobs += runJob(batch, k, &result) != 0 && result.status == BATCH_JOB_BAD_SCENARIO;
+        istringstream row(table[k + 1]);
+        uint64_t index;
+        string axisValue, thetaValue;
+        int status;
+        double t;
+        long steps;
+        row >> index >> axisValue >> thetaValue >> status >> t >> steps;
+        if (index != k || status != result.status || steps != result.steps ||
+            fabs(t - result.t) > 1e-6 * result.t) {
+            ordered = false;
+        }
+    }
+    if (ret == 0 && failed == 6 && badJobs == 6 && ordered) { cout << "Passed - results table" << endl; }
+    else { cout << "Failed - results table" << endl; numFailed++; }
+    if (failedThreads == failed && table == tableThreads) { cout << "Passed - same table for any number of threads" << endl; }
+    else { cout << "Failed - same table for any number of threads" << endl; numFailed++; }
+
+    if (runBatch(batch, "doesNotExist/results.txt", 1) == -1) { cout << "Passed - bad results path" << endl; }
+    else { cout << "Failed - bad results path" << endl; numFailed++; }
+
+    ////////////////////////////////////////// Print tests results
+    if (numFailed == 0) {
+        cout << "ALL Scenario TESTS PASSED!" << endl;
+        return 0;
+    }
+    else {
+        cout << "FAILED - Failed " << numFailed << " Scenario Test Failed..." << endl;
+        return -numFailed;
+    }
+}
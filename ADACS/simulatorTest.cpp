@@ -0,0 +1,321 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  simulatorTest.cpp
+//
+// This is the set of test code for the OrbitModel and Simulator.
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "Simulator.hpp"
+
+using namespace std;
+
+// fixed field and dipole system for checking the integrators on their own
+class ConstantDipoleSystem : public IntegratorSystem {
+public:
+    ConstantDipoleSystem(const Mat3 &inertia) : model(inertia)
+    {
+        Binr = makeVec3(1.2e-5, -2.0e-5, 2.6e-5);
+        D = makeVec3(0.004, -0.002, 0.006);
+    }
+    // the dipole is constant, so the time isn't used
+    void derivative(double, const StateVector &x, StateVector *xDot) { model.derivative(x, Binr, D, xDot); }
+    void jacobian(double, const StateVector &x, StateMatrix *F) { model.jacobian(x, Binr, D, F); }
+
+    StateModel model;
+    Vec3 Binr;
+    Vec3 D;
+};
+
+// fixedStep - integrates 60 s with n fixed steps
+StateVector fixedStep(const Integrator *integrator, ConstantDipoleSystem &system, int n)
+{
+    double h = 60.0 / n;
+    StateVector w = defaultInitialState();
+    StateVector f, wNew, fNew;
+    double err;
+    system.derivative(0.0, w, &f);
+    for (int k = 0; k < n; k++) {
+        integrator->attempt(system, k * h, w, h, f, &wNew, &fNew, &err);
+        w = wNew;
+        f = fNew;
+    }
+    return w;
+}
+
+double maxDiff(const StateVector &a, const StateVector &b)
+{
+    double d = 0.0;
+    for (int k = 0; k < STATE_SIZE; k++) {
+        d = fmax(d, fabs(a[k] - b[k]));
+    }
+    return d;
+}
+
+// bitEqual - true if both states are exactly the same
+bool bitEqual(const SimulatorState &a, const SimulatorState &b)
+{
+    return a.t == b.t && a.h == b.h && a.i == b.i && a.rng == b.rng &&
+           memcmp(&a.w, &b.w, sizeof(a.w)) == 0 &&
+           memcmp(&a.s7, &b.s7, sizeof(a.s7)) == 0 &&
+           memcmp(&a.controller.pid.Esum, &b.controller.pid.Esum, sizeof(Vec3)) == 0;
+}
+
+int main(void) {
+    int numFailed = 0;
+
+    /////////////////////////////////////////// Test 1 - orbit and magnetic field
+    OrbitParameters orbit = defaultOrbit();
+    double maxRadiusErr = 0.0;
+    double maxFieldErr = 0.0;
+    for (int k = 0; k < 100; k++) {
+        double t = k * 97.0;
+        Vec3 r = keplOrbitModel(orbit, t);
+        Vec3 B = magFieldModel(orbit, t);
+        // dipole field magnitude B0 (Re/r)^3 sqrt(1 + 3 cos^2(theta))
+        double cosTheta = r[2] / norm(r);
+        double expected = EARTH_B0 * pow(EARTH_RADIUS / norm(r), 3) * sqrt(1 + 3 * cosTheta * cosTheta);
+        maxRadiusErr = fmax(maxRadiusErr, fabs(norm(r) - orbit.rp));
+        maxFieldErr = fmax(maxFieldErr, fabs(norm(B) - expected) / expected);
+    }
+
+    cout << "TEST  - [OrbitModel]" << endl;
+    if (maxRadiusErr < 1e-6 && maxFieldErr < 1e-12) {
+        cout << "Passed - circular orbit and dipole field" << endl;
+    } else {
+        cout << "Failed - circular orbit and dipole field" << endl;
+        numFailed++;
+    }
+    // polar orbit is over the north pole a quarter orbit after perigee
+    Vec3 rPole = keplOrbitModel(orbit, orbitPeriod(orbit) / 4);
+    if (fabs(rPole[2] - orbit.rp) < 1.0) {
+        cout << "Passed - polar orbit" << endl;
+    } else {
+        cout << "Failed - polar orbit" << endl;
+        numFailed++;
+    }
+
+
+    /////////////////////////////////////////// Test 2 - checkpoint and bit exact restart
+    SimulatorConfig config = defaultSimulatorConfig();
+    config.stateNoise = 1e-4;
+    config.seed = 7;
+    config.statusInterval = 0;
+    ControllerGains gains = defaultControllerGains();
+    double tEnd = 1200.0;
+
+    Simulator full(config, gains);
+    full.init(defaultInitialState());
+    int ret = full.run(tEnd);
+
+    Simulator first(config, gains);
+    first.init(defaultInitialState());
+    ret += first.run(tEnd / 2);
+    ret += first.saveCheckpoint("simulatorTest.ckpt");
+
+    Simulator resumed(config, gains);
+    ret += resumed.loadCheckpoint("simulatorTest.ckpt");
+    ret += resumed.run(tEnd);
+
+    cout << "TEST  - [Simulator checkpoints]" << endl;
+    cout << "steps = " << full.getState().i << " rejected = " << full.getState().rejected
+         << " evaluations = " << full.getState().evaluations << endl;
+    if (ret == 0 && bitEqual(full.getState(), resumed.getState())) {
+        cout << "Passed - bit exact restart" << endl;
+    } else {
+        cout << "Failed - bit exact restart" << endl;
+        numFailed++;
+    }
+
+    // periodic checkpoints during run()
+    Simulator periodic(config, gains);
+    periodic.init(defaultInitialState());
+    periodic.setCheckpoint("simulatorPeriodic.ckpt", 10);
+    long lastStep = 0;
+    periodic.setOutputHandler([&](const SimulatorState &s) { lastStep = s.i; });
+    ret = periodic.run(tEnd / 4);
+    SimulatorState periodicState;
+    ret += readCheckpoint("simulatorPeriodic.ckpt", config, &periodicState);
+    remove("simulatorPeriodic.ckpt");
+    if (ret == 0 && periodicState.i % 10 == 0 && periodicState.i <= lastStep &&
+        lastStep == periodic.getState().i) {
+        cout << "Passed - periodic checkpoints" << endl;
+    } else {
+        cout << "Failed - periodic checkpoints" << endl;
+        numFailed++;
+    }
+
+
+    /////////////////////////////////////////// Test 3 - bad checkpoints
+    SimulatorConfig otherConfig = config;
+    otherConfig.tolerance = 1e-9;
+    Simulator other(otherConfig, gains);
+    int badRet = other.loadCheckpoint("simulatorTest.ckpt");
+
+    // flip a byte in the payload
+    fstream corrupt("simulatorTest.ckpt", ios::in | ios::out | ios::binary);
+    corrupt.seekp(40);
+    corrupt.put(0x55);
+    corrupt.close();
+    Simulator corrupted(config, gains);
+    SimulatorState before = corrupted.getState();
+    badRet += corrupted.loadCheckpoint("simulatorTest.ckpt");
+    badRet += corrupted.loadCheckpoint("doesNotExist.ckpt");
+
+    if (badRet == -3 && bitEqual(before, corrupted.getState())) {
+        cout << "Passed - bad checkpoints rejected" << endl;
+    } else {
+        cout << "Failed - bad checkpoints rejected" << endl;
+        numFailed++;
+    }
+
+
+    /////////////////////////////////////////// Test 4 - branches from one checkpoint
+    vector<ControllerGains> variants(3, gains);
+    variants[1].Kp = Mat3::identity() * 1e-5;
+    variants[2].Kd = Mat3::identity() * 1e-4;
+    vector<SimulatorState> results;
+    int diverged = runBranches(config, first.getState(), variants, tEnd, &results, 0);
+
+    cout << "TEST  - [Simulator branches]" << endl;
+    if (diverged == 0 && bitEqual(results[0], full.getState()) &&
+        !bitEqual(results[1], full.getState()) && !bitEqual(results[2], full.getState())) {
+        cout << "Passed - branches" << endl;
+    } else {
+        cout << "Failed - branches" << endl;
+        numFailed++;
+    }
+
+    remove("simulatorTest.ckpt");
+
+
+    /////////////////////////////////////////// Test 5 - integrators
+    ConstantDipoleSystem system(config.inertia);
+    StateVector reference = fixedStep(getIntegrator(SIM_INTEGRATOR_DP45), system, 8000);
+    double lieErr = maxDiff(fixedStep(getIntegrator(SIM_INTEGRATOR_LIE_GROUP), system, 60), reference);
+    double rosErr1 = maxDiff(fixedStep(getIntegrator(SIM_INTEGRATOR_ROSENBROCK), system, 200), reference);
+    double rosErr2 = maxDiff(fixedStep(getIntegrator(SIM_INTEGRATOR_ROSENBROCK), system, 400), reference);
+
+    cout << "TEST  - [Integrators]" << endl;
+    cout << "lie error = " << lieErr << " rosenbrock error = " << rosErr1 << ", " << rosErr2 << endl;
+    if (lieErr < 1e-8 && rosErr2 < rosErr1 / 3.5 && integratorType("rosenbrock") == SIM_INTEGRATOR_ROSENBROCK &&
+        integratorType("rk4") == -1) {
+        cout << "Passed - integrator accuracy" << endl;
+    } else {
+        cout << "Failed - integrator accuracy" << endl;
+        numFailed++;
+    }
+
+    // the lie group integrator keeps q on the unit sphere without the
+    // normalization, and restarts from a checkpoint like the others.
+    SimulatorConfig lieConfig = config;
+    lieConfig.integrator = SIM_INTEGRATOR_LIE_GROUP;
+    double maxNormErr = 0.0;
+    Simulator lie(lieConfig, gains);
+    lie.init(defaultInitialState());
+    lie.setOutputHandler([&](const SimulatorState &s) {
+        double n = sqrt(s.w[0] * s.w[0] + s.w[1] * s.w[1] + s.w[2] * s.w[2] + s.w[3] * s.w[3]);
+        maxNormErr = fmax(maxNormErr, fabs(n - 1));
+    });
+    ret = lie.run(tEnd);
+
+    Simulator lieFirst(lieConfig, gains);
+    lieFirst.init(defaultInitialState());
+    ret += lieFirst.run(tEnd / 2);
+    ret += lieFirst.saveCheckpoint("simulatorTest.ckpt");
+    Simulator lieResumed(lieConfig, gains);
+    ret += lieResumed.loadCheckpoint("simulatorTest.ckpt");
+    ret += lieResumed.run(tEnd);
+    remove("simulatorTest.ckpt");
+
+    cout << "lie steps = " << lie.getState().i << " max |q| error = " << maxNormErr << endl;
+    if (ret == 0 && maxNormErr < 1e-13 && bitEqual(lie.getState(), lieResumed.getState())) {
+        cout << "Passed - lie group norm and restart" << endl;
+    } else {
+        cout << "Failed - lie group norm and restart" << endl;
+        numFailed++;
+    }
+
+    /////////////////////////////////////////// Test 6 - zero order hold controllers
+    SimulatorConfig zohConfig = config;
+    zohConfig.controlPeriod = 0.5;
+    Simulator zoh(zohConfig, gains);
+    zoh.init(defaultInitialState());
+    // no step crosses a tick and the dipole only changes at a tick
+    bool held = true;
+    long lastTick = zoh.getState().tick;
+    Vec3 lastD = zoh.getState().D;
+    zoh.setOutputHandler([&](const SimulatorState &s) {
+        if (s.t > s.tick * zohConfig.controlPeriod) { held = false; }
+        if (s.tick == lastTick && memcmp(&s.D, &lastD, sizeof(Vec3)) != 0) { held = false; }
+        lastTick = s.tick;
+        lastD = s.D;
+    });
+    ret = zoh.run(tEnd);
+    SimulatorState zohState = zoh.getState();
+
+    SimulatorConfig tightConfig = zohConfig;
+    tightConfig.tolerance = 1e-10;
+    Simulator zohTight(tightConfig, gains);
+    zohTight.init(defaultInitialState());
+    ret += zohTight.run(tEnd);
+
+    Simulator zohFirst(zohConfig, gains);
+    zohFirst.init(defaultInitialState());
+    ret += zohFirst.run(tEnd / 2);
+    ret += zohFirst.saveCheckpoint("simulatorTest.ckpt");
+    Simulator zohResumed(zohConfig, gains);
+    ret += zohResumed.loadCheckpoint("simulatorTest.ckpt");
+    ret += zohResumed.run(tEnd);
+    // a checkpoint is only for the control period it was made with
+    ret += full.loadCheckpoint("simulatorTest.ckpt") + 1;
+    remove("simulatorTest.ckpt");
+
+    double toleranceDiff = maxDiff(zohState.w, zohTight.getState().w);
+    cout << "TEST  - [Zero order hold controllers]" << endl;
+    cout << "ticks = " << zohState.tick << " evaluations = " << zohState.evaluations
+         << " max diff from tolerance 1e-10 = " << toleranceDiff << endl;
+    if (ret == 0 && held && zohState.t == tEnd && zohState.tick == (long)(tEnd / zohConfig.controlPeriod)) {
+        cout << "Passed - dipole held between ticks" << endl;
+    } else {
+        cout << "Failed - dipole held between ticks" << endl;
+        numFailed++;
+    }
+    if (toleranceDiff < 1e-5 && bitEqual(zohState, zohResumed.getState())) {
+        cout << "Passed - step independent and restart" << endl;
+    } else {
+        cout << "Failed - step independent and restart" << endl;
+        numFailed++;
+    }
+
+    ////////////////////////////////////////// Print tests results
+    if (numFailed == 0) {
+        cout << "ALL Simulator TESTS PASSED!" << endl;
+        return 0;
+    }
+    else {
+        cout << "FAILED - Failed " << numFailed << " Simulator Test Failed..." << endl;
+        return -numFailed;
+    }
+}
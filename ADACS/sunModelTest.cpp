@@ -0,0 +1,215 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  sunModelTest.cpp
+//
+// This is the set of test code for the SunModel.
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include "SunModel.hpp"
+#include "Simulator.hpp"
+#include "Quaternion.hpp"
+
+using namespace std;
+
+// checkLookup - compares the eclipse list against the direct shadow check at
+// n evenly spaced times and just inside and outside every entry and exit.
+// @return - the number of times that don't match.
+int checkLookup(const SunModel &sun, double tEnd, int n)
+{
+    vector<double> times;
+    for (int k = 0; k <= n; k++) {
+        times.push_back(tEnd * k / n);
+    }
+    const vector<EclipseInterval> &eclipses = sun.getEclipses();
+    for (size_t k = 0; k < eclipses.size(); k++) {
+        times.push_back(eclipses[k].start - 0.01);
+        times.push_back(eclipses[k].start + 0.01);
+        times.push_back(eclipses[k].end - 0.01);
+        times.push_back(eclipses[k].end + 0.01);
+    }
+
+    int mismatches = 0;
+    size_t hint = 0;
+    for (size_t k = 0; k < times.size(); k++) {
+        double t = times[k];
+        bool direct = sun.isVisibleDirect(t);
+        if (sun.isVisible(t, &hint) != direct || sun.isVisible(t) != direct) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+int main(void) {
+    int numFailed = 0;
+
+    /////////////////////////////////////////// Test 1 - solar ephemeris
+    cout << "TEST  - [Sun position]" << endl;
+    // sun at J2000 from the Astronomical Almanac, about 0.9833 AU
+    Vec3 rSun = sunPosition(J2000_JD);
+    Vec3 expected = makeVec3(0.1771, -0.8874, -0.3847);
+    double angle = acos(dot(rSun, expected) / (norm(rSun) * norm(expected))) * 180 / M_PI;
+    cout << "r = " << norm(rSun) / ASTRONOMICAL_UNIT << " AU, error = " << angle << " deg" << endl;
+    if (angle < 0.05 && fabs(norm(rSun) / ASTRONOMICAL_UNIT - 0.9833) < 1e-3) { cout << "Passed - sun position" << endl; }
+    else { cout << "Failed - sun position" << endl; numFailed++; }
+
+    Vec3 r = makeVec3(-7000.0, 0.0, 0.0);
+    Vec3 far = makeVec3(ASTRONOMICAL_UNIT, 0.0, 0.0);
+    if (illumination(r, far, SHADOW_CYLINDRICAL) == 0.0 && illumination(r, far, SHADOW_CONICAL) == 0.0 &&
+        illumination(-1.0 * r, far, SHADOW_CONICAL) == 1.0 && illumination(-1.0 * r, far, SHADOW_CYLINDRICAL) == 1.0) {
+        cout << "Passed - shadow and sun side" << endl;
+    }
+    else { cout << "Failed - shadow and sun side" << endl; numFailed++; }
+
+    // the illuminated fraction should go smoothly from 0 to 1 across the penumbra
+    bool monotone = true;
+    double last = 0.0;
+    for (int k = 0; k <= 200; k++) {
+        Vec3 p = makeVec3(-7000.0, EARTH_RADIUS - 100 + k, 0.0);
+        double f = illumination(p, far, SHADOW_CONICAL);
+        if (f < last || f < 0.0 || f > 1.0) { monotone = false; }
+        last = f;
+    }
+    if (monotone && last == 1.0) { cout << "Passed - penumbra" << endl; }
+    else { cout << "Failed - penumbra" << endl; numFailed++; }
+
+
+    /////////////////////////////////////////// Test 2 - eclipse list vs brute force
+    cout << "TEST  - [Eclipse intervals]" << endl;
+    // RAAN of 90 deg puts the sun close to the orbit plane at J2000 so the
+    // eclipses are near their longest.
+    OrbitParameters orbit = defaultOrbit();
+    orbit.RAAN = 90;
+    double tEnd = 16 * 3600;
+    SunModel cylindrical(orbit, J2000_JD, SHADOW_CYLINDRICAL, 0.0, tEnd);
+    SunModel conical(orbit, J2000_JD, SHADOW_CONICAL, 0.0, tEnd);
+
+    int mismatches = checkLookup(cylindrical, tEnd, 20000) + checkLookup(conical, tEnd, 20000);
+    if (mismatches == 0) { cout << "Passed - lookup matches the direct check" << endl; }
+    else { cout << "Failed - lookup matches the direct check (" << mismatches << ")" << endl; numFailed++; }
+
+    // one eclipse per orbit of at most 2 * asin(Re / r) / 2pi of the period
+    const vector<EclipseInterval> &ec = conical.getEclipses();
+    const vector<EclipseInterval> &ey = cylindrical.getEclipses();
+    double period = orbitPeriod(orbit);
+    double maxDuration = asin(EARTH_RADIUS / orbit.rp) / M_PI * period;
+    int expectedCount = (int)(tEnd / period);
+    bool plausible = ec.size() == ey.size() && (int)ec.size() >= expectedCount &&
+                     (int)ec.size() <= expectedCount + 1;
+    double maxDiff = 0.0;
+    for (size_t k = 0; plausible && k < ec.size(); k++) {
+        double duration = ec[k].end - ec[k].start;
+        bool full = ec[k].start > 0.0 && ec[k].end < tEnd;
+        if (full && (duration < 0.8 * maxDuration || duration > maxDuration)) { plausible = false; }
+        if (k > 0 && ec[k].start <= ec[k - 1].end) { plausible = false; }
+        maxDiff = fmax(maxDiff, fmax(fabs(ec[k].start - ey[k].start), fabs(ec[k].end - ey[k].end)));
+    }
+    cout << ec.size() << " eclipses, first " << ec[0].end - ec[0].start << " s (max "
+         << maxDuration << " s), conical vs cylindrical " << maxDiff << " s" << endl;
+    if (plausible) { cout << "Passed - eclipse durations" << endl; }
+    else { cout << "Failed - eclipse durations" << endl; numFailed++; }
+    // at 50% visible the conical edge is within a few seconds of the cylinder
+    if (maxDiff < 10.0) { cout << "Passed - conical vs cylindrical" << endl; }
+    else { cout << "Failed - conical vs cylindrical" << endl; numFailed++; }
+
+    // no eclipses with the sun 62 deg from the plane of a higher orbit
+    orbit.RAAN = 0;
+    orbit.rp = 8378;
+    SunModel noEclipse(orbit, J2000_JD, SHADOW_CONICAL, 0.0, tEnd);
+    if (noEclipse.getEclipses().empty() && checkLookup(noEclipse, tEnd, 2000) == 0) {
+        cout << "Passed - no eclipses" << endl;
+    }
+    else { cout << "Failed - no eclipses" << endl; numFailed++; }
+
+    // lookup speed, the hint makes a forward scan O(1)
+    const int lookups = 1000000;
+    size_t hint = 0;
+    int visible = 0;
+    auto start = chrono::steady_clock::now();
+    for (int k = 0; k < lookups; k++) {
+        visible += conical.isVisible(tEnd * k / lookups, &hint);
+    }
+    auto mid = chrono::steady_clock::now();
+    for (int k = 0; k < lookups / 100; k++) {
+        visible += conical.isVisibleDirect(tEnd * k / (lookups / 100));
+    }
+    auto stop = chrono::steady_clock::now();
+    cout << "lookup " << chrono::duration<double, nano>(mid - start).count() / lookups << " ns, direct "
+         << chrono::duration<double, nano>(stop - mid).count() / (lookups / 100) << " ns" << endl;
+
+
+    /////////////////////////////////////////// Test 3 - controllers in eclipse
+    cout << "TEST  - [Eclipse control]" << endl;
+    ControllerGains gains = defaultControllerGains();
+    gains.Kb = Mat3::identity() * 1e3;
+    AttitudeController controller(gains);
+    BdotController bdot(gains.Kb);
+    ControllerState state;
+    BdotState bdotState;
+    controller.reset(&state);
+    bdot.reset(&bdotState);
+
+    StateVector x = defaultInitialState();
+    Vec4 q;
+    for (int k = 0; k < 4; k++) { q[k] = x[k]; }
+    bool bdotOnly = true;
+    for (int i = 1; i <= 3; i++) {
+        Vec3 Binr = makeVec3(1.2e-5, -2.0e-5 + 1e-6 * i, 2.6e-5);
+        Vec3 D = controller.step(&state, x, Binr, Vec3(), 0.1 * i, i);
+        Vec3 Dbdot = bdot.step(&bdotState, quatTrans(q, Binr), 0.1 * i, i);
+        if (norm(Dbdot) > ADACS_MAX_DIPOLE) { Dbdot *= ADACS_MAX_DIPOLE / norm(Dbdot); }
+        if (norm(D - Dbdot) > 1e-15 || norm(state.pid.Esum) != 0.0) { bdotOnly = false; }
+    }
+    if (bdotOnly) { cout << "Passed - only B-dot in eclipse" << endl; }
+    else { cout << "Failed - only B-dot in eclipse" << endl; numFailed++; }
+
+    // a run with the ephemeris goes through the eclipses and can be restarted
+    SimulatorConfig config = defaultSimulatorConfig();
+    config.sunModel = SIM_SUN_EPHEMERIS;
+    config.orbit.RAAN = 90;
+    config.runTime = 2 * 3600;
+    config.integrator = SIM_INTEGRATOR_LIE_GROUP;
+    config.statusInterval = 0;
+    Simulator sim(config, defaultControllerGains());
+    sim.init(defaultInitialState());
+    int ret = sim.run(config.runTime);
+    SimulatorConfig fixed = config;
+    fixed.sunModel = SIM_SUN_FIXED;
+    SimulatorState loaded;
+    ret += writeCheckpoint("sunModelTest.ckpt", config, sim.getState());
+    ret += readCheckpoint("sunModelTest.ckpt", config, &loaded);
+    bool mismatch = readCheckpoint("sunModelTest.ckpt", fixed, &loaded) != 0;
+    remove("sunModelTest.ckpt");
+    if (ret == 0 && mismatch && sim.getState().t >= config.runTime) { cout << "Passed - ephemeris run" << endl; }
+    else { cout << "Failed - ephemeris run" << endl; numFailed++; }
+
+    ////////////////////////////////////////// Print tests results
+    if (numFailed == 0) {
+        cout << "ALL SunModel TESTS PASSED!" << endl;
+        return 0;
+    }
+    else {
+        cout << "FAILED - Failed " << numFailed << " SunModel Test Failed..." << endl;
+        return -numFailed;
+    }
+}
@@ -0,0 +1,115 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  telemetryBenchmark.cpp
+//
+// Benchmark of the telemetry frame encodings, the size and the time to
+// encode and decode a frame of a slow tumble.
+//
+// Output is one line per encoding:
+// encoding  bytes/frame  encode(ns/frame)  decode(ns/frame)
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include "Telemetry.hpp"
+
+using namespace std;
+
+#define BENCHMARK_FRAMES 1000
+#define BENCHMARK_PASSES 200
+
+// makeFrames - snapshots of a slow tumble at 10 Hz
+void makeFrames(vector<TelemetrySnapshot> *frames)
+{
+    Vec3 axis = makeVec3(0.3, -0.8, 0.5);
+    axis *= 1.0 / norm(axis);
+    frames->resize(BENCHMARK_FRAMES);
+    for (int k = 0; k < BENCHMARK_FRAMES; k++) {
+        TelemetrySnapshot &s = (*frames)[k];
+        double angle = 0.01 * k;
+        s.t = 0.1 * k;
+        for (int i = 0; i < 3; i++) {
+            s.q[i] = axis[i] * sin(angle / 2);
+        }
+        s.q[3] = cos(angle / 2);
+        s.omega = makeVec3(0.1 * sin(0.001 * k), 0.05, -0.02);
+        s.errors[0] = 620;
+        s.errorCount = k % 50 == 0 ? 1 : 0;
+        for (int c = 0; c < 4; c++) {
+            s.configIds[c] = (uint16_t)c;
+            s.configValues[c] = 0.5 + c + (k / 200);
+        }
+        s.configCount = 4;
+    }
+}
+
+// run - encodes and decodes every frame BENCHMARK_PASSES times.
+void run(const char *name, int encoding, int keyframeInterval,
+         const vector<TelemetrySnapshot> &frames)
+{
+    vector<uint8_t> buffer(BENCHMARK_FRAMES * TELEMETRY_MAX_FRAME);
+    vector<int> lengths(BENCHMARK_FRAMES);
+    long bytes = 0;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+        TelemetryEncoder encoder(encoding, keyframeInterval);
+        uint8_t *p = &buffer[0];
+        bytes = 0;
+        for (int k = 0; k < BENCHMARK_FRAMES; k++) {
+            lengths[k] = encoder.encode(frames[k], p, TELEMETRY_MAX_FRAME);
+            p += lengths[k];
+            bytes += lengths[k];
+        }
+    }
+    chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+
+    double sum = 0.0;
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+        TelemetryDecoder decoder;
+        TelemetrySnapshot s;
+        const uint8_t *p = &buffer[0];
+        for (int k = 0; k < BENCHMARK_FRAMES; k++) {
+            p += decoder.decode(p, lengths[k], &s);
+            // keep the compiler from removing the loop
+            sum += s.q[0];
+        }
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    if (sum == 12345.0) { cout << sum << endl; }
+
+    double count = (double)BENCHMARK_FRAMES * BENCHMARK_PASSES;
+    cout << name << " " << (double)bytes / BENCHMARK_FRAMES << " "
+         << chrono::duration<double, nano>(middle - start).count() / count << " "
+         << chrono::duration<double, nano>(end - middle).count() / count << endl;
+}
+
+int main(void) {
+    vector<TelemetrySnapshot> frames;
+    makeFrames(&frames);
+
+    cout << "encoding bytes/frame encode(ns) decode(ns)" << endl;
+    run("full", TELEMETRY_ENCODING_FULL, 1, frames);
+    run("compact", TELEMETRY_ENCODING_COMPACT, 1, frames);
+    run("compact+delta(10)", TELEMETRY_ENCODING_COMPACT, 10, frames);
+    run("compact+delta(100)", TELEMETRY_ENCODING_COMPACT, 100, frames);
+    return 0;
+}
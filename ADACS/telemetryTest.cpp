@@ -0,0 +1,247 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  telemetryTest.cpp
+//
+// This is the set of test code for the telemetry frame encoder and decoder.
+
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include "Telemetry.hpp"
+
+using namespace std;
+
+#define TEST_FRAMES 200
+
+// snapshotAt - a slow tumble with a couple of errors and config values
+TelemetrySnapshot snapshotAt(int k)
+{
+    TelemetrySnapshot s;
+    s.t = 0.1 * k;
+    double angle = 0.002 * k;
+    Vec3 axis = makeVec3(1.0, 0.5, 0.25);
+    axis *= 1.0 / norm(axis);
+    for (int i = 0; i < 3; i++) {
+        s.q[i] = axis[i] * sin(angle / 2);
+    }
+    s.q[3] = cos(angle / 2);
+    s.omega = makeVec3(0.2, -0.1 + 0.001 * k, 0.05);
+
+    s.errors[0] = 620;
+    s.errors[1] = (uint16_t)(k % 3 == 0 ? 601 : 602);
+    s.errorCount = 2;
+
+    s.configIds[0] = 0;
+    s.configIds[1] = 1;
+    s.configIds[2] = 2;
+    s.configValues[0] = 0.25;
+    s.configValues[1] = k < 100 ? 1.5 : 3.0;
+    s.configValues[2] = -12.0;
+    s.configCount = 3;
+    return s;
+}
+
+// sameFrame - two decoded snapshots are the same
+bool sameFrame(const TelemetrySnapshot &a, const TelemetrySnapshot &b)
+{
+    if (a.t != b.t || a.errorCount != b.errorCount || a.configCount != b.configCount) {
+        return false;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (a.q[i] != b.q[i]) { return false; }
+    }
+    for (int i = 0; i < 3; i++) {
+        if (a.omega[i] != b.omega[i]) { return false; }
+    }
+    for (int k = 0; k < a.errorCount; k++) {
+        if (a.errors[k] != b.errors[k]) { return false; }
+    }
+    for (int k = 0; k < a.configCount; k++) {
+        if (a.configIds[k] != b.configIds[k] || a.configValues[k] != b.configValues[k]) { return false; }
+    }
+    return true;
+}
+
+int main(void) {
+    int numFailed = 0;
+
+    /////////////////////////////////////////// Test 1 - float16
+    cout << "TEST  - [float16]" << endl;
+    bool halvesOk = true;
+    for (int h = 0; h < 0x10000; h++) {
+        // every half that is not a nan comes back the same
+        bool nan = (h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0;
+        if (!nan && floatToHalf(halfToFloat((uint16_t)h)) != h) { halvesOk = false; }
+    }
+    if (halvesOk) { cout << "Passed - every half round trips" << endl; }
+    else { cout << "Failed - every half round trips" << endl; numFailed++; }
+
+    if (floatToHalf(1.0f) == 0x3c00 && floatToHalf(-2.0f) == 0xc000 && floatToHalf(65504.0f) == 0x7bff &&
+        floatToHalf(65520.0f) == 0x7c00 && floatToHalf(1e-8f) == 0x0000 &&
+        floatToHalf(5.9604645e-8f) == 0x0001 && floatToHalf(1.0f + 1.0f / 2048) == 0x3c00 &&
+        floatToHalf(1.0f + 3.0f / 2048) == 0x3c02 && halfToFloat(floatToHalf(NAN)) != halfToFloat(floatToHalf(NAN))) {
+        cout << "Passed - rounding, overflow, subnormals and nan" << endl;
+    }
+    else { cout << "Failed - rounding, overflow, subnormals and nan" << endl; numFailed++; }
+
+
+    /////////////////////////////////////////// Test 2 - full frames
+    cout << "TEST  - [Full frames]" << endl;
+    TelemetryEncoder full(TELEMETRY_ENCODING_FULL, 10);
+    TelemetryDecoder fullDecoder;
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    TelemetrySnapshot in = snapshotAt(7), out;
+    int length = full.encode(in, frame, sizeof(frame));
+    int read = fullDecoder.decode(frame, length, &out);
+
+    bool fullOk = length == 12 + 28 + 2 * 2 + 6 * 3 + 2 && read == length &&
+                  fabs(out.t - in.t) < 1e-9 && out.errorCount == 2 && out.errors[1] == 602 &&
+                  out.configCount == 3 && out.configValues[2] == -12.0;
+    for (int i = 0; i < 4; i++) { fullOk = fullOk && out.q[i] == (double)(float)in.q[i]; }
+    for (int i = 0; i < 3; i++) { fullOk = fullOk && out.omega[i] == (double)(float)in.omega[i]; }
+    if (fullOk) { cout << "Passed - full frame round trip (" << length << " bytes)" << endl; }
+    else { cout << "Failed - full frame round trip" << endl; numFailed++; }
+
+
+    /////////////////////////////////////////// Test 3 - compact and delta frames
+    cout << "TEST  - [Compact and delta frames]" << endl;
+    TelemetryEncoder keyframes(TELEMETRY_ENCODING_COMPACT, 1);
+    TelemetryEncoder deltas(TELEMETRY_ENCODING_COMPACT, 10);
+    TelemetryDecoder keyDecoder, deltaDecoder;
+    double maxQError = 0.0, maxOmegaError = 0.0, maxConfigError = 0.0;
+    int keyBytes = 0, deltaBytes = 0, deltaFrames = 0, decodeErrors = 0;
+    bool sameAsKeyframes = true;
+
+    for (int k = 0; k < TEST_FRAMES; k++) {
+        TelemetrySnapshot s = snapshotAt(k), a, b;
+        uint8_t deltaFrame[TELEMETRY_MAX_FRAME];
+        int keyLength = keyframes.encode(s, frame, sizeof(frame));
+        int deltaLength = deltas.encode(s, deltaFrame, sizeof(deltaFrame));
+        decodeErrors += keyDecoder.decode(frame, keyLength, &a) != keyLength;
+        decodeErrors += deltaDecoder.decode(deltaFrame, deltaLength, &b) != deltaLength;
+        keyBytes += keyLength;
+        deltaBytes += deltaLength;
+        deltaFrames += (deltaFrame[3] & TELEMETRY_FLAG_DELTA) != 0;
+
+        for (int i = 0; i < 4; i++) { maxQError = fmax(maxQError, fabs(a.q[i] - s.q[i])); }
+        for (int i = 0; i < 3; i++) { maxOmegaError = fmax(maxOmegaError, fabs(a.omega[i] - s.omega[i])); }
+        for (int i = 0; i < 3; i++) {
+            maxConfigError = fmax(maxConfigError, fabs(a.configValues[i] - s.configValues[i]) / fabs(s.configValues[i]));
+        }
+        sameAsKeyframes = sameAsKeyframes && sameFrame(a, b);
+    }
+
+    cout << "bytes per frame key = " << (double)keyBytes / TEST_FRAMES << " delta = "
+         << (double)deltaBytes / TEST_FRAMES << endl;
+    if (decodeErrors == 0) { cout << "Passed - all frames decoded" << endl; }
+    else { cout << "Failed - all frames decoded" << endl; numFailed++; }
+    if (maxQError <= 0.5 / 32767 + 1e-12 && maxOmegaError <= 0.5 * TELEMETRY_OMEGA_RANGE / 32767 + 1e-12 &&
+        maxConfigError < 1.0 / 1024) {
+        cout << "Passed - quantization within half a step" << endl;
+    }
+    else { cout << "Failed - quantization within half a step" << endl; numFailed++; }
+    if (sameAsKeyframes) { cout << "Passed - delta frames decode the same as key frames" << endl; }
+    else { cout << "Failed - delta frames decode the same as key frames" << endl; numFailed++; }
+    // 9 of each 10 frames are deltas
+    if (deltaFrames == TEST_FRAMES / 10 * 9 && deltaBytes < keyBytes * 3 / 4) {
+        cout << "Passed - delta frames are smaller" << endl;
+    }
+    else { cout << "Failed - delta frames are smaller" << endl; numFailed++; }
+
+
+    /////////////////////////////////////////// Test 4 - lost and bad frames
+    cout << "TEST  - [Lost and bad frames]" << endl;
+    TelemetryEncoder encoder(TELEMETRY_ENCODING_COMPACT, 5);
+    TelemetryDecoder decoder;
+    // frames 0 to 9, frame 2 is lost
+    int results[10];
+    for (int k = 0; k < 10; k++) {
+        length = encoder.encode(snapshotAt(k), frame, sizeof(frame));
+        results[k] = k == 2 ? 0 : decoder.decode(frame, length, &out);
+    }
+    // 3 and 4 are deltas after the lost frame, 5 is the next key frame
+    if (results[1] > 0 && results[3] == -1 && results[4] == -1 && results[5] > 0 && results[6] > 0 &&
+        results[9] > 0 && fabs(out.t - 0.9) < 1e-9) {
+        cout << "Passed - deltas after a lost frame are rejected" << endl;
+    }
+    else { cout << "Failed - deltas after a lost frame are rejected" << endl; numFailed++; }
+
+    TelemetryEncoder corrupt(TELEMETRY_ENCODING_COMPACT, 1);
+    TelemetryDecoder corruptDecoder;
+    length = corrupt.encode(snapshotAt(3), frame, sizeof(frame));
+    int rejected = 0;
+    for (int k = 0; k < length; k++) {
+        frame[k] ^= 0x10;
+        rejected += corruptDecoder.decode(frame, length, &out) == -1;
+        frame[k] ^= 0x10;
+    }
+    rejected += corruptDecoder.decode(frame, length - 1, &out) == -1;
+    if (rejected == length + 1 && corruptDecoder.decode(frame, length, &out) == length) {
+        cout << "Passed - corrupt and short frames are rejected" << endl;
+    }
+    else { cout << "Failed - corrupt and short frames are rejected" << endl; numFailed++; }
+
+    // a frame that does not fit leaves the encoder as it was
+    TelemetryEncoder small(TELEMETRY_ENCODING_COMPACT, 10);
+    TelemetryDecoder smallDecoder;
+    int ret = small.encode(snapshotAt(0), frame, 10);
+    length = small.encode(snapshotAt(0), frame, sizeof(frame));
+    ret += smallDecoder.decode(frame, length, &out) == length ? 0 : -10;
+    length = small.encode(snapshotAt(1), frame, sizeof(frame));
+    ret += smallDecoder.decode(frame, length, &out) == length ? 0 : -10;
+    TelemetrySnapshot tooMany = snapshotAt(0);
+    tooMany.errorCount = TELEMETRY_MAX_ERRORS + 1;
+    ret += small.encode(tooMany, frame, sizeof(frame));
+    if (ret == -2 && (frame[3] & TELEMETRY_FLAG_DELTA)) {
+        cout << "Passed - buffer too small and too many errors" << endl;
+    }
+    else { cout << "Failed - buffer too small and too many errors" << endl; numFailed++; }
+
+
+    /////////////////////////////////////////// Test 5 - config values
+    cout << "TEST  - [Config values]" << endl;
+    ConfigFile configFile("");
+    configFile.setDouble("kp", 0.5);
+    configFile.setDouble("kd", 2.0);
+    vector<string> keys;
+    keys.push_back("kd");
+    keys.push_back("kp");
+    TelemetrySnapshot withConfig;
+    ret = readTelemetryConfig(configFile, keys, &withConfig);
+    keys.push_back("missing");
+    ret += readTelemetryConfig(configFile, keys, &withConfig) == -1 ? 0 : 1;
+    keys.pop_back();
+    ret += readTelemetryConfig(configFile, keys, &withConfig);
+    if (ret == 0 && withConfig.configCount == 2 && withConfig.configIds[1] == 1 &&
+        withConfig.configValues[0] == 2.0 && withConfig.configValues[1] == 0.5) {
+        cout << "Passed - config values read by key" << endl;
+    }
+    else { cout << "Failed - config values read by key" << endl; numFailed++; }
+
+    ////////////////////////////////////////// Print tests results
+    if (numFailed == 0) {
+        cout << "ALL Telemetry TESTS PASSED!" << endl;
+        return 0;
+    }
+    else {
+        cout << "FAILED - Failed " << numFailed << " Telemetry Test Failed..." << endl;
+        return -numFailed;
+    }
+}
@@ -0,0 +1,225 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  ukfBenchmark.cpp
+//
+// Benchmark of the EKF (KalmanFilter) and the square root UKF
+// (UnscentedKalmanFilter) tracking the tumble that INCA_Dynamics_Solution.m
+// starts from, omega = [1, 5, -30] deg/s, with the gyro, magnetometer and sun
+// sensor read every step. Both filters are given the same measurements and
+// the same initial error, 10 or 90 deg in attitude and 1 deg/s on each axis.
+// The truth is propagated with 20 RK4 steps per filter step.
+//
+// Output is one line per filter, initial error and step size:
+// filter  initial error(deg)  dt(s)  ns/step(predict+update)  rms attitude error(deg)
+// rms rate error(deg/s)  the same two over the second half of the run (after
+// the filters have converged)  failed updates
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include "KalmanFilter.hpp"
+#include "UnscentedKalmanFilter.hpp"
+#include "Quaternion.hpp"
+
+using namespace std;
+
+#define BENCHMARK_RUN_TIME 600.0
+#define TRUTH_SUBSTEPS 20
+
+// propagate - RK4 steps of the truth model.
+void propagate(const StateModel &model, StateVector *x, double dt, const Vec3 &Binr, const Vec3 &D)
+{
+    double h = dt / TRUTH_SUBSTEPS;
+    for (int s = 0; s < TRUTH_SUBSTEPS; s++) {
+        StateVector k1, k2, k3, k4;
+        model.derivative(*x, Binr, D, &k1);
+        model.derivative(*x + k1 * (0.5 * h), Binr, D, &k2);
+        model.derivative(*x + k2 * (0.5 * h), Binr, D, &k3);
+        model.derivative(*x + k3 * h, Binr, D, &k4);
+        *x += (k1 + 2.0 * k2 + 2.0 * k3 + k4) * (h / 6.0);
+        normalizeQuat(*x);
+    }
+}
+
+// attitudeError - angle between the attitudes of two states (deg)
+double attitudeError(const StateVector &a, const StateVector &b)
+{
+    Vec4 qa, qb;
+    for (int i = 0; i < 4; i++) {
+        qa[i] = a[i];
+        qb[i] = b[i];
+    }
+    double d = fabs(dot(qa, qb)) / (norm(qa) * norm(qb));
+    return 2.0 * acos(fmin(d, 1.0)) * 180.0 / M_PI;
+}
+
+// rate - the body rotation rate of a state (deg/s)
+Vec3 rate(const StateVector &x)
+{
+    Vec4 q, qDot;
+    for (int i = 0; i < 4; i++) {
+        q[i] = x[i];
+        qDot[i] = x[i + 4];
+    }
+    return (Xi(q).transpose() * qDot) * (2.0 / dot(q, q) * 180.0 / M_PI);
+}
+
+struct RunResult {
+    double nsPerStep;
+    double rmsAttitude;
+    double rmsRate;
+    double steadyAttitude;
+    double steadyRate;
+    int failed;
+};
+
+// run - tracks the tumble with one filter.
+template <typename Filter>
+RunResult run(const StateModel &model, double dt, double initialError)
+{
+    mt19937 gen(7);
+    normal_distribution<double> normal(0.0, 1.0);
+
+    double gyroStd = 2e-3;
+    double magStd = 5e-7;
+    double sunStd = 2e-2;
+    Vec3 Binr = makeVec3(1.2e-5, -2.0e-5, 2.6e-5);
+    Vec3 rSun = makeVec3(1.0, 0.0, 0.0);
+    Vec3 zero;
+
+    // tumble from INCA_Dynamics_Solution.m
+    Vec3 V = makeVec3(1.0, 0.5, 0.0);
+    V *= 1.0 / norm(V);
+    double theta = M_PI / 180.0 * 120.0;
+    Vec3 omega = makeVec3(1.0, 5.0, -30.0) * (M_PI / 180.0);
+    Vec4 q;
+    for (int i = 0; i < 3; i++) { q[i] = V[i] * sin(theta / 2); }
+    q[3] = cos(theta / 2);
+    Vec4 qDot = 0.5 * (Xi(q) * omega);
+    StateVector truth;
+    for (int i = 0; i < 4; i++) {
+        truth[i] = q[i];
+        truth[i + 4] = qDot[i];
+    }
+
+    // initialError about x off, 1 deg/s off on each axis
+    double halfError = 0.5 * initialError * M_PI / 180.0;
+    Vec4 error;
+    error[0] = sin(halfError);
+    error[3] = cos(halfError);
+    Vec4 qEst = hamMult(q, error);
+    Vec4 qDotEst = 0.5 * (Xi(qEst) * (omega + makeVec3(1.0, 1.0, 1.0) * (M_PI / 180.0)));
+    StateVector x0;
+    for (int i = 0; i < 4; i++) {
+        x0[i] = qEst[i];
+        x0[i + 4] = qDotEst[i];
+    }
+
+    StateMatrix P0, Q;
+    for (int i = 0; i < 4; i++) {
+        P0(i, i) = fmax(1e-2, sin(halfError) * sin(halfError));
+        P0(i + 4, i + 4) = 1e-4;
+        Q(i, i) = 1e-10 * dt;
+        Q(i + 4, i + 4) = 1e-9 * dt;
+    }
+    Filter filter(model, x0, P0, Q);
+
+    int steps = (int)(BENCHMARK_RUN_TIME / dt);
+    double filterTime = 0.0;
+    double attitudeSum = 0.0, rateSum = 0.0;
+    double steadyAttitudeSum = 0.0, steadyRateSum = 0.0;
+    RunResult result;
+    result.failed = 0;
+
+    for (int k = 0; k < steps; k++) {
+        propagate(model, &truth, dt, Binr, zero);
+
+        Measurement m[3];
+        MeasurementJacobian H;
+        m[0].type = SENSOR_GYRO;
+        gyroMeasurement(truth, &m[0].z, &H);
+        m[1].type = SENSOR_MAGNETOMETER;
+        m[1].reference = Binr;
+        vectorMeasurement(truth, Binr, &m[1].z, &H);
+        m[2].type = SENSOR_SUN;
+        m[2].reference = rSun;
+        vectorMeasurement(truth, rSun, &m[2].z, &H);
+        double stds[3] = {gyroStd, magStd, sunStd};
+        for (int s = 0; s < 3; s++) {
+            for (int i = 0; i < 3; i++) {
+                m[s].z[i] += stds[s] * normal(gen);
+                m[s].variance[i] = stds[s] * stds[s];
+            }
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        filter.predict(dt, Binr, zero);
+        result.failed += filter.update(m, 3) != 0;
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+        filterTime += chrono::duration<double, nano>(end - start).count();
+
+        double attitude = attitudeError(filter.getState(), truth);
+        Vec3 rateErr = rate(filter.getState()) - rate(truth);
+        attitudeSum += attitude * attitude;
+        rateSum += dot(rateErr, rateErr);
+        if (k >= steps / 2) {
+            steadyAttitudeSum += attitude * attitude;
+            steadyRateSum += dot(rateErr, rateErr);
+        }
+    }
+
+    result.nsPerStep = filterTime / steps;
+    result.rmsAttitude = sqrt(attitudeSum / steps);
+    result.rmsRate = sqrt(rateSum / steps);
+    result.steadyAttitude = sqrt(steadyAttitudeSum / (steps - steps / 2));
+    result.steadyRate = sqrt(steadyRateSum / (steps - steps / 2));
+    return result;
+}
+
+int main(void) {
+    Mat3 Inr;
+    Inr(0,0) = 0.031000;
+    Inr(1,1) = 0.031134;
+    Inr(2,2) = 0.0183645;
+    StateModel model(Inr);
+
+    double dts[3] = {0.1, 0.5, 1.0};
+    double errors[2] = {10.0, 90.0};
+
+    cout << "filter initialError dt ns/step rmsAttitude(deg) rmsRate(deg/s) steadyAttitude(deg) steadyRate(deg/s) failed"
+         << endl;
+    for (int e = 0; e < 2; e++) {
+        for (int k = 0; k < 3; k++) {
+            RunResult results[2];
+            results[0] = run<KalmanFilter>(model, dts[k], errors[e]);
+            results[1] = run<UnscentedKalmanFilter>(model, dts[k], errors[e]);
+            const char *names[2] = {"EKF", "UKF"};
+            for (int f = 0; f < 2; f++) {
+                RunResult &r = results[f];
+                cout << names[f] << " " << errors[e] << " " << dts[k] << " " << r.nsPerStep << " "
+                     << r.rmsAttitude << " " << r.rmsRate << " " << r.steadyAttitude << " "
+                     << r.steadyRate << " " << r.failed << endl;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -48,6 +48,8 @@
 #include <iostream>
 // for ERROR
 #include <ErrorManager.hpp>
+// for INSTRUMENT_TIMER
+#include <Instrumentation.hpp>
 // for string conversion methods
 #include <string>
 // for rename
@@ -58,6 +60,8 @@
 #include <cstdlib>
 
 #include <sstream>
+// for yield
+#include <thread>
 
 template <typename T>
 std::string ToString(T val)
@@ -70,9 +74,189 @@ std::string ToString(T val)
 
 // constructor for the config file
 // @param filepath to the configuration file.
-ConfigFile::ConfigFile(string path)
+ConfigFile::ConfigFile(string path) : table(new Table()), setMap(new SetMap(CONFIG_SET_MIN_CAPACITY)),
+                                      generation(0)
 {
     filepath = path;
+    readers[0] = 0;
+    readers[1] = 0;
+    saveWindow = CONFIG_SAVE_WINDOW_MS;
+    savePending = false;
+    saveStop = false;
+
+    // the base file, empty until it is loaded, and the set layer
+    Table *first = table.load();
+    shared_ptr<Layer> base(new Layer());
+    base->path = path;
+    first->layers.push_back(base);
+    first->layers.push_back(shared_ptr<Layer>(new Layer()));
+}
+
+ConfigFile::~ConfigFile()
+{
+    // the saves that are waiting are written before the writer stops
+    {
+        lock_guard<mutex> lock(saveLock);
+        saveStop = true;
+    }
+    saveWake.notify_all();
+    if (saveThread.joinable()) {
+        saveThread.join();
+    }
+    reclaim();
+    SetMap *set = setMap.load();
+    for (size_t k = 0; k < set->capacity; k++) {
+        delete set->slots[k].load();
+    }
+    delete set;
+    delete table.load();
+}
+
+// SetMap - an empty set map.
+// @param capacity - a power of 2.
+ConfigFile::SetMap::SetMap(size_t capacity) : capacity(capacity), used(0),
+                                              slots(new atomic<const SetNode *>[capacity])
+{
+    for (size_t k = 0; k < capacity; k++) {
+        slots[k].store(NULL, memory_order_relaxed);
+    }
+}
+
+// find - the slot of the key, or the empty slot it goes in. There is
+// always an empty slot, the map is at most half used.
+size_t ConfigFile::SetMap::find(const string &key) const
+{
+    size_t mask = capacity - 1;
+    size_t k = hash<string>()(key) & mask;
+    while (true) {
+        const SetNode *node = slots[k].load();
+        if (node == NULL || node->key == key) {
+            return k;
+        }
+        k = (k + 1) & mask;
+    }
+}
+
+// ReadGuard - marks a reader in the current generation. If the generation
+// moved on before the mark was made the writer may not have seen it, so it
+// is taken back and tried again.
+ConfigFile::ReadGuard::ReadGuard(const ConfigFile &config) : config(config)
+{
+    while (true) {
+        unsigned g = config.generation.load();
+        slot = g & 1;
+        config.readers[slot].fetch_add(1);
+        if (config.generation.load() == g) {
+            break;
+        }
+        config.readers[slot].fetch_sub(1);
+    }
+    table = config.table.load();
+    setMap = config.setMap.load();
+}
+
+ConfigFile::ReadGuard::~ReadGuard()
+{
+    config.readers[slot].fetch_sub(1);
+}
+
+// publish - swaps in the next table and frees the old one once nothing
+// is reading it. writeLock must be held.
+void ConfigFile::publish(Table *next)
+{
+    retiredTables.push_back(table.exchange(next));
+    reclaim();
+}
+
+// reclaim - frees what was retired once nothing can read it.
+// writeLock must be held.
+void ConfigFile::reclaim()
+{
+    // readers that start after this only see what replaced it
+    unsigned g = generation.fetch_add(1);
+    while (readers[g & 1].load() != 0) {
+        this_thread::yield();
+    }
+    for (size_t k = 0; k < retiredTables.size(); k++) {
+        delete retiredTables[k];
+    }
+    // the nodes of a map are freed on their own, a node may be in the
+    // next map too
+    for (size_t k = 0; k < retiredMaps.size(); k++) {
+        delete retiredMaps[k];
+    }
+    for (size_t k = 0; k < retiredNodes.size(); k++) {
+        delete retiredNodes[k];
+    }
+    retiredTables.clear();
+    retiredMaps.clear();
+    retiredNodes.clear();
+}
+
+// find - the variable in the set map, or else in the table.
+// @return - true if it is found.
+bool ConfigFile::find(const ReadGuard &guard, const string &varName, Value *found)
+{
+    const SetMap &set = guard.sets();
+    if (set.used != 0) {
+        const SetNode *node = set.slots[set.find(varName)].load();
+        if (node != NULL && node->set) {
+            found->value = &node->value;
+            found->arrayData = node->arrayData.data();
+            found->rows = node->rows;
+            found->cols = node->cols;
+            found->layer = CONFIG_LAYER_SET;
+            return true;
+        }
+    }
+    unordered_map<string, Entry>::const_iterator itr = guard->vars.find(varName);
+    if (itr == guard->vars.end()) {
+        return false;
+    }
+    const Entry &entry = itr->second;
+    found->value = &entry.value;
+    found->arrayData = guard->layers[entry.layer]->arrayData.data() + entry.array.offset;
+    found->rows = entry.array.rows;
+    found->cols = entry.array.cols;
+    found->layer = entry.layer;
+    return true;
+}
+
+// snapshot - a copy of the table with the set layer filled in from the set
+// map, for the callers that walk every variable.
+unique_ptr<ConfigFile::Table> ConfigFile::snapshot() const
+{
+    ReadGuard guard(*this);
+    return unique_ptr<Table>(mergeSet(*guard, guard.sets()));
+}
+
+// mergeSet - a copy of the table with the values of the set map in its set
+// layer.
+ConfigFile::Table *ConfigFile::mergeSet(const Table &current, const SetMap &set)
+{
+    Table *next = new Table(current);
+    shared_ptr<Layer> layer(new Layer());
+    for (size_t k = 0; k < set.capacity; k++) {
+        const SetNode *node = set.slots[k].load();
+        if (node == NULL || !node->set) {
+            continue;
+        }
+        layer->vars[node->key] = node->value;
+        if (node->rows != 0) {
+            ArrayValue array;
+            array.offset = layer->arrayData.size();
+            array.rows = node->rows;
+            array.cols = node->cols;
+            layer->arrayData.insert(layer->arrayData.end(), node->arrayData.begin(), node->arrayData.end());
+            layer->arrays[node->key] = array;
+        }
+    }
+    next->layers.back() = layer;
+    for (unordered_map<string, string>::const_iterator itr = layer->vars.begin();
+         itr != layer->vars.end(); ++itr) {
+        resolve(next, itr->first);
+    }
+    return next;
 }
 
 
@@ -92,6 +276,8 @@ ConfigFile::ConfigFile(string path)
 int ConfigFile::parseLine(string line, string &varName, string &value, string &comment)
 {
     short state = START_STATE;
+    // depth of the brackets in the value, spaces inside of brackets are kept
+    int depth = 0;
     //string varName;
     //string value;
 
@@ -126,14 +312,18 @@ int ConfigFile::parseLine(string line, string &varName, string &value, string &c
                 if (!(isspace(c) || c == '=')) {
                     value.push_back(c);
                     state = VALUE_NAME_STATE;
+                    if (c == '[' || c == '{') depth++;
                 }
                 break;
             case VALUE_NAME_STATE :
-                if (isspace(c) || c == '=') {
-                    if (c == '=') return -1;
+                if (c == '=') return -1;
+                if (isspace(c) && depth == 0) {
                     state = END_STATE;
                 } else {
                     value.push_back(c);
+                    if (c == '[' || c == '{') depth++;
+                    if (c == ']' || c == '}') depth--;
+                    if (depth < 0) return -1;
                 }
 
                 break;
@@ -146,6 +336,9 @@ int ConfigFile::parseLine(string line, string &varName, string &value, string &c
         } // end switch
     } // end for loop
 
+    if (depth != 0) {
+        return -1; // unclosed bracket
+    }
     if (state == VALUE_NAME_STATE || state == END_STATE) {
         //vars[varName] = value; Removed line and store instead in parameter.
         return 0; // finished line with complete statement
@@ -157,16 +350,50 @@ int ConfigFile::parseLine(string line, string &varName, string &value, string &c
 }
 
 
-// reloads the configuration file
+// reloads the configuration file and the overlays, nothing is changed
+// unless every line of every file parses.
 // @return - 0 on success, -1 on failure.
 int ConfigFile::load()
+{
+    return load(function<int(ConfigFile &)>());
+}
+
+// load - reloads the configuration file and the overlays, and only keeps
+// them if validate returns 0 for the new values. validate must not call
+// the set functions or load() of this config.
+// @param validate - checks the new config before it is swapped in.
+// @return - 0 on success, -1 on failure.
+int ConfigFile::load(const function<int(ConfigFile &)> &validate)
+{
+    INSTRUMENT_TIMER("ConfigFile::load");
+    return reloadLayers(0, getLayerCount() - 1, validate);
+}
+
+// loadLayer - reloads only one file, 0 is the base file.
+// @return - 0 on success, -1 on failure.
+int ConfigFile::loadLayer(int layer)
+{
+    return loadLayer(layer, function<int(ConfigFile &)>());
+}
+int ConfigFile::loadLayer(int layer, const function<int(ConfigFile &)> &validate)
+{
+    if (layer < 0 || layer >= getLayerCount()) {
+        ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+        return -1;
+    }
+    return reloadLayers(layer, layer, validate);
+}
+
+// parseFile - reads a file into a layer.
+// @return - 0 on success, -1 on failure.
+int ConfigFile::parseFile(Layer *layer)
 {
     ifstream iFile;
 
-    iFile.open(filepath, ios::in);
+    iFile.open(layer->path, ios::in);
     if (!iFile.is_open()) {
-        // TODO: Deal with error case of no input!
         cout << "Couldn't read file" << endl;
+        ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
         return -1;
     }
     string line;
@@ -185,7 +412,19 @@ int ConfigFile::load()
             ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
             return -1;
         } else if (ret == 0) {
-            vars[varName] = value;
+            ArrayValue array;
+            int arrayRet = parseArray(value, layer->arrayData, &array);
+            if (arrayRet < 0) {
+                ErrorManager::ERROR(CONFIG_FILE_READ_ARRAY_INVALID_VALUE);
+                return -1;
+            } else if (arrayRet == 0) {
+                layer->arrays[varName] = array;
+            } else {
+                // the elements of an array set earlier in the file are left
+                // in arrayData
+                layer->arrays.erase(varName);
+            }
+            layer->vars[varName] = value;
         }
     } // end while loop for parsing
 
@@ -193,11 +432,232 @@ int ConfigFile::load()
     return 0;
 }
 
+// resolve - finds the highest layer with the variable and updates the
+// flattened map.
+void ConfigFile::resolve(Table *next, const string &varName)
+{
+    for (int k = (int)next->layers.size() - 1; k >= 0; k--) {
+        const Layer &layer = *next->layers[k];
+        unordered_map<string, string>::const_iterator itr = layer.vars.find(varName);
+        if (itr == layer.vars.end()) {
+            continue;
+        }
+        Entry &entry = next->vars[varName];
+        entry.value = itr->second;
+        entry.layer = k;
+        unordered_map<string, ArrayValue>::const_iterator array = layer.arrays.find(varName);
+        if (array != layer.arrays.end()) {
+            entry.array = array->second;
+        } else {
+            entry.array.offset = 0;
+            entry.array.rows = 0;
+            entry.array.cols = 0;
+        }
+        return;
+    }
+    next->vars.erase(varName);
+}
+
+// reloadLayers - reloads the files first to last into a new table.
+// Only the variables in the old or new versions of those files are
+// resolved again, the rest of the flattened map is copied.
+// @return - 0 on success, -1 on failure.
+int ConfigFile::reloadLayers(int first, int last, const function<int(ConfigFile &)> &validate)
+{
+    // the files are read before the lock, the table they go into is made
+    // after, so a set call in between is not lost.
+    vector<shared_ptr<Layer> > layers;
+    for (int k = first; k <= last; k++) {
+        shared_ptr<Layer> layer(new Layer());
+        layer->path = getLayerPath(k);
+        if (parseFile(layer.get()) != 0) {
+            return -1;
+        }
+        layers.push_back(layer);
+    }
+
+    lock_guard<mutex> lock(writeLock);
+    const Table &current = *table.load();
+    Table *next = new Table(current);
+    for (int k = first; k <= last; k++) {
+        const Layer &old = *current.layers[k];
+        next->layers[k] = layers[k - first];
+        for (unordered_map<string, string>::const_iterator itr = old.vars.begin();
+             itr != old.vars.end(); ++itr) {
+            resolve(next, itr->first);
+        }
+        const Layer &loaded = *layers[k - first];
+        for (unordered_map<string, string>::const_iterator itr = loaded.vars.begin();
+             itr != loaded.vars.end(); ++itr) {
+            resolve(next, itr->first);
+        }
+    }
+
+    if (validate) {
+        // the new values, with the values of the set functions on top, are
+        // checked in a config of their own, nothing can read them from this
+        // one yet.
+        ConfigFile candidate(filepath);
+        delete candidate.table.exchange(mergeSet(*next, *setMap.load()));
+        int ret = validate(candidate);
+        if (ret != 0) {
+            ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+            delete next;
+            return -1;
+        }
+    }
+
+    publish(next);
+    return 0;
+}
+
+// addOverlay - loads a file on top of the base file and the overlays
+// added before it.
+// @param path - the overlay file.
+// @return - the layer number (1 for the first overlay) on success,
+//           -1 if the file did not load.
+int ConfigFile::addOverlay(string path)
+{
+    shared_ptr<Layer> layer(new Layer());
+    layer->path = path;
+    if (parseFile(layer.get()) != 0) {
+        return -1;
+    }
+
+    lock_guard<mutex> lock(writeLock);
+    Table *next = new Table();
+    next->layers = table.load()->layers;
+    // the set layer stays on top
+    int index = (int)next->layers.size() - 1;
+    next->layers.insert(next->layers.begin() + index, layer);
+    // the layer of every value above it moved, so all of them are resolved
+    for (size_t k = 0; k < next->layers.size(); k++) {
+        const Layer &each = *next->layers[k];
+        for (unordered_map<string, string>::const_iterator itr = each.vars.begin();
+             itr != each.vars.end(); ++itr) {
+            resolve(next, itr->first);
+        }
+    }
+    publish(next);
+    return index;
+}
+
+// getLayerCount - the number of files, the base file and the overlays.
+int ConfigFile::getLayerCount() const
+{
+    ReadGuard guard(*this);
+    return (int)guard->layers.size() - 1;
+}
+
+// getLayerPath - the path of a file, 0 is the base file.
+string ConfigFile::getLayerPath(int layer) const
+{
+    ReadGuard guard(*this);
+    if (layer < 0 || layer >= (int)guard->layers.size() - 1) {
+        return "";
+    }
+    return guard->layers[layer]->path;
+}
+
+// getSource - the layer a variable comes from, 0 for the base file,
+// 1 and up for the overlays or CONFIG_LAYER_SET for a set function.
+// @return - 0 for no error, 1 for unable to find variable in config file.
+int ConfigFile::getSource(string varName, int *layer) const
+{
+    ReadGuard guard(*this);
+    Value found;
+    if (!find(guard, varName, &found)) {
+        ErrorManager::ERROR(UNABLE_TO_FIND_VARIABLE_IN_CONFIG_FILE);
+        return 1;
+    }
+    *layer = found.layer;
+    return 0;
+}
+
+// parseArray - parses a bracketed array value and adds its elements to
+// the end of data. The elements are split by commas or spaces and the rows
+// by semicolons, every row must be the same length.
+// @return - 0 on success, 1 if it is not an array, -1 for a bad array.
+int ConfigFile::parseArray(const string &value, vector<double> &data, ArrayValue *array)
+{
+    if (value.empty() || value[0] != '[') {
+        return 1;
+    }
+
+    size_t start = data.size();
+    const char *p = value.c_str() + 1;
+    int rows = 0;
+    int cols = 0;
+    int count = 0;
+    // the last thing other than a space was a number
+    bool afterNumber = false;
+    // there was a space after the last number
+    bool spaced = false;
+
+    while (true) {
+        char c = *p;
+        if (c == ']' || c == ';') {
+            if (!afterNumber || (rows > 0 && count != cols)) {
+                break;
+            }
+            cols = count;
+            rows++;
+            count = 0;
+            afterNumber = false;
+            p++;
+            if (c == ']') {
+                if (*p != '\0') {
+                    break;
+                }
+                array->offset = start;
+                array->rows = rows;
+                array->cols = cols;
+                return 0;
+            }
+        } else if (isspace(c)) {
+            spaced = true;
+            p++;
+        } else if (c == ',') {
+            if (!afterNumber) {
+                break;
+            }
+            afterNumber = false;
+            p++;
+        } else {
+            char *next;
+            double v = strtod(p, &next);
+            if (next == p || (afterNumber && !spaced)) {
+                break;
+            }
+            data.push_back(v);
+            count++;
+            afterNumber = true;
+            spaced = false;
+            p = next;
+        }
+    }
+
+    data.resize(start);
+    return -1;
+}
+
 
 #define TEMP_CONFIG_FILE "tmp.inca"
 
 int ConfigFile::save()
 {
+    INSTRUMENT_TIMER("ConfigFile::save");
+    // the snapshot is a copy, so the config can change while the file is
+    // written.
+    unique_ptr<Table> merged = snapshot();
+    return writeFile(*merged->layers[0], *merged->layers.back());
+}
+
+// writeFile - writes the base file with the values of the set layer.
+// @return - 0 on success, -1 on failure.
+int ConfigFile::writeFile(const Layer &base, const Layer &set)
+{
+    lock_guard<mutex> lock(fileLock);
     ifstream iFile;
     ofstream oFile;
 
@@ -211,6 +671,10 @@ int ConfigFile::save()
 
     string line;
     unordered_map<string, bool> savedValues;
+    // the base file and the set layer on top of it
+    unordered_map<string, string> vars = set.vars;
+    const unordered_map<string, string> &baseVars = base.vars;
+    vars.insert(baseVars.begin(), baseVars.end());
 
     iFile.open(filepath);
     if (iFile.is_open()) {
@@ -230,7 +694,7 @@ int ConfigFile::save()
                 // valid value found
                 // ignore any values found that are not currently in the RAM config file
                 if (vars.count(varName) > 0) {
-                    oFile << varName << " = " << vars[varName] << " " << comment << endl;
+                    oFile << varName << " = " << vars.at(varName) << " " << comment << endl;
                     savedValues[varName] = true;
                 }
             } else if (ret == 1) {
@@ -248,7 +712,7 @@ int ConfigFile::save()
 
 
     // read through all values in config file, and store any new values not found
-    for (unordered_map<string, string>::iterator itr = vars.begin(); itr != vars.end(); ++itr) {
+    for (unordered_map<string, string>::const_iterator itr = vars.begin(); itr != vars.end(); ++itr) {
         if (savedValues.count(itr->first) == 0) {
             //cout << "Hasn't encountered " << itr->first << endl;
             //cout << itr->first << " = " << itr->second << "\n";
@@ -268,18 +732,267 @@ int ConfigFile::save()
     return 0;
 } // end save function
 
+// saveAsync - save() on the writer thread of the config, the caller
+// does not wait on the file.
+// @return - the result of the save, 0 on success, -1 on failure.
+future<int> ConfigFile::saveAsync()
+{
+    shared_ptr<promise<int> > result(new promise<int>());
+    saveAsync([result](int ret) {
+        result->set_value(ret);
+    });
+    return result->get_future();
+}
+
+// saveAsync - save() on the writer thread of the config.
+// @param done - called on the writer thread with the result of the save.
+void ConfigFile::saveAsync(function<void(int)> done)
+{
+    lock_guard<mutex> lock(saveLock);
+    if (!savePending) {
+        savePending = true;
+        saveFirst = chrono::steady_clock::now();
+    }
+    if (done) {
+        saveWaiters.push_back(done);
+    }
+    if (!saveThread.joinable()) {
+        saveThread = thread(&ConfigFile::saveLoop, this);
+    }
+    saveWake.notify_all();
+}
+
+// setSaveWindow - how long saveAsync() waits for more saves.
+// @param ms - 0 to write as soon as the writer is free.
+void ConfigFile::setSaveWindow(int ms)
+{
+    lock_guard<mutex> lock(saveLock);
+    saveWindow = ms;
+    saveWake.notify_all();
+}
+
+// saveLoop - the writer thread, writes the waiting saves until the config
+// is destroyed.
+void ConfigFile::saveLoop()
+{
+    unique_lock<mutex> lock(saveLock);
+    while (true) {
+        if (!savePending) {
+            if (saveStop) {
+                return;
+            }
+            saveWake.wait(lock);
+            continue;
+        }
+        // wait out the window for more saves, unless the config is going away
+        chrono::steady_clock::time_point due = saveFirst + chrono::milliseconds(saveWindow);
+        if (!saveStop && chrono::steady_clock::now() < due) {
+            saveWake.wait_until(lock, due);
+            continue;
+        }
+
+        vector<function<void(int)> > waiters;
+        waiters.swap(saveWaiters);
+        savePending = false;
+        lock.unlock();
+        int ret = save();
+        for (size_t k = 0; k < waiters.size(); k++) {
+            waiters[k](ret);
+        }
+        lock.lock();
+    }
+}
+
 
 // setString - function sets the given varName to the string given.
 // If the variable already exists, it modifies the current value.
 // If the variable does not exist, then it creates a new variable.
 // You must call the save() function after a set call before it gets saved to disk
+// A value starting with [ has to be an array.
 // @param varName - the variable name in the config file.
 // @param var - the variable to be stored
 //
-// @return - 0 for no error
+// @return - 0 for no error, -1 for a bad array.
 int ConfigFile::setString(string varName, string var) {
-    vars[varName] = var;
+    return setValue(varName, &var);
+}
 
+// clearSet - drops the value given to a set function, so the value
+// from the files is used again.
+void ConfigFile::clearSet(string varName) {
+    setValue(varName, NULL);
+}
+
+// clearSetLayer - drops every value given to the set functions, so all the
+// variables come from the files again.
+void ConfigFile::clearSetLayer() {
+    lock_guard<mutex> lock(writeLock);
+    SetMap *old = setMap.load();
+    if (old->used == 0) {
+        return;
+    }
+    setMap.store(new SetMap(CONFIG_SET_MIN_CAPACITY));
+    for (size_t k = 0; k < old->capacity; k++) {
+        const SetNode *node = old->slots[k].load();
+        if (node != NULL) {
+            retiredNodes.push_back(node);
+        }
+    }
+    retiredMaps.push_back(old);
+    reclaim();
+}
+
+// makeNode - parses the value of a set function.
+// @param value - the new value, NULL to clear it.
+// @return - 0 for no error, -1 for a bad array.
+int ConfigFile::makeNode(const string &varName, const string *value, SetNode *node) {
+    node->key = varName;
+    node->set = value != NULL;
+    node->rows = 0;
+    node->cols = 0;
+    if (value == NULL) {
+        return 0;
+    }
+    node->value = *value;
+    ArrayValue array;
+    int ret = parseArray(*value, node->arrayData, &array);
+    if (ret < 0) {
+        // it would not load again
+        ErrorManager::ERROR(CONFIG_FILE_READ_ARRAY_INVALID_VALUE);
+        return -1;
+    } else if (ret == 0) {
+        node->rows = array.rows;
+        node->cols = array.cols;
+    }
+    return 0;
+}
+
+// copySet - a copy of the set map sized for extra more values, the cleared
+// nodes are left out and retired. The copy is at most a quarter used, so
+// it is made again only after as many sets as it has values.
+// writeLock must be held.
+ConfigFile::SetMap *ConfigFile::copySet(const SetMap &old, size_t extra) {
+    size_t live = 0;
+    for (size_t k = 0; k < old.capacity; k++) {
+        const SetNode *node = old.slots[k].load();
+        if (node != NULL && node->set) {
+            live++;
+        }
+    }
+    size_t capacity = CONFIG_SET_MIN_CAPACITY;
+    while (capacity < 4 * (live + extra)) {
+        capacity *= 2;
+    }
+    SetMap *next = new SetMap(capacity);
+    for (size_t k = 0; k < old.capacity; k++) {
+        const SetNode *node = old.slots[k].load();
+        if (node == NULL) {
+            continue;
+        }
+        if (!node->set) {
+            retiredNodes.push_back(node);
+            continue;
+        }
+        next->slots[next->find(node->key)].store(node);
+        next->used++;
+    }
+    return next;
+}
+
+// setValue - swaps the node of one variable in the set map, nothing else
+// is copied. The replaced nodes are freed in batches.
+// @param value - the new value, NULL to drop it.
+// @return - 0 for no error, -1 for a bad array.
+int ConfigFile::setValue(const string &varName, const string *value) {
+    unique_ptr<SetNode> node(new SetNode());
+    if (makeNode(varName, value, node.get()) != 0) {
+        return -1;
+    }
+
+    lock_guard<mutex> lock(writeLock);
+    SetMap *set = setMap.load();
+    size_t k = set->find(varName);
+    const SetNode *old = set->slots[k].load();
+    if (old == NULL) {
+        if (value == NULL) {
+            // nothing to clear
+            return 0;
+        }
+        if ((set->used + 1) * 2 > set->capacity) {
+            SetMap *next = copySet(*set, 1);
+            setMap.store(next);
+            retiredMaps.push_back(set);
+            set = next;
+            k = set->find(varName);
+        }
+        set->used++;
+    }
+    set->slots[k].store(node.release());
+    if (old != NULL) {
+        retiredNodes.push_back(old);
+    }
+    if (!retiredMaps.empty() || retiredNodes.size() >= CONFIG_RECLAIM_BATCH) {
+        reclaim();
+    }
+    return 0;
+}
+
+// setValues - sets many variables at once, the way to make bulk edits.
+// The readers see all of the new values or none of them.
+// @param values - the variables and their new values.
+// @return - 0 for no error, -1 for a bad array, nothing is set then.
+int ConfigFile::setValues(const vector<pair<string, string> > &values) {
+    vector<pair<string, const string *> > changes;
+    changes.reserve(values.size());
+    for (size_t k = 0; k < values.size(); k++) {
+        changes.push_back(make_pair(values[k].first, &values[k].second));
+    }
+    return setValues(changes, function<int(const Table &)>());
+}
+
+// setValues - copies the set map with variables changed, all of them in one
+// swap. The cost is the size of the set map, not of the config.
+// @param values - the variables and their new values, NULL to drop one.
+// @param check - called with a snapshot() of the config before it is
+//                changed, the change is only made if it returns 0. Empty
+//                for no check.
+// @return - 0 for no error, -1 for a bad array, or what check returned.
+int ConfigFile::setValues(const vector<pair<string, const string *> > &values,
+                          const function<int(const Table &)> &check) {
+    vector<unique_ptr<SetNode> > nodes(values.size());
+    for (size_t k = 0; k < values.size(); k++) {
+        nodes[k].reset(new SetNode());
+        if (makeNode(values[k].first, values[k].second, nodes[k].get()) != 0) {
+            return -1;
+        }
+    }
+
+    lock_guard<mutex> lock(writeLock);
+    SetMap *old = setMap.load();
+    if (check) {
+        unique_ptr<Table> current(mergeSet(*table.load(), *old));
+        int ret = check(*current);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    SetMap *next = copySet(*old, values.size());
+    for (size_t k = 0; k < nodes.size(); k++) {
+        size_t slot = next->find(nodes[k]->key);
+        const SetNode *replaced = next->slots[slot].load();
+        if (replaced != NULL) {
+            retiredNodes.push_back(replaced);
+        } else if (!nodes[k]->set) {
+            // nothing to clear
+            continue;
+        } else {
+            next->used++;
+        }
+        next->slots[slot].store(nodes[k].release());
+    }
+    setMap.store(next);
+    retiredMaps.push_back(old);
+    reclaim();
     return 0;
 }
 // setDouble function sets the given varName to the variable given, but it must
@@ -292,19 +1005,73 @@ int ConfigFile::setString(string varName, string var) {
 //
 // @return - 0 for no error
 int ConfigFile::setDouble(string varName, double var) {
-    vars[varName] = ToString(var);
-
-    return 0;
+    return setString(varName, ToString(var));
 }
 int ConfigFile::setInt(string varName, int var) {
-    vars[varName] = ToString(var);
-
-    return 0;
+    return setString(varName, ToString(var));
 }
 int ConfigFile::setLong(string varName, long var) {
-   vars[varName] = ToString(var);
+   return setString(varName, ToString(var));
+}
 
-   return 0;
+// setArray - stores a rows x cols array given in row order.
+// The elements are written with enough digits to read back the same value.
+// @return - 0 for no error
+int ConfigFile::setArray(string varName, const double *var, int rows, int cols) {
+    return setString(varName, formatArray(var, rows, cols));
+}
+
+// formatArray - the value of a rows x cols array given in row order, with
+// enough digits to read back the same elements.
+string ConfigFile::formatArray(const double *var, int rows, int cols) {
+    string value = "[";
+    for (int i = 0; i < rows * cols; i++) {
+        if (i > 0) {
+            value += (i % cols == 0) ? "; " : ", ";
+        }
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.15g", var[i]);
+        if (strtod(buffer, NULL) != var[i]) {
+            snprintf(buffer, sizeof(buffer), "%.17g", var[i]);
+        }
+        value += buffer;
+    }
+    value += "]";
+    return value;
+}
+int ConfigFile::setVec3(string varName, const double var[3]) {
+    return setArray(varName, var, 1, 3);
+}
+int ConfigFile::setMat3(string varName, const double var[9]) {
+    return setArray(varName, var, 3, 3);
+}
+
+// contains - checks if the variable is in the config file without
+// posting an error when it is missing.
+bool ConfigFile::contains(string varName) const {
+    ReadGuard guard(*this);
+    Value found;
+    return find(guard, varName, &found);
+}
+
+// getKeys - all of the variable names in the config file, in no order.
+vector<string> ConfigFile::getKeys() const {
+    ReadGuard guard(*this);
+    const unordered_map<string, Entry> &vars = guard->vars;
+    const SetMap &set = guard.sets();
+    vector<string> keys;
+    keys.reserve(vars.size() + set.used);
+    for (unordered_map<string, Entry>::const_iterator itr = vars.begin(); itr != vars.end(); ++itr) {
+        keys.push_back(itr->first);
+    }
+    // the set values that are not in the files
+    for (size_t k = 0; k < set.capacity; k++) {
+        const SetNode *node = set.slots[k].load();
+        if (node != NULL && node->set && vars.count(node->key) == 0) {
+            keys.push_back(node->key);
+        }
+    }
+    return keys;
 }
 
 // getString - function finds the given varName and returns the string version of the value.
@@ -313,12 +1080,14 @@ int ConfigFile::setLong(string varName, long var) {
 //
 // @return - 0 for no error, 1 for unable to find variable in config file.
 int ConfigFile::getString(string varName, string *var) {
-    if (vars.count(varName) != 1) {
+    ReadGuard guard(*this);
+    Value found;
+    if (!find(guard, varName, &found)) {
         ErrorManager::ERROR(UNABLE_TO_FIND_VARIABLE_IN_CONFIG_FILE);
         return 1;
     }
 
-    *var = vars[varName];
+    *var = *found.value;
 
     return 0;
 }
@@ -451,11 +1220,98 @@ int ConfigFile::getLong(string varName, long *var) {
    return 0;
 }
 
+// getArrayData - the parsed array without a copy, the pointer is good
+// until the next load() or set call.
+// @return - 0 for no error, 1 for unable to find variable in config file,
+//           2 - the value is not an array.
+int ConfigFile::getArrayData(string varName, const double **data, int *rows, int *cols) {
+    ReadGuard guard(*this);
+    return getArrayData(guard, varName, data, rows, cols);
+}
+
+// getArrayData - the array of a variable.
+int ConfigFile::getArrayData(const ReadGuard &guard, const string &varName, const double **data,
+                             int *rows, int *cols) {
+    Value found;
+    if (!find(guard, varName, &found)) {
+        ErrorManager::ERROR(UNABLE_TO_FIND_VARIABLE_IN_CONFIG_FILE);
+        return 1;
+    }
+    if (found.rows == 0) {
+        ErrorManager::ERROR(CONFIG_FILE_READ_ARRAY_INVALID_VALUE);
+        return 2;
+    }
+
+    *data = found.arrayData;
+    *rows = found.rows;
+    *cols = found.cols;
+    return 0;
+}
+
+// getArray - every element of the array in row order.
+// @return - 0 for no error, 1 for unable to find variable in config file,
+//           2 - the value is not an array.
+int ConfigFile::getArray(string varName, vector<double> *var) {
+    ReadGuard guard(*this);
+    const double *data;
+    int rows, cols;
+    int ret = getArrayData(guard, varName, &data, &rows, &cols);
+    if (ret != 0) {
+        return ret;
+    }
+    var->assign(data, data + rows * cols);
+    return 0;
+}
+
+// getVec3 - any array of 3 elements (row or column).
+// @return - 0 for no error, 1 for unable to find variable in config file,
+//           2 - the value is not an array of 3 elements.
+int ConfigFile::getVec3(string varName, double var[3]) {
+    ReadGuard guard(*this);
+    const double *data;
+    int rows, cols;
+    int ret = getArrayData(guard, varName, &data, &rows, &cols);
+    if (ret != 0) {
+        return ret;
+    }
+    if (rows * cols != 3) {
+        ErrorManager::ERROR(CONFIG_FILE_READ_ARRAY_WRONG_SIZE);
+        return 2;
+    }
+    for (int i = 0; i < 3; i++) {
+        var[i] = data[i];
+    }
+    return 0;
+}
+
+// getMat3 - a 3x3 array in row order.
+// @return - 0 for no error, 1 for unable to find variable in config file,
+//           2 - the value is not a 3x3 array.
+int ConfigFile::getMat3(string varName, double var[9]) {
+    ReadGuard guard(*this);
+    const double *data;
+    int rows, cols;
+    int ret = getArrayData(guard, varName, &data, &rows, &cols);
+    if (ret != 0) {
+        return ret;
+    }
+    if (rows != 3 || cols != 3) {
+        ErrorManager::ERROR(CONFIG_FILE_READ_ARRAY_WRONG_SIZE);
+        return 2;
+    }
+    for (int i = 0; i < 9; i++) {
+        var[i] = data[i];
+    }
+    return 0;
+}
+
 // this function will go through the map and output all of the key-value pairs
 // this probably shouldn't be called in flight.
 void ConfigFile::print() {
-    for (unordered_map<string, string>::iterator itr = vars.begin(); itr != vars.end(); ++itr) {
-        cout << "key: " << itr->first << " value: " << itr->second << endl;
+    unique_ptr<Table> merged = snapshot();
+    const unordered_map<string, Entry> &vars = merged->vars;
+    for (unordered_map<string, Entry>::const_iterator itr = vars.begin(); itr != vars.end(); ++itr) {
+        cout << "key: " << itr->first << " value: " << itr->second.value << endl;
     }
 }
 
@@ -474,6 +1330,8 @@ void ConfigFile::print() {
 // @return true if it passes, false if it fails.
 bool ConfigFile::checkElementsAndKeys(string *keys, string *values, int length)
 {
+    unique_ptr<Table> merged = snapshot();
+    const unordered_map<string, Entry> &vars = merged->vars;
     if ((unsigned int)length != vars.size()) {
         cout << "ERROR: ConfigFile Test: map size = " << vars.size() << " test length = " << length << " do not match..." << endl;
         return false;
@@ -484,7 +1342,7 @@ bool ConfigFile::checkElementsAndKeys(string *keys, string *values, int length)
             return false;
         }
         //cout << "vars[keys[i]] = " << vars[keys[i]] << " values[i] = " << values[i] << std::endl;
-        if (vars[keys[i]] != values[i]) {
+        if (vars.at(keys[i]).value != values[i]) {
             cout << "ERROR: ConfigFile Test: The values in map do not match..." << endl;
             return false;
         }
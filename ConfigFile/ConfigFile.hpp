@@ -27,6 +27,40 @@
 // if another data type is requried.
 // The class can handle both loading and saving to the config file.
 //
+// Vectors and matrices are written as bracketed arrays, with the elements
+// split by commas or spaces and the rows split by semicolons like MATLAB:
+//
+// rTarget = [0, 0, 1]
+// Kp = [1e-6 0 0; 0 1e-6 0; 0 0 1e-6]
+//
+// Arrays are parsed once when they are loaded (or set) and kept as doubles
+// back to back in a single buffer, so reading one is a lookup and a copy.
+//
+// A config is a stack of layers, the base file, any overlay files added on
+// top of it (per unit or per mission values), and the values given to the
+// set functions on top of everything. A variable comes from the highest layer
+// that has it, getSource() tells which one. The result for every file variable
+// is kept in a single flattened map, so a get is a lookup in the set map and
+// one in the flattened map however many layers there are, and reloading a
+// layer only looks again at the variables of that layer.
+//
+// The flattened map and the layers are never changed once they are in use.
+// load() builds a new table and swaps it in, so a file that does not parse
+// leaves the old values alone, and the gets never wait on a lock while
+// another thread reloads the file (see ConfigWatcher). The set functions do
+// not touch the table, they swap one slot of the set map, so a set costs the
+// same however big the config is. setValues() changes many variables in one
+// swap and is the way to make bulk edits.
+//
+// A set value wins over the files until it is cleared, also over an edit of
+// the file that is loaded later by load(), loadLayer() or a ConfigWatcher,
+// and save() does not clear it. Use clearSet() or clearSetLayer() to go back
+// to the values of the files.
+//
+// saveAsync() does the save on a writer thread of the config, so a control
+// thread that changes a value does not wait on the flash. Saves asked for
+// close together are written once.
+//
 // Example code for use is shown below:
 //
 // ConfigFile config("pathToConfigFile");
@@ -39,6 +73,14 @@
 // }
 //
 // // x should now have value that was stored in config file
+//
+// // values in the overlay are used in place of the base file
+// config.addOverlay("pathToUnitConfigFile");
+//
+// double Kp[9];
+// if (config.getMat3("Kp", Kp) != 0) {
+// // handle error of no Kp, or Kp is not 3x3
+// }
 
 #ifndef ConfigFile_hpp
 #define ConfigFile_hpp
@@ -46,10 +88,29 @@
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <condition_variable>
+#include <future>
+#include <chrono>
 
 
 using namespace std;
 
+// the layer of the values given to the set functions, see getSource()
+#define CONFIG_LAYER_SET -1
+
+// ms saveAsync() waits for more saves before it writes the file
+#define CONFIG_SAVE_WINDOW_MS 20
+
+// the slots of a new set map
+#define CONFIG_SET_MIN_CAPACITY 16
+// the replaced set values that are kept before they are freed together
+#define CONFIG_RECLAIM_BATCH 64
+
 template <typename T>
 std::string ToString(T val);
 
@@ -59,11 +120,65 @@ public:
     // constructor for the config file
     // @param filepath to the configuration file.
     ConfigFile(string path);
+    ~ConfigFile();
 
-    // reloads the configuration file
+    // reloads the configuration file and the overlays, nothing is changed
+    // unless every line of every file parses.
     // @return - 0 on success, -1 on failure.
     int load();
+    // load - reloads the configuration file and the overlays, and only keeps
+    // them if validate returns 0 for the new values. validate must not call
+    // the set functions or load() of this config.
+    // @param validate - checks the new config before it is swapped in.
+    // @return - 0 on success, -1 on failure.
+    int load(const function<int(ConfigFile &)> &validate);
+    // save - writes the base file with the values of the set functions,
+    // the values of the overlays are not written.
     int save();
+    // saveAsync - save() on the writer thread of the config, the caller
+    // does not wait on the file. The saves asked for within the save window
+    // of the first one are written once, with the values at the time of the
+    // write. A failed save posts its error like save() does.
+    // @return - the result of the save, 0 on success, -1 on failure.
+    future<int> saveAsync();
+    // @param done - called on the writer thread with the result of the save.
+    void saveAsync(function<void(int)> done);
+    // setSaveWindow - how long saveAsync() waits for more saves.
+    // @param ms - 0 to write as soon as the writer is free.
+    void setSaveWindow(int ms);
+
+    // addOverlay - loads a file on top of the base file and the overlays
+    // added before it.
+    // @param path - the overlay file.
+    // @return - the layer number (1 for the first overlay) on success,
+    //           -1 if the file did not load.
+    int addOverlay(string path);
+
+    // loadLayer - reloads only one file, 0 is the base file.
+    // @return - 0 on success, -1 on failure.
+    int loadLayer(int layer);
+    int loadLayer(int layer, const function<int(ConfigFile &)> &validate);
+
+    // getLayerCount - the number of files, the base file and the overlays.
+    int getLayerCount() const;
+    // getLayerPath - the path of a file, 0 is the base file.
+    string getLayerPath(int layer) const;
+
+    // getSource - the layer a variable comes from, 0 for the base file,
+    // 1 and up for the overlays or CONFIG_LAYER_SET for a set function.
+    // @return - 0 for no error, 1 for unable to find variable in config file.
+    int getSource(string varName, int *layer) const;
+
+    // clearSet - drops the value given to a set function, so the value
+    // from the files is used again.
+    void clearSet(string varName);
+
+    // clearSetLayer - drops every value given to the set functions, so all
+    // the variables come from the files again.
+    void clearSetLayer();
+
+    // getPath - the path of the configuration file.
+    string getPath() const { return filepath; }
 
     // getString - function finds the given varName and returns the string version of the value.
     // @param varName - the variable name in the config file.
@@ -87,11 +202,42 @@ public:
     int getHex(string varName, int *var);
     int getLong(string varName, long *var);
 
+    // array get functions, these return 2 if the value is not an array or
+    // does not have the number of elements asked for.
+    // getVec3 - any array of 3 elements.
+    // getMat3 - a 3x3 array in row order.
+    // getArray - every element of the array in row order.
+    // getArrayData - the parsed array without a copy, the pointer is good
+    //                until the next load() or set call, so it should not be
+    //                used while a ConfigWatcher is running.
+    int getVec3(string varName, double var[3]);
+    int getMat3(string varName, double var[9]);
+    int getArray(string varName, vector<double> *var);
+    template <typename T>
+    int getArray(string varName, vector<T> *var);
+    int getArrayData(string varName, const double **data, int *rows, int *cols);
+
     // set function, these will change the variable given
     int setDouble(string varName, double var);
     int setString(string varName, string var);
     int setInt(string varName, int var);
     int setLong(string varName, long var);
+    int setVec3(string varName, const double var[3]);
+    int setMat3(string varName, const double var[9]);
+    // setArray - stores a rows x cols array given in row order.
+    int setArray(string varName, const double *var, int rows, int cols);
+    // setValues - sets many variables at once, the way to make bulk edits.
+    // The readers see all of the new values or none of them.
+    // @param values - the variables and their new values.
+    // @return - 0 for no error, -1 for a bad array, nothing is set then.
+    int setValues(const vector<pair<string, string> > &values);
+
+    // contains - checks if the variable is in the config file without
+    // posting an error when it is missing.
+    bool contains(string varName) const;
+
+    // getKeys - all of the variable names in the config file, in no order.
+    vector<string> getKeys() const;
 
     // this function will go through the map and output all of the key-value pairs
     // this probably shouldn't be called in flight.
@@ -110,11 +256,209 @@ public:
     bool checkElementsAndKeys(string *keys, string *values, int length);
 
 private:
-    // map of variables.
-    unordered_map<string, string> vars;
+    // publishes the table to shared memory
+    friend class ConfigSegment;
+    // makes and applies patches against the table
+    friend class ConfigPatch;
+
+    // where a parsed array is in arrayData
+    struct ArrayValue {
+        size_t offset;
+        int rows;
+        int cols;
+    };
+
+    // the variables of one file, or of the set functions.
+    struct Layer {
+        string path;
+        // map of variables.
+        unordered_map<string, string> vars;
+        // the variables that are arrays
+        unordered_map<string, ArrayValue> arrays;
+        // elements of all of the arrays back to back.
+        vector<double> arrayData;
+    };
+
+    // the value a variable resolved to
+    struct Entry {
+        string value;
+        // index of the layer in the table
+        int layer;
+        // where the array is in the arrayData of the layer, rows is 0 if the
+        // value is not an array.
+        ArrayValue array;
+    };
+
+    // one version of the variables, it is not changed once it is published.
+    struct Table {
+        // the base file, the overlays and last the set layer. A layer that is
+        // not reloaded is shared by the next table.
+        vector<shared_ptr<const Layer> > layers;
+        // the flattened map of variables.
+        unordered_map<string, Entry> vars;
+    };
+
+    // a value given to a set function, it is not changed once it is in the
+    // set map.
+    struct SetNode {
+        string key;
+        // false once the value is cleared, the files are used again
+        bool set;
+        string value;
+        // the parsed array, rows is 0 if the value is not an array.
+        vector<double> arrayData;
+        int rows;
+        int cols;
+    };
+
+    // the values of the set functions, open addressing with linear probing.
+    // A set swaps the node in one slot. A slot is not emptied again, a
+    // cleared value keeps its slot until the map is copied.
+    struct SetMap {
+        SetMap(size_t capacity);
+        // find - the slot of the key, or the empty slot it goes in.
+        size_t find(const string &key) const;
+        // a power of 2, at least twice used
+        size_t capacity;
+        // the slots with a node, cleared ones too
+        size_t used;
+        unique_ptr<atomic<const SetNode *>[]> slots;
+    };
+
+    // ReadGuard - keeps the current table and set map, and the nodes in
+    // it, from being freed while they are read. A reader marks itself in the
+    // count of the current generation, a writer that retired something moves
+    // to the next generation and then waits for the count of the old one to
+    // drain before freeing it.
+    class ReadGuard {
+    public:
+        ReadGuard(const ConfigFile &config);
+        ~ReadGuard();
+        const Table *operator->() const { return table; }
+        const Table &operator*() const { return *table; }
+        const SetMap &sets() const { return *setMap; }
+    private:
+        const ConfigFile &config;
+        const Table *table;
+        const SetMap *setMap;
+        unsigned slot;
+    };
+
+    // where a get found a variable
+    struct Value {
+        const string *value;
+        // the array, rows is 0 if the value is not an array
+        const double *arrayData;
+        int rows;
+        int cols;
+        // the layer of the table, or CONFIG_LAYER_SET
+        int layer;
+    };
+
+    // the current table, the files without the values of the set functions
+    atomic<Table *> table;
+    // the values of the set functions
+    atomic<SetMap *> setMap;
+    // generation of the table and the readers in the last two generations
+    mutable atomic<unsigned> generation;
+    mutable atomic<int> readers[2];
+    // only one writer changes the table or the set map at a time
+    mutex writeLock;
+    // swapped out, freed by reclaim() once nothing can read them.
+    // writeLock must be held.
+    vector<Table *> retiredTables;
+    vector<SetMap *> retiredMaps;
+    vector<const SetNode *> retiredNodes;
 
     string filepath;
 
+    // only one save writes the file at a time
+    mutex fileLock;
+
+    // the saveAsync() writer, started by the first saveAsync()
+    thread saveThread;
+    mutex saveLock;
+    condition_variable saveWake;
+    // a save is waiting to be written, and the callbacks of those saves
+    bool savePending;
+    vector<function<void(int)> > saveWaiters;
+    // when the first waiting save was asked for
+    chrono::steady_clock::time_point saveFirst;
+    int saveWindow;
+    bool saveStop;
+
+    // ConfigFile is not copied, the readers hold on to the table.
+    ConfigFile(const ConfigFile &);
+    ConfigFile &operator=(const ConfigFile &);
+
+    // publish - swaps in the next table and frees the old one once nothing
+    // is reading it. writeLock must be held.
+    void publish(Table *next);
+
+    // reclaim - frees what was retired once nothing can read it.
+    // writeLock must be held.
+    void reclaim();
+
+    // find - the variable in the set map, or else in the table.
+    // @return - true if it is found.
+    static bool find(const ReadGuard &guard, const string &varName, Value *found);
+
+    // snapshot - a copy of the table with the set layer filled in from the
+    // set map, for the callers that walk every variable.
+    unique_ptr<Table> snapshot() const;
+
+    // mergeSet - a copy of the table with the values of the set map in its
+    // set layer.
+    static Table *mergeSet(const Table &current, const SetMap &set);
+
+    // copySet - a copy of the set map sized for extra more values, the
+    // cleared nodes are left out and retired. writeLock must be held.
+    SetMap *copySet(const SetMap &old, size_t extra);
+
+    // makeNode - parses the value of a set function.
+    // @param value - the new value, NULL to clear it.
+    // @return - 0 for no error, -1 for a bad array.
+    static int makeNode(const string &varName, const string *value, SetNode *node);
+
+    // saveLoop - the writer thread, writes the waiting saves until the
+    // config is destroyed.
+    void saveLoop();
+
+    // writeFile - writes the base file with the values of the set layer.
+    // @return - 0 on success, -1 on failure.
+    int writeFile(const Layer &base, const Layer &set);
+
+    // setValue - swaps the node of one variable in the set map.
+    // @param value - the new value, NULL to drop it.
+    // @return - 0 for no error, -1 for a bad array.
+    int setValue(const string &varName, const string *value);
+
+    // setValues - copies the set map with variables changed, all of them in
+    // one swap.
+    // @param values - the variables and their new values, NULL to drop one.
+    // @param check - called with a snapshot() of the config before it is
+    //                changed, the change is only made if it returns 0. Empty
+    //                for no check.
+    // @return - 0 for no error, -1 for a bad array, or what check returned.
+    int setValues(const vector<pair<string, const string *> > &values,
+                  const function<int(const Table &)> &check);
+
+    // reloadLayers - reloads the files first to last into a new table.
+    // @return - 0 on success, -1 on failure.
+    int reloadLayers(int first, int last, const function<int(ConfigFile &)> &validate);
+
+    // parseFile - reads a file into a layer.
+    // @return - 0 on success, -1 on failure.
+    int parseFile(Layer *layer);
+
+    // resolve - finds the highest layer with the variable and updates the
+    // flattened map.
+    static void resolve(Table *next, const string &varName);
+
+    // getArrayData - the array of a variable.
+    static int getArrayData(const ReadGuard &guard, const string &varName, const double **data,
+                            int *rows, int *cols);
+
 
 
     // parseLine - parses a single line of the file
@@ -125,6 +469,28 @@ private:
     // @return - 0 if it completes with a valid statement, 1 if it parses correctly without a statement,
     //           -1 if it fails to parse
     int parseLine(string line, string &varName, string &value, string &comment);
+
+    // parseArray - parses a bracketed array value and adds its elements to
+    // the end of data.
+    // @return - 0 on success, 1 if it is not an array, -1 for a bad array.
+    static int parseArray(const string &value, vector<double> &data, ArrayValue *array);
+
+    // formatArray - the value of a rows x cols array given in row order, with
+    // enough digits to read back the same elements.
+    static string formatArray(const double *var, int rows, int cols);
 };
 
+// getArray - every element of the array in row order, converted to T.
+template <typename T>
+int ConfigFile::getArray(string varName, vector<T> *var)
+{
+    vector<double> data;
+    int ret = getArray(varName, &data);
+    if (ret != 0) {
+        return ret;
+    }
+    var->assign(data.begin(), data.end());
+    return 0;
+}
+
 #endif /* ConfigFile_hpp */
@@ -0,0 +1,529 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  ConfigPatch.cpp
+//
+// Binary patches of a config for the uplink.
+
+#include "ConfigPatch.hpp"
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define PATCH_MAGIC_0 'C'
+#define PATCH_MAGIC_1 'P'
+#define PATCH_HEADER_SIZE 19
+#define PATCH_CHECK_SIZE 4
+
+// value types
+#define PATCH_STRING 0
+#define PATCH_INT 1
+#define PATCH_FLOAT 2
+#define PATCH_DOUBLE 3
+#define PATCH_ARRAY 4
+// the type byte has this bit set when the name is sent
+#define PATCH_NAMED 0x80
+
+// fnv1a32 - 32 bit FNV-1a, for the key ids and the check of a patch
+static uint32_t fnv1a32(const uint8_t *data, size_t length)
+{
+    uint32_t hash = 0x811c9dc5;
+    for (size_t k = 0; k < length; k++) {
+        hash ^= data[k];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+// fnv1a64 - 64 bit FNV-1a, for the version
+static uint64_t fnv1a64(const void *data, size_t length, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t k = 0; k < length; k++) {
+        hash ^= bytes[k];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// writes to the end of a patch
+static void putVarint(vector<uint8_t> *out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out->push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out->push_back((uint8_t)value);
+}
+
+static void putBytes(vector<uint8_t> *out, uint64_t value, int bytes)
+{
+    for (int k = 0; k < bytes; k++) {
+        out->push_back((uint8_t)(value >> (8 * k)));
+    }
+}
+
+static void putFloat(vector<uint8_t> *out, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putBytes(out, bits, 4);
+}
+
+static void putDouble(vector<uint8_t> *out, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putBytes(out, bits, 8);
+}
+
+// reads a patch, every read checks the length and a failed read stops the
+// rest of them.
+class PatchReader {
+public:
+    PatchReader(const uint8_t *data, size_t size) : p(data), end(data + size), ok(true) {}
+
+    bool done() const { return p == end; }
+    bool good() const { return ok; }
+
+    uint64_t bytes(int count)
+    {
+        if (!ok || end - p < count) {
+            ok = false;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int k = 0; k < count; k++) {
+            value |= (uint64_t)p[k] << (8 * k);
+        }
+        p += count;
+        return value;
+    }
+
+    uint64_t varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; ok && shift < 64; shift += 7) {
+            uint64_t b = bytes(1);
+            value |= (b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                return value;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+
+    float readFloat()
+    {
+        uint32_t bits = (uint32_t)bytes(4);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    double readDouble()
+    {
+        uint64_t bits = bytes(8);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    string text()
+    {
+        uint64_t length = varint();
+        if (!ok || (uint64_t)(end - p) < length) {
+            ok = false;
+            return "";
+        }
+        string value((const char *)p, length);
+        p += length;
+        return value;
+    }
+
+private:
+    const uint8_t *p;
+    const uint8_t *end;
+    bool ok;
+};
+
+// shortestText - the shortest %g text that reads back the same value, as a
+// float or a double.
+static string shortestText(double value, bool asFloat)
+{
+    char buffer[32];
+    for (int digits = 1; digits <= 17; digits++) {
+        snprintf(buffer, sizeof(buffer), "%.*g", digits, value);
+        double back = strtod(buffer, NULL);
+        if (asFloat ? (float)back == (float)value : back == value) {
+            break;
+        }
+    }
+    return buffer;
+}
+
+// integerText - the value is an integer written the way to_string writes
+// it, so it can be sent as a number.
+static bool integerText(const string &value, long long *number)
+{
+    if (value.empty() || value.size() > 18) {
+        return false;
+    }
+    char *end;
+    *number = strtoll(value.c_str(), &end, 10);
+    return *end == '\0' && to_string(*number) == value;
+}
+
+// validName - a name that can be saved to a file and loaded again
+static bool validName(const string &varName)
+{
+    if (varName.empty()) {
+        return false;
+    }
+    for (size_t k = 0; k < varName.size(); k++) {
+        char c = varName[k];
+        if (c == ' ' || c == '\t' || c == '=' || c == '#' || c == '\n' || c == '\r') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// putValue - the value of a scalar variable in its smallest type
+static void putValue(vector<uint8_t> *out, uint8_t named, const string &value)
+{
+    long long integer;
+    if (integerText(value, &integer)) {
+        out->push_back(PATCH_INT | named);
+        return;
+    }
+    char *end;
+    double number = strtod(value.c_str(), &end);
+    if (!value.empty() && *end == '\0' && std::isfinite(number)) {
+        if (shortestText((float)number, true) == value) {
+            out->push_back(PATCH_FLOAT | named);
+            return;
+        }
+        if (shortestText(number, false) == value) {
+            out->push_back(PATCH_DOUBLE | named);
+            return;
+        }
+    }
+    out->push_back(PATCH_STRING | named);
+}
+
+// keyId - the id a variable is sent with.
+uint32_t ConfigPatch::keyId(const string &varName)
+{
+    return fnv1a32((const uint8_t *)varName.data(), varName.size());
+}
+
+// entryHash - the hash of one variable, the version is the sum of them.
+uint64_t ConfigPatch::entryHash(const ConfigFile::Table &table, const string &varName,
+                                const ConfigFile::Entry &entry)
+{
+    uint64_t hash = fnv1a64(varName.data(), varName.size() + 1);
+    if (entry.array.rows == 0) {
+        return fnv1a64(entry.value.data(), entry.value.size(), hash);
+    }
+    int32_t size[2] = {entry.array.rows, entry.array.cols};
+    hash = fnv1a64(size, sizeof(size), hash);
+    const double *data = table.layers[entry.layer]->arrayData.data() + entry.array.offset;
+    return fnv1a64(data, entry.array.rows * entry.array.cols * sizeof(double), hash);
+}
+
+// version - the version of a table.
+uint64_t ConfigPatch::version(const ConfigFile::Table &table)
+{
+    // a sum, so the order of the map does not matter
+    uint64_t version = 0;
+    for (unordered_map<string, ConfigFile::Entry>::const_iterator itr = table.vars.begin();
+         itr != table.vars.end(); ++itr) {
+        version += entryHash(table, itr->first, itr->second);
+    }
+    return version;
+}
+
+// version - a hash of every variable and value of the config.
+uint64_t ConfigPatch::version(ConfigFile &config)
+{
+    unique_ptr<ConfigFile::Table> table = config.snapshot();
+    return version(*table);
+}
+
+// make - the patch that makes base the same as target.
+// @param patch - output patch.
+// @param dropped - output names of the variables of base that target
+//                  does not have, a patch can not remove them. NULL to
+//                  skip them.
+// @return - the number of variables in the patch.
+int ConfigPatch::make(ConfigFile &base, ConfigFile &target, vector<uint8_t> *patch,
+                      vector<string> *dropped)
+{
+    unique_ptr<ConfigFile::Table> from = base.snapshot();
+    unique_ptr<ConfigFile::Table> to = target.snapshot();
+
+    // ids shared by two variables of base are sent by name
+    unordered_map<uint32_t, int> idCount;
+    for (unordered_map<string, ConfigFile::Entry>::const_iterator itr = from->vars.begin();
+         itr != from->vars.end(); ++itr) {
+        idCount[keyId(itr->first)]++;
+    }
+
+    // the same patch for the same files, whatever order the maps are in
+    vector<string> names;
+    for (unordered_map<string, ConfigFile::Entry>::const_iterator itr = to->vars.begin();
+         itr != to->vars.end(); ++itr) {
+        names.push_back(itr->first);
+    }
+    sort(names.begin(), names.end());
+
+    uint64_t baseVersion = version(*from);
+    uint64_t targetVersion = baseVersion;
+    vector<uint8_t> entries;
+    int count = 0;
+    for (size_t k = 0; k < names.size(); k++) {
+        const string &varName = names[k];
+        const ConfigFile::Entry &entry = to->vars.at(varName);
+        uint64_t hash = entryHash(*to, varName, entry);
+        unordered_map<string, ConfigFile::Entry>::const_iterator old = from->vars.find(varName);
+        if (old != from->vars.end()) {
+            uint64_t oldHash = entryHash(*from, varName, old->second);
+            if (oldHash == hash) {
+                continue;
+            }
+            targetVersion -= oldHash;
+        }
+        targetVersion += hash;
+        count++;
+
+        uint8_t named = old == from->vars.end() || idCount[keyId(varName)] > 1 ? PATCH_NAMED : 0;
+        size_t typeAt = entries.size();
+        if (entry.array.rows != 0) {
+            entries.push_back(PATCH_ARRAY | named);
+        } else {
+            putValue(&entries, named, entry.value);
+        }
+        if (named) {
+            putVarint(&entries, varName.size());
+            entries.insert(entries.end(), varName.begin(), varName.end());
+        } else {
+            putBytes(&entries, keyId(varName), 4);
+        }
+
+        switch (entries[typeAt] & ~PATCH_NAMED) {
+            case PATCH_INT : {
+                long long integer = strtoll(entry.value.c_str(), NULL, 10);
+                putVarint(&entries, ((uint64_t)integer << 1) ^ (uint64_t)(integer >> 63));
+                break;
+            }
+            case PATCH_FLOAT :
+                putFloat(&entries, (float)strtod(entry.value.c_str(), NULL));
+                break;
+            case PATCH_DOUBLE :
+                putDouble(&entries, strtod(entry.value.c_str(), NULL));
+                break;
+            case PATCH_ARRAY : {
+                int elements = entry.array.rows * entry.array.cols;
+                const double *data = to->layers[entry.layer]->arrayData.data() + entry.array.offset;
+                putVarint(&entries, entry.array.rows);
+                putVarint(&entries, entry.array.cols);
+                // gain matrices are mostly zeros, each element has the
+                // bytes it needs
+                for (int i = 0; i < elements; i++) {
+                    uint64_t bits;
+                    memcpy(&bits, &data[i], sizeof(bits));
+                    if (bits == 0) {
+                        entries.push_back(0);
+                    } else if ((double)(float)data[i] == data[i]) {
+                        entries.push_back(4);
+                        putFloat(&entries, (float)data[i]);
+                    } else {
+                        entries.push_back(8);
+                        putDouble(&entries, data[i]);
+                    }
+                }
+                break;
+            }
+            default:
+                putVarint(&entries, entry.value.size());
+                entries.insert(entries.end(), entry.value.begin(), entry.value.end());
+                break;
+        }
+    }
+
+    if (dropped != NULL) {
+        dropped->clear();
+        for (unordered_map<string, ConfigFile::Entry>::const_iterator itr = from->vars.begin();
+             itr != from->vars.end(); ++itr) {
+            if (to->vars.count(itr->first) == 0) {
+                dropped->push_back(itr->first);
+            }
+        }
+        sort(dropped->begin(), dropped->end());
+    }
+
+    patch->clear();
+    patch->push_back(PATCH_MAGIC_0);
+    patch->push_back(PATCH_MAGIC_1);
+    patch->push_back(CONFIG_PATCH_FORMAT_VERSION);
+    putBytes(patch, baseVersion, 8);
+    putBytes(patch, targetVersion, 8);
+    putVarint(patch, count);
+    patch->insert(patch->end(), entries.begin(), entries.end());
+    putBytes(patch, fnv1a32(patch->data(), patch->size()), 4);
+    return count;
+}
+
+// apply - changes the variables of a patch in the set layer of config,
+// all of them at once.
+// @return - 0 if the patch was applied or the config was already at the
+//           target version, -1 for a bad patch or another base version.
+int ConfigPatch::apply(ConfigFile &config, const uint8_t *patch, size_t size)
+{
+    if (size < PATCH_HEADER_SIZE + PATCH_CHECK_SIZE || patch[0] != PATCH_MAGIC_0 ||
+        patch[1] != PATCH_MAGIC_1 || patch[2] != CONFIG_PATCH_FORMAT_VERSION) {
+        ErrorManager::ERROR(CONFIG_PATCH_INVALID);
+        return -1;
+    }
+    PatchReader check(patch + size - PATCH_CHECK_SIZE, PATCH_CHECK_SIZE);
+    if (check.bytes(4) != fnv1a32(patch, size - PATCH_CHECK_SIZE)) {
+        ErrorManager::ERROR(CONFIG_PATCH_INVALID);
+        return -1;
+    }
+    PatchReader in(patch + 3, size - 3 - PATCH_CHECK_SIZE);
+    uint64_t baseVersion = in.bytes(8);
+    uint64_t targetVersion = in.bytes(8);
+
+    // the names of the ids, for the version the patch was made from
+    unordered_map<uint32_t, string> names;
+    {
+        unique_ptr<ConfigFile::Table> table = config.snapshot();
+        uint64_t current = version(*table);
+        if (current == targetVersion) {
+            return 0;
+        }
+        if (current != baseVersion) {
+            ErrorManager::ERROR(CONFIG_PATCH_VERSION_MISMATCH);
+            return -1;
+        }
+        for (unordered_map<string, ConfigFile::Entry>::const_iterator itr = table->vars.begin();
+             itr != table->vars.end(); ++itr) {
+            uint32_t id = keyId(itr->first);
+            // a shared id is sent by name, so it does not name anything
+            if (names.count(id) == 0) {
+                names[id] = itr->first;
+            } else {
+                names[id].clear();
+            }
+        }
+    }
+
+    uint64_t count = in.varint();
+    vector<pair<string, string> > entries;
+    for (uint64_t k = 0; in.good() && k < count; k++) {
+        uint8_t type = (uint8_t)in.bytes(1);
+        string varName;
+        if (type & PATCH_NAMED) {
+            varName = in.text();
+        } else {
+            unordered_map<uint32_t, string>::const_iterator itr = names.find((uint32_t)in.bytes(4));
+            if (itr != names.end()) {
+                varName = itr->second;
+            }
+        }
+        if (!validName(varName)) {
+            ErrorManager::ERROR(CONFIG_PATCH_INVALID);
+            return -1;
+        }
+
+        string value;
+        switch (type & ~PATCH_NAMED) {
+            case PATCH_STRING :
+                value = in.text();
+                break;
+            case PATCH_INT : {
+                uint64_t zigzag = in.varint();
+                value = to_string((long long)(zigzag >> 1) ^ -(long long)(zigzag & 1));
+                break;
+            }
+            case PATCH_FLOAT :
+                value = shortestText(in.readFloat(), true);
+                break;
+            case PATCH_DOUBLE :
+                value = shortestText(in.readDouble(), false);
+                break;
+            case PATCH_ARRAY : {
+                uint64_t rows = in.varint();
+                uint64_t cols = in.varint();
+                if (rows == 0 || cols == 0 || rows > size || cols > size || rows * cols > size) {
+                    ErrorManager::ERROR(CONFIG_PATCH_INVALID);
+                    return -1;
+                }
+                vector<double> data(rows * cols);
+                for (size_t i = 0; in.good() && i < data.size(); i++) {
+                    uint64_t width = in.bytes(1);
+                    if (width == 4) {
+                        data[i] = in.readFloat();
+                    } else if (width == 8) {
+                        data[i] = in.readDouble();
+                    } else if (width != 0) {
+                        ErrorManager::ERROR(CONFIG_PATCH_INVALID);
+                        return -1;
+                    }
+                }
+                value = ConfigFile::formatArray(data.data(), (int)rows, (int)cols);
+                break;
+            }
+            default:
+                ErrorManager::ERROR(CONFIG_PATCH_INVALID);
+                return -1;
+        }
+        entries.push_back(make_pair(varName, value));
+    }
+    if (!in.good() || !in.done()) {
+        ErrorManager::ERROR(CONFIG_PATCH_INVALID);
+        return -1;
+    }
+
+    vector<pair<string, const string *> > values;
+    for (size_t k = 0; k < entries.size(); k++) {
+        values.push_back(make_pair(entries[k].first, &entries[k].second));
+    }
+    // the version is checked again under the write lock, another thread
+    // may have changed the config since it was read above.
+    int ret = config.setValues(values, [&](const ConfigFile::Table &table) {
+        uint64_t current = version(table);
+        return current == baseVersion ? 0 : (current == targetVersion ? 1 : 2);
+    });
+    if (ret == 1) {
+        return 0;
+    } else if (ret == 2) {
+        ErrorManager::ERROR(CONFIG_PATCH_VERSION_MISMATCH);
+        return -1;
+    }
+    return ret;
+}
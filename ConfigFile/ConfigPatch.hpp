@@ -0,0 +1,114 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  ConfigPatch.hpp
+//
+// Binary patches of a config, to change a few values in flight without
+// sending the whole .inca file over the UHF or UART link.
+//
+// A patch has the version of the config it was made from and the version
+// it makes, followed by one entry per changed variable. The version is a
+// hash of every variable and value. A variable that the config already has
+// is named by a 32 bit hash of its name, only new variables (or ones whose
+// hash is shared) send the name. Values are sent in the smallest type that
+// gives back the same text:
+//
+//  integer - zigzag varint
+//  float   - 4 bytes, when the shortest float text is the value
+//  double  - 8 bytes, when the shortest double text is the value
+//  array   - rows, cols and each element as a size (0 for zero, 4 or 8)
+//            and a float or a double
+//  string  - length and text, for everything else
+//
+// Frame layout (little endian):
+//  0  magic "CP", 2 version
+//  3  base version (uint64), target version (uint64)
+//  19 number of entries (varint), then the entries:
+//       type (bit 7 set when the name is sent), the key (uint32 id, or a
+//       varint length and the name) and the value
+//  .. FNV-1a (uint32) of everything before it
+//
+// A patch goes in the set layer in one swap, and only onto the base
+// version. A config that is already at the target version is left as it
+// is, so sending a patch again does no harm. A patch can not remove a
+// variable.
+//
+// Example code for use is shown below:
+//
+// // on the ground
+// ConfigFile flight("ControllerGains.inca"), tuned("TunedGains.inca");
+// flight.load();
+// tuned.load();
+// vector<uint8_t> patch;
+// ConfigPatch::make(flight, tuned, &patch);
+//
+// // on the satellite
+// if (ConfigPatch::apply(gainsFile, &patch[0], patch.size()) != 0) {
+// // handle error, corrupt patch or gains file is not the base version
+// }
+// gainsFile.saveAsync();
+
+#ifndef ConfigPatch_hpp
+#define ConfigPatch_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ConfigFile.hpp"
+
+using namespace std;
+
+#define CONFIG_PATCH_FORMAT_VERSION 1
+
+class ConfigPatch {
+public:
+    // make - the patch that makes base the same as target.
+    // @param patch - output patch.
+    // @param dropped - output names of the variables of base that target
+    //                  does not have, a patch can not remove them. NULL to
+    //                  skip them.
+    // @return - the number of variables in the patch.
+    static int make(ConfigFile &base, ConfigFile &target, vector<uint8_t> *patch,
+                    vector<string> *dropped = NULL);
+
+    // apply - changes the variables of a patch in the set layer of config,
+    // all of them at once.
+    // @return - 0 if the patch was applied or the config was already at the
+    //           target version, -1 for a bad patch or another base version.
+    static int apply(ConfigFile &config, const uint8_t *patch, size_t size);
+
+    // version - a hash of every variable and value of the config. Arrays
+    // are hashed by their elements, so the spacing of the text does not
+    // change it.
+    static uint64_t version(ConfigFile &config);
+
+    // keyId - the id a variable is sent with.
+    static uint32_t keyId(const string &varName);
+
+private:
+    // version - the version of a table.
+    static uint64_t version(const ConfigFile::Table &table);
+
+    // entryHash - the hash of one variable, the version is the sum of them.
+    static uint64_t entryHash(const ConfigFile::Table &table, const string &varName,
+                              const ConfigFile::Entry &entry);
+};
+
+#endif /* ConfigPatch_hpp */
@@ -0,0 +1,531 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  ConfigSegment.cpp
+//
+// Shares a parsed config with other processes through shared memory.
+
+#include "ConfigSegment.hpp"
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CONFIG_SEGMENT_MAGIC "INCACFG1"
+#define CONFIG_SEGMENT_VERSION 1
+// the header and the slots start on their own cache lines
+#define CONFIG_SEGMENT_ALIGN 64
+
+// the counters are shared with other processes, so they can not be a lock
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "ConfigSegment needs lock free 32 bit atomics");
+
+// start of the segment
+struct ConfigSegment::Header {
+    char magic[8];
+    uint32_t version;
+    // bytes of each slot
+    uint32_t slotSize;
+    // the number of publishes, the slot in use is generation & 1
+    atomic<uint32_t> generation;
+    // odd while the slot is written
+    atomic<uint32_t> sequence[2];
+};
+
+// start of a slot, followed by the buckets, the entries, the keys and
+// values, and the array elements.
+struct ConfigSegment::SlotHeader {
+    // a power of 2, each bucket is the entry index + 1, 0 for none
+    uint32_t bucketCount;
+    uint32_t entryCount;
+    // offsets of the buckets and entries
+    uint32_t buckets;
+    uint32_t entries;
+};
+
+// one variable, the offsets are from the start of the slot
+struct ConfigSegment::SlotEntry {
+    // the value as a double, like ConfigFile::getDouble()
+    double number;
+    uint32_t hash;
+    uint32_t key;
+    uint32_t keyLength;
+    uint32_t value;
+    uint32_t valueLength;
+    // rows is 0 if the value is not an array
+    uint32_t array;
+    int32_t rows;
+    int32_t cols;
+};
+
+// headerSize - bytes before the first slot
+size_t ConfigSegment::headerSize()
+{
+    return (sizeof(ConfigSegment::Header) + CONFIG_SEGMENT_ALIGN - 1) & ~(size_t)(CONFIG_SEGMENT_ALIGN - 1);
+}
+
+// hashKey - 32 bit FNV-1a of a variable name
+static inline uint32_t hashKey(const char *data, size_t length)
+{
+    uint32_t hash = 0x811c9dc5;
+    for (size_t k = 0; k < length; k++) {
+        hash ^= (unsigned char)data[k];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+// inSlot - the bytes are inside of the slot, used on everything a reader
+// gets from a slot since it could be in the middle of being written.
+static inline bool inSlot(uint64_t offset, uint64_t length, uint32_t slotSize)
+{
+    return offset <= slotSize && length <= slotSize - offset;
+}
+
+// constructor for the segment, nothing is opened until create() or
+// attach() is called.
+// @param name - the shared memory name, a '/' and no other slashes.
+ConfigSegment::ConfigSegment(string name) : name(name)
+{
+    fd = -1;
+    memory = NULL;
+    size = 0;
+    header = NULL;
+    owner = false;
+}
+
+ConfigSegment::~ConfigSegment()
+{
+    close();
+}
+
+// close - unmaps the segment.
+void ConfigSegment::close()
+{
+    if (memory != NULL) {
+        munmap(memory, size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    memory = NULL;
+    size = 0;
+    header = NULL;
+    owner = false;
+}
+
+// create - creates the segment as its owner, it starts out with no
+// variables. An old segment of the same name is unlinked first, so a process
+// still attached to it is not cut off.
+// @param size - bytes of the segment, each slot gets just under half.
+// @return - 0 on success, -1 on failure.
+int ConfigSegment::create(size_t size)
+{
+    close();
+    size_t slotSize = ((size - headerSize()) / 2) & ~(size_t)(CONFIG_SEGMENT_ALIGN - 1);
+    if (size < headerSize() + 2 * CONFIG_SEGMENT_ALIGN || slotSize > UINT32_MAX) {
+        ErrorManager::ERROR(CONFIG_SEGMENT_FAILED);
+        return -1;
+    }
+
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+        ErrorManager::ERROR(CONFIG_SEGMENT_FAILED);
+        close();
+        return -1;
+    }
+    void *mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        ErrorManager::ERROR(CONFIG_SEGMENT_FAILED);
+        close();
+        return -1;
+    }
+    memory = (char *)mapped;
+    this->size = size;
+    owner = true;
+
+    // slot 0 is an empty table, the new segment is all zeros
+    header = new (memory) Header();
+    header->version = CONFIG_SEGMENT_VERSION;
+    header->slotSize = (uint32_t)slotSize;
+    SlotHeader *slot = (SlotHeader *)(memory + headerSize());
+    slot->bucketCount = 1;
+    slot->entryCount = 0;
+    slot->buckets = sizeof(SlotHeader);
+    slot->entries = sizeof(SlotHeader) + sizeof(uint32_t);
+
+    // the magic goes last, attach() fails until it is there
+    atomic_thread_fence(memory_order_release);
+    memcpy(header->magic, CONFIG_SEGMENT_MAGIC, sizeof(header->magic));
+    return 0;
+}
+
+// attach - maps a segment made by create() read only.
+// @return - 0 on success, -1 on failure.
+int ConfigSegment::attach()
+{
+    close();
+    fd = shm_open(name.c_str(), O_RDONLY, 0);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || (size_t)info.st_size < headerSize()) {
+        ErrorManager::ERROR(CONFIG_SEGMENT_FAILED);
+        close();
+        return -1;
+    }
+    void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        ErrorManager::ERROR(CONFIG_SEGMENT_FAILED);
+        close();
+        return -1;
+    }
+    memory = (char *)mapped;
+    size = info.st_size;
+
+    Header *found = (Header *)memory;
+    bool ready = memcmp(found->magic, CONFIG_SEGMENT_MAGIC, sizeof(found->magic)) == 0;
+    atomic_thread_fence(memory_order_acquire);
+    if (!ready || found->version != CONFIG_SEGMENT_VERSION ||
+        headerSize() + 2 * (size_t)found->slotSize > size) {
+        ErrorManager::ERROR(CONFIG_SEGMENT_FAILED);
+        close();
+        return -1;
+    }
+    header = found;
+    return 0;
+}
+
+// unlink - removes the name of the segment, processes that have it
+// mapped keep using it.
+// @return - 0 on success, -1 on failure.
+int ConfigSegment::unlink()
+{
+    if (shm_unlink(name.c_str()) != 0) {
+        ErrorManager::ERROR(CONFIG_SEGMENT_FAILED);
+        return -1;
+    }
+    return 0;
+}
+
+// publish - writes the current values of the config to the segment.
+// Only the owner can publish.
+// @return - 0 on success, -1 if the config does not fit in a slot.
+int ConfigSegment::publish(ConfigFile &config)
+{
+    if (!owner) {
+        ErrorManager::ERROR(CONFIG_SEGMENT_FAILED);
+        return -1;
+    }
+    lock_guard<mutex> lock(publishLock);
+    unique_ptr<ConfigFile::Table> table = config.snapshot();
+    const unordered_map<string, ConfigFile::Entry> &vars = table->vars;
+
+    // size up the slot, the buckets are at most half full
+    uint32_t bucketCount = 2;
+    while (bucketCount < 2 * vars.size()) {
+        bucketCount *= 2;
+    }
+    uint64_t textBytes = 0;
+    uint64_t arrayCount = 0;
+    for (unordered_map<string, ConfigFile::Entry>::const_iterator itr = vars.begin(); itr != vars.end(); ++itr) {
+        textBytes += itr->first.size() + itr->second.value.size();
+        arrayCount += (uint64_t)itr->second.array.rows * itr->second.array.cols;
+    }
+    uint64_t buckets = sizeof(SlotHeader);
+    uint64_t entries = (buckets + (uint64_t)bucketCount * sizeof(uint32_t) + 7) & ~7ULL;
+    uint64_t text = entries + vars.size() * sizeof(SlotEntry);
+    uint64_t arrays = (text + textBytes + 7) & ~7ULL;
+    if (arrays + arrayCount * sizeof(double) > header->slotSize) {
+        ErrorManager::ERROR(CONFIG_SEGMENT_FAILED);
+        return -1;
+    }
+
+    uint32_t generation = header->generation.load(memory_order_relaxed);
+    int s = (generation + 1) & 1;
+    char *slot = memory + headerSize() + (size_t)s * header->slotSize;
+
+    // the sequence is odd while the slot is written
+    uint32_t sequence = header->sequence[s].load(memory_order_relaxed);
+    header->sequence[s].store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    SlotHeader *slotHeader = (SlotHeader *)slot;
+    slotHeader->bucketCount = bucketCount;
+    slotHeader->entryCount = (uint32_t)vars.size();
+    slotHeader->buckets = (uint32_t)buckets;
+    slotHeader->entries = (uint32_t)entries;
+    uint32_t *bucket = (uint32_t *)(slot + buckets);
+    memset(bucket, 0, bucketCount * sizeof(uint32_t));
+    SlotEntry *entry = (SlotEntry *)(slot + entries);
+
+    uint32_t index = 0;
+    for (unordered_map<string, ConfigFile::Entry>::const_iterator itr = vars.begin(); itr != vars.end();
+         ++itr, index++) {
+        const string &key = itr->first;
+        const ConfigFile::Entry &value = itr->second;
+        SlotEntry &e = entry[index];
+        e.number = strtod(value.value.c_str(), NULL);
+        e.hash = hashKey(key.data(), key.size());
+        e.key = (uint32_t)text;
+        e.keyLength = (uint32_t)key.size();
+        memcpy(slot + text, key.data(), key.size());
+        text += key.size();
+        e.value = (uint32_t)text;
+        e.valueLength = (uint32_t)value.value.size();
+        memcpy(slot + text, value.value.data(), value.value.size());
+        text += value.value.size();
+
+        e.rows = value.array.rows;
+        e.cols = value.array.cols;
+        e.array = (uint32_t)arrays;
+        if (value.array.rows != 0) {
+            size_t count = (size_t)value.array.rows * value.array.cols;
+            memcpy(slot + arrays, table->layers[value.layer]->arrayData.data() + value.array.offset,
+                   count * sizeof(double));
+            arrays += count * sizeof(double);
+        }
+
+        // linear probing
+        uint32_t b = e.hash & (bucketCount - 1);
+        while (bucket[b] != 0) {
+            b = (b + 1) & (bucketCount - 1);
+        }
+        bucket[b] = index + 1;
+    }
+
+    header->sequence[s].store(sequence + 2, memory_order_release);
+    header->generation.store(generation + 1, memory_order_release);
+    return 0;
+}
+
+// getGeneration - the number of publishes, it changes every time the
+// readers see new values.
+uint32_t ConfigSegment::getGeneration() const
+{
+    if (header == NULL) {
+        return 0;
+    }
+    return header->generation.load(memory_order_acquire);
+}
+
+// read - finds a variable and copies it out of a consistent slot.
+// @param value - output string value, NULL to skip it.
+// @param number - output value as a double, NULL to skip it.
+// @param array - output array elements, NULL to skip it.
+// @param rows - output array rows, 0 if it is not an array.
+// @return - 0 if it was found, 1 if not.
+int ConfigSegment::read(const string &varName, string *value, double *number,
+                        vector<double> *array, int *rows) const
+{
+    if (header == NULL) {
+        return 1;
+    }
+    uint32_t hash = hashKey(varName.data(), varName.size());
+    uint32_t slotSize = header->slotSize;
+
+    for (;;) {
+        uint32_t generation = header->generation.load(memory_order_acquire);
+        int s = generation & 1;
+        uint32_t sequence = header->sequence[s].load(memory_order_acquire);
+        if (sequence & 1) {
+            // the owner is writing this slot, it is about to move on to it
+            this_thread::yield();
+            continue;
+        }
+        const char *slot = memory + headerSize() + (size_t)s * slotSize;
+
+        // everything read from the slot is checked before it is used, it is
+        // only known to be whole once the sequence is checked again.
+        bool found = false;
+        bool valid = true;
+        SlotHeader slotHeader;
+        memcpy(&slotHeader, slot, sizeof(slotHeader));
+        uint32_t bucketCount = slotHeader.bucketCount;
+        if (bucketCount == 0 || (bucketCount & (bucketCount - 1)) != 0 ||
+            !inSlot(slotHeader.buckets, (uint64_t)bucketCount * sizeof(uint32_t), slotSize) ||
+            !inSlot(slotHeader.entries, (uint64_t)slotHeader.entryCount * sizeof(SlotEntry), slotSize)) {
+            valid = false;
+        }
+
+        SlotEntry e;
+        for (uint32_t probe = 0, b = hash & (bucketCount - 1); valid && probe < bucketCount;
+             probe++, b = (b + 1) & (bucketCount - 1)) {
+            uint32_t index;
+            memcpy(&index, slot + slotHeader.buckets + (size_t)b * sizeof(uint32_t), sizeof(index));
+            if (index == 0) {
+                break;
+            }
+            if (index > slotHeader.entryCount) {
+                valid = false;
+                break;
+            }
+            memcpy(&e, slot + slotHeader.entries + (size_t)(index - 1) * sizeof(SlotEntry), sizeof(e));
+            if (e.hash != hash || e.keyLength != varName.size()) {
+                continue;
+            }
+            if (!inSlot(e.key, e.keyLength, slotSize)) {
+                valid = false;
+                break;
+            }
+            if (memcmp(slot + e.key, varName.data(), e.keyLength) == 0) {
+                found = true;
+                break;
+            }
+        }
+
+        if (valid && found) {
+            uint64_t count = e.rows > 0 && e.cols > 0 ? (uint64_t)e.rows * e.cols : 0;
+            if (!inSlot(e.value, e.valueLength, slotSize) ||
+                !inSlot(e.array, count * sizeof(double), slotSize)) {
+                valid = false;
+            } else {
+                if (value != NULL) {
+                    value->assign(slot + e.value, e.valueLength);
+                }
+                if (number != NULL) {
+                    *number = e.number;
+                }
+                if (array != NULL) {
+                    array->resize(count);
+                    if (count > 0) {
+                        memcpy(&(*array)[0], slot + e.array, count * sizeof(double));
+                    }
+                }
+                if (rows != NULL) {
+                    *rows = count > 0 ? e.rows : 0;
+                }
+            }
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        if (header->sequence[s].load(memory_order_relaxed) != sequence) {
+            continue;
+        }
+        // a slot that is not being written is whole
+        return valid && found ? 0 : 1;
+    }
+}
+
+// getString - the string version of the value.
+// @return - 0 for no error, 1 for unable to find variable in the segment.
+int ConfigSegment::getString(string varName, string *var) const
+{
+    if (read(varName, var, NULL, NULL, NULL) != 0) {
+        ErrorManager::ERROR(UNABLE_TO_FIND_VARIABLE_IN_CONFIG_FILE);
+        return 1;
+    }
+    return 0;
+}
+
+// getDouble - the value as a double, parsed when it was published.
+// @return - 0 for no error, 1 for unable to find variable in the segment.
+int ConfigSegment::getDouble(string varName, double *var) const
+{
+    if (read(varName, NULL, var, NULL, NULL) != 0) {
+        ErrorManager::ERROR(UNABLE_TO_FIND_VARIABLE_IN_CONFIG_FILE);
+        return 1;
+    }
+    return 0;
+}
+
+// getInt - the value as an int, like ConfigFile::getInt()
+// @return - 0 for no error, 1 for unable to find variable in the segment.
+int ConfigSegment::getInt(string varName, int *var) const
+{
+    double number;
+    if (read(varName, NULL, &number, NULL, NULL) != 0) {
+        ErrorManager::ERROR(UNABLE_TO_FIND_VARIABLE_IN_CONFIG_FILE);
+        return 1;
+    }
+    *var = (int)number;
+    return 0;
+}
+
+// getArray - every element of the array in row order.
+// @return - 0 for no error, 1 for unable to find variable in the segment,
+//           2 - the value is not an array.
+int ConfigSegment::getArray(string varName, vector<double> *var) const
+{
+    int rows;
+    if (read(varName, NULL, NULL, var, &rows) != 0) {
+        ErrorManager::ERROR(UNABLE_TO_FIND_VARIABLE_IN_CONFIG_FILE);
+        return 1;
+    }
+    if (rows == 0) {
+        ErrorManager::ERROR(CONFIG_FILE_READ_ARRAY_INVALID_VALUE);
+        return 2;
+    }
+    return 0;
+}
+
+// getVec3 - any array of 3 elements.
+// @return - 0 for no error, 1 for unable to find variable in the segment,
+//           2 - the value is not an array of 3 elements.
+int ConfigSegment::getVec3(string varName, double var[3]) const
+{
+    vector<double> data;
+    int ret = getArray(varName, &data);
+    if (ret != 0) {
+        return ret;
+    }
+    if (data.size() != 3) {
+        ErrorManager::ERROR(CONFIG_FILE_READ_ARRAY_WRONG_SIZE);
+        return 2;
+    }
+    memcpy(var, &data[0], 3 * sizeof(double));
+    return 0;
+}
+
+// getMat3 - a 3x3 array in row order.
+// @return - 0 for no error, 1 for unable to find variable in the segment,
+//           2 - the value is not a 3x3 array.
+int ConfigSegment::getMat3(string varName, double var[9]) const
+{
+    int rows;
+    vector<double> data;
+    if (read(varName, NULL, NULL, &data, &rows) != 0) {
+        ErrorManager::ERROR(UNABLE_TO_FIND_VARIABLE_IN_CONFIG_FILE);
+        return 1;
+    }
+    if (rows == 0) {
+        ErrorManager::ERROR(CONFIG_FILE_READ_ARRAY_INVALID_VALUE);
+        return 2;
+    }
+    if (rows != 3 || data.size() != 9) {
+        ErrorManager::ERROR(CONFIG_FILE_READ_ARRAY_WRONG_SIZE);
+        return 2;
+    }
+    memcpy(var, &data[0], 9 * sizeof(double));
+    return 0;
+}
+
+// contains - checks if the variable is in the segment without posting
+// an error when it is missing.
+bool ConfigSegment::contains(string varName) const
+{
+    return read(varName, NULL, NULL, NULL, NULL) == 0;
+}
@@ -0,0 +1,149 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  ConfigSegment.hpp
+//
+// Shares a parsed config with other processes through a POSIX shared memory
+// segment. One owner process loads the .inca files into a ConfigFile and
+// publishes it, the other processes attach the segment read only and look
+// the variables up in place, without parsing the files or keeping a copy of
+// the map of their own.
+//
+// The segment has a header and two slots. Each slot holds one version of
+// the config as an open addressing hash table that only uses offsets from
+// the start of the slot, so it reads the same at any address it is mapped
+// at. Arrays are stored parsed, as doubles.
+//
+// publish() writes the slot that is not in use and then moves the
+// generation to it. Each slot has a sequence number that is odd while it is
+// written, a reader copies the value out and then checks that the sequence
+// did not change, and tries again if it did (a seqlock). A reader only has
+// to try again when the owner publishes twice during one get, and an owner
+// that dies while writing leaves the published slot alone.
+//
+// Example code for use is shown below:
+//
+// // owner
+// ConfigFile config("pathToConfigFile");
+// config.load();
+// ConfigSegment segment("/inca-config");
+// segment.create(1 << 20);
+// segment.publish(config);
+//
+// // any other process
+// ConfigSegment shared("/inca-config");
+// if (shared.attach() != 0) {
+// // handle error, the owner has not created the segment yet
+// }
+// double x;
+// shared.getDouble("x", &x);
+
+#ifndef ConfigSegment_hpp
+#define ConfigSegment_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ConfigFile.hpp"
+
+using namespace std;
+
+class ConfigSegment {
+public:
+    // constructor for the segment, nothing is opened until create() or
+    // attach() is called.
+    // @param name - the shared memory name, a '/' and no other slashes.
+    ConfigSegment(string name);
+    ~ConfigSegment();
+
+    // create - creates (or resets) the segment as its owner, it starts out
+    // with no variables.
+    // @param size - bytes of the segment, each slot gets just under half.
+    // @return - 0 on success, -1 on failure.
+    int create(size_t size);
+    // attach - maps a segment made by create() read only.
+    // @return - 0 on success, -1 on failure.
+    int attach();
+    // unlink - removes the name of the segment, processes that have it
+    // mapped keep using it.
+    // @return - 0 on success, -1 on failure.
+    int unlink();
+
+    // publish - writes the current values of the config to the segment.
+    // Only the owner can publish.
+    // @return - 0 on success, -1 if the config does not fit in a slot.
+    int publish(ConfigFile &config);
+
+    // getGeneration - the number of publishes, it changes every time the
+    // readers see new values.
+    uint32_t getGeneration() const;
+
+    // get functions, the same as the ConfigFile get functions.
+    // @return - 0 for no error, 1 for unable to find variable in the segment,
+    //           2 - the value is not an array of the size asked for.
+    int getString(string varName, string *var) const;
+    int getDouble(string varName, double *var) const;
+    int getInt(string varName, int *var) const;
+    int getVec3(string varName, double var[3]) const;
+    int getMat3(string varName, double var[9]) const;
+    int getArray(string varName, vector<double> *var) const;
+
+    // contains - checks if the variable is in the segment without posting
+    // an error when it is missing.
+    bool contains(string varName) const;
+
+private:
+    struct Header;
+    struct SlotHeader;
+    struct SlotEntry;
+
+    string name;
+    int fd;
+    // the mapping, header is NULL until create() or attach()
+    char *memory;
+    size_t size;
+    Header *header;
+    bool owner;
+    // only one thread publishes at a time
+    mutex publishLock;
+
+    // ConfigSegment is not copied, it owns the mapping.
+    ConfigSegment(const ConfigSegment &);
+    ConfigSegment &operator=(const ConfigSegment &);
+
+    // close - unmaps the segment.
+    void close();
+
+    // headerSize - bytes before the first slot
+    static size_t headerSize();
+
+    // read - finds a variable and copies it out of a consistent slot.
+    // @param value - output string value, NULL to skip it.
+    // @param number - output value as a double, NULL to skip it.
+    // @param array - output array elements, NULL to skip it.
+    // @param rows - output array rows, 0 if it is not an array.
+    // @return - 0 if it was found, 1 if not.
+    int read(const string &varName, string *value, double *number,
+             vector<double> *array, int *rows) const;
+};
+
+#endif /* ConfigSegment_hpp */
@@ -0,0 +1,205 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  ConfigWatcher.cpp
+//
+// Reloads a config file when it changes on disk.
+
+#include "ConfigWatcher.hpp"
+
+// for ERROR
+#include <ErrorManager.hpp>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define WATCH_BUFFER_SIZE 4096
+
+// constructor for the watcher, it does not watch until start() is called.
+// @param config - the config to reload, it must outlive the watcher.
+ConfigWatcher::ConfigWatcher(ConfigFile &config) : config(config), reloads(0), failures(0)
+{
+    nextId = 0;
+    inotifyFd = -1;
+    stopPipe[0] = -1;
+    stopPipe[1] = -1;
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    stop();
+}
+
+// setValidator - sets the check a reloaded file has to pass, it is
+// called with the new values before they are swapped in.
+// @param validate - returns 0 to accept the file.
+void ConfigWatcher::setValidator(function<int(ConfigFile &)> validate)
+{
+    lock_guard<mutex> lock(callbackLock);
+    validator = validate;
+}
+
+// subscribe - adds a function to call after each good reload.
+// @return - the id to unsubscribe with.
+int ConfigWatcher::subscribe(function<void(ConfigFile &)> callback)
+{
+    lock_guard<mutex> lock(callbackLock);
+    callbacks.push_back(make_pair(nextId, callback));
+    return nextId++;
+}
+
+void ConfigWatcher::unsubscribe(int id)
+{
+    lock_guard<mutex> lock(callbackLock);
+    for (size_t k = 0; k < callbacks.size(); k++) {
+        if (callbacks[k].first == id) {
+            callbacks.erase(callbacks.begin() + k);
+            return;
+        }
+    }
+}
+
+// start - starts watching the file on a thread of its own.
+// @return - 0 on success, -1 if the file could not be watched.
+int ConfigWatcher::start()
+{
+    if (worker.joinable()) {
+        return 0;
+    }
+
+    inotifyFd = inotify_init1(IN_CLOEXEC);
+    if (inotifyFd < 0 || pipe(stopPipe) != 0) {
+        ErrorManager::ERROR(CONFIG_FILE_WATCH_FAILED);
+        stop();
+        return -1;
+    }
+
+    // the directories are watched, the files themselves are replaced on a
+    // rename. A directory with two of the files gets the same watch twice.
+    vector<WatchedFile> files;
+    for (int layer = 0; layer < config.getLayerCount(); layer++) {
+        string path = config.getLayerPath(layer);
+        size_t slash = path.find_last_of('/');
+        string directory = slash == string::npos ? "." : path.substr(0, slash + 1);
+
+        WatchedFile file;
+        file.layer = layer;
+        file.name = slash == string::npos ? path : path.substr(slash + 1);
+        file.watch = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (file.watch < 0) {
+            ErrorManager::ERROR(CONFIG_FILE_WATCH_FAILED);
+            stop();
+            return -1;
+        }
+        files.push_back(file);
+    }
+
+    worker = thread(&ConfigWatcher::run, this, files);
+    return 0;
+}
+
+// stop - stops watching, it waits for a reload that is running.
+void ConfigWatcher::stop()
+{
+    if (worker.joinable()) {
+        char c = 0;
+        if (write(stopPipe[1], &c, 1) != 1) {
+            ErrorManager::ERROR(CONFIG_FILE_WATCH_FAILED);
+        }
+        worker.join();
+    }
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+    for (int k = 0; k < 2; k++) {
+        if (stopPipe[k] >= 0) {
+            close(stopPipe[k]);
+            stopPipe[k] = -1;
+        }
+    }
+}
+
+// reload - reloads the files now and calls the subscribers.
+// @return - 0 on success, -1 if the old values were kept.
+int ConfigWatcher::reload()
+{
+    return reload(-1);
+}
+
+// reload - reloads one file, or all of them for a layer of -1.
+int ConfigWatcher::reload(int layer)
+{
+    lock_guard<mutex> lock(callbackLock);
+    int ret = layer < 0 ? config.load(validator) : config.loadLayer(layer, validator);
+    if (ret != 0) {
+        // the load already posted why it failed
+        failures++;
+        return -1;
+    }
+    reloads++;
+    for (size_t k = 0; k < callbacks.size(); k++) {
+        callbacks[k].second(config);
+    }
+    return 0;
+}
+
+// run - the watcher thread, reloads a file when it is changed.
+void ConfigWatcher::run(vector<WatchedFile> files)
+{
+    // aligned for the inotify_event structs
+    char buffer[WATCH_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd fds[2];
+    fds[0].fd = inotifyFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = stopPipe[0];
+    fds[1].events = POLLIN;
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            continue;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            continue;
+        }
+
+        // one reload of each file for all of the events read together
+        vector<bool> changed(files.size(), false);
+        for (char *p = buffer; p < buffer + length;) {
+            struct inotify_event *event = (struct inotify_event *)p;
+            for (size_t k = 0; k < files.size(); k++) {
+                if (event->len > 0 && event->wd == files[k].watch && files[k].name == event->name) {
+                    changed[k] = true;
+                }
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+        for (size_t k = 0; k < files.size(); k++) {
+            if (changed[k]) {
+                reload(files[k].layer);
+            }
+        }
+    }
+}
@@ -0,0 +1,124 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  ConfigWatcher.hpp
+//
+// Reloads a config file and its overlays when they change on disk. The
+// watcher uses inotify on the directory of each file, so it sees the file
+// being written in place and the file being replaced by a rename, which is
+// how save() and most editors write it. Only the file that changed is
+// reloaded, overlays added after start() are not watched.
+//
+// A reload goes through ConfigFile::loadLayer(), so a file that does not
+// parse, or that the validator does not accept, leaves the old values in
+// place and posts ERROR_READING_CONFIG_FILE. After a good reload every
+// subscriber is called from the watcher thread. The gets of the ConfigFile
+// never wait on the watcher.
+//
+// Example code for use is shown below:
+//
+// ConfigFile gainsFile("ControllerGains.inca");
+// gainsFile.load();
+// ConfigWatcher watcher(gainsFile);
+// watcher.setValidator([](ConfigFile &candidate) {
+//     ControllerGains gains;
+//     return loadControllerGains(candidate, &gains);
+// });
+// watcher.subscribe([&](ConfigFile &file) {
+//     // pass the new gains to the controller
+// });
+// watcher.start();
+
+#ifndef ConfigWatcher_hpp
+#define ConfigWatcher_hpp
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ConfigFile.hpp"
+
+using namespace std;
+
+class ConfigWatcher {
+public:
+    // constructor for the watcher, it does not watch until start() is called.
+    // @param config - the config to reload, it must outlive the watcher.
+    ConfigWatcher(ConfigFile &config);
+    ~ConfigWatcher();
+
+    // setValidator - sets the check a reloaded file has to pass, it is
+    // called with the new values before they are swapped in.
+    // @param validate - returns 0 to accept the file.
+    void setValidator(function<int(ConfigFile &)> validate);
+
+    // subscribe - adds a function to call after each good reload.
+    // @return - the id to unsubscribe with.
+    int subscribe(function<void(ConfigFile &)> callback);
+    void unsubscribe(int id);
+
+    // start - starts watching the file on a thread of its own.
+    // @return - 0 on success, -1 if the file could not be watched.
+    int start();
+    // stop - stops watching, it waits for a reload that is running.
+    void stop();
+
+    // reload - reloads the files now and calls the subscribers.
+    // @return - 0 on success, -1 if the old values were kept.
+    int reload();
+
+    // number of good and rejected reloads
+    unsigned long getReloads() const { return reloads.load(); }
+    unsigned long getFailures() const { return failures.load(); }
+
+private:
+    // a file of the config and the watch on its directory
+    struct WatchedFile {
+        int layer;
+        int watch;
+        string name;
+    };
+
+    ConfigFile &config;
+
+    function<int(ConfigFile &)> validator;
+    vector<pair<int, function<void(ConfigFile &)> > > callbacks;
+    int nextId;
+    // guards the validator and the callbacks
+    mutex callbackLock;
+
+    thread worker;
+    int inotifyFd;
+    // written to wake the thread up to stop
+    int stopPipe[2];
+
+    atomic<unsigned long> reloads;
+    atomic<unsigned long> failures;
+
+    // reload - reloads one file, or all of them for a layer of -1.
+    int reload(int layer);
+
+    // run - the watcher thread, reloads a file when it is changed.
+    void run(vector<WatchedFile> files);
+};
+
+#endif /* ConfigWatcher_hpp */
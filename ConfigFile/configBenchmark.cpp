@@ -0,0 +1,340 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  configBenchmark.cpp
+//
+// Benchmark of the ConfigFile and ErrorManager calls. Each call is timed on
+// generated config files of different sizes, and the allocations are counted
+// with a replaced operator new.
+//
+// Output is JSON on stdout so two runs can be compared:
+// {"benchmark": "ConfigFile", "results": [
+//   {"operation": "getDouble", "keys": 100, "iterations": 1048576,
+//    "nsPerOp": 35.1, "allocsPerOp": 0, "bytesPerOp": 0}, ...]}
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "ConfigFile.hpp"
+#include <ErrorManager.hpp>
+
+using namespace std;
+
+// each operation is run until a batch takes this long
+#define BENCHMARK_SECONDS 0.05
+#define BENCHMARK_FILE "testConfigFiles/benchmarkConfigFile.inca"
+#define BENCHMARK_OVERLAY "testConfigFiles/benchmarkOverlay.inca"
+
+// allocations since the start of the program, the saveAsync() writer
+// thread allocates too
+static atomic<unsigned long> allocations(0);
+static atomic<unsigned long> allocatedBytes(0);
+
+void *operator new(size_t size)
+{
+    allocations++;
+    allocatedBytes += size;
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == NULL) {
+        throw bad_alloc();
+    }
+    return p;
+}
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+struct BenchmarkResult {
+    string operation;
+    int keys;
+    unsigned long iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+// keeps the compiler from removing the calls
+static volatile double sink;
+
+// measure - runs op in batches that double in size until a batch takes
+// BENCHMARK_SECONDS, the last batch is the result.
+// @param op - called with the iteration number.
+template <typename F>
+BenchmarkResult measure(const string &operation, int keys, F op)
+{
+    BenchmarkResult result;
+    result.operation = operation;
+    result.keys = keys;
+
+    // once to warm up
+    op(0);
+    for (unsigned long n = 1;; n *= 2) {
+        unsigned long startAllocations = allocations;
+        unsigned long startBytes = allocatedBytes;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (unsigned long i = 0; i < n; i++) {
+            op(i);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        if (seconds >= BENCHMARK_SECONDS || n >= (1UL << 30)) {
+            result.iterations = n;
+            result.nsPerOp = seconds * 1e9 / n;
+            result.allocsPerOp = (double)(allocations - startAllocations) / n;
+            result.bytesPerOp = (double)(allocatedBytes - startBytes) / n;
+            return result;
+        }
+    }
+}
+
+// keyName - the name of the k'th generated variable
+string keyName(int k)
+{
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "var%05d", k);
+    return buffer;
+}
+
+// writeConfig - writes a config file with keys variables, the k'th one is
+// a number, a string, a vector or a 3x3 matrix for k % 4 = 0 to 3.
+void writeConfig(const char *path, int keys)
+{
+    ofstream out(path);
+    out << "# generated by configBenchmark" << endl;
+    for (int k = 0; k < keys; k++) {
+        out << keyName(k) << " = ";
+        switch (k % 4) {
+            case 0 :
+                out << 1.5 + k;
+                break;
+            case 1 :
+                out << "value" << k;
+                break;
+            case 2 :
+                out << "[" << k << ", 0.5, -2e-6]";
+                break;
+            default:
+                out << "[1 0 0; 0 " << k << " 0; 0 0 1]";
+                break;
+        }
+        out << " # variable " << k << endl;
+    }
+}
+
+// runConfig - all of the ConfigFile calls on a config with keys variables.
+void runConfig(int keys, vector<BenchmarkResult> *results)
+{
+    writeConfig(BENCHMARK_FILE, keys);
+    ConfigFile config(BENCHMARK_FILE);
+    config.load();
+
+    // the keys of each type, so every call reads a value it can convert
+    vector<string> numbers, strings, vectors, matrices;
+    for (int k = 0; k < keys; k++) {
+        vector<string> *list[4] = {&numbers, &strings, &vectors, &matrices};
+        list[k % 4]->push_back(keyName(k));
+    }
+
+    results->push_back(measure("load", keys, [&](unsigned long) {
+        sink = config.load();
+    }));
+    results->push_back(measure("contains", keys, [&](unsigned long i) {
+        sink = config.contains(numbers[i % numbers.size()]);
+    }));
+    results->push_back(measure("getString", keys, [&](unsigned long i) {
+        string value;
+        config.getString(strings[i % strings.size()], &value);
+        sink = value.size();
+    }));
+    results->push_back(measure("getDouble", keys, [&](unsigned long i) {
+        double value;
+        config.getDouble(numbers[i % numbers.size()], &value);
+        sink = value;
+    }));
+    results->push_back(measure("getFloat", keys, [&](unsigned long i) {
+        float value;
+        config.getFloat(numbers[i % numbers.size()], &value);
+        sink = value;
+    }));
+    results->push_back(measure("getInt", keys, [&](unsigned long i) {
+        int value;
+        config.getInt(numbers[i % numbers.size()], &value);
+        sink = value;
+    }));
+    results->push_back(measure("getHex", keys, [&](unsigned long i) {
+        int value;
+        config.getHex(numbers[i % numbers.size()], &value);
+        sink = value;
+    }));
+    results->push_back(measure("getLong", keys, [&](unsigned long i) {
+        long value;
+        config.getLong(numbers[i % numbers.size()], &value);
+        sink = value;
+    }));
+    results->push_back(measure("getVec3", keys, [&](unsigned long i) {
+        double value[3];
+        config.getVec3(vectors[i % vectors.size()], value);
+        sink = value[0];
+    }));
+    results->push_back(measure("getMat3", keys, [&](unsigned long i) {
+        double value[9];
+        config.getMat3(matrices[i % matrices.size()], value);
+        sink = value[4];
+    }));
+    results->push_back(measure("getArray", keys, [&](unsigned long i) {
+        vector<double> value;
+        config.getArray(matrices[i % matrices.size()], &value);
+        sink = value[4];
+    }));
+    results->push_back(measure("getArrayData", keys, [&](unsigned long i) {
+        const double *data;
+        int rows, cols;
+        config.getArrayData(vectors[i % vectors.size()], &data, &rows, &cols);
+        sink = data[0];
+    }));
+    results->push_back(measure("getSource", keys, [&](unsigned long i) {
+        int layer;
+        config.getSource(numbers[i % numbers.size()], &layer);
+        sink = layer;
+    }));
+    results->push_back(measure("getKeys", keys, [&](unsigned long) {
+        sink = config.getKeys().size();
+    }));
+    results->push_back(measure("getLayerCount", keys, [&](unsigned long) {
+        sink = config.getLayerCount();
+    }));
+
+    results->push_back(measure("setString", keys, [&](unsigned long i) {
+        sink = config.setString(strings[i % strings.size()], "changed");
+    }));
+    results->push_back(measure("setDouble", keys, [&](unsigned long i) {
+        sink = config.setDouble(numbers[i % numbers.size()], 0.25 * i);
+    }));
+    results->push_back(measure("setInt", keys, [&](unsigned long i) {
+        sink = config.setInt(numbers[i % numbers.size()], (int)i);
+    }));
+    results->push_back(measure("setLong", keys, [&](unsigned long i) {
+        sink = config.setLong(numbers[i % numbers.size()], (long)i);
+    }));
+    double values[9] = {1, 0, 0, 0, 2, 0, 0, 0, 3};
+    results->push_back(measure("setVec3", keys, [&](unsigned long i) {
+        sink = config.setVec3(vectors[i % vectors.size()], values);
+    }));
+    results->push_back(measure("setMat3", keys, [&](unsigned long i) {
+        sink = config.setMat3(matrices[i % matrices.size()], values);
+    }));
+    results->push_back(measure("setArray", keys, [&](unsigned long i) {
+        sink = config.setArray(matrices[i % matrices.size()], values, 1, 9);
+    }));
+    results->push_back(measure("save", keys, [&](unsigned long) {
+        sink = config.save();
+    }));
+    // the time the caller waits, the writes are coalesced on the writer
+    results->push_back(measure("saveAsync", keys, [&](unsigned long) {
+        config.saveAsync(function<void(int)>());
+    }));
+    sink = config.saveAsync().get();
+    results->push_back(measure("clearSet", keys, [&](unsigned long i) {
+        config.clearSet(numbers[i % numbers.size()]);
+    }));
+
+    // an overlay with a tenth of the keys
+    writeConfig(BENCHMARK_OVERLAY, keys / 10 + 1);
+    results->push_back(measure("addOverlay", keys, [&](unsigned long) {
+        ConfigFile layered(BENCHMARK_FILE);
+        layered.load();
+        sink = layered.addOverlay(BENCHMARK_OVERLAY);
+    }));
+    config.addOverlay(BENCHMARK_OVERLAY);
+    results->push_back(measure("loadLayer", keys, [&](unsigned long) {
+        sink = config.loadLayer(1);
+    }));
+    results->push_back(measure("getDoubleOverlay", keys, [&](unsigned long i) {
+        double value;
+        config.getDouble(numbers[i % numbers.size()], &value);
+        sink = value;
+    }));
+
+    remove(BENCHMARK_FILE);
+    remove(BENCHMARK_OVERLAY);
+}
+
+// runErrorManager - the ErrorManager calls, the printed errors are dropped.
+void runErrorManager(vector<BenchmarkResult> *results)
+{
+    ostringstream dropped;
+    streambuf *coutBuffer = cout.rdbuf(dropped.rdbuf());
+    results->push_back(measure("getErrorManager", 0, [&](unsigned long) {
+        sink = ErrorManager::getErrorManager() != NULL;
+    }));
+    results->push_back(measure("ERROR", 0, [&](unsigned long i) {
+        ErrorManager::ERROR(ERROR_READING_CONFIG_FILE);
+        // keep the dropped output from growing
+        if ((i & 1023) == 0) {
+            dropped.str("");
+        }
+    }));
+    cout.rdbuf(coutBuffer);
+}
+
+int main(void) {
+    vector<BenchmarkResult> results;
+
+    int sizes[4] = {10, 100, 1000, 10000};
+    for (int k = 0; k < 4; k++) {
+        runConfig(sizes[k], &results);
+    }
+    runErrorManager(&results);
+
+    cout << "{\"benchmark\": \"ConfigFile\", \"results\": [" << endl;
+    for (size_t k = 0; k < results.size(); k++) {
+        const BenchmarkResult &r = results[k];
+        cout << "  {\"operation\": \"" << r.operation << "\", \"keys\": " << r.keys
+             << ", \"iterations\": " << r.iterations << ", \"nsPerOp\": " << r.nsPerOp
+             << ", \"allocsPerOp\": " << r.allocsPerOp << ", \"bytesPerOp\": " << r.bytesPerOp
+             << "}" << (k + 1 < results.size() ? "," : "") << endl;
+    }
+    cout << "]}" << endl;
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  configPatch.cpp
+//
+// Command line tool for config patches. It makes the patch between two
+// .inca files and prints its size next to the size of the new file, or
+// applies a patch to a file and saves it.
+//
+// Usage: ./configPatch <base.inca> <target.inca> <patch.bin>
+//        ./configPatch --apply <config.inca> <patch.bin>
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include "ConfigPatch.hpp"
+
+using namespace std;
+
+// fileSize - bytes in a file, -1 if it can not be read
+long fileSize(const char *path)
+{
+    ifstream in(path, ios::binary | ios::ate);
+    return in.is_open() ? (long)in.tellg() : -1;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        cout << "Usage: " << argv[0] << " <base.inca> <target.inca> <patch.bin>" << endl;
+        cout << "       " << argv[0] << " --apply <config.inca> <patch.bin>" << endl;
+        return -1;
+    }
+
+    if (strcmp(argv[1], "--apply") == 0) {
+        ifstream in(argv[3], ios::binary);
+        vector<uint8_t> patch((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        ConfigFile config(argv[2]);
+        if (!in.is_open() || patch.empty() || config.load() != 0 ||
+            ConfigPatch::apply(config, patch.data(), patch.size()) != 0 || config.save() != 0) {
+            return -1;
+        }
+        cout << "applied " << patch.size() << " byte patch to " << argv[2] << endl;
+        return 0;
+    }
+
+    ConfigFile base(argv[1]), target(argv[2]);
+    if (base.load() != 0 || target.load() != 0) {
+        return -1;
+    }
+    vector<uint8_t> patch;
+    vector<string> dropped;
+    int count = ConfigPatch::make(base, target, &patch, &dropped);
+    ofstream out(argv[3], ios::binary);
+    out.write((const char *)patch.data(), patch.size());
+    if (!out.good()) {
+        cout << "could not write " << argv[3] << endl;
+        return -1;
+    }
+
+    long targetSize = fileSize(argv[2]);
+    cout << count << " variables changed" << endl;
+    cout << "patch " << patch.size() << " bytes, " << argv[2] << " " << targetSize << " bytes ("
+         << 100.0 * patch.size() / targetSize << "%)" << endl;
+    for (size_t k = 0; k < dropped.size(); k++) {
+        cout << "warning: " << dropped[k] << " is not in " << argv[2]
+             << ", patches can not remove a variable" << endl;
+    }
+    return 0;
+}
@@ -24,7 +24,18 @@
 
 #include <iostream>
 #include "ConfigFile.hpp"
+#include "ConfigWatcher.hpp"
+#include "ConfigSegment.hpp"
+#include "ConfigPatch.hpp"
 #include <cstdio>
+#include <fstream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <sys/wait.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -40,6 +51,62 @@ string test4_1Values[2] = {"forty", "2"};
 string test5Keys[6] = {"var1", "var2", "hey", "neg", "negD", "n"};
 string test5Values[6] = {"helloWorld", "byeWorld", "45.95", "-2", "-2.045", "3"};
 
+#define RELOAD_FILE "testConfigFiles/reloadConfigFile.inca"
+#define BASE_FILE "testConfigFiles/baseConfigFile.inca"
+#define OVERLAY_FILE "testConfigFiles/overlayConfigFile.inca"
+#define ASYNC_FILE "testConfigFiles/asyncConfigFile.inca"
+#define PATCH_FILE "testConfigFiles/patchConfigFile.inca"
+
+// saveCount - the number of times a file of the watched directory was
+// written since the last call, save() writes a file by renaming a new one
+// over it. The events are queued by the rename, so they are all there once
+// the save returns. The moves from the temp file are watched too, inotify
+// merges an event with the one before it if they are the same.
+// @param fd - an inotify watching the directory for IN_MOVED_FROM and
+//             IN_MOVED_TO.
+// @param name - the name of the file in the directory.
+int saveCount(int fd, const string &name)
+{
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int count = 0;
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + length;) {
+            struct inotify_event *event = (struct inotify_event *)p;
+            if ((event->mask & IN_MOVED_TO) && event->len > 0 && name == event->name) {
+                count++;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    return count;
+}
+
+void writeFile(const char *path, const char *text)
+{
+    ofstream out(path);
+    out << text;
+}
+
+// waitFor - waits up to 5 s for done to be true.
+bool waitFor(function<bool()> done)
+{
+    for (int i = 0; i < 500 && !done(); i++) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return done();
+}
+
+// the gain has to be positive
+int checkGain(ConfigFile &config)
+{
+    double gain;
+    if (config.getDouble("gain", &gain) != 0 || !(gain > 0)) {
+        return -1;
+    }
+    return 0;
+}
+
 
 
 
@@ -196,6 +263,478 @@ int main(void) {
     // comment out line below to check if output is correct
     remove("testConfigFiles/newConfigFile.inca");
 
+
+    //////////////////////////////////////////// Test 6 vectors and matrices
+    ConfigFile test6("testConfigFiles/TestConfig6.inca");
+    ret = test6.load();
+    retGets = 0;
+
+    double rTarget[3], Kp[9], column[3];
+    vector<double> list;
+    vector<int> intList;
+    retGets += test6.getVec3("rTarget", rTarget);
+    retGets += test6.getMat3("Kp", Kp);
+    retGets += test6.getVec3("column", column);
+    retGets += test6.getArray("list", &list);
+    retGets += test6.getArray("list", &intList);
+
+    cout << "TEST  - [TestConfig6]" << endl;
+    if (ret == 0 && retGets == 0) { cout << "Passed - read arrays" << endl; }
+    else { cout << "Failed - read arrays" << endl; numFailed++; }
+    if (rTarget[2] == 1.0 && Kp[4] == 2e-6 && Kp[8] == 3e-6 && Kp[1] == 0.0 && column[2] == 3.0 &&
+        list.size() == 5 && list[4] == 5.0 && intList[3] == 4) {
+        cout << "Passed - array values" << endl;
+    } else {
+        cout << "Failed - array values" << endl;
+        numFailed++;
+    }
+
+    // wrong sizes and types
+    int badGets = test6.getMat3("rTarget", Kp) + test6.getVec3("list", rTarget) +
+                  test6.getVec3("name", rTarget) + test6.getVec3("missing", rTarget);
+    if (badGets == 7) { cout << "Passed - bad array gets" << endl; }
+    else { cout << "Failed - bad array gets" << endl; numFailed++; }
+
+    // rows that are not the same length do not load
+    ConfigFile test7("testConfigFiles/TestConfig7.inca");
+    if (test7.load() != 0) { cout << "Passed - [TestConfig7.inca] test" << endl; }
+    else { cout << "Failed - [TestConfig7.inca] test" << endl; numFailed++; }
+
+    // set and save, then check the values and comments survive a reload
+    {
+        ifstream in("testConfigFiles/TestConfig6.inca");
+        ofstream out("testConfigFiles/arrayConfigFile.inca");
+        out << in.rdbuf();
+    }
+    double values[9] = {0.1, -2.5e-7, 1.0 / 3.0, 4, 5, 6, 7, 8, 9};
+    ConfigFile test8("testConfigFiles/arrayConfigFile.inca");
+    ret = test8.load();
+    ret += test8.setMat3("Kp", values);
+    ret += test8.setString("rTarget", "[1 , 0 , 0]");
+    // not a valid array, so it is not set
+    ret += test8.setString("name", "[bob") + 1;
+    ret += test8.setVec3("newVector", values);
+    ret += test8.save();
+
+    ConfigFile test8_1("testConfigFiles/arrayConfigFile.inca");
+    ret += test8_1.load();
+    retGets = test8_1.getMat3("Kp", Kp) + test8_1.getVec3("rTarget", rTarget) +
+              test8_1.getVec3("newVector", column);
+    string name;
+    test8_1.getString("name", &name);
+    bool same = true;
+    for (int i = 0; i < 9; i++) {
+        if (Kp[i] != values[i]) { same = false; }
+    }
+
+    // the comments are still in the file
+    ifstream saved("testConfigFiles/arrayConfigFile.inca");
+    string savedText((istreambuf_iterator<char>(saved)), istreambuf_iterator<char>());
+    saved.close();
+    remove("testConfigFiles/arrayConfigFile.inca");
+
+    if (ret == 0 && retGets == 0 && same && rTarget[0] == 1.0 && column[2] == values[2] && name == "bob" &&
+        savedText.find("# Vectors and matrices") != string::npos &&
+        savedText.find("# unit vector") != string::npos) {
+        cout << "Passed - [TestConfig6.inca] save and reload arrays" << endl;
+    } else {
+        cout << "Failed - [TestConfig6.inca] save and reload arrays" << endl;
+        numFailed++;
+    }
+
+    //////////////////////////////////////////// Test 9 a file that does not load changes nothing
+    writeFile(RELOAD_FILE, "gain = 1\nrTarget = [0, 0, 1]\n");
+    ConfigFile test9(RELOAD_FILE);
+    ret = test9.load();
+    // the bad line is after the good ones
+    writeFile(RELOAD_FILE, "gain = 2\nrTarget = [1, 0, 0]\nbad line here\n");
+    ret += test9.load() + 1;
+    writeFile(RELOAD_FILE, "gain = -1\n");
+    ret += test9.load(checkGain) + 1;
+
+    double gain = 0;
+    retGets = test9.getDouble("gain", &gain) + test9.getVec3("rTarget", rTarget);
+    cout << "TEST  - [Reload]" << endl;
+    if (ret == 0 && retGets == 0 && gain == 1.0 && rTarget[2] == 1.0) { cout << "Passed - failed loads keep the old values" << endl; }
+    else { cout << "Failed - failed loads keep the old values" << endl; numFailed++; }
+
+    //////////////////////////////////////////// Test 10 watch the file for changes
+    ConfigWatcher watcher(test9);
+    watcher.setValidator(checkGain);
+    atomic<int> notified(0);
+    // subscribers are handed the watched config
+    watcher.subscribe([&](ConfigFile &config) { if (&config == &test9) { notified++; } });
+    ret = watcher.start();
+
+    // readers should only ever see whole tables
+    atomic<bool> reading(true);
+    atomic<int> badReads(0);
+    vector<thread> readers;
+    for (int k = 0; k < 2; k++) {
+        readers.push_back(thread([&]() {
+            while (reading) {
+                double g, r[3];
+                if (test9.getDouble("gain", &g) != 0 || !(g >= 1.0) ||
+                    test9.getVec3("rTarget", r) != 0 || r[2] != 1.0) {
+                    badReads++;
+                }
+            }
+        }));
+    }
+
+    writeFile(RELOAD_FILE, "gain = 2\nrTarget = [0, 0, 1]\n");
+    bool changed = waitFor([&]() { return notified == 1; });
+    test9.getDouble("gain", &gain);
+    if (ret == 0 && changed && gain == 2.0) { cout << "Passed - reload on write" << endl; }
+    else { cout << "Failed - reload on write" << endl; numFailed++; }
+
+    writeFile(RELOAD_FILE, "gain = 0\nrTarget = [0, 0, 1]\n");
+    bool rejected = waitFor([&]() { return watcher.getFailures() == 1; });
+    test9.getDouble("gain", &gain);
+    if (rejected && gain == 2.0 && notified == 1) { cout << "Passed - rejected reload" << endl; }
+    else { cout << "Failed - rejected reload" << endl; numFailed++; }
+
+    // save() renames over the file
+    for (int k = 3; k < 200; k++) {
+        test9.setDouble("gain", k);
+    }
+    test9.save();
+    changed = waitFor([&]() { return notified == 2; });
+    test9.getDouble("gain", &gain);
+    if (changed && gain == 199.0) { cout << "Passed - reload on save" << endl; }
+    else { cout << "Failed - reload on save" << endl; numFailed++; }
+
+    watcher.stop();
+    reading = false;
+    for (size_t k = 0; k < readers.size(); k++) {
+        readers[k].join();
+    }
+    remove(RELOAD_FILE);
+    if (badReads == 0) { cout << "Passed - reads during reloads" << endl; }
+    else { cout << "Failed - reads during reloads" << endl; numFailed++; }
+
+    //////////////////////////////////////////// Test 11 overlays
+    writeFile(BASE_FILE, "gain = 1\nrTarget = [0, 0, 1]\nname = base\nKp = [1 0 0; 0 1 0; 0 0 1]\n");
+    writeFile(OVERLAY_FILE, "gain = 2 # per unit\nrTarget = [1, 0, 0]\nunit = 7\n");
+    ConfigFile test11(BASE_FILE);
+    ret = test11.load();
+    int layer = test11.addOverlay(OVERLAY_FILE);
+    // a bad overlay is not added
+    ret += test11.addOverlay("testConfigFiles/TestConfig7.inca") + 1;
+
+    int gainLayer, nameLayer, targetLayer;
+    retGets = test11.getDouble("gain", &gain) + test11.getVec3("rTarget", rTarget) +
+              test11.getMat3("Kp", Kp) + test11.getSource("gain", &gainLayer) +
+              test11.getSource("name", &nameLayer) + test11.getSource("rTarget", &targetLayer);
+    cout << "TEST  - [Overlays]" << endl;
+    if (ret == 0 && retGets == 0 && layer == 1 && test11.getLayerCount() == 2 &&
+        test11.getLayerPath(1) == OVERLAY_FILE && gain == 2.0 && rTarget[0] == 1.0 && Kp[8] == 1.0 &&
+        gainLayer == 1 && nameLayer == 0 && targetLayer == 1) {
+        cout << "Passed - overlay values" << endl;
+    } else {
+        cout << "Failed - overlay values" << endl;
+        numFailed++;
+    }
+
+    // set values go on top of the files until they are cleared
+    double vec[3] = {0, 1, 0};
+    for (int k = 0; k < 100; k++) {
+        vec[2] = k;
+        test11.setVec3("rTarget", vec);
+    }
+    test11.setDouble("gain", 3);
+    retGets = test11.getDouble("gain", &gain) + test11.getSource("gain", &gainLayer) +
+              test11.getVec3("rTarget", rTarget);
+    test11.clearSet("gain");
+    double cleared;
+    retGets += test11.getDouble("gain", &cleared) + test11.getSource("rTarget", &targetLayer);
+    if (retGets == 0 && gain == 3.0 && gainLayer == CONFIG_LAYER_SET && cleared == 2.0 &&
+        rTarget[1] == 1.0 && rTarget[2] == 99.0 && targetLayer == CONFIG_LAYER_SET) {
+        cout << "Passed - set layer" << endl;
+    } else {
+        cout << "Failed - set layer" << endl;
+        numFailed++;
+    }
+
+    // the set map grows and drops cleared values, a batch is all or nothing
+    ConfigFile test11_2(BASE_FILE);
+    ret = test11_2.load();
+    for (int k = 0; k < 1000; k++) {
+        ret += test11_2.setInt("set" + to_string(k), k);
+    }
+    for (int k = 0; k < 1000; k += 2) {
+        test11_2.clearSet("set" + to_string(k));
+    }
+    vector<pair<string, string> > batch;
+    batch.push_back(make_pair("gain", "4"));
+    batch.push_back(make_pair("set1", "[1 2; 3 4]"));
+    batch.push_back(make_pair("set3", "-3"));
+    ret += test11_2.setValues(batch);
+    vector<pair<string, string> > badBatch(batch);
+    badBatch[0].second = "7";
+    badBatch.push_back(make_pair("set5", "[1 2; 3]"));
+    int badRet = test11_2.setValues(badBatch);
+    int set3, set999, setLayer;
+    vector<double> set1;
+    retGets = test11_2.getDouble("gain", &gain) + test11_2.getArray("set1", &set1) +
+              test11_2.getInt("set3", &set3) + test11_2.getInt("set999", &set999) +
+              test11_2.getSource("set3", &setLayer);
+    if (ret == 0 && retGets == 0 && badRet == -1 && gain == 4.0 && set1.size() == 4 && set1[3] == 4.0 &&
+        set3 == -3 && set999 == 999 && setLayer == CONFIG_LAYER_SET && !test11_2.contains("set998") &&
+        test11_2.getKeys().size() == 4 + 500) {
+        cout << "Passed - many set values" << endl;
+    } else {
+        cout << "Failed - many set values" << endl;
+        numFailed++;
+    }
+
+    // reloading the overlay falls back to the base file for what it dropped
+    test11.clearSet("rTarget");
+    writeFile(OVERLAY_FILE, "gain = 5\n");
+    ret = test11.loadLayer(1) + test11.getDouble("gain", &gain) + test11.getVec3("rTarget", rTarget) +
+          test11.getSource("rTarget", &targetLayer);
+    if (ret == 0 && gain == 5.0 && rTarget[2] == 1.0 && targetLayer == 0 && !test11.contains("unit")) {
+        cout << "Passed - reload overlay" << endl;
+    } else {
+        cout << "Failed - reload overlay" << endl;
+        numFailed++;
+    }
+
+    // a set value masks a reloaded file until the set layer is cleared
+    double masked;
+    test11.setDouble("gain", 9);
+    writeFile(OVERLAY_FILE, "gain = 6\n");
+    ret = test11.loadLayer(1) + test11.getDouble("gain", &masked);
+    test11.clearSetLayer();
+    ret += test11.getDouble("gain", &gain) + test11.getSource("gain", &gainLayer);
+    if (ret == 0 && masked == 9.0 && gain == 6.0 && gainLayer == 1) {
+        cout << "Passed - clear set layer" << endl;
+    } else {
+        cout << "Failed - clear set layer" << endl;
+        numFailed++;
+    }
+
+    // only the base file and the set values are saved
+    test11.setString("name", "saved");
+    ret = test11.save();
+    ConfigFile test11_1(BASE_FILE);
+    ret += test11_1.load() + test11_1.getString("name", &name) + test11_1.getDouble("gain", &gain);
+    remove(BASE_FILE);
+    remove(OVERLAY_FILE);
+    if (ret == 0 && name == "saved" && gain == 1.0) { cout << "Passed - save with overlays" << endl; }
+    else { cout << "Failed - save with overlays" << endl; numFailed++; }
+
+    //////////////////////////////////////////// Test 12 shared memory segment read by other processes
+    cout << "TEST  - [Shared segment]" << endl;
+    string segmentName = "/inca-config-test-" + to_string(getpid());
+    ConfigFile test12("");
+    ConfigSegment owner(segmentName);
+    ret = owner.create(1 << 16);
+    test12.setDouble("gain", 2.5);
+    test12.setString("name", "shared");
+    double kp[9] = {1, 0, 0, 0, 2, 0, 0, 0, 3};
+    test12.setMat3("Kp", kp);
+    ret += owner.publish(test12);
+
+    ConfigSegment reader(segmentName);
+    ret += reader.attach();
+    double sharedKp[9];
+    int count;
+    ret += reader.getDouble("gain", &gain) + reader.getString("name", &name) + reader.getMat3("Kp", sharedKp) +
+           reader.getInt("gain", &count);
+    if (ret == 0 && gain == 2.5 && name == "shared" && sharedKp[8] == 3.0 && count == 2 &&
+        !reader.contains("missing") && reader.getVec3("Kp", rTarget) == 2 && reader.getGeneration() == 1) {
+        cout << "Passed - attach and get" << endl;
+    } else {
+        cout << "Failed - attach and get" << endl;
+        numFailed++;
+    }
+
+    // a reader can not publish, and a config that does not fit is not published
+    ConfigSegment tiny(segmentName + "-tiny");
+    ret = tiny.create(256) + reader.publish(test12);
+    if (ret == -1 && tiny.publish(test12) == -1 && tiny.unlink() == 0) {
+        cout << "Passed - publish checks" << endl;
+    } else {
+        cout << "Failed - publish checks" << endl;
+        numFailed++;
+    }
+
+    // readers in other processes only ever see whole values while the owner
+    // keeps publishing new ones.
+    const int segmentReaders = 3;
+    const int publishes = 20000;
+    double first[3] = {0.0, 1.0, 2.0};
+    test12.setString("pair", "0,0");
+    test12.setArray("vec", first, 1, 3);
+    owner.publish(test12);
+    pid_t children[segmentReaders];
+    for (int k = 0; k < segmentReaders; k++) {
+        children[k] = fork();
+        if (children[k] == 0) {
+            ConfigSegment child(segmentName);
+            if (child.attach() != 0) {
+                _exit(2);
+            }
+            long last = 0, seen = 0;
+            while (!child.contains("done")) {
+                string pair;
+                vector<double> vec;
+                if (child.getString("pair", &pair) != 0 || child.getArray("vec", &vec) != 0 || vec.size() != 3) {
+                    _exit(3);
+                }
+                long a = 0, b = 0;
+                if (sscanf(pair.c_str(), "%ld,%ld", &a, &b) != 2 || b != 7 * a || a < last ||
+                    vec[1] != vec[0] + 1 || vec[2] != vec[0] + 2) {
+                    _exit(4);
+                }
+                seen += a != last;
+                last = a;
+            }
+            _exit(seen > 1 ? 0 : 5);
+        }
+    }
+    for (long i = 1; i <= publishes; i++) {
+        double vec[3] = {(double)i, i + 1.0, i + 2.0};
+        test12.setString("pair", to_string(i) + "," + to_string(7 * i));
+        test12.setArray("vec", vec, 1, 3);
+        owner.publish(test12);
+    }
+    test12.setString("done", "1");
+    owner.publish(test12);
+    int childrenFailed = 0;
+    for (int k = 0; k < segmentReaders; k++) {
+        int status = -1;
+        waitpid(children[k], &status, 0);
+        childrenFailed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    ret = owner.unlink();
+    if (childrenFailed == 0 && ret == 0) {
+        cout << "Passed - forked readers during republishing" << endl;
+    } else {
+        cout << "Failed - forked readers during republishing" << endl;
+        numFailed++;
+    }
+
+    //////////////////////////////////////////// Test 13 saves on the writer thread
+    cout << "TEST  - [Async save]" << endl;
+    writeFile(ASYNC_FILE, "gain = 1 # the gain\n");
+    int renames = inotify_init1(IN_NONBLOCK);
+    inotify_add_watch(renames, "testConfigFiles", IN_MOVED_FROM | IN_MOVED_TO);
+    {
+        ConfigFile test13(ASYNC_FILE);
+        test13.load();
+        test13.setSaveWindow(100);
+        vector<future<int> > saves;
+        for (int k = 0; k < 10; k++) {
+            test13.setDouble("gain", k);
+            saves.push_back(test13.saveAsync());
+        }
+        ret = 0;
+        for (size_t k = 0; k < saves.size(); k++) {
+            ret += saves[k].get();
+        }
+        ConfigFile test13_1(ASYNC_FILE);
+        ret += test13_1.load() + test13_1.getDouble("gain", &gain);
+        if (ret == 0 && gain == 9.0 && saveCount(renames, "asyncConfigFile.inca") == 1) {
+            cout << "Passed - saves in the window are written once" << endl;
+        } else {
+            cout << "Failed - saves in the window are written once" << endl;
+            numFailed++;
+        }
+        close(renames);
+
+        // the saves still waiting are written when the config goes away
+        test13.setSaveWindow(60000);
+        test13.setString("name", "flushed");
+        test13.saveAsync([&](int result) { ret = result + 1; });
+    }
+    ConfigFile test13_2(ASYNC_FILE);
+    ret += test13_2.load() + test13_2.getString("name", &name);
+    remove(ASYNC_FILE);
+    if (ret == 1 && name == "flushed") { cout << "Passed - waiting saves written on exit" << endl; }
+    else { cout << "Failed - waiting saves written on exit" << endl; numFailed++; }
+
+    // a save that can not be written reports the failure
+    ConfigFile test13_3("testConfigFiles/missingDirectory/config.inca");
+    test13_3.setSaveWindow(0);
+    test13_3.setDouble("gain", 1.0);
+    if (test13_3.saveAsync().get() == -1) { cout << "Passed - failed async save" << endl; }
+    else { cout << "Failed - failed async save" << endl; numFailed++; }
+
+    //////////////////////////////////////////// Test 14 binary patches
+    cout << "TEST  - [Patches]" << endl;
+    writeFile(PATCH_FILE,
+              "# controller gains\n"
+              "Kp = [0.002, 0, 0; 0, 0.002, 0; 0, 0, 0.002]\n"
+              "Kd = [0.01, 0, 0; 0, 0.01, 0; 0, 0, 0.01]\n"
+              "rTarget = [0, 0, 1]\n"
+              "mode = detumble\n"
+              "period = 10\n");
+    ConfigFile test14(PATCH_FILE);
+    ConfigFile test14_1(PATCH_FILE);
+    ret = test14.load() + test14_1.load();
+    double patchKp[9] = {0.0025, 0, 0, 0, 0.0025, 0, 0, 0, 0.0031};
+    double patchTarget[3] = {0, 1, 0};
+    ret += test14_1.setMat3("Kp", patchKp) + test14_1.setVec3("rTarget", patchTarget);
+    ret += test14_1.setInt("period", -5) + test14_1.setString("newMode", "pointing");
+
+    vector<uint8_t> patch;
+    int patchChanged = ConfigPatch::make(test14, test14_1, &patch);
+    ifstream patchFile(PATCH_FILE, ios::ate);
+    cout << "patch " << patch.size() << " bytes, file " << patchFile.tellg() << " bytes" << endl;
+
+    uint64_t baseVersion = ConfigPatch::version(test14);
+    ret += ConfigPatch::apply(test14, &patch[0], patch.size());
+    int period = 0;
+    ret += test14.getInt("period", &period) + test14.getString("newMode", &name);
+    if (ret == 0 && patchChanged == 4 && period == -5 && name == "pointing" &&
+        ConfigPatch::version(test14) == ConfigPatch::version(test14_1)) {
+        cout << "Passed - patch makes the target" << endl;
+    } else {
+        cout << "Failed - patch makes the target" << endl;
+        numFailed++;
+    }
+
+    // sending it again is harmless
+    if (ConfigPatch::apply(test14, &patch[0], patch.size()) == 0 &&
+        ConfigPatch::version(test14) == ConfigPatch::version(test14_1)) {
+        cout << "Passed - patch applied twice" << endl;
+    } else {
+        cout << "Failed - patch applied twice" << endl;
+        numFailed++;
+    }
+
+    // a config at another version is not changed
+    ConfigFile test14_2(PATCH_FILE);
+    ret = test14_2.load() + test14_2.setDouble("period", 20);
+    uint64_t otherVersion = ConfigPatch::version(test14_2);
+    ret += ConfigPatch::apply(test14_2, &patch[0], patch.size()) + 1;
+    if (ret == 0 && ConfigPatch::version(test14_2) == otherVersion) {
+        cout << "Passed - wrong base version rejected" << endl;
+    } else {
+        cout << "Failed - wrong base version rejected" << endl;
+        numFailed++;
+    }
+
+    // every corrupted byte and every cut is caught
+    ConfigFile test14_3(PATCH_FILE);
+    ret = test14_3.load();
+    int accepted = 0;
+    for (size_t k = 0; k < patch.size(); k++) {
+        vector<uint8_t> bad = patch;
+        bad[k] ^= 0x5a;
+        accepted += ConfigPatch::apply(test14_3, &bad[0], bad.size()) == 0;
+        accepted += ConfigPatch::apply(test14_3, &patch[0], k) == 0;
+    }
+    remove(PATCH_FILE);
+    if (ret == 0 && accepted == 0 && ConfigPatch::version(test14_3) == baseVersion) {
+        cout << "Passed - corrupted patches rejected" << endl;
+    } else {
+        cout << "Failed - corrupted patches rejected" << endl;
+        numFailed++;
+    }
+
     ////////////////////////////////////////// Print tests results
     if (numFailed == 0) {
         cout << "ALL ConfigFile TESTS PASSED!" << endl;
@@ -23,6 +23,9 @@
 
 #include "ErrorManager.hpp"
 
+// for INSTRUMENT_TIMER
+#include <Instrumentation.hpp>
+
 // manager instance for error handler, for singleton class.
 static ErrorManager *managerInstance;
 
@@ -40,6 +43,7 @@ ErrorManager *ErrorManager::getErrorManager() {
 
 // a simple function for telling to log an error.
 void ErrorManager::ERROR(int errorType) {
+    INSTRUMENT_TIMER("ErrorManager::ERROR");
     ErrorManager::getErrorManager()->error(errorType);
 }
 
@@ -108,6 +108,18 @@ private:
 // completly non-critcal error
 #define CONFIG_FILE_SAVE_FOUND_BAD_LINE_IGNORING 19
 #define CONFIG_FILE_FAILED_TO_RENAME_FILE 20
+// a bracketed array value could not be parsed, or is not the size asked for.
+#define CONFIG_FILE_READ_ARRAY_INVALID_VALUE 21
+#define CONFIG_FILE_READ_ARRAY_WRONG_SIZE 22
+// the config file could not be watched for changes.
+#define CONFIG_FILE_WATCH_FAILED 23
+// the shared config segment could not be created or attached, or the config
+// did not fit in it.
+#define CONFIG_SEGMENT_FAILED 24
+// a config patch is corrupt or names a variable the config does not have.
+#define CONFIG_PATCH_INVALID 35
+// a config patch was made for another version of the config.
+#define CONFIG_PATCH_VERSION_MISMATCH 36
 
 // non-critcal error.
 #define ADACS_ADC_FAILED_VOLTAGE_READ 25
@@ -192,6 +204,77 @@ private:
 
 
 
+/////////////////////////////// ADACS errors
+
+// Non-critical error, the inertia matrix given to the state model is singular.
+#define ADACS_STATE_MODEL_SINGULAR_INERTIA 600
+// Non-critical error, the kalman filter was given a bad set of measurements.
+#define KALMAN_FILTER_BAD_MEASUREMENT 601
+// Non-critical error, innovation covariance not positive, the update was skipped.
+#define KALMAN_FILTER_UPDATE_FAILED 602
+// Non-critical error, a covariance given to the filter is not positive semidefinite.
+#define KALMAN_FILTER_BAD_COVARIANCE 603
+
+// Non-critical error, a sensor sample was dropped because the pipeline queue was full.
+#define SENSOR_PIPELINE_QUEUE_FULL 610
+// critical error, the sensor pipeline could not start its threads.
+#define SENSOR_PIPELINE_FAILED_TO_START_THREAD 611
+// Non-critical error, programming error, too many sensors added to the pipeline.
+#define SENSOR_PIPELINE_TOO_MANY_SENSORS 612
+// Non-critical error, a sensor replay file could not be opened.
+#define SENSOR_REPLAY_FILE_FAILED_TO_OPEN 613
+
+// Non-critical error, a control loop cycle ran past its deadline.
+#define ADACS_CONTROL_LOOP_DEADLINE_OVERRUN 620
+// Non-critical error, the control loop could not be pinned to its cpu.
+#define ADACS_CONTROL_LOOP_FAILED_TO_SET_AFFINITY 621
+// Non-critical error, the control loop could not be set to SCHED_FIFO.
+#define ADACS_CONTROL_LOOP_FAILED_TO_SET_PRIORITY 622
+// critical error, the control loop thread failed to start.
+#define ADACS_CONTROL_LOOP_FAILED_TO_START 623
+// Non-critical error, a control loop stage returned a failure.
+#define ADACS_CONTROL_LOOP_STAGE_FAILED 624
+
+// Non-critical error, the attitude simulation exceeded its permitted state.
+#define ADACS_SIMULATOR_DIVERGED 630
+// Non-critical error, a simulation checkpoint could not be written.
+#define ADACS_SIMULATOR_CHECKPOINT_WRITE_FAILED 631
+// Non-critical error, a simulation checkpoint could not be read.
+#define ADACS_SIMULATOR_CHECKPOINT_READ_FAILED 632
+// Non-critical error, a simulation checkpoint is corrupt or from another version.
+#define ADACS_SIMULATOR_CHECKPOINT_INVALID 633
+// Non-critical error, the gain optimizer was given a search space with no gains enabled.
+#define ADACS_OPTIMIZER_EMPTY_SEARCH_SPACE 634
+
+// Non-critical error, a scenario file has a bad sweep value.
+#define ADACS_SCENARIO_BAD_SWEEP 640
+// Non-critical error, the batch runner could not write the results table.
+#define ADACS_BATCH_RESULTS_WRITE_FAILED 641
+
+// Non-critical error, a telemetry frame did not fit in the buffer given.
+#define ADACS_TELEMETRY_BUFFER_TOO_SMALL 650
+// Non-critical error, a telemetry frame is corrupt, out of order or has too many values.
+#define ADACS_TELEMETRY_BAD_FRAME 651
+
+// Non-critical error, a trajectory, channel or summary file could not be written.
+#define ADACS_TRAJECTORY_WRITE_FAILED 660
+// Non-critical error, a trajectory file could not be read.
+#define ADACS_TRAJECTORY_READ_FAILED 661
+// Non-critical error, a trajectory file is truncated, corrupt or from another version.
+#define ADACS_TRAJECTORY_INVALID 662
+
+// Non-critical error, a regression golden output or baseline could not be written.
+#define ADACS_REGRESSION_GOLDEN_WRITE_FAILED 670
+// Non-critical error, a regression golden output or baseline is missing or corrupt.
+#define ADACS_REGRESSION_GOLDEN_READ_FAILED 671
+// Non-critical error, the regression report could not be written.
+#define ADACS_REGRESSION_REPORT_WRITE_FAILED 672
+// Non-critical error, a regression scenario could not be run in a child process.
+#define ADACS_REGRESSION_CHILD_FAILED 673
+
+
+
+
 //////////////////////////////// GPIO errors
 
 // Non critical errors.
@@ -0,0 +1,315 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Instrumentation.cpp
+//
+// Timers, counters and value histograms for profiling the flight software.
+
+#include "Instrumentation.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+// the totals of one probe in one thread
+struct ProbeData {
+    atomic<uint64_t> count;
+    atomic<uint64_t> total;
+    atomic<uint64_t> min;
+    atomic<uint64_t> max;
+    atomic<uint64_t> buckets[INSTRUMENTATION_BUCKETS];
+};
+
+// the probes of one thread. Only that thread writes to it, the atomics are
+// there so report() can read it at the same time.
+struct ThreadBuffer {
+    ProbeData probes[INSTRUMENTATION_MAX_PROBES];
+    // a thread is using it, guarded by the registry lock
+    bool inUse;
+};
+
+// every probe name and every thread buffer. The buffers are never freed,
+// the buffer of a thread that exits is given to the next new thread, so
+// its totals are kept.
+struct Registry {
+    mutex lock;
+    vector<ThreadBuffer *> buffers;
+    string names[INSTRUMENTATION_MAX_PROBES];
+    int types[INSTRUMENTATION_MAX_PROBES];
+    int probeCount;
+
+    Registry() : probeCount(0) {}
+};
+
+static Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+// clearBuffer - zeros every probe of a buffer.
+static void clearBuffer(ThreadBuffer *buffer)
+{
+    for (int p = 0; p < INSTRUMENTATION_MAX_PROBES; p++) {
+        ProbeData &data = buffer->probes[p];
+        data.count.store(0, memory_order_relaxed);
+        data.total.store(0, memory_order_relaxed);
+        data.min.store(UINT64_MAX, memory_order_relaxed);
+        data.max.store(0, memory_order_relaxed);
+        for (int b = 0; b < INSTRUMENTATION_BUCKETS; b++) {
+            data.buckets[b].store(0, memory_order_relaxed);
+        }
+    }
+}
+
+// the buffer of this thread, NULL until the first probe runs
+static thread_local ThreadBuffer *threadBuffer = NULL;
+
+// gives the buffer back when the thread exits
+struct BufferRelease {
+    ~BufferRelease()
+    {
+        Registry &r = registry();
+        lock_guard<mutex> lock(r.lock);
+        if (threadBuffer != NULL) {
+            threadBuffer->inUse = false;
+            threadBuffer = NULL;
+        }
+    }
+};
+
+// acquireBuffer - finds a free buffer or makes a new one for this thread.
+static ThreadBuffer *acquireBuffer()
+{
+    static thread_local BufferRelease release;
+    (void)release;
+
+    Registry &r = registry();
+    lock_guard<mutex> lock(r.lock);
+    for (size_t k = 0; k < r.buffers.size(); k++) {
+        if (!r.buffers[k]->inUse) {
+            r.buffers[k]->inUse = true;
+            threadBuffer = r.buffers[k];
+            return threadBuffer;
+        }
+    }
+    ThreadBuffer *buffer = new ThreadBuffer();
+    clearBuffer(buffer);
+    buffer->inUse = true;
+    r.buffers.push_back(buffer);
+    threadBuffer = buffer;
+    return buffer;
+}
+
+static inline ProbeData &probeData(int probe)
+{
+    ThreadBuffer *buffer = threadBuffer;
+    if (buffer == NULL) {
+        buffer = acquireBuffer();
+    }
+    return buffer->probes[probe];
+}
+
+// bump - adds to a value only this thread writes, without a locked add.
+static inline void bump(atomic<uint64_t> &value, uint64_t n)
+{
+    value.store(value.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// bucketIndex - the bucket of a value, 4 linear buckets per power of 2.
+static inline int bucketIndex(uint64_t value)
+{
+    if (value < INSTRUMENTATION_SUB_BUCKETS) {
+        return (int)value;
+    }
+    int power = 63 - __builtin_clzll(value);
+    int sub = (int)(value >> (power - 2)) & (INSTRUMENTATION_SUB_BUCKETS - 1);
+    return INSTRUMENTATION_SUB_BUCKETS * (power - 1) + sub;
+}
+
+// bucketUpper - the largest value in a bucket.
+static uint64_t bucketUpper(int index)
+{
+    if (index < INSTRUMENTATION_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    int power = index / INSTRUMENTATION_SUB_BUCKETS + 1;
+    uint64_t sub = (uint64_t)(index % INSTRUMENTATION_SUB_BUCKETS);
+    uint64_t width = 1ULL << (power - 2);
+    return (INSTRUMENTATION_SUB_BUCKETS + sub) * width + (width - 1);
+}
+
+// registerProbe - finds or adds the probe with the given name.
+// @return - the probe id, -1 if there are already
+//           INSTRUMENTATION_MAX_PROBES probes.
+int Instrumentation::registerProbe(const char *name, int type)
+{
+    Registry &r = registry();
+    lock_guard<mutex> lock(r.lock);
+    for (int p = 0; p < r.probeCount; p++) {
+        if (r.names[p] == name) {
+            return p;
+        }
+    }
+    if (r.probeCount == INSTRUMENTATION_MAX_PROBES) {
+        return -1;
+    }
+    r.names[r.probeCount] = name;
+    r.types[r.probeCount] = type;
+    return r.probeCount++;
+}
+
+// add - adds n to a counter.
+void Instrumentation::add(int probe, uint64_t n)
+{
+    if (probe < 0) {
+        return;
+    }
+    ProbeData &data = probeData(probe);
+    bump(data.count, 1);
+    bump(data.total, n);
+}
+
+// record - adds a value to the histogram of a timer or value probe.
+void Instrumentation::record(int probe, uint64_t value)
+{
+    if (probe < 0) {
+        return;
+    }
+    ProbeData &data = probeData(probe);
+    bump(data.count, 1);
+    bump(data.total, value);
+    if (value < data.min.load(memory_order_relaxed)) {
+        data.min.store(value, memory_order_relaxed);
+    }
+    if (value > data.max.load(memory_order_relaxed)) {
+        data.max.store(value, memory_order_relaxed);
+    }
+    bump(data.buckets[bucketIndex(value)], 1);
+}
+
+// ticksPerNs - the rate of ticks(), measured the first time it is called.
+double Instrumentation::ticksPerNs()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    static double rate = 0.0;
+    static once_flag measured;
+    call_once(measured, []() {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        uint64_t startTicks = ticks();
+        this_thread::sleep_for(chrono::milliseconds(20));
+        uint64_t endTicks = ticks();
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        rate = (double)(endTicks - startTicks) / ns;
+    });
+    return rate;
+#else
+    return 1.0;
+#endif
+}
+
+// report - the totals of every probe that has run.
+void Instrumentation::report(vector<ProbeReport> *reports)
+{
+    double nsPerTick = 1.0 / ticksPerNs();
+    reports->clear();
+
+    Registry &r = registry();
+    lock_guard<mutex> lock(r.lock);
+    for (int p = 0; p < r.probeCount; p++) {
+        uint64_t count = 0;
+        uint64_t total = 0;
+        uint64_t min = UINT64_MAX;
+        uint64_t max = 0;
+        vector<uint64_t> buckets(INSTRUMENTATION_BUCKETS, 0);
+        for (size_t k = 0; k < r.buffers.size(); k++) {
+            const ProbeData &data = r.buffers[k]->probes[p];
+            count += data.count.load(memory_order_relaxed);
+            total += data.total.load(memory_order_relaxed);
+            min = std::min(min, data.min.load(memory_order_relaxed));
+            max = std::max(max, data.max.load(memory_order_relaxed));
+            for (int b = 0; b < INSTRUMENTATION_BUCKETS; b++) {
+                buckets[b] += data.buckets[b].load(memory_order_relaxed);
+            }
+        }
+        if (count == 0) {
+            continue;
+        }
+
+        ProbeReport report;
+        report.name = r.names[p];
+        report.type = r.types[p];
+        report.count = count;
+        double scale = report.type == PROBE_TIMER ? nsPerTick : 1.0;
+        report.total = (double)total * (report.type == PROBE_COUNTER ? 1.0 : scale);
+        report.mean = report.total / (double)count;
+        if (report.type == PROBE_COUNTER) {
+            report.min = report.max = report.p50 = report.p99 = 0.0;
+        } else {
+            report.min = (double)min * scale;
+            report.max = (double)max * scale;
+            // the upper bound of the bucket holding each percentile
+            double percentiles[2] = {0.50, 0.99};
+            double *results[2] = {&report.p50, &report.p99};
+            for (int q = 0; q < 2; q++) {
+                uint64_t target = (uint64_t)(percentiles[q] * (double)count);
+                uint64_t seen = 0;
+                int b = 0;
+                for (; b < INSTRUMENTATION_BUCKETS - 1; b++) {
+                    seen += buckets[b];
+                    if (seen > target) {
+                        break;
+                    }
+                }
+                *results[q] = (double)std::min(bucketUpper(b), max) * scale;
+            }
+        }
+        reports->push_back(report);
+    }
+}
+
+// print - outputs one line for each probe that has run.
+void Instrumentation::print(ostream &out)
+{
+    vector<ProbeReport> reports;
+    report(&reports);
+    for (size_t k = 0; k < reports.size(); k++) {
+        const ProbeReport &r = reports[k];
+        out << r.name << ": count = " << r.count;
+        if (r.type == PROBE_COUNTER) {
+            out << " total = " << r.total << endl;
+            continue;
+        }
+        out << " min = " << r.min << " mean = " << r.mean << " p50 = " << r.p50
+            << " p99 = " << r.p99 << " max = " << r.max
+            << (r.type == PROBE_TIMER ? " (ns)" : "") << endl;
+    }
+}
+
+// reset - clears every probe, the names are kept.
+// Not safe to call while other threads are recording.
+void Instrumentation::reset()
+{
+    Registry &r = registry();
+    lock_guard<mutex> lock(r.lock);
+    for (size_t k = 0; k < r.buffers.size(); k++) {
+        clearBuffer(r.buffers[k]);
+    }
+}
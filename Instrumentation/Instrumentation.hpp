@@ -0,0 +1,171 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  Instrumentation.hpp
+//
+// Timers, counters and value histograms for profiling the flight software
+// while it runs. Each thread records into a buffer of its own with plain
+// relaxed loads and stores, so a probe never takes a lock or shares a cache
+// line with another thread. report() adds up the buffers of every thread
+// when it is asked for.
+//
+// A probe is named where it is used, the name is registered the first time
+// the line runs. Probes with the same name share their totals.
+//
+//  INSTRUMENT_TIMER(name) - times from here to the end of the scope
+//  INSTRUMENT_COUNT(name, n) - adds n to a counter
+//  INSTRUMENT_VALUE(name, v) - adds v to a histogram
+//
+// Timers read the time stamp counter on x86 and CLOCK_MONOTONIC elsewhere,
+// the ticks are changed to ns in report(). Building with
+// -DINSTRUMENTATION_DISABLED removes every probe.
+//
+// Example code for use is shown below:
+//
+// int ConfigFile::load() {
+//     INSTRUMENT_TIMER("ConfigFile::load");
+//     ...
+// }
+// ...
+// Instrumentation::print();
+
+#ifndef Instrumentation_hpp
+#define Instrumentation_hpp
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+// for clock_gettime
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+#define PROBE_TIMER 0
+#define PROBE_COUNTER 1
+#define PROBE_VALUE 2
+
+#define INSTRUMENTATION_MAX_PROBES 64
+// values below 4 get their own bucket, then every power of 2 is split in 4
+#define INSTRUMENTATION_SUB_BUCKETS 4
+#define INSTRUMENTATION_BUCKETS 252
+
+// the totals of one probe over every thread
+struct ProbeReport {
+    string name;
+    int type;
+    // number of times the probe ran, and the sum of the values (the sum of
+    // n for a counter)
+    uint64_t count;
+    double total;
+    // values for timers and histograms, ns for timers
+    double min;
+    double max;
+    double mean;
+    double p50;
+    double p99;
+};
+
+class Instrumentation {
+public:
+    // registerProbe - finds or adds the probe with the given name.
+    // @return - the probe id, -1 if there are already
+    //           INSTRUMENTATION_MAX_PROBES probes.
+    static int registerProbe(const char *name, int type);
+
+    // add - adds n to a counter.
+    static void add(int probe, uint64_t n);
+    // record - adds a value to the histogram of a timer or value probe.
+    static void record(int probe, uint64_t value);
+
+    // ticks - the timer clock, the time stamp counter on x86 and
+    // CLOCK_MONOTONIC (ns) elsewhere.
+    static inline uint64_t ticks()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+    }
+
+    // ticksPerNs - the rate of ticks(), measured the first time it is called.
+    static double ticksPerNs();
+
+    // report - the totals of every probe that has run.
+    static void report(vector<ProbeReport> *reports);
+
+    // print - outputs one line for each probe that has run.
+    static void print(ostream &out = cout);
+
+    // reset - clears every probe, the names are kept.
+    // Not safe to call while other threads are recording.
+    static void reset();
+};
+
+// ScopedTimer - records the ticks between its constructor and destructor.
+class ScopedTimer {
+public:
+    ScopedTimer(int probe) : probe(probe), start(Instrumentation::ticks()) {}
+    ~ScopedTimer() { Instrumentation::record(probe, Instrumentation::ticks() - start); }
+private:
+    int probe;
+    uint64_t start;
+
+    ScopedTimer(const ScopedTimer &);
+    ScopedTimer &operator=(const ScopedTimer &);
+};
+
+#define INSTRUMENT_JOIN2(a, b) a##b
+#define INSTRUMENT_JOIN(a, b) INSTRUMENT_JOIN2(a, b)
+
+#ifndef INSTRUMENTATION_DISABLED
+
+#define INSTRUMENT_TIMER(name) \
+    static const int INSTRUMENT_JOIN(instrumentProbe, __LINE__) = \
+        Instrumentation::registerProbe(name, PROBE_TIMER); \
+    ScopedTimer INSTRUMENT_JOIN(instrumentTimer, __LINE__)(INSTRUMENT_JOIN(instrumentProbe, __LINE__))
+
+#define INSTRUMENT_COUNT(name, n) \
+    do { \
+        static const int instrumentProbe = Instrumentation::registerProbe(name, PROBE_COUNTER); \
+        Instrumentation::add(instrumentProbe, n); \
+    } while (0)
+
+#define INSTRUMENT_VALUE(name, v) \
+    do { \
+        static const int instrumentProbe = Instrumentation::registerProbe(name, PROBE_VALUE); \
+        Instrumentation::record(instrumentProbe, v); \
+    } while (0)
+
+#else
+
+#define INSTRUMENT_TIMER(name) ((void)0)
+#define INSTRUMENT_COUNT(name, n) ((void)0)
+#define INSTRUMENT_VALUE(name, v) ((void)0)
+
+#endif
+
+#endif /* Instrumentation_hpp */
@@ -0,0 +1,212 @@
+// Copyright © 2019 New Mexico State Univeristy
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the “Software”), to deal in
+// the Software without restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+// Software, and to permit persons to whom the Software is furnished to
+// do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+//  instrumentationTest.cpp
+//
+// This is the set of test code for the Instrumentation probes.
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include "Instrumentation.hpp"
+
+using namespace std;
+
+#define OVERHEAD_ITERATIONS 1000000
+// the overhead is the fastest of this many rounds, so a round the VM or
+// another process slowed down doesn't count
+#define OVERHEAD_ROUNDS 20
+// the budget of the probe bookkeeping (ns), a timer may also take the time
+// of its two ticks() reads
+#define OVERHEAD_BUDGET_NS 20.0
+
+// findReport - the report with the given name, NULL if it did not run.
+const ProbeReport *findReport(const vector<ProbeReport> &reports, const string &name)
+{
+    for (size_t k = 0; k < reports.size(); k++) {
+        if (reports[k].name == name) {
+            return &reports[k];
+        }
+    }
+    return NULL;
+}
+
+void countFromOtherSite(int n)
+{
+    INSTRUMENT_COUNT("test::count", n);
+}
+
+void sleepTimed()
+{
+    INSTRUMENT_TIMER("test::sleep");
+    this_thread::sleep_for(chrono::milliseconds(2));
+}
+
+void timerLoop(int n)
+{
+    for (int i = 0; i < n; i++) {
+        INSTRUMENT_TIMER("test::overhead");
+    }
+}
+
+void counterLoop(int n)
+{
+    for (int i = 0; i < n; i++) {
+        INSTRUMENT_COUNT("test::overheadCount", 1);
+    }
+}
+
+void valueLoop(int n)
+{
+    for (int i = 0; i < n; i++) {
+        INSTRUMENT_VALUE("test::overheadValue", i & 1023);
+    }
+}
+
+volatile uint64_t ticksSink;
+
+void ticksLoop(int n)
+{
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += Instrumentation::ticks();
+    }
+    ticksSink = sum;
+}
+
+// overheadNs - time of one iteration of loop (ns), the fastest round of
+// OVERHEAD_ROUNDS.
+double overheadNs(void (*loop)(int))
+{
+    const int n = OVERHEAD_ITERATIONS / OVERHEAD_ROUNDS;
+    double best = 1e300;
+    for (int round = 0; round < OVERHEAD_ROUNDS; round++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        loop(n);
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / n;
+        best = fmin(best, ns);
+    }
+    return best;
+}
+
+int main(void) {
+    int numFailed = 0;
+
+    /////////////////////////////////////////// Test 1 - counters, values and timers
+    for (int i = 0; i < 10; i++) {
+        INSTRUMENT_COUNT("test::count", 3);
+    }
+    // the same name in another place adds to the same counter
+    countFromOtherSite(5);
+    for (int v = 1; v <= 1000; v++) {
+        INSTRUMENT_VALUE("test::value", v);
+    }
+    for (int i = 0; i < 5; i++) {
+        sleepTimed();
+    }
+
+    vector<ProbeReport> reports;
+    Instrumentation::report(&reports);
+    const ProbeReport *count = findReport(reports, "test::count");
+    const ProbeReport *value = findReport(reports, "test::value");
+    const ProbeReport *timer = findReport(reports, "test::sleep");
+
+    cout << "TEST  - [Probes]" << endl;
+    Instrumentation::print();
+    if (count != NULL && count->count == 11 && count->total == 35.0 && count->type == PROBE_COUNTER) {
+        cout << "Passed - counter" << endl;
+    } else {
+        cout << "Failed - counter" << endl;
+        numFailed++;
+    }
+    // the percentiles are the top of a bucket, within 25% of the real value
+    if (value != NULL && value->count == 1000 && value->min == 1.0 && value->max == 1000.0 &&
+        value->mean == 500.5 && fabs(value->p50 - 500.0) < 125.0 && fabs(value->p99 - 990.0) < 250.0) {
+        cout << "Passed - value histogram" << endl;
+    } else {
+        cout << "Failed - value histogram" << endl;
+        numFailed++;
+    }
+    if (timer != NULL && timer->count == 5 && timer->min > 1.5e6 && timer->mean < 100e6) {
+        cout << "Passed - timer" << endl;
+    } else {
+        cout << "Failed - timer" << endl;
+        numFailed++;
+    }
+
+    /////////////////////////////////////////// Test 2 - threads
+    Instrumentation::reset();
+    for (int round = 0; round < 3; round++) {
+        vector<thread> threads;
+        for (int k = 0; k < 4; k++) {
+            threads.push_back(thread([]() {
+                for (int i = 0; i < 100000; i++) {
+                    INSTRUMENT_COUNT("test::threads", 1);
+                }
+            }));
+        }
+        for (size_t k = 0; k < threads.size(); k++) {
+            threads[k].join();
+        }
+    }
+    Instrumentation::report(&reports);
+    count = findReport(reports, "test::threads");
+    // only the new probe ran since the reset
+    if (count != NULL && count->count == 1200000 && reports.size() == 1) {
+        cout << "Passed - threads and reset" << endl;
+    } else {
+        cout << "Failed - threads and reset" << endl;
+        numFailed++;
+    }
+
+    /////////////////////////////////////////// Test 3 - overhead of the probes
+    double timerNs = overheadNs(timerLoop);
+    double counterNs = overheadNs(counterLoop);
+    double valueNs = overheadNs(valueLoop);
+    double ticksNs = overheadNs(ticksLoop);
+    cout << "probe overhead: timer = " << timerNs << " ns, counter = " << counterNs
+         << " ns, value = " << valueNs << " ns, ticks() = " << ticksNs << " ns" << endl;
+    Instrumentation::report(&reports);
+    timer = findReport(reports, "test::overhead");
+    if (timer != NULL && timer->count == OVERHEAD_ITERATIONS &&
+        timerNs < OVERHEAD_BUDGET_NS + 2 * ticksNs) {
+        cout << "Passed - timer overhead" << endl;
+    } else {
+        cout << "Failed - timer overhead" << endl;
+        numFailed++;
+    }
+    if (counterNs < OVERHEAD_BUDGET_NS && valueNs < OVERHEAD_BUDGET_NS) {
+        cout << "Passed - counter and value overhead" << endl;
+    } else {
+        cout << "Failed - counter and value overhead" << endl;
+        numFailed++;
+    }
+
+    ////////////////////////////////////////// Print tests results
+    if (numFailed == 0) {
+        cout << "ALL Instrumentation TESTS PASSED!" << endl;
+        return 0;
+    }
+    else {
+        cout << "FAILED - Failed " << numFailed << " Instrumentation Test Failed..." << endl;
+        return -numFailed;
+    }
+}